@@ -15,14 +15,78 @@ uniform vec3 lightPosition;         //Position of the light in camera coordinate
 
 uniform bool useDiffuse;
 uniform bool useNormal;
+uniform bool useParallax; //Parallax occlusion mapping of the displacement instead of moving the vertices in bump.vert
 
 uniform sampler2D diffuseTexture;
 uniform sampler2D normalTexture;
+uniform sampler2D displacementTexture;
+
+uniform samplerBuffer pointLights;  //Two texels per point light: position in camera coordinates and radius, color (see PointLights)
+uniform int pointLightCount;        //Number of point lights, 0 if there are none
+
+// clustered lighting, see lambert.frag
+uniform bool useClusters;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterLightIndices;
+uniform vec2 clusterTileSize;
+uniform vec2 clusterDepth;
+uniform ivec3 clusterCount;
 
 out vec4 color; // output color
 
+// parallax occlusion mapping: bump.vert moves a vertex by the displacement value (0 to 1) times this along
+// its normal. The sphere is drawn at the largest displacement, the relief lies below it.
+const float displacementScale = 1.0;
+const float parallaxMinSteps = 8.0;            // steps when looking straight at the surface
+const float parallaxMaxSteps = 32.0;           // steps at grazing angles
+const float parallaxFullDetailDistance = 15.0; // beyond it the steps halve with every doubling of the distance
+
+// Follows the view ray below the surface in steps until it is under the displacement and returns the
+// texture coordinate where it hits the relief, interpolated between the last two steps.
+vec2 parallaxTexCoord(vec2 texCoord, vec3 n) {
+	// gradients of the texture coordinates in the plane of the surface, from the screen space derivatives
+	vec3 dp1 = dFdx(vPos);
+	vec3 dp2 = dFdy(vPos);
+	vec2 duv1 = dFdx(texCoord);
+	vec2 duv2 = dFdy(texCoord);
+	vec3 dp2perp = cross(dp2, n);
+	vec3 dp1perp = cross(n, dp1);
+	float det = dot(dp1, dp2perp);
+	if (abs(det) < 1e-12) {
+		return texCoord;
+	}
+	vec3 gradientU = (dp2perp * duv1.x + dp1perp * duv2.x) / det;
+	vec3 gradientV = (dp2perp * duv1.y + dp1perp * duv2.y) / det;
+
+	// change of the texture coordinates per unit of depth below the surface, along the view ray
+	vec3 ray = normalize(vPos);
+	float cosine = max(dot(-ray, n), 0.05);
+	vec2 perDepth = vec2(dot(gradientU, ray), dot(gradientV, ray)) * (displacementScale / cosine);
+
+	// more steps at grazing angles, where the ray passes more texels, and fewer far away
+	float steps = mix(parallaxMaxSteps, parallaxMinSteps, cosine) * clamp(parallaxFullDetailDistance / length(vPos), 0.25, 1.0);
+	int stepCount = int(ceil(max(steps, 0.5 * parallaxMinSteps)));
+	float layer = 1.0 / float(stepCount);
+	vec2 delta = perDepth * layer;
+
+	// the loop runs a different number of steps per fragment, so the derivatives are taken outside of it
+	float depth = 0.0;
+	float surface = 1.0 - textureGrad(displacementTexture, texCoord, duv1, duv2).r;
+	vec2 current = texCoord;
+	for (int i = 0; i < stepCount && depth < surface; ++i) {
+		current += delta;
+		depth += layer;
+		surface = 1.0 - textureGrad(displacementTexture, current, duv1, duv2).r;
+	}
+	float after = surface - depth;
+	float before = 1.0 - textureGrad(displacementTexture, current - delta, duv1, duv2).r - (depth - layer);
+	float weight = depth > 0.0 ? after / (after - before) : 0.0;
+	return mix(current, current - delta, weight);
+}
+
 void main() {
 	vec3 normal = normalize(vNormal); // re-normalize normal, because it has been interpolated
+	vec2 texCoord = useParallax ? parallaxTexCoord(vTexCoord, normal) : vTexCoord;
 
 	if (useNormal) {
 		vec3 n = normal;
@@ -32,7 +96,7 @@ void main() {
 		// TODO(3.4): Implement normal mapping.
 
 		// load the normal from texture normal map and scale to [-1, 1]
-		vec3 new_normal = normalize(2.0 * texture(normalTexture, vTexCoord).xyz - 1.0); 
+		vec3 new_normal = normalize(2.0 * texture(normalTexture, texCoord).xyz - 1.0); 
 		
 		// transform from tangent space to view space
 		mat3 transform_mat = transpose(mat3(t, n, b));
@@ -51,6 +115,33 @@ void main() {
 	float specularIntesity = 0.2 * pow(max(dot(halfView, normal), 0.0), 30.0);
 	float intensity = ambientIntensity + diffuseIntensity + specularIntesity;
 
-	vec3 baseColor = useDiffuse ? texture(diffuseTexture, vTexCoord).rgb : vColor;
-	color = vec4(baseColor * intensity, 1.0);
+	// the point lights without ambient term, they fade out to zero at their radius
+	vec3 light = vec3(intensity);
+	int lightOffset = 0;
+	int lightCount = pointLightCount;
+	if (useClusters) {
+		ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), clusterCount.xy - 1);
+		int slice = max(int(log(-vPos.z / clusterDepth.x) * clusterDepth.y), 0);
+		uvec2 range = slice < clusterCount.z ? texelFetch(clusterRanges, (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x).xy : uvec2(0);
+		lightOffset = int(range.x);
+		lightCount = int(range.y);
+	}
+	for (int k = 0; k < lightCount; ++k) {
+		int i = useClusters ? int(texelFetch(clusterLightIndices, lightOffset + k).r) : k;
+		vec4 sphere = texelFetch(pointLights, 2 * i);
+		vec3 toLight = sphere.xyz - vPos;
+		float distance2 = dot(toLight, toLight);
+		float radius2 = sphere.w * sphere.w;
+		if (distance2 >= radius2) {
+			continue;
+		}
+		vec3 pointDir = toLight * inversesqrt(distance2);
+		vec3 pointHalf = normalize(pointDir + viewDir);
+		float pointIntensity = 0.9 * max(dot(pointDir, normal), 0.0) + 0.2 * pow(max(dot(pointHalf, normal), 0.0), 30.0);
+		float falloff = 1.0 - distance2 / radius2;
+		light += texelFetch(pointLights, 2 * i + 1).rgb * pointIntensity * falloff * falloff;
+	}
+
+	vec3 baseColor = useDiffuse ? texture(diffuseTexture, texCoord).rgb : vColor;
+	color = vec4(baseColor * light, 1.0);
 }
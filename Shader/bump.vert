@@ -20,6 +20,8 @@ out vec3 vPos;      //Position in camera coordinates
 out vec2 vTexCoord; //Texture coordinate of current vertex
 out vec3 vTangent;  //Per-vertex tangent, in view space
 
+invariant gl_Position; //The depth pre-pass uses this shader too, with depth_only.frag
+
 void main() {
 	vec3 pos = position;
 
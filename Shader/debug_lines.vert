@@ -0,0 +1,20 @@
+#version 330 core
+
+/*
+This vertex shader draws the batched debug geometry of DebugDraw. Lines arrive in camera coordinates already. Boxes are instances of a unit box, each with its own modelView matrix and color as instance attributes.
+*/
+
+layout(location = 0) in vec3 position;         //Line vertex in camera coordinates, or unit box vertex
+layout(location = 2) in vec3 color;            //Per-vertex (lines) or per-instance (boxes) color
+layout(location = 5) in mat4 instanceModelView; //ModelView matrix of a box instance (locations 5 to 8)
+
+uniform mat4 projection; //Projection matrix
+uniform bool instanced;  //true while drawing the box instances
+
+out vec3 vColor; //Color, for constant_color.frag
+
+void main() {
+    vec4 eyePos = instanced ? instanceModelView * vec4(position, 1.0) : vec4(position, 1.0);
+    gl_Position = projection * eyePos;
+    vColor = color;
+}
@@ -0,0 +1,53 @@
+#version 330 core
+
+/*
+This fragment shader adds one point light to a pixel of the G-buffer, drawn on the back faces of its light volume with light_volume.vert and additive blending (see DeferredRenderer). The light fades out to zero at its radius, like in the point light loop of lambert.frag and bump.frag.
+*/
+
+flat in vec4 vLight;       //Position of the light in camera coordinates, radius
+flat in vec3 vLightColor;  //Color of the light
+
+uniform sampler2D albedoTexture;  //Base color, the material bits / 255 in alpha
+uniform sampler2D normalTexture;  //Octahedral encoded normal
+uniform sampler2D depthTexture;   //Depth of the surface
+uniform mat4 inverseProjection;   //Inverse of the projection matrix of the geometry pass
+
+out vec4 color;
+
+//Same as in deferred_sun.frag
+vec3 decodeNormal(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(depthTexture, pixel, 0).r;
+    vec2 ndc = gl_FragCoord.xy / vec2(textureSize(depthTexture, 0)) * 2.0 - 1.0;
+    vec4 viewPos = inverseProjection * vec4(ndc, 2.0 * depth - 1.0, 1.0);
+    vec3 pos = viewPos.xyz / viewPos.w;
+
+    //The stencil test only knows that some light of the batch reaches the pixel
+    vec3 toLight = vLight.xyz - pos;
+    float distance2 = dot(toLight, toLight);
+    float radius2 = vLight.w * vLight.w;
+    if (distance2 >= radius2) {
+        discard;
+    }
+    float falloff = 1.0 - distance2 / radius2;
+    falloff *= falloff;
+
+    vec4 albedo = texelFetch(albedoTexture, pixel, 0);
+    vec3 normal = decodeNormal(texelFetch(normalTexture, pixel, 0).rg);
+    uint material = uint(albedo.a * 255.0 + 0.5);
+
+    vec3 lightDir = toLight * inversesqrt(distance2);
+    float intensity = max(dot(lightDir, normal), 0.0);
+    if ((material & 1u) != 0u) {
+        vec3 halfView = normalize(lightDir + normalize(-pos));
+        intensity = 0.9 * intensity + 0.2 * pow(max(dot(halfView, normal), 0.0), 30.0);
+    }
+    color = vec4(albedo.rgb * vLightColor * (intensity * falloff), 1.0);
+}
@@ -0,0 +1,47 @@
+#version 330 core
+
+/*
+This fragment shader adds the main light to every pixel of the G-buffer (see DeferredRenderer), drawn as a full-screen triangle with fullscreen.vert. It shades like lambert.frag, or like bump.frag for the specular material.
+*/
+
+uniform sampler2D albedoTexture;  //Base color, the material bits / 255 in alpha
+uniform sampler2D normalTexture;  //Octahedral encoded normal
+uniform sampler2D depthTexture;   //Depth of the surface
+uniform mat4 inverseProjection;   //Inverse of the projection matrix of the geometry pass
+uniform vec3 lightPosition;       //Position of the light in camera coordinates
+
+out vec4 color;
+
+//Inverse of encodeNormal() in gbuffer.frag
+vec3 decodeNormal(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(depthTexture, pixel, 0).r;
+    if (depth == 1.0) {
+        discard; //Nothing drawn, the skybox fills the pixel later
+    }
+    vec2 ndc = gl_FragCoord.xy / vec2(textureSize(depthTexture, 0)) * 2.0 - 1.0;
+    vec4 viewPos = inverseProjection * vec4(ndc, 2.0 * depth - 1.0, 1.0);
+    vec3 pos = viewPos.xyz / viewPos.w;
+
+    vec4 albedo = texelFetch(albedoTexture, pixel, 0);
+    vec3 normal = decodeNormal(texelFetch(normalTexture, pixel, 0).rg);
+    uint material = uint(albedo.a * 255.0 + 0.5);
+
+    vec3 lightDir = normalize(lightPosition - pos);
+    float intensity;
+    if ((material & 1u) != 0u) {
+        vec3 halfView = normalize(lightDir + normalize(-pos));
+        intensity = 0.1 + 0.9 * max(dot(lightDir, normal), 0.0) + 0.2 * pow(max(dot(halfView, normal), 0.0), 30.0);
+    }
+    else {
+        intensity = max(dot(lightDir, normal), 0.05);
+    }
+    color = vec4(albedo.rgb * intensity, 1.0);
+}
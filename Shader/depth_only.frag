@@ -0,0 +1,8 @@
+#version 330 core
+
+/*
+This fragment shader writes no color, only the depth of the fragment is stored. The color writes are masked during a depth-only pass anyway.
+*/
+
+void main() {
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+/*
+This vertex shader only transforms the position, for depth-only passes (see Scene::beginDepthPrepass). It computes gl_Position exactly like only_mvp.vert and pull.vert, and gl_Position is invariant in all of them, so the shading pass after the depth pass gets the same depth values.
+*/
+
+layout(location = 0) in vec3 position; //Vertex position in model coordinates
+
+uniform mat4 modelView;     //ModelView matrix
+uniform mat4 projection;    //Projection matrix
+
+invariant gl_Position;
+
+void main() {
+    gl_Position = projection * modelView * vec4(position, 1.0);
+}
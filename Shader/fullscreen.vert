@@ -0,0 +1,11 @@
+#version 330 core
+
+/*
+This vertex shader draws one triangle that covers the whole viewport, without vertex attributes. Draw it with glDrawArrays(GL_TRIANGLES, 0, 3) and any VAO.
+*/
+
+void main() {
+    //(-1, -1), (3, -1), (-1, 3)
+    vec2 position = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+    gl_Position = vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,31 @@
+#version 330 core
+
+/*
+This fragment shader writes the surface of a fragment into the G-buffer of the deferred shading path (see DeferredRenderer) instead of shading it: the base color like lambert.frag chooses it and the octahedral encoded normal. The light is added later by deferred_sun.frag and deferred_light.frag.
+*/
+
+in vec3 vColor;     //Color of the fragment
+in vec3 vNormal;    //Normal of the fragment in camera coordinates
+in vec3 vPos;       //Position of the fragment in camera coordinates
+in vec2 vTexCoord;  //Texture coordinate of the fragment
+
+uniform bool useTexture;            //Flag whether to use a texture instead of per-vertex colors
+uniform sampler2D diffuseTexture;   //Texture to use
+
+layout(location = 0) out vec4 albedo; //Base color, the material bits / 255 in alpha
+layout(location = 1) out vec2 normal; //Octahedral encoded normal
+
+//Projects the unit vector onto the octahedron |x| + |y| + |z| = 1 and folds its lower half over the upper one
+vec2 encodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return n.xy;
+}
+
+void main() {
+    vec3 baseColor = useTexture ? texture(diffuseTexture, vTexCoord).rgb : vColor;
+    albedo = vec4(baseColor, 0.0);
+    normal = encodeNormal(normalize(vNormal));
+}
@@ -0,0 +1,100 @@
+#version 330 core
+
+/*
+This fragment shader writes the surface of the bump mapping sphere into the G-buffer (see gbuffer.frag): the normal and parallax occlusion mapping of bump.frag, and the specular material bit so the light passes add the highlights of bump.frag.
+*/
+
+in vec3 vColor;     //Color of the fragment
+in vec3 vNormal;    //Normal in view space
+in vec3 vPos;       //Position of the fragment in camera coordinates
+in vec2 vTexCoord;  //Texture coordinate of the fragment
+in vec3 vTangent;   //Tangent in view space
+
+uniform bool useDiffuse;
+uniform bool useNormal;
+uniform bool useParallax; //Parallax occlusion mapping, see bump.frag
+
+uniform sampler2D diffuseTexture;
+uniform sampler2D normalTexture;
+uniform sampler2D displacementTexture;
+
+layout(location = 0) out vec4 albedo; //Base color, the material bits / 255 in alpha
+layout(location = 1) out vec2 normal; //Octahedral encoded normal
+
+const float materialSpecular = 1.0; //DeferredRenderer::materialSpecular
+
+//Same as in gbuffer.frag
+vec2 encodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return n.xy;
+}
+
+// parallax occlusion mapping, the same as in bump.frag: bump.vert moves a vertex by the displacement value
+// (0 to 1) times this along its normal. The sphere is drawn at the largest displacement, the relief lies below it.
+const float displacementScale = 1.0;
+const float parallaxMinSteps = 8.0;            // steps when looking straight at the surface
+const float parallaxMaxSteps = 32.0;           // steps at grazing angles
+const float parallaxFullDetailDistance = 15.0; // beyond it the steps halve with every doubling of the distance
+
+// Follows the view ray below the surface in steps until it is under the displacement and returns the
+// texture coordinate where it hits the relief, interpolated between the last two steps.
+vec2 parallaxTexCoord(vec2 texCoord, vec3 n) {
+    // gradients of the texture coordinates in the plane of the surface, from the screen space derivatives
+    vec3 dp1 = dFdx(vPos);
+    vec3 dp2 = dFdy(vPos);
+    vec2 duv1 = dFdx(texCoord);
+    vec2 duv2 = dFdy(texCoord);
+    vec3 dp2perp = cross(dp2, n);
+    vec3 dp1perp = cross(n, dp1);
+    float det = dot(dp1, dp2perp);
+    if (abs(det) < 1e-12) {
+        return texCoord;
+    }
+    vec3 gradientU = (dp2perp * duv1.x + dp1perp * duv2.x) / det;
+    vec3 gradientV = (dp2perp * duv1.y + dp1perp * duv2.y) / det;
+
+    // change of the texture coordinates per unit of depth below the surface, along the view ray
+    vec3 ray = normalize(vPos);
+    float cosine = max(dot(-ray, n), 0.05);
+    vec2 perDepth = vec2(dot(gradientU, ray), dot(gradientV, ray)) * (displacementScale / cosine);
+
+    // more steps at grazing angles, where the ray passes more texels, and fewer far away
+    float steps = mix(parallaxMaxSteps, parallaxMinSteps, cosine) * clamp(parallaxFullDetailDistance / length(vPos), 0.25, 1.0);
+    int stepCount = int(ceil(max(steps, 0.5 * parallaxMinSteps)));
+    float layer = 1.0 / float(stepCount);
+    vec2 delta = perDepth * layer;
+
+    // the loop runs a different number of steps per fragment, so the derivatives are taken outside of it
+    float depth = 0.0;
+    float surface = 1.0 - textureGrad(displacementTexture, texCoord, duv1, duv2).r;
+    vec2 current = texCoord;
+    for (int i = 0; i < stepCount && depth < surface; ++i) {
+        current += delta;
+        depth += layer;
+        surface = 1.0 - textureGrad(displacementTexture, current, duv1, duv2).r;
+    }
+    float after = surface - depth;
+    float before = 1.0 - textureGrad(displacementTexture, current - delta, duv1, duv2).r - (depth - layer);
+    float weight = depth > 0.0 ? after / (after - before) : 0.0;
+    return mix(current, current - delta, weight);
+}
+
+void main() {
+	vec3 n = normalize(vNormal);
+	vec2 texCoord = useParallax ? parallaxTexCoord(vTexCoord, n) : vTexCoord;
+
+	if (useNormal) {
+		vec3 t = normalize(vTangent - n * dot(vTangent, n));
+		vec3 b = cross(n, t);
+		vec3 mapped = normalize(2.0 * texture(normalTexture, texCoord).xyz - 1.0);
+		n = normalize(transpose(mat3(t, n, b)) * mapped);
+		n.x = - n.x;
+	}
+
+	vec3 baseColor = useDiffuse ? texture(diffuseTexture, texCoord).rgb : vColor;
+	albedo = vec4(baseColor, materialSpecular / 255.0);
+	normal = encodeNormal(n);
+}
@@ -14,6 +14,17 @@ uniform vec3 lightPosition;         //Position of the light in camera coordinate
 uniform bool useTexture;            //Flag whether to use a texture instead of per-vertex colors
 uniform sampler2D diffuseTexture;   //Texture to use
 
+uniform samplerBuffer pointLights;  //Two texels per point light: position in camera coordinates and radius, color (see PointLights)
+uniform int pointLightCount;        //Number of point lights, 0 if there are none
+
+//Clustered lighting (see LightClusters): only the lights of the cluster of the fragment are evaluated
+uniform bool useClusters;
+uniform usamplerBuffer clusterRanges;       //Per cluster: offset into clusterLightIndices, number of lights
+uniform usamplerBuffer clusterLightIndices; //Indices of the point lights of all clusters
+uniform vec2 clusterTileSize;               //Size of a screen tile in pixels
+uniform vec2 clusterDepth;                  //Depth of the first slice, slices per log of the depth
+uniform ivec3 clusterCount;                 //Tiles in x and y, slices
+
 //Output color
 out vec4 color;
 
@@ -23,12 +34,35 @@ void main() {
     //Calculate Lambertian intensity. We clamp at 0.1 in order to simulate some kind of ambient light
     //Please note that both vectors are normalized, so the dot is the cosine of the encapsulated angle.
     float intensity = max(dot(lightDir, vNormal), 0.05);
+    //Add the point lights. Their light fades out to zero at the radius, like in deferred_light.frag.
+    vec3 light = vec3(intensity);
+    int lightOffset = 0;
+    int lightCount = pointLightCount;
+    if (useClusters) {
+        ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), clusterCount.xy - 1);
+        int slice = max(int(log(-vPos.z / clusterDepth.x) * clusterDepth.y), 0);
+        uvec2 range = slice < clusterCount.z ? texelFetch(clusterRanges, (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x).xy : uvec2(0);
+        lightOffset = int(range.x);
+        lightCount = int(range.y);
+    }
+    for (int k = 0; k < lightCount; ++k) {
+        int i = useClusters ? int(texelFetch(clusterLightIndices, lightOffset + k).r) : k;
+        vec4 sphere = texelFetch(pointLights, 2 * i);
+        vec3 toLight = sphere.xyz - vPos;
+        float distance2 = dot(toLight, toLight);
+        float radius2 = sphere.w * sphere.w;
+        if (distance2 >= radius2) {
+            continue;
+        }
+        float falloff = 1.0 - distance2 / radius2;
+        light += texelFetch(pointLights, 2 * i + 1).rgb * max(dot(toLight * inversesqrt(distance2), vNormal), 0.0) * falloff * falloff;
+    }
     //Set color, depending on set color source
     if (useTexture) {
-        color = vec4(texture(diffuseTexture, vTexCoord).xyz * intensity, 1.0);
+        color = vec4(texture(diffuseTexture, vTexCoord).xyz * light, 1.0);
     }
     else {
-        color = vec4(vColor * intensity, 1.0);
+        color = vec4(vColor * light, 1.0);
     }
     
     //Note that a fragment shader implicitly calls following line:
@@ -0,0 +1,20 @@
+#version 330 core
+
+/*
+This vertex shader places one instance of the light volume (see DeferredRenderer) around every point light. The volume is a sphere that encloses the unit sphere, it is scaled by the radius of the light.
+*/
+
+layout(location = 0) in vec3 position;   //Vertex of the volume
+layout(location = 5) in vec4 light;      //Per instance: position of the light in camera coordinates, radius
+layout(location = 6) in vec4 lightColor; //Per instance: color of the light, w is unused
+
+uniform mat4 projection;    //Projection matrix
+
+flat out vec4 vLight;       //Position and radius of the light
+flat out vec3 vLightColor;  //Color of the light
+
+void main() {
+    gl_Position = projection * vec4(light.xyz + light.w * position, 1.0);
+    vLight = light;
+    vLightColor = lightColor.rgb;
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+/*
+This vertex shader passes the position and normal of every vertex in model coordinates to normals.geom, which expands them into the normal arrows.
+*/
+
+layout(location = 0) in vec3 position; //Vertex position in model coordinates
+layout(location = 1) in vec3 normal;   //Vertex normal
+
+out vec3 vModelPos;    //Position in model coordinates
+out vec3 vModelNormal; //Normal in model coordinates
+
+void main() {
+    vModelPos = position;
+    vModelNormal = normal;
+}
@@ -18,6 +18,8 @@ out vec3 vNormal;   //Per-vertex normal, transformed
 out vec3 vPos;      //Position in camera coordinates
 out vec2 vTexCoord; //Texture coordinate of current vertex
 
+invariant gl_Position; //Same depth as in the depth pre-pass (depth_only.vert)
+
 void main() {
     gl_Position = projection * modelView * vec4(position, 1.0);
     vec4 tempPos = modelView * vec4(position, 1.0);
@@ -0,0 +1,13 @@
+#version 330 core
+
+/*
+This fragment shader fills the pixels of one band of the overdraw heatmap (see OverdrawMeter). The stencil test selects the pixels, so every fragment gets the same color.
+*/
+
+uniform vec3 bandColor; //False color of the band
+
+out vec4 color;
+
+void main() {
+    color = vec4(bandColor, 1.0);
+}
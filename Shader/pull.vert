@@ -0,0 +1,48 @@
+#version 330 core
+
+/*
+This vertex shader does the same as only_mvp.vert, but without vertex attributes: it fetches the index of the current vertex and its attributes from buffer textures (see VertexPullBuffers). The layout of every mesh is stored as two texels of pullDraws, so meshes with different layouts are drawn with the same empty VAO.
+*/
+
+uniform samplerBuffer pullVertices; //Attributes of all meshes, one float per texel
+uniform usamplerBuffer pullIndices; //Triangle indices of all meshes, relative to the first vertex of their mesh
+uniform isamplerBuffer pullDraws;   //Per mesh: (first index, first float, floats per vertex, normal offset), (color offset, texCoord offset, -, -). Offsets are -1 for missing attributes.
+uniform int drawIndex;              //Mesh of the current draw
+uniform bool useColorArray;         //Use the per-vertex colors instead of the constant color attribute
+
+layout(location = 2) in vec3 color; //Never enabled, the static color of the mesh (see TriangleMesh::bindMaterial)
+
+uniform mat4 modelView;     //ModelView matrix
+uniform mat4 projection;    //Projection matrix
+uniform mat3 normalMatrix;  //The transpose inverse of the ModelView matrix, used for transformation of normals.
+
+out vec3 vColor;    //Per-vertex color
+out vec3 vNormal;   //Per-vertex normal, transformed
+out vec3 vPos;      //Position in camera coordinates
+out vec2 vTexCoord; //Texture coordinate of current vertex
+
+invariant gl_Position; //Same depth as in the depth pre-pass (depth_only.vert)
+
+float fetch1(int at) {
+    return texelFetch(pullVertices, at).r;
+}
+
+vec3 fetch3(int at) {
+    return vec3(fetch1(at), fetch1(at + 1), fetch1(at + 2));
+}
+
+void main() {
+    ivec4 layout0 = texelFetch(pullDraws, 2 * drawIndex);
+    ivec4 layout1 = texelFetch(pullDraws, 2 * drawIndex + 1);
+    int vertex = int(texelFetch(pullIndices, layout0.x + gl_VertexID).r);
+    int first = layout0.y + vertex * layout0.z;
+
+    vec3 position = fetch3(first);
+    vec3 normal = fetch3(first + layout0.w);
+    gl_Position = projection * modelView * vec4(position, 1.0);
+    vec4 tempPos = modelView * vec4(position, 1.0);
+    vPos = tempPos.xyz / tempPos.w; //inhomogenous coordinates
+    vColor = (useColorArray && layout1.x >= 0) ? fetch3(first + layout1.x) : color;
+    vNormal = normalMatrix * normal;
+    vTexCoord = layout1.y >= 0 ? vec2(fetch1(first + layout1.y), fetch1(first + layout1.y + 1)) : vec2(0.0);
+}
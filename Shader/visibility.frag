@@ -0,0 +1,14 @@
+#version 330 core
+
+/*
+This fragment shader writes the visibility buffer (see VisibilityBuffer) with pull.vert: instead of a color only the ID of the instance and triangle of the fragment. The surface is reconstructed and shaded later by visibility_resolve.frag, once per pixel.
+*/
+
+uniform uint visibilityInstanceBase; //Instance of the draw, shifted above the bits of the triangle index
+
+out uint id;
+
+void main() {
+    //glDrawArrays(GL_TRIANGLES, 0, indexCount) numbers the triangles of the mesh like its index buffer
+    id = visibilityInstanceBase | uint(gl_PrimitiveID);
+}
@@ -0,0 +1,141 @@
+#version 330 core
+
+/*
+This fragment shader shades the visibility buffer (see VisibilityBuffer), drawn as a full-screen triangle with fullscreen.vert. It decodes the instance and triangle of the pixel, fetches the three vertices from the buffer textures of pull.vert and intersects the view ray through the pixel center with the triangle. The barycentric coordinates of the hit point are perspective correct, and those of the rays through the neighboring pixels give the screen space derivatives of the texture coordinates. The lighting is the one of lambert.frag.
+*/
+
+uniform usampler2D visibilityIds;           //(instance << triangleBits) | triangle, 0xffffffff where nothing was drawn
+uniform samplerBuffer visibilityInstances;  //Six texels per instance: the columns of the ModelView matrix, (draw index, material texture or -1, use color array, -), (static color, -)
+uniform uint triangleBits;                  //Bits of the triangle index in the IDs
+uniform sampler2D materialTexture0;         //The material textures of the frame
+uniform sampler2D materialTexture1;
+uniform sampler2D materialTexture2;
+
+uniform samplerBuffer pullVertices; //The buffer textures of pull.vert
+uniform usamplerBuffer pullIndices;
+uniform isamplerBuffer pullDraws;
+
+uniform mat4 inverseProjection;     //Inverse of the projection matrix of the geometry pass
+uniform vec3 lightPosition;         //Position of the light in camera coordinates
+
+uniform samplerBuffer pointLights;  //Two texels per point light: position in camera coordinates and radius, color (see PointLights)
+uniform int pointLightCount;        //Number of point lights, 0 if there are none
+
+//Clustered lighting (see LightClusters): only the lights of the cluster of the pixel are evaluated
+uniform bool useClusters;
+uniform usamplerBuffer clusterRanges;       //Per cluster: offset into clusterLightIndices, number of lights
+uniform usamplerBuffer clusterLightIndices; //Indices of the point lights of all clusters
+uniform vec2 clusterTileSize;               //Size of a screen tile in pixels
+uniform vec2 clusterDepth;                  //Depth of the first slice, slices per log of the depth
+uniform ivec3 clusterCount;                 //Tiles in x and y, slices
+
+out vec4 color;
+
+float fetch1(int at) {
+    return texelFetch(pullVertices, at).r;
+}
+
+vec3 fetch3(int at) {
+    return vec3(fetch1(at), fetch1(at + 1), fetch1(at + 2));
+}
+
+//Direction of the view ray through a point of the window, the camera is at the origin
+vec3 viewRay(vec2 fragCoord) {
+    vec2 ndc = fragCoord / vec2(textureSize(visibilityIds, 0)) * 2.0 - 1.0;
+    vec4 onNearPlane = inverseProjection * vec4(ndc, -1.0, 1.0);
+    return onNearPlane.xyz / onNearPlane.w;
+}
+
+//Barycentric coordinates of vertices 1 and 2 where the ray hits the plane of the triangle p0, p0 + e1, p0 + e2
+vec2 barycentrics(vec3 ray, vec3 p0, vec3 e1, vec3 e2, vec3 n) {
+    vec3 hit = ray * (dot(p0, n) / dot(ray, n)) - p0;
+    return vec2(dot(cross(hit, e2), n), dot(cross(e1, hit), n)) / dot(n, n);
+}
+
+void main() {
+    uint id = texelFetch(visibilityIds, ivec2(gl_FragCoord.xy), 0).r;
+    if (id == 0xffffffffu) {
+        discard; //Nothing drawn, the skybox fills the pixel later
+    }
+    int instance = 6 * int(id >> triangleBits);
+    int triangle = int(id & ((1u << triangleBits) - 1u));
+    mat4 modelView = mat4(texelFetch(visibilityInstances, instance), texelFetch(visibilityInstances, instance + 1),
+                          texelFetch(visibilityInstances, instance + 2), texelFetch(visibilityInstances, instance + 3));
+    vec4 material = texelFetch(visibilityInstances, instance + 4);
+    vec3 staticColor = texelFetch(visibilityInstances, instance + 5).rgb;
+
+    //The vertices of the triangle, like pull.vert fetches them
+    int drawIndex = int(material.x);
+    ivec4 layout0 = texelFetch(pullDraws, 2 * drawIndex);
+    ivec4 layout1 = texelFetch(pullDraws, 2 * drawIndex + 1);
+    int first[3];
+    vec3 p[3];
+    for (int k = 0; k < 3; ++k) {
+        int vertex = int(texelFetch(pullIndices, layout0.x + 3 * triangle + k).r);
+        first[k] = layout0.y + vertex * layout0.z;
+        vec4 position = modelView * vec4(fetch3(first[k]), 1.0);
+        p[k] = position.xyz / position.w;
+    }
+    vec3 e1 = p[1] - p[0];
+    vec3 e2 = p[2] - p[0];
+    vec3 n = cross(e1, e2);
+
+    vec2 b = barycentrics(viewRay(gl_FragCoord.xy), p[0], e1, e2, n);
+    vec3 weights = vec3(1.0 - b.x - b.y, b);
+    vec3 pos = p[0] + b.x * e1 + b.y * e2;
+    mat3 normalMatrix = transpose(inverse(mat3(modelView)));
+    vec3 normal = normalize(normalMatrix * (weights.x * fetch3(first[0] + layout0.w) + weights.y * fetch3(first[1] + layout0.w)
+                                            + weights.z * fetch3(first[2] + layout0.w)));
+
+    vec3 baseColor = staticColor;
+    int textureSlot = int(material.y);
+    if (textureSlot >= 0 && layout1.y >= 0) {
+        vec2 t0 = vec2(fetch1(first[0] + layout1.y), fetch1(first[0] + layout1.y + 1));
+        vec2 t1 = vec2(fetch1(first[1] + layout1.y), fetch1(first[1] + layout1.y + 1));
+        vec2 t2 = vec2(fetch1(first[2] + layout1.y), fetch1(first[2] + layout1.y + 1));
+        vec2 texCoord = t0 + b.x * (t1 - t0) + b.y * (t2 - t0);
+        //The texture coordinates one pixel to the right and above on the same plane, for the mipmap level
+        vec2 bx = barycentrics(viewRay(gl_FragCoord.xy + vec2(1.0, 0.0)), p[0], e1, e2, n);
+        vec2 by = barycentrics(viewRay(gl_FragCoord.xy + vec2(0.0, 1.0)), p[0], e1, e2, n);
+        vec2 dx = (bx.x - b.x) * (t1 - t0) + (bx.y - b.y) * (t2 - t0);
+        vec2 dy = (by.x - b.x) * (t1 - t0) + (by.y - b.y) * (t2 - t0);
+        if (textureSlot == 0) {
+            baseColor = textureGrad(materialTexture0, texCoord, dx, dy).rgb;
+        }
+        else if (textureSlot == 1) {
+            baseColor = textureGrad(materialTexture1, texCoord, dx, dy).rgb;
+        }
+        else {
+            baseColor = textureGrad(materialTexture2, texCoord, dx, dy).rgb;
+        }
+    }
+    else if (material.z != 0.0 && layout1.x >= 0) {
+        baseColor = weights.x * fetch3(first[0] + layout1.x) + weights.y * fetch3(first[1] + layout1.x) + weights.z * fetch3(first[2] + layout1.x);
+    }
+
+    //The lights of lambert.frag
+    vec3 lightDir = normalize(lightPosition - pos);
+    vec3 light = vec3(max(dot(lightDir, normal), 0.05));
+    int lightOffset = 0;
+    int lightCount = pointLightCount;
+    if (useClusters) {
+        ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), clusterCount.xy - 1);
+        int slice = max(int(log(-pos.z / clusterDepth.x) * clusterDepth.y), 0);
+        uvec2 range = slice < clusterCount.z ? texelFetch(clusterRanges, (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x).xy : uvec2(0);
+        lightOffset = int(range.x);
+        lightCount = int(range.y);
+    }
+    for (int k = 0; k < lightCount; ++k) {
+        int i = useClusters ? int(texelFetch(clusterLightIndices, lightOffset + k).r) : k;
+        vec4 sphere = texelFetch(pointLights, 2 * i);
+        vec3 toLight = sphere.xyz - pos;
+        float distance2 = dot(toLight, toLight);
+        float radius2 = sphere.w * sphere.w;
+        if (distance2 >= radius2) {
+            continue;
+        }
+        float falloff = 1.0 - distance2 / radius2;
+        light += texelFetch(pointLights, 2 * i + 1).rgb * max(dot(toLight * inversesqrt(distance2), normal), 0.0) * falloff * falloff;
+    }
+    color = vec4(baseColor * light, 1.0);
+}
@@ -0,0 +1,138 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Warmup, repetitions and the JSON report of the micro benchmarks  //
+// ========================================================================= //
+
+#ifndef BENCHRUNNER_H
+#define BENCHRUNNER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "benchstats.h"
+
+// Keeps the compiler from optimizing away results that are never read.
+template<typename T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(int warmup, int repetitions, const QString &filter)
+        : warmup(warmup), repetitions(repetitions), filter(filter) {}
+
+    // Runs body warmup + repetitions times. setup is executed before every run and is not timed.
+    // items is the number of processed elements per run, used for the throughput.
+    void run(const QString &name, const std::function<void()> &body, double items = 0.0,
+             const std::function<void()> &setup = std::function<void()>())
+    {
+        if (!filter.isEmpty() && !name.contains(filter))
+            return;
+        std::vector<double> samples;
+        samples.reserve(repetitions);
+        for (int i = 0; i < warmup + repetitions; ++i)
+        {
+            if (setup)
+                setup();
+            const auto start = std::chrono::steady_clock::now();
+            body();
+            const auto end = std::chrono::steady_clock::now();
+            if (i >= warmup)
+                samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        const SampleSummary summary = summarize(samples);
+
+        QJsonObject result;
+        result["name"] = name;
+        result["ms"] = toJson(summary);
+        if (items > 0.0)
+        {
+            result["items"] = items;
+            result["itemsPerSecond"] = items / (summary.p50 / 1000.0);
+        }
+        results.append(result);
+
+        std::fprintf(stderr, "%-48s median %10.4f ms  p90 %10.4f ms  stddev %8.4f ms\n",
+                     qPrintable(name), summary.p50, summary.p90, summary.stddev);
+    }
+
+    QJsonObject report() const
+    {
+        QJsonObject result;
+        result["warmup"] = warmup;
+        result["repetitions"] = repetitions;
+        result["benchmarks"] = results;
+        return result;
+    }
+
+private:
+    int warmup, repetitions;
+    QString filter;
+    QJsonArray results;
+};
+
+// The command line options of both micro benchmark programs
+struct BenchmarkOptions {
+    const QCommandLineOption warmup{QStringLiteral("warmup"), QStringLiteral("Unmeasured runs per benchmark."), QStringLiteral("n"), QStringLiteral("3")};
+    const QCommandLineOption repetitions{QStringLiteral("repetitions"), QStringLiteral("Measured runs per benchmark."), QStringLiteral("n"), QStringLiteral("15")};
+    const QCommandLineOption filter{QStringLiteral("filter"), QStringLiteral("Only run benchmarks whose name contains this text."), QStringLiteral("text")};
+    const QCommandLineOption output{QStringLiteral("output"), QStringLiteral("Write the JSON report to this file instead of stdout."), QStringLiteral("file")};
+
+    void addTo(QCommandLineParser &parser) const
+    {
+        parser.addOption(warmup);
+        parser.addOption(repetitions);
+        parser.addOption(filter);
+        parser.addOption(output);
+    }
+
+    BenchmarkRunner runner(const QCommandLineParser &parser) const
+    {
+        return BenchmarkRunner(std::max(0, parser.value(warmup).toInt()), std::max(1, parser.value(repetitions).toInt()),
+                               parser.value(filter));
+    }
+
+    // writes the report of runner to --output or stdout, returns the exit code of the program
+    int writeReport(const QCommandLineParser &parser, const BenchmarkRunner &runner, const char *program) const
+    {
+        const QByteArray json = QJsonDocument(runner.report()).toJson(QJsonDocument::Indented);
+        if (parser.isSet(output))
+        {
+            QFile outputFile(parser.value(output));
+            if (!outputFile.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate))
+            {
+                std::cerr << program << ": could not open " << qPrintable(parser.value(output)) << std::endl;
+                return 1;
+            }
+            outputFile.write(json);
+        }
+        else
+        {
+            std::cout << json.constData() << std::endl;
+        }
+        return 0;
+    }
+};
+
+#endif // BENCHRUNNER_H
@@ -0,0 +1,76 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Statistical summaries of timing samples for the benchmarks      //
+// ========================================================================= //
+
+#ifndef BENCHSTATS_H
+#define BENCHSTATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <QJsonObject>
+
+struct SampleSummary {
+    size_t count = 0;
+    double min = 0.0, max = 0.0, mean = 0.0, stddev = 0.0;
+    double p50 = 0.0, p90 = 0.0, p95 = 0.0, p99 = 0.0;
+};
+
+// percentile (0..100) of an already sorted sample set, linearly interpolated between ranks
+inline double percentileOfSorted(const std::vector<double>& sorted, double percentile)
+{
+    if (sorted.empty())
+        return 0.0;
+    const double rank = percentile / 100.0 * static_cast<double>(sorted.size() - 1);
+    const size_t lower = static_cast<size_t>(std::floor(rank));
+    const size_t upper = std::min(lower + 1, sorted.size() - 1);
+    const double weight = rank - static_cast<double>(lower);
+    return sorted[lower] * (1.0 - weight) + sorted[upper] * weight;
+}
+
+inline SampleSummary summarize(std::vector<double> samples)
+{
+    SampleSummary result;
+    result.count = samples.size();
+    if (samples.empty())
+        return result;
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double s : samples)
+        sum += s;
+    result.mean = sum / static_cast<double>(samples.size());
+    double squaredDeviation = 0.0;
+    for (double s : samples)
+        squaredDeviation += (s - result.mean) * (s - result.mean);
+    result.stddev = samples.size() > 1 ? std::sqrt(squaredDeviation / static_cast<double>(samples.size() - 1)) : 0.0;
+    result.min = samples.front();
+    result.max = samples.back();
+    result.p50 = percentileOfSorted(samples, 50.0);
+    result.p90 = percentileOfSorted(samples, 90.0);
+    result.p95 = percentileOfSorted(samples, 95.0);
+    result.p99 = percentileOfSorted(samples, 99.0);
+    return result;
+}
+
+inline QJsonObject toJson(const SampleSummary& summary)
+{
+    QJsonObject result;
+    result["count"] = static_cast<qint64>(summary.count);
+    result["min"] = summary.min;
+    result["max"] = summary.max;
+    result["mean"] = summary.mean;
+    result["stddev"] = summary.stddev;
+    result["p50"] = summary.p50;
+    result["p90"] = summary.p90;
+    result["p95"] = summary.p95;
+    result["p99"] = summary.p99;
+    return result;
+}
+
+#endif // BENCHSTATS_H
@@ -0,0 +1,122 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Recorded camera paths with scene settings and frame statistics  //
+//          for deterministic replays and comparisons of performance runs    //
+// ========================================================================= //
+
+#include <algorithm>
+
+#include <QDataStream>
+#include <QFile>
+
+#include "camerapath.h"
+
+namespace {
+
+const char fileMagic[8] = {'G', 'D', 'V', 'C', 'A', 'M', '\0', '\0'};
+// bytes of one frame as written by CameraPath::save()
+constexpr qint64 frameRecordBytes = 4 + 3 * 12 + 2 + 1 + 2 + 2 + 2 + 4 + 1 + 3 * 4 + 3 * 4;
+
+void writeVector(QDataStream &out, float x, float y, float z)
+{
+    out << x << y << z;
+}
+
+void readVector(QDataStream &in, QVector3D &v)
+{
+    float x, y, z;
+    in >> x >> y >> z;
+    v = QVector3D(x, y, z);
+}
+
+} // namespace
+
+bool CameraPathFrame::sameState(const CameraPathFrame &other) const
+{
+    const float eps = 1e-5f;
+    return (cameraPos - other.cameraPos).lengthSquared() < eps && (cameraDir - other.cameraDir).lengthSquared() < eps
+        && lightPos.distance(other.lightPos) < eps && gridSize == other.gridSize && coloringMode == other.coloringMode
+        && shaderIndex == other.shaderIndex && terrainGeneration == other.terrainGeneration && flags == other.flags
+        && pointLightCount == other.pointLightCount && depthPrepass == other.depthPrepass;
+}
+
+bool CameraPath::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate))
+        return false;
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    out.writeRawData(fileMagic, sizeof(fileMagic));
+    out << fileVersion << static_cast<uint32_t>(seed) << static_cast<uint32_t>(frames.size());
+    for (const CameraPathFrame &frame : frames)
+    {
+        out << frame.timeMs;
+        writeVector(out, frame.cameraPos.x(), frame.cameraPos.y(), frame.cameraPos.z());
+        writeVector(out, frame.cameraDir.x(), frame.cameraDir.y(), frame.cameraDir.z());
+        writeVector(out, frame.lightPos.x(), frame.lightPos.y(), frame.lightPos.z());
+        out << static_cast<uint16_t>(frame.gridSize) << static_cast<int8_t>(frame.coloringMode) << frame.flags
+            << static_cast<uint16_t>(frame.shaderIndex) << static_cast<uint16_t>(frame.terrainGeneration)
+            << static_cast<uint32_t>(frame.pointLightCount) << frame.depthPrepass;
+        out << frame.frameMs << frame.cpuMs << frame.gpuMs
+            << static_cast<uint32_t>(frame.triangles) << static_cast<uint32_t>(frame.drawCalls) << static_cast<uint32_t>(frame.objectsCulled);
+    }
+    return out.status() == QDataStream::Ok && file.flush();
+}
+
+bool CameraPath::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::OpenModeFlag::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    char magic[sizeof(fileMagic)];
+    if (in.readRawData(magic, sizeof(magic)) != sizeof(magic) || !std::equal(magic, magic + sizeof(magic), fileMagic))
+        return false;
+    uint32_t version = 0, fileSeed = 0, frameCount = 0;
+    in >> version >> fileSeed >> frameCount;
+    if (version != fileVersion)
+        return false;
+
+    std::vector<CameraPathFrame> loaded;
+    // the count comes from the file, a corrupt one must not allocate more than the file can hold
+    loaded.reserve(static_cast<size_t>(std::min<qint64>(frameCount, (file.size() - file.pos()) / frameRecordBytes)));
+    for (uint32_t i = 0; i < frameCount && in.status() == QDataStream::Ok; ++i)
+    {
+        CameraPathFrame frame;
+        QVector3D light;
+        uint16_t gridSize, shaderIndex, terrainGeneration;
+        int8_t coloringMode;
+        uint32_t pointLightCount, triangles, drawCalls, objectsCulled;
+        in >> frame.timeMs;
+        readVector(in, frame.cameraPos);
+        readVector(in, frame.cameraDir);
+        readVector(in, light);
+        in >> gridSize >> coloringMode >> frame.flags >> shaderIndex >> terrainGeneration >> pointLightCount >> frame.depthPrepass;
+        in >> frame.frameMs >> frame.cpuMs >> frame.gpuMs >> triangles >> drawCalls >> objectsCulled;
+        frame.lightPos = Vec3f(light.x(), light.y(), light.z());
+        frame.gridSize = gridSize;
+        frame.coloringMode = coloringMode;
+        frame.shaderIndex = shaderIndex;
+        frame.terrainGeneration = terrainGeneration;
+        frame.pointLightCount = pointLightCount;
+        frame.triangles = triangles;
+        frame.drawCalls = drawCalls;
+        frame.objectsCulled = objectsCulled;
+        loaded.push_back(frame);
+    }
+    if (in.status() != QDataStream::Ok)
+        return false;
+    seed = fileSeed;
+    frames = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,81 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Recorded camera paths with scene settings and frame statistics  //
+//          for deterministic replays and comparisons of performance runs    //
+// ========================================================================= //
+
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <cstdint>
+#include <vector>
+
+#include <QString>
+#include <QVector3D>
+
+#include "vec3.h"
+
+// State and measurements of one frame.
+struct CameraPathFrame {
+    enum Flags : uint16_t {
+        LightMoves = 1 << 0,
+        BoundingBox = 1 << 1,
+        Normals = 1 << 2,
+        Diffuse = 1 << 3,
+        NormalMapping = 1 << 4,
+        Displacement = 1 << 5,
+        Parallax = 1 << 6,
+        StaticBatching = 1 << 7,
+        VertexPulling = 1 << 8,
+        DeferredShading = 1 << 9,
+        ClusteredLighting = 1 << 10,
+        VisibilityBuffer = 1 << 11,
+    };
+
+    float timeMs = 0.0f; // since the start of the recording
+    QVector3D cameraPos, cameraDir;
+    Vec3f lightPos;
+    int gridSize = 3;
+    int coloringMode = -1; // TriangleMesh::ColoringType, -1 if never changed (every mesh keeps its own mode)
+    unsigned int shaderIndex = 0;
+    unsigned int terrainGeneration = 0; // how often the terrain was generated again
+    uint16_t flags = 0;
+    unsigned int pointLightCount = 0;
+    uint8_t depthPrepass = 0; // DepthPrepassMode of every Scene::ShadedPass, two bits each from the lowest
+
+    // measured while recording or replaying
+    float frameMs = 0.0f, cpuMs = 0.0f, gpuMs = 0.0f;
+    unsigned int triangles = 0, drawCalls = 0, objectsCulled = 0;
+
+    bool hasFlag(Flags flag) const { return (flags & flag) != 0; }
+    void setFlag(Flags flag, bool enable) { flags = enable ? (flags | flag) : (flags & ~flag); }
+    int getDepthPrepass(int pass) const { return (depthPrepass >> (2 * pass)) & 3; }
+    void setDepthPrepass(int pass, int mode) {
+        depthPrepass = static_cast<uint8_t>((depthPrepass & ~(3 << (2 * pass))) | ((mode & 3) << (2 * pass)));
+    }
+    // true if both frames show the same view of the same scene. Measurements are ignored.
+    bool sameState(const CameraPathFrame& other) const;
+};
+
+/*
+ * A recording of all frames of a run together with the seed of the random object positions and terrain.
+ * Replaying the frames in order with the same seed renders the same images, independent of the frame rate.
+ * Stored in a little endian binary file, about 80 bytes per frame.
+ */
+class CameraPath {
+public:
+    static constexpr uint32_t fileVersion = 2;
+
+    unsigned int seed = 0;
+    std::vector<CameraPathFrame> frames;
+
+    // return false if the file could not be written or is no valid recording
+    bool save(const QString& fileName) const;
+    bool load(const QString& fileName);
+};
+
+#endif // CAMERAPATH_H
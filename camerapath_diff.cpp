@@ -0,0 +1,171 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Compares two replays of the same camera path frame by frame     //
+//          and reports the timing differences as JSON                       //
+// ========================================================================= //
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "benchstats.h"
+#include "camerapath.h"
+
+namespace {
+
+// relative change from a to b in percent
+double deltaPercent(double a, double b)
+{
+    return a > 0.0 ? 100.0 * (b - a) / a : 0.0;
+}
+
+QJsonObject compareMetric(const std::vector<double> &a, const std::vector<double> &b)
+{
+    const SampleSummary summaryA = summarize(a);
+    const SampleSummary summaryB = summarize(b);
+    QJsonObject result;
+    result["a"] = toJson(summaryA);
+    result["b"] = toJson(summaryB);
+    result["meanDeltaPercent"] = deltaPercent(summaryA.mean, summaryB.mean);
+    result["p50DeltaPercent"] = deltaPercent(summaryA.p50, summaryB.p50);
+    result["p99DeltaPercent"] = deltaPercent(summaryA.p99, summaryB.p99);
+    return result;
+}
+
+QJsonObject frameJson(size_t index, const CameraPathFrame &a, const CameraPathFrame &b)
+{
+    QJsonObject result;
+    result["frame"] = static_cast<qint64>(index);
+    result["frameMsA"] = a.frameMs;
+    result["frameMsB"] = b.frameMs;
+    result["deltaPercent"] = deltaPercent(a.frameMs, b.frameMs);
+    result["cpuMsA"] = a.cpuMs;
+    result["cpuMsB"] = b.cpuMs;
+    result["gpuMsA"] = a.gpuMs;
+    result["gpuMsB"] = b.gpuMs;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("camerapath_diff"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Compares two replays of the same camera path, written with --replay-output or --record-output."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("a"), QStringLiteral("Baseline run."));
+    parser.addPositionalArgument(QStringLiteral("b"), QStringLiteral("Run to compare with the baseline."));
+    const QCommandLineOption thresholdOption(QStringLiteral("threshold"), QStringLiteral("List frames that are more than this percentage slower in b."), QStringLiteral("percent"), QStringLiteral("20"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Write the JSON report to this file instead of stdout."), QStringLiteral("file"));
+    parser.addOption(thresholdOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    const QStringList files = parser.positionalArguments();
+    if (files.size() != 2)
+        parser.showHelp(1);
+
+    CameraPath runs[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!runs[i].load(files[i]))
+        {
+            std::cerr << "camerapath_diff: could not load " << qPrintable(files[i]) << std::endl;
+            return 1;
+        }
+    }
+    const CameraPath &a = runs[0];
+    const CameraPath &b = runs[1];
+    if (a.seed != b.seed)
+        std::cerr << "camerapath_diff: the runs use different seeds, the scenes differ" << std::endl;
+    if (a.frames.size() != b.frames.size())
+        std::cerr << "camerapath_diff: the runs have " << a.frames.size() << " and " << b.frames.size() << " frames" << std::endl;
+
+    // Frames are only comparable while both runs show the same scene from the same camera
+    const size_t count = std::min(a.frames.size(), b.frames.size());
+    size_t compared = 0;
+    while (compared < count && a.frames[compared].sameState(b.frames[compared]))
+        compared++;
+    if (compared < count)
+        std::cerr << "camerapath_diff: the runs diverge at frame " << compared << ", only the frames before are compared" << std::endl;
+
+    std::vector<double> frameA, frameB, cpuA, cpuB, gpuA, gpuB;
+    std::vector<size_t> slowerFrames;
+    const double threshold = parser.value(thresholdOption).toDouble();
+    for (size_t i = 0; i < compared; ++i)
+    {
+        const CameraPathFrame &frameOfA = a.frames[i];
+        const CameraPathFrame &frameOfB = b.frames[i];
+        frameA.push_back(frameOfA.frameMs);
+        frameB.push_back(frameOfB.frameMs);
+        cpuA.push_back(frameOfA.cpuMs);
+        cpuB.push_back(frameOfB.cpuMs);
+        gpuA.push_back(frameOfA.gpuMs);
+        gpuB.push_back(frameOfB.gpuMs);
+        if (deltaPercent(frameOfA.frameMs, frameOfB.frameMs) > threshold)
+            slowerFrames.push_back(i);
+    }
+
+    // the ten frames with the largest absolute regression
+    std::vector<size_t> regressions(compared);
+    for (size_t i = 0; i < compared; ++i)
+        regressions[i] = i;
+    const size_t topCount = std::min<size_t>(10, compared);
+    std::partial_sort(regressions.begin(), regressions.begin() + topCount, regressions.end(), [&](size_t x, size_t y) {
+        return b.frames[x].frameMs - a.frames[x].frameMs > b.frames[y].frameMs - a.frames[y].frameMs;
+    });
+    regressions.resize(topCount);
+
+    QJsonObject report;
+    report["a"] = files[0];
+    report["b"] = files[1];
+    report["seed"] = static_cast<qint64>(a.seed);
+    report["sameSeed"] = a.seed == b.seed;
+    report["framesA"] = static_cast<qint64>(a.frames.size());
+    report["framesB"] = static_cast<qint64>(b.frames.size());
+    report["framesCompared"] = static_cast<qint64>(compared);
+    report["divergesAtFrame"] = compared < count ? static_cast<qint64>(compared) : -1;
+    report["frameMs"] = compareMetric(frameA, frameB);
+    report["cpuFrameMs"] = compareMetric(cpuA, cpuB);
+    report["gpuFrameMs"] = compareMetric(gpuA, gpuB);
+    report["thresholdPercent"] = threshold;
+    QJsonArray slower;
+    for (size_t i : slowerFrames)
+        slower.append(static_cast<qint64>(i));
+    report["slowerFrames"] = slower;
+    QJsonArray worst;
+    for (size_t i : regressions)
+        worst.append(frameJson(i, a.frames[i], b.frames[i]));
+    report["largestRegressions"] = worst;
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOption))
+    {
+        QFile outputFile(parser.value(outputOption));
+        if (!outputFile.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate))
+        {
+            std::cerr << "camerapath_diff: could not open " << qPrintable(parser.value(outputOption)) << std::endl;
+            return 1;
+        }
+        outputFile.write(json);
+    }
+    else
+    {
+        std::cout << json.constData() << std::endl;
+    }
+    return 0;
+}
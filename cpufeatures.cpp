@@ -0,0 +1,132 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Detection of the SIMD instruction sets of the CPU                //
+// ========================================================================= //
+
+#include <cstdlib>
+#include <cstring>
+
+#include "cpufeatures.h"
+#include "log.h"
+
+#if defined(GDV_SIMD_DISPATCH_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+#if defined(GDV_SIMD_DISPATCH_X86)
+
+void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4])
+{
+#if defined(_MSC_VER)
+    int values[4];
+    __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; ++i)
+        registers[i] = static_cast<uint32_t>(values[i]);
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// register states the operating system saves on context switches (XCR0)
+uint64_t enabledStates()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+}
+
+SimdLevel detect()
+{
+    uint32_t r[4]; // eax, ebx, ecx, edx
+    cpuid(0, 0, r);
+    const uint32_t maxLeaf = r[0];
+    if (maxLeaf < 1)
+        return SimdLevel::Scalar;
+
+    cpuid(1, 0, r);
+    const bool sse42 = r[2] & (1u << 20);
+    const bool fma = r[2] & (1u << 12);
+    const bool osxsave = r[2] & (1u << 27);
+    const bool avx = r[2] & (1u << 28);
+    if (!sse42)
+        return SimdLevel::Scalar;
+    if (!osxsave || !avx || !fma || maxLeaf < 7)
+        return SimdLevel::SSE42;
+
+    const uint64_t states = enabledStates();
+    const bool ymmEnabled = (states & 0x6) == 0x6;  // SSE and AVX
+    const bool zmmEnabled = (states & 0xe0) == 0xe0; // opmask and both halves of zmm
+    cpuid(7, 0, r);
+    const bool avx2 = r[1] & (1u << 5);
+    const bool avx512f = r[1] & (1u << 16);
+    const bool avx512dq = r[1] & (1u << 17);
+    if (!ymmEnabled || !avx2)
+        return SimdLevel::SSE42;
+    if (!zmmEnabled || !avx512f || !avx512dq)
+        return SimdLevel::AVX2;
+    return SimdLevel::AVX512;
+}
+
+#else
+
+SimdLevel detect()
+{
+    return SimdLevel::Scalar;
+}
+
+#endif // GDV_SIMD_DISPATCH_X86
+
+SimdLevel select()
+{
+    const SimdLevel detected = detectedSimdLevel();
+    const char* value = std::getenv("GDV_SIMD");
+    if (!value || !*value)
+        return detected;
+    for (uint8_t level = 0; level < static_cast<uint8_t>(SimdLevel::Count); ++level)
+    {
+        if (std::strcmp(value, simdLevelName(static_cast<SimdLevel>(level))) != 0)
+            continue;
+        if (level > static_cast<uint8_t>(detected))
+        {
+            LOG_WARNING(General, "GDV_SIMD={} is not supported by this CPU, using {}", value, simdLevelName(detected));
+            return detected;
+        }
+        return static_cast<SimdLevel>(level);
+    }
+    LOG_WARNING(General, "unknown GDV_SIMD={}, expected scalar, sse4.2, avx2 or avx512", value);
+    return detected;
+}
+
+} // namespace
+
+SimdLevel detectedSimdLevel()
+{
+    static const SimdLevel level = detect();
+    return level;
+}
+
+SimdLevel activeSimdLevel()
+{
+    static const SimdLevel level = select();
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    static const char* names[] = {"scalar", "sse4.2", "avx2", "avx512"};
+    return level < SimdLevel::Count ? names[static_cast<size_t>(level)] : "unknown";
+}
@@ -0,0 +1,28 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Detection of the SIMD instruction sets of the CPU                //
+// ========================================================================= //
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+#include <cstdint>
+
+// Instruction set levels the SIMD kernels are compiled for, each one includes the ones before
+enum class SimdLevel : uint8_t { Scalar, SSE42, AVX2, AVX512, Count };
+
+// Highest level the CPU and the operating system support, detected once with cpuid and xgetbv.
+// Scalar on other architectures.
+SimdLevel detectedSimdLevel();
+
+// Level the kernels run with: the detected one, or the one set by GDV_SIMD=scalar|sse4.2|avx2|avx512.
+// A level above the detected one is not used.
+SimdLevel activeSimdLevel();
+
+const char* simdLevelName(SimdLevel level);
+
+#endif // CPUFEATURES_H
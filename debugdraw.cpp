@@ -0,0 +1,174 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Batched debug lines, boxes and normals, drawn once per frame     //
+// ========================================================================= //
+
+#include <cstddef>
+
+#include "debugdraw.h"
+#include "profiler.h"
+#include "renderstate.h"
+#include "shader.h"
+#include "utilities.h"
+
+void DebugDraw::initialize(GLFunctions *f, GLuint lineProgram, GLuint normalProgram)
+{
+    this->f = f;
+    this->lineProgram = lineProgram;
+    this->normalProgram = normalProgram;
+    instancedUniform = lineProgram ? f->glGetUniformLocation(lineProgram, "instanced") : -1;
+
+    // lines: interleaved position and color, streamed every frame
+    f->glGenVertexArrays(1, &lineVAO);
+    f->glGenBuffers(1, &lineVBO);
+    f->glBindVertexArray(lineVAO);
+    f->glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
+    f->glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(LineVertex), reinterpret_cast<void *>(offsetof(LineVertex, position)));
+    f->glEnableVertexAttribArray(POSITION_LOCATION);
+    f->glVertexAttribPointer(COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(LineVertex), reinterpret_cast<void *>(offsetof(LineVertex, color)));
+    f->glEnableVertexAttribArray(COLOR_LOCATION);
+
+    // boxes: unit box per vertex, matrix and color per instance
+    f->glGenVertexArrays(1, &boxVAO);
+    f->glGenBuffers(1, &boxVBO);
+    f->glGenBuffers(1, &boxIBO);
+    f->glGenBuffers(1, &instanceVBO);
+    f->glBindVertexArray(boxVAO);
+    f->glBindBuffer(GL_ARRAY_BUFFER, boxVBO);
+    f->glBufferData(GL_ARRAY_BUFFER, BoxVerticesSize, BoxVertices, GL_STATIC_DRAW);
+    f->glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    f->glEnableVertexAttribArray(POSITION_LOCATION);
+    f->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxIBO);
+    f->glBufferData(GL_ELEMENT_ARRAY_BUFFER, BoxLineIndicesSize, BoxLineIndices, GL_STATIC_DRAW);
+    f->glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        const GLuint location = INSTANCE_MATRIX_LOCATION + column;
+        f->glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(BoxInstance),
+                                 reinterpret_cast<void *>(offsetof(BoxInstance, modelView) + 4 * column * sizeof(float)));
+        f->glEnableVertexAttribArray(location);
+        f->glVertexAttribDivisor(location, 1);
+    }
+    f->glVertexAttribPointer(COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(BoxInstance), reinterpret_cast<void *>(offsetof(BoxInstance, color)));
+    f->glEnableVertexAttribArray(COLOR_LOCATION);
+    f->glVertexAttribDivisor(COLOR_LOCATION, 1);
+
+    f->glBindVertexArray(0);
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    f->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void DebugDraw::cleanup()
+{
+    if (!f)
+        return;
+    for (GLuint *vertexArray : {&lineVAO, &boxVAO})
+    {
+        if (*vertexArray != 0)
+            f->glDeleteVertexArrays(1, vertexArray);
+        *vertexArray = 0;
+    }
+    for (GLuint *buffer : {&lineVBO, &boxVBO, &boxIBO, &instanceVBO})
+    {
+        if (*buffer != 0)
+            f->glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    lineVertices.clear();
+    boxInstances.clear();
+    normalDraws.clear();
+    f = nullptr;
+}
+
+void DebugDraw::line(const QMatrix4x4 &modelView, const Vec3f &from, const Vec3f &to, const Vec3f &color)
+{
+    // transformed here, so lines of any model view matrix share one draw
+    const float *m = modelView.constData();
+    for (const Vec3f *p : {&from, &to})
+    {
+        LineVertex vertex;
+        for (int row = 0; row < 3; ++row)
+            vertex.position[row] = m[row] * p->x() + m[4 + row] * p->y() + m[8 + row] * p->z() + m[12 + row];
+        vertex.color[0] = color.x();
+        vertex.color[1] = color.y();
+        vertex.color[2] = color.z();
+        lineVertices.push_back(vertex);
+    }
+}
+
+void DebugDraw::box(const QMatrix4x4 &modelView, const Vec3f &center, const Vec3f &size, const Vec3f &color)
+{
+    // modelView * translate(center) * scale(size), without the general matrix product
+    const float *m = modelView.constData();
+    BoxInstance instance;
+    for (int column = 0; column < 3; ++column)
+    {
+        for (int row = 0; row < 4; ++row)
+            instance.modelView[4 * column + row] = m[4 * column + row] * size[column];
+    }
+    for (int row = 0; row < 4; ++row)
+        instance.modelView[12 + row] = m[row] * center.x() + m[4 + row] * center.y() + m[8 + row] * center.z() + m[12 + row];
+    instance.color[0] = color.x();
+    instance.color[1] = color.y();
+    instance.color[2] = color.z();
+    boxInstances.push_back(instance);
+}
+
+void DebugDraw::normals(const QMatrix4x4 &modelView, GLuint vertexArray, unsigned int vertexCount)
+{
+    if (vertexArray != 0 && vertexCount != 0)
+        normalDraws.push_back({modelView, vertexArray, vertexCount});
+}
+
+void DebugDraw::flush(RenderState &state)
+{
+    PROFILE_FUNCTION();
+    if (!f || (lineVertices.empty() && boxInstances.empty() && normalDraws.empty()))
+        return;
+    if (lineProgram != 0 && (!lineVertices.empty() || !boxInstances.empty()))
+    {
+        state.setCurrentProgram(lineProgram);
+        f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
+        if (!lineVertices.empty())
+        {
+            // a new buffer store every frame, the driver does not have to wait for the last frame's draw
+            f->glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
+            f->glBufferData(GL_ARRAY_BUFFER, lineVertices.size() * sizeof(LineVertex), lineVertices.data(), GL_STREAM_DRAW);
+            f->glUniform1ui(instancedUniform, GL_FALSE);
+            f->glBindVertexArray(lineVAO);
+            f->glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(lineVertices.size()));
+            state.countDrawCall();
+        }
+        if (!boxInstances.empty())
+        {
+            f->glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            f->glBufferData(GL_ARRAY_BUFFER, boxInstances.size() * sizeof(BoxInstance), boxInstances.data(), GL_STREAM_DRAW);
+            f->glUniform1ui(instancedUniform, GL_TRUE);
+            f->glBindVertexArray(boxVAO);
+            f->glDrawElementsInstanced(GL_LINES, 24, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(boxInstances.size()));
+            state.countDrawCall();
+        }
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    if (normalProgram != 0 && !normalDraws.empty())
+    {
+        state.setCurrentProgram(normalProgram);
+        f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
+        for (const NormalDraw &draw : normalDraws)
+        {
+            // one point per vertex of the mesh VAO, normals.geom turns each into a line along the normal
+            f->glUniformMatrix4fv(state.getModelViewUniform(), 1, GL_FALSE, draw.modelView.constData());
+            f->glBindVertexArray(draw.vertexArray);
+            f->glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(draw.vertexCount));
+            state.countDrawCall();
+        }
+    }
+    f->glBindVertexArray(0);
+    lineVertices.clear();
+    boxInstances.clear();
+    normalDraws.clear();
+}
@@ -0,0 +1,82 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Batched debug lines, boxes and normals, drawn once per frame     //
+// ========================================================================= //
+
+#ifndef DEBUGDRAW_H
+#define DEBUGDRAW_H
+
+#include <vector>
+
+#include <QMatrix4x4>
+
+#include "glfunctions.h"
+#include "vec3.h"
+
+class RenderState;
+
+/*
+ * Immediate style debug geometry. line(), box() and normals() can be called from anywhere during a frame
+ * (e.g. TriangleMesh::drawVisible(), through RenderState::getDebugDraw()); they only append to arrays on
+ * the CPU. flush() streams the lines into one buffer and the boxes into one instance buffer and draws them
+ * with one draw each, the boxes as instances of a unit box. Normals are drawn from the VAO of their mesh by
+ * the geometry shader program, one draw per mesh but without switching programs in between.
+ */
+class DebugDraw {
+public:
+    DebugDraw() = default;
+    ~DebugDraw() = default;
+    DebugDraw(const DebugDraw& other) = delete;
+    DebugDraw& operator= (const DebugDraw& other) = delete;
+
+    // creates the buffers. lineProgram draws the lines and boxes (debug_lines.vert), normalProgram the
+    // normals (normals.vert/geom). The programs stay owned by the caller. Needs a current OpenGL context.
+    void initialize(GLFunctions* f, GLuint lineProgram, GLuint normalProgram);
+    // deletes the buffers, needs the context of initialize()
+    void cleanup();
+
+    // line from 'from' to 'to' in the coordinates of modelView
+    void line(const QMatrix4x4& modelView, const Vec3f& from, const Vec3f& to, const Vec3f& color);
+    // axis aligned box in the coordinates of modelView, wired
+    void box(const QMatrix4x4& modelView, const Vec3f& center, const Vec3f& size, const Vec3f& color);
+    // normals of the vertexCount vertices of vertexArray (position and normal attributes)
+    void normals(const QMatrix4x4& modelView, GLuint vertexArray, unsigned int vertexCount);
+
+    // Draws everything appended since the last flush() over the current frame and clears it. Leaves the
+    // line or normal program current.
+    void flush(RenderState& state);
+
+    size_t getLineCount() const { return lineVertices.size() / 2; }
+    size_t getBoxCount() const { return boxInstances.size(); }
+
+private:
+    struct LineVertex {
+        float position[3]; // in eye coordinates
+        float color[3];
+    };
+    struct BoxInstance {
+        float modelView[16]; // unit box to eye coordinates, column-major
+        float color[3];
+    };
+    struct NormalDraw {
+        QMatrix4x4 modelView;
+        GLuint vertexArray;
+        unsigned int vertexCount;
+    };
+
+    std::vector<LineVertex> lineVertices;
+    std::vector<BoxInstance> boxInstances;
+    std::vector<NormalDraw> normalDraws;
+
+    GLFunctions* f = nullptr;
+    GLuint lineProgram = 0, normalProgram = 0;
+    GLint instancedUniform = -1;
+    GLuint lineVAO = 0, lineVBO = 0;
+    GLuint boxVAO = 0, boxVBO = 0, boxIBO = 0, instanceVBO = 0;
+};
+
+#endif // DEBUGDRAW_H
@@ -0,0 +1,307 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: G-buffer and light passes of the deferred shading path, with     //
+//          stencil-marked light volumes                                     //
+// ========================================================================= //
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <QMatrix4x4>
+
+#include "deferredrenderer.h"
+#include "log.h"
+#include "pointlights.h"
+#include "profiler.h"
+#include "renderstate.h"
+#include "shader.h"
+
+namespace {
+
+// instance attributes of light_volume.vert, (position, radius) and (color, 0) of PointLights
+constexpr GLuint LIGHT_LOCATION = 5;
+constexpr GLuint LIGHT_COLOR_LOCATION = 6;
+
+// longitude and latitude divisions of the light volume
+constexpr int volumeSlices = 12;
+constexpr int volumeStacks = 8;
+
+} // namespace
+
+void DeferredRenderer::initialize(GLFunctions *f, GLuint sunProgram, GLuint volumeStencilProgram, GLuint lightProgram)
+{
+    this->f = f;
+    this->sunProgram = sunProgram;
+    this->volumeStencilProgram = volumeStencilProgram;
+    this->lightProgram = lightProgram;
+    createVolumeMesh();
+}
+
+void DeferredRenderer::cleanup()
+{
+    if (!f)
+        return;
+    deleteGBuffer();
+    if (volumeVAO != 0)
+        f->glDeleteVertexArrays(1, &volumeVAO);
+    for (GLuint *buffer : {&volumeVBO, &volumeIBO})
+    {
+        if (*buffer != 0)
+            f->glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    volumeVAO = 0;
+    volumeIndexCount = 0;
+    sunProgram = volumeStencilProgram = lightProgram = 0;
+    f = nullptr;
+}
+
+void DeferredRenderer::createVolumeMesh()
+{
+    // UV sphere: the poles and volumeStacks - 1 rings of volumeSlices vertices
+    std::vector<float> positions;
+    positions.reserve(3 * (2 + (volumeStacks - 1) * volumeSlices));
+    auto addVertex = [&](float theta, float phi) {
+        positions.push_back(std::sin(theta) * std::cos(phi));
+        positions.push_back(std::cos(theta));
+        positions.push_back(std::sin(theta) * std::sin(phi));
+    };
+    const float pi = static_cast<float>(M_PI);
+    addVertex(0.0f, 0.0f);
+    for (int stack = 1; stack < volumeStacks; ++stack)
+    {
+        for (int slice = 0; slice < volumeSlices; ++slice)
+            addVertex(pi * stack / volumeStacks, 2.0f * pi * slice / volumeSlices);
+    }
+    addVertex(pi, 0.0f);
+    const GLuint bottom = static_cast<GLuint>(positions.size() / 3 - 1);
+    auto ring = [](int stack, int slice) {
+        return static_cast<GLuint>(1 + (stack - 1) * volumeSlices + slice % volumeSlices);
+    };
+
+    // counterclockwise seen from outside
+    std::vector<GLuint> indices;
+    for (int slice = 0; slice < volumeSlices; ++slice)
+    {
+        indices.insert(indices.end(), {0, ring(1, slice + 1), ring(1, slice)});
+        for (int stack = 1; stack < volumeStacks - 1; ++stack)
+        {
+            indices.insert(indices.end(), {ring(stack, slice), ring(stack, slice + 1), ring(stack + 1, slice)});
+            indices.insert(indices.end(), {ring(stack + 1, slice), ring(stack, slice + 1), ring(stack + 1, slice + 1)});
+        }
+        indices.insert(indices.end(), {bottom, ring(volumeStacks - 1, slice), ring(volumeStacks - 1, slice + 1)});
+    }
+
+    // the faces lie within the unit sphere; scaled by the inverse distance of the closest face plane, the
+    // polyhedron encloses the sphere and every lit point is inside the volume
+    float closest = 1.0f;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const float *a = &positions[3 * indices[i]], *b = &positions[3 * indices[i + 1]], *c = &positions[3 * indices[i + 2]];
+        const float u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        const float v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        const float n[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        closest = std::min(closest, (n[0] * a[0] + n[1] * a[1] + n[2] * a[2]) / length);
+    }
+    for (float &coordinate : positions)
+        coordinate /= closest;
+    volumeIndexCount = static_cast<GLsizei>(indices.size());
+
+    f->glGenVertexArrays(1, &volumeVAO);
+    f->glGenBuffers(1, &volumeVBO);
+    f->glGenBuffers(1, &volumeIBO);
+    f->glBindVertexArray(volumeVAO);
+    f->glBindBuffer(GL_ARRAY_BUFFER, volumeVBO);
+    f->glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(positions.size() * sizeof(float)), positions.data(), GL_STATIC_DRAW);
+    f->glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    f->glEnableVertexAttribArray(POSITION_LOCATION);
+    f->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, volumeIBO);
+    f->glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(GLuint)), indices.data(), GL_STATIC_DRAW);
+    // the pointers into the light buffer are set per batch in drawPointLights()
+    for (GLuint location : {LIGHT_LOCATION, LIGHT_COLOR_LOCATION})
+    {
+        f->glEnableVertexAttribArray(location);
+        f->glVertexAttribDivisor(location, 1);
+    }
+    f->glBindVertexArray(0);
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    f->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+bool DeferredRenderer::prepareGBuffer(int width, int height)
+{
+    if (gBufferFBO != 0 && width == this->width && height == this->height)
+        return true;
+    deleteGBuffer();
+
+    auto createTexture = [&](GLuint &texture, GLint internalFormat, GLenum format, GLenum type) {
+        f->glGenTextures(1, &texture);
+        f->glBindTexture(GL_TEXTURE_2D, texture);
+        f->glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        // read with texelFetch only, but without mipmaps the texture is incomplete with the default filter
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    };
+    createTexture(albedoTexture, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+    createTexture(normalTexture, GL_RG16F, GL_RG, GL_HALF_FLOAT);
+    createTexture(depthTexture, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLint formerFramebuffer = 0;
+    f->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &formerFramebuffer);
+    f->glGenFramebuffers(1, &gBufferFBO);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, gBufferFBO);
+    f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTexture, 0);
+    f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
+    f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    f->glDrawBuffers(2, drawBuffers);
+    const bool complete = f->glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    f->glBindFramebuffer(GL_FRAMEBUFFER, formerFramebuffer);
+    if (!complete)
+    {
+        LOG_WARNING(Render, "DeferredRenderer: G-buffer of {}x{} is incomplete", width, height);
+        deleteGBuffer();
+        return false;
+    }
+    this->width = width;
+    this->height = height;
+    return true;
+}
+
+void DeferredRenderer::deleteGBuffer()
+{
+    if (gBufferFBO != 0)
+        f->glDeleteFramebuffers(1, &gBufferFBO);
+    for (GLuint *texture : {&albedoTexture, &normalTexture, &depthTexture})
+    {
+        if (*texture != 0)
+            f->glDeleteTextures(1, texture);
+        *texture = 0;
+    }
+    gBufferFBO = 0;
+    width = height = 0;
+}
+
+bool DeferredRenderer::beginGeometry(int width, int height)
+{
+    if (!f || !prepareGBuffer(width, height))
+        return false;
+    f->glBindFramebuffer(GL_FRAMEBUFFER, gBufferFBO);
+    // the clear color is black, i.e. no albedo and the normal (0, 0), which decodes to (0, 0, 1)
+    f->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    return true;
+}
+
+void DeferredRenderer::endGeometry(GLuint targetFramebuffer)
+{
+    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, gBufferFBO);
+    f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+    f->glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+}
+
+void DeferredRenderer::bindGBufferTextures(bool bind)
+{
+    const std::pair<GLuint, GLuint> textures[] = {{albedoUnit, albedoTexture}, {normalUnit, normalTexture}, {depthUnit, depthTexture}};
+    for (const auto &[unit, texture] : textures)
+    {
+        f->glActiveTexture(GL_TEXTURE0 + unit);
+        f->glBindTexture(GL_TEXTURE_2D, bind ? texture : 0);
+    }
+    f->glActiveTexture(GL_TEXTURE0);
+}
+
+void DeferredRenderer::useLightProgram(RenderState &state, GLuint program, const QMatrix4x4 &inverseProjection)
+{
+    state.setCurrentProgram(program);
+    f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
+    f->glUniformMatrix4fv(f->glGetUniformLocation(program, "inverseProjection"), 1, GL_FALSE, inverseProjection.constData());
+    f->glUniform1i(f->glGetUniformLocation(program, "albedoTexture"), albedoUnit);
+    f->glUniform1i(f->glGetUniformLocation(program, "normalTexture"), normalUnit);
+    f->glUniform1i(f->glGetUniformLocation(program, "depthTexture"), depthUnit);
+}
+
+void DeferredRenderer::drawMainLight(RenderState &state)
+{
+    PROFILE_FUNCTION();
+    if (sunProgram == 0 || gBufferFBO == 0)
+        return;
+    bindGBufferTextures(true);
+    useLightProgram(state, sunProgram, state.getCurrentProjectionMatrix().inverted());
+    state.setLightUniform();
+    // every pixel once; the sky keeps the depth 1 and is discarded
+    f->glDisable(GL_DEPTH_TEST);
+    f->glBindVertexArray(volumeVAO); // fullscreen.vert reads no attributes, any VAO will do
+    f->glDrawArrays(GL_TRIANGLES, 0, 3);
+    state.countDrawCall();
+    f->glBindVertexArray(0);
+    f->glEnable(GL_DEPTH_TEST);
+    bindGBufferTextures(false);
+}
+
+void DeferredRenderer::drawPointLights(RenderState &state, const PointLights &lights)
+{
+    PROFILE_FUNCTION();
+    const unsigned int count = lights.getCount();
+    if (count == 0 || lights.getBuffer() == 0 || volumeStencilProgram == 0 || lightProgram == 0 || gBufferFBO == 0)
+        return;
+    bindGBufferTextures(true);
+    const QMatrix4x4 inverseProjection = state.getCurrentProjectionMatrix().inverted();
+    const GLsizei stride = static_cast<GLsizei>(PointLights::floatsPerLight * sizeof(float));
+
+    f->glBindVertexArray(volumeVAO);
+    f->glBindBuffer(GL_ARRAY_BUFFER, lights.getBuffer());
+    f->glEnable(GL_STENCIL_TEST);
+    f->glDepthMask(GL_FALSE);
+    f->glBlendFunc(GL_ONE, GL_ONE);
+    for (unsigned int first = 0; first < count; first += lightsPerBatch)
+    {
+        const GLsizei batch = static_cast<GLsizei>(std::min(lightsPerBatch, count - first));
+        const size_t offset = first * static_cast<size_t>(stride);
+        f->glVertexAttribPointer(LIGHT_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offset));
+        f->glVertexAttribPointer(LIGHT_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offset + 4 * sizeof(float)));
+
+        // stencil pass: per pixel the number of volumes around its surface. Only the depth fails count, so
+        // it does not matter whether the camera is inside a volume and its front faces are clipped.
+        useLightProgram(state, volumeStencilProgram, inverseProjection);
+        f->glClear(GL_STENCIL_BUFFER_BIT);
+        f->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        f->glDepthFunc(GL_LESS);
+        f->glStencilFunc(GL_ALWAYS, 0, 0xff);
+        f->glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        f->glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+        f->glDrawElementsInstanced(GL_TRIANGLES, volumeIndexCount, GL_UNSIGNED_INT, nullptr, batch);
+        state.countDrawCall();
+
+        // lighting pass: the back faces behind the surface, once per light and pixel
+        useLightProgram(state, lightProgram, inverseProjection);
+        f->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        f->glDepthFunc(GL_GEQUAL);
+        f->glEnable(GL_CULL_FACE);
+        f->glCullFace(GL_FRONT);
+        f->glStencilFunc(GL_NOTEQUAL, 0, 0xff);
+        f->glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+        f->glEnable(GL_BLEND);
+        f->glDrawElementsInstanced(GL_TRIANGLES, volumeIndexCount, GL_UNSIGNED_INT, nullptr, batch);
+        state.countDrawCall();
+        f->glDisable(GL_BLEND);
+        f->glCullFace(GL_BACK);
+        f->glDisable(GL_CULL_FACE);
+    }
+    f->glBindVertexArray(0);
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    f->glDisable(GL_STENCIL_TEST);
+    f->glDepthFunc(GL_LESS);
+    f->glDepthMask(GL_TRUE);
+    bindGBufferTextures(false);
+}
@@ -0,0 +1,92 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: G-buffer and light passes of the deferred shading path, with     //
+//          stencil-marked light volumes                                     //
+// ========================================================================= //
+
+#ifndef DEFERREDRENDERER_H
+#define DEFERREDRENDERER_H
+
+#include <QMatrix4x4>
+
+#include "glfunctions.h"
+
+class PointLights;
+class RenderState;
+
+/*
+ * The geometry passes write their surfaces into a G-buffer of 12 bytes per pixel instead of shading them:
+ *   - albedo, GL_RGBA8: the base color, alpha holds the material bits (materialSpecular) divided by 255
+ *   - normal, GL_RG16F: the view space normal, octahedral encoded
+ *   - depth, GL_DEPTH24_STENCIL8: the view space position is reconstructed from it with the inverse projection
+ * The light passes then shade every pixel once per light that reaches it. The main light is one full-screen
+ * triangle. The point lights are drawn as instanced spheres around their radius, in batches of at most
+ * lightsPerBatch: first the stencil buffer counts for every pixel the volumes whose inside contains its
+ * surface (back faces behind the surface increment, front faces behind it decrement), then the back faces of
+ * the volumes add their light with additive blending where the count is not zero. Pixels no light of the
+ * batch reaches, e.g. the sky or surfaces in front of all volumes, are not shaded at all.
+ *
+ * The G-buffer shaders are gbuffer.frag and gbuffer_bump.frag; the light passes use fullscreen.vert with
+ * deferred_sun.frag, light_volume.vert with depth_only.frag and light_volume.vert with deferred_light.frag.
+ */
+class DeferredRenderer
+{
+public:
+    // material bits in the alpha channel of the albedo, see gbuffer_bump.frag
+    static constexpr unsigned int materialSpecular = 1;
+    // the stencil counts of one batch must not wrap around to zero
+    static constexpr unsigned int lightsPerBatch = 255;
+    // texture units of albedo, normal and depth during the light passes
+    static constexpr GLuint albedoUnit = 0, normalUnit = 1, depthUnit = 2;
+
+    DeferredRenderer() = default;
+    ~DeferredRenderer() = default;
+    DeferredRenderer(const DeferredRenderer& other) = delete;
+    DeferredRenderer& operator= (const DeferredRenderer& other) = delete;
+
+    // The programs stay owned by the caller: the full-screen main light, the stencil pass and the lighting
+    // pass of the light volumes. Needs a current OpenGL context.
+    void initialize(GLFunctions* f, GLuint sunProgram, GLuint volumeStencilProgram, GLuint lightProgram);
+    // deletes the G-buffer and the volume mesh, needs the context of initialize()
+    void cleanup();
+
+    // Binds the G-buffer of size width x height and clears it; the geometry is drawn with the G-buffer shaders
+    // afterwards. False if the G-buffer could not be created, the framebuffer binding is unchanged then.
+    bool beginGeometry(int width, int height);
+    // Copies the depth of the G-buffer into targetFramebuffer, which needs a depth and stencil buffer of the
+    // same size and format, and binds it. The light passes add to its color, which should be cleared.
+    void endGeometry(GLuint targetFramebuffer);
+    // Adds the light at the light position of state, with the current model view matrix as the camera.
+    void drawMainLight(RenderState& state);
+    // adds the light of all lights, uploaded for the current camera
+    void drawPointLights(RenderState& state, const PointLights& lights);
+
+    // bytes of the G-buffer attachments
+    size_t getGBufferBytes() const { return static_cast<size_t>(width) * static_cast<size_t>(height) * 12; }
+
+private:
+    GLFunctions* f = nullptr;
+    GLuint sunProgram = 0, volumeStencilProgram = 0, lightProgram = 0;
+
+    GLuint gBufferFBO = 0, albedoTexture = 0, normalTexture = 0, depthTexture = 0;
+    int width = 0, height = 0;
+
+    // unit sphere that encloses the radius, instanced per light
+    GLuint volumeVAO = 0, volumeVBO = 0, volumeIBO = 0;
+    GLsizei volumeIndexCount = 0;
+
+    void createVolumeMesh();
+    bool prepareGBuffer(int width, int height);
+    void deleteGBuffer();
+    // binds the G-buffer textures to their units or unbinds them, so the next geometry pass, which renders
+    // into them, can not sample them by accident
+    void bindGBufferTextures(bool bind);
+    // makes program current with the matrices and the G-buffer texture units
+    void useLightProgram(RenderState& state, GLuint program, const QMatrix4x4& inverseProjection);
+};
+
+#endif // DEFERREDRENDERER_H
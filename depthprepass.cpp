@@ -0,0 +1,69 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Chooses per render pass whether a depth-only pass is drawn       //
+//          before the shading pass                                          //
+// ========================================================================= //
+
+#include "depthprepass.h"
+
+void DepthPrepassSelector::setMode(DepthPrepassMode mode)
+{
+    this->mode = mode;
+    phase = Phase::ProbeWithout;
+    restart = true;
+    chosen = false;
+    settledFrames = 0;
+}
+
+bool DepthPrepassSelector::usePrepass() const
+{
+    switch (mode)
+    {
+    case DepthPrepassMode::Off:
+        return false;
+    case DepthPrepassMode::On:
+        return true;
+    case DepthPrepassMode::Auto:
+        break;
+    }
+    return phase == Phase::ProbeWith || (phase == Phase::Settled && chosen);
+}
+
+bool DepthPrepassSelector::update(const Cost &without, const Cost &with)
+{
+    if (mode != DepthPrepassMode::Auto)
+        return false;
+    if (restart)
+    {
+        restart = false;
+        return true;
+    }
+    switch (phase)
+    {
+    case Phase::ProbeWithout:
+        if (without.samples < probeFrames)
+            return false;
+        msWithout = without.ms;
+        phase = Phase::ProbeWith;
+        return true;
+    case Phase::ProbeWith:
+        if (with.samples < probeFrames)
+            return false;
+        msWith = with.ms;
+        chosen = msWith < (1.0 - minimumGain) * msWithout;
+        phase = Phase::Settled;
+        settledFrames = 0;
+        return false;
+    case Phase::Settled:
+        // the view, the grid size or the shader may have changed the balance
+        if (++settledFrames < settleFrames)
+            return false;
+        phase = Phase::ProbeWithout;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,68 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Chooses per render pass whether a depth-only pass is drawn       //
+//          before the shading pass                                          //
+// ========================================================================= //
+
+#ifndef DEPTHPREPASS_H
+#define DEPTHPREPASS_H
+
+enum class DepthPrepassMode {
+    Off,
+    On,
+    Auto, // measured, see DepthPrepassSelector
+};
+
+/*
+ * A depth pre-pass draws the geometry of a pass without color first, then the shading pass draws it again
+ * with GL_LEQUAL and depth writes off, so the expensive fragment shader runs only once per pixel. Whether
+ * that pays off depends on the overdraw and on the fragment cost, so in Auto mode the selector measures the
+ * GPU time of the pass without a pre-pass for probeFrames frames, then with a pre-pass (depth plus shading),
+ * keeps the faster variant for settleFrames frames and measures again. The pre-pass has to save at least
+ * minimumGain of the time, otherwise the pass is drawn once.
+ */
+class DepthPrepassSelector
+{
+public:
+    static constexpr int probeFrames = 30;
+    static constexpr int settleFrames = 900;
+    static constexpr double minimumGain = 0.03;
+
+    // GPU time of one variant, averaged over 'samples' frames since its measurement started
+    struct Cost {
+        double ms = 0.0;
+        int samples = 0;
+    };
+
+    void setMode(DepthPrepassMode mode);
+    DepthPrepassMode getMode() const { return mode; }
+
+    // whether the current frame draws the pre-pass
+    bool usePrepass() const;
+
+    // Called once per frame with the measurements of both variants. Returns true if the measurement of a
+    // variant starts, the caller then restarts the averages of that pass.
+    bool update(const Cost& without, const Cost& with);
+
+    // the latest complete measurements, 0 before the first one
+    double getMsWithout() const { return msWithout; }
+    double getMsWith() const { return msWith; }
+    // whether Auto currently chose the pre-pass
+    bool isPrepassChosen() const { return chosen; }
+
+private:
+    enum class Phase { ProbeWithout, ProbeWith, Settled };
+
+    DepthPrepassMode mode = DepthPrepassMode::Off;
+    Phase phase = Phase::ProbeWithout;
+    bool restart = true; // the next update() starts the measurement of the current phase
+    bool chosen = false;
+    int settledFrames = 0;
+    double msWithout = 0.0, msWith = 0.0;
+};
+
+#endif // DEPTHPREPASS_H
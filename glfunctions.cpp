@@ -0,0 +1,745 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: OpenGL 3.3 core functions that can record the calls of the      //
+//          scene into a GLTrace                                             //
+// ========================================================================= //
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <QOpenGLContext>
+
+#include "glfunctions.h"
+
+namespace {
+
+// object names in creation order (as far as the driver hands them out ascending), so traces are reproducible
+std::vector<GLuint> sortedNames(const std::unordered_set<GLuint> &names)
+{
+    std::vector<GLuint> result(names.begin(), names.end());
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<GLuint> sortedNames(const std::unordered_map<GLuint, GLenum> &names)
+{
+    std::vector<GLuint> result;
+    result.reserve(names.size());
+    for (const auto &name : names)
+        result.push_back(name.first);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// Format and type to read back a texture level without losing precision, and the resulting bytes per pixel.
+// All of them are multiples of 4, so the rows never need padding.
+struct PixelTransfer {
+    GLenum format, type;
+    int bytesPerPixel;
+};
+
+PixelTransfer pixelTransferFor(GLint internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_DEPTH_COMPONENT:
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32:
+    case GL_DEPTH_COMPONENT32F:
+        return {GL_DEPTH_COMPONENT, GL_FLOAT, 4};
+    case GL_DEPTH24_STENCIL8:
+        return {GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4};
+    case GL_DEPTH32F_STENCIL8:
+        return {GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, 8};
+    case GL_R8I: case GL_R16I: case GL_R32I: case GL_RG8I: case GL_RG16I: case GL_RG32I:
+    case GL_RGB8I: case GL_RGB16I: case GL_RGB32I: case GL_RGBA8I: case GL_RGBA16I: case GL_RGBA32I:
+        return {GL_RGBA_INTEGER, GL_INT, 16};
+    case GL_R8UI: case GL_R16UI: case GL_R32UI: case GL_RG8UI: case GL_RG16UI: case GL_RG32UI:
+    case GL_RGB8UI: case GL_RGB16UI: case GL_RGB32UI: case GL_RGBA8UI: case GL_RGBA16UI: case GL_RGBA32UI:
+        return {GL_RGBA_INTEGER, GL_UNSIGNED_INT, 16};
+    case GL_R16F: case GL_RG16F: case GL_RGB16F: case GL_RGBA16F:
+    case GL_R32F: case GL_RG32F: case GL_RGB32F: case GL_RGBA32F: case GL_R11F_G11F_B10F:
+        return {GL_RGBA, GL_FLOAT, 16};
+    default:
+        return {GL_RGBA, GL_UNSIGNED_BYTE, 4};
+    }
+}
+
+// bytes of an image passed to glTexImage2D with the default unpack alignment of 4
+size_t imageSize(GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+    int components = 4;
+    switch (format)
+    {
+    case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+        components = 1;
+        break;
+    case GL_RG: case GL_RG_INTEGER:
+        components = 2;
+        break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+        components = 3;
+        break;
+    case GL_DEPTH_STENCIL:
+        components = 1; // packed types
+        break;
+    }
+    int componentBytes = 1;
+    switch (type)
+    {
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+        componentBytes = 2;
+        break;
+    case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV: case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_10F_11F_11F_REV:
+        componentBytes = 4;
+        break;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+        componentBytes = 8;
+        break;
+    }
+    if (type == GL_UNSIGNED_INT_8_8_8_8 || type == GL_UNSIGNED_INT_8_8_8_8_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV
+        || type == GL_UNSIGNED_INT_10F_11F_11F_REV)
+        components = 1;
+    const size_t rowBytes = (static_cast<size_t>(width) * components * componentBytes + 3) / 4 * 4;
+    return rowBytes * static_cast<size_t>(height);
+}
+
+} // namespace
+
+void GLFunctions::beginCapture(GLTrace *trace)
+{
+    endCapture();
+    trace->clear();
+    snapshot(*trace);
+    trace->setupCommands = trace->commands.size();
+    this->trace = trace;
+}
+
+void GLFunctions::endCaptureFrame()
+{
+    if (trace)
+        trace->add(GLTraceOp::FrameEnd, {});
+}
+
+void GLFunctions::endCapture()
+{
+    trace = nullptr;
+}
+
+void GLFunctions::recordNames(GLTraceOp op, GLsizei n, const GLuint *names)
+{
+    if (trace && n > 0)
+        trace->add(op, {n}, trace->addBlob(names, sizeof(GLuint) * static_cast<size_t>(n)));
+}
+
+void GLFunctions::glBindTexture(GLenum target, GLuint texture)
+{
+    record(GLTraceOp::BindTexture, {target, texture});
+    Base::glBindTexture(target, texture);
+    // a texture gets its target on the first binding
+    if (texture != 0)
+    {
+        auto it = textures.find(texture);
+        if (it != textures.end() && it->second == 0)
+            it->second = target;
+    }
+}
+
+void GLFunctions::glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+    if (trace)
+        trace->add(GLTraceOp::BufferData, {target, size, usage},
+                   data ? trace->addBlob(data, static_cast<size_t>(size)) : GLTraceCommand::noBlob);
+    Base::glBufferData(target, size, data, usage);
+}
+
+void GLFunctions::glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+    if (trace)
+        trace->add(GLTraceOp::BufferSubData, {target, offset, size}, trace->addBlob(data, static_cast<size_t>(size)));
+    Base::glBufferSubData(target, offset, size, data);
+}
+
+GLuint GLFunctions::glCreateProgram()
+{
+    const GLuint program = Base::glCreateProgram();
+    programs.insert(program);
+    record(GLTraceOp::CreateProgram, {program});
+    return program;
+}
+
+GLuint GLFunctions::glCreateShader(GLenum type)
+{
+    const GLuint shader = Base::glCreateShader(type);
+    record(GLTraceOp::CreateShader, {shader, type});
+    return shader;
+}
+
+void GLFunctions::glDeleteBuffers(GLsizei n, const GLuint *buffers)
+{
+    recordNames(GLTraceOp::DeleteBuffers, n, buffers);
+    for (GLsizei i = 0; i < n; ++i)
+        this->buffers.erase(buffers[i]);
+    Base::glDeleteBuffers(n, buffers);
+}
+
+void GLFunctions::glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+    recordNames(GLTraceOp::DeleteFramebuffers, n, framebuffers);
+    for (GLsizei i = 0; i < n; ++i)
+        this->framebuffers.erase(framebuffers[i]);
+    Base::glDeleteFramebuffers(n, framebuffers);
+}
+
+void GLFunctions::glDeleteProgram(GLuint program)
+{
+    record(GLTraceOp::DeleteProgram, {program});
+    programs.erase(program);
+    Base::glDeleteProgram(program);
+}
+
+void GLFunctions::glDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers)
+{
+    recordNames(GLTraceOp::DeleteRenderbuffers, n, renderbuffers);
+    for (GLsizei i = 0; i < n; ++i)
+        this->renderbuffers.erase(renderbuffers[i]);
+    Base::glDeleteRenderbuffers(n, renderbuffers);
+}
+
+void GLFunctions::glDeleteTextures(GLsizei n, const GLuint *textures)
+{
+    recordNames(GLTraceOp::DeleteTextures, n, textures);
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        this->textures.erase(textures[i]);
+        textureBuffers.erase(textures[i]);
+    }
+    Base::glDeleteTextures(n, textures);
+}
+
+void GLFunctions::glDeleteVertexArrays(GLsizei n, const GLuint *arrays)
+{
+    recordNames(GLTraceOp::DeleteVertexArrays, n, arrays);
+    for (GLsizei i = 0; i < n; ++i)
+        vertexArrays.erase(arrays[i]);
+    Base::glDeleteVertexArrays(n, arrays);
+}
+
+void GLFunctions::glGenBuffers(GLsizei n, GLuint *buffers)
+{
+    Base::glGenBuffers(n, buffers);
+    this->buffers.insert(buffers, buffers + n);
+    recordNames(GLTraceOp::GenBuffers, n, buffers);
+}
+
+void GLFunctions::glGenFramebuffers(GLsizei n, GLuint *framebuffers)
+{
+    Base::glGenFramebuffers(n, framebuffers);
+    this->framebuffers.insert(framebuffers, framebuffers + n);
+    recordNames(GLTraceOp::GenFramebuffers, n, framebuffers);
+}
+
+void GLFunctions::glGenRenderbuffers(GLsizei n, GLuint *renderbuffers)
+{
+    Base::glGenRenderbuffers(n, renderbuffers);
+    this->renderbuffers.insert(renderbuffers, renderbuffers + n);
+    recordNames(GLTraceOp::GenRenderbuffers, n, renderbuffers);
+}
+
+void GLFunctions::glGenTextures(GLsizei n, GLuint *textures)
+{
+    Base::glGenTextures(n, textures);
+    for (GLsizei i = 0; i < n; ++i)
+        this->textures[textures[i]] = 0;
+    recordNames(GLTraceOp::GenTextures, n, textures);
+}
+
+void GLFunctions::glGenVertexArrays(GLsizei n, GLuint *arrays)
+{
+    Base::glGenVertexArrays(n, arrays);
+    vertexArrays.insert(arrays, arrays + n);
+    recordNames(GLTraceOp::GenVertexArrays, n, arrays);
+}
+
+GLint GLFunctions::glGetUniformLocation(GLuint program, const GLchar *name)
+{
+    const GLint location = Base::glGetUniformLocation(program, name);
+    // the replayer looks the name up in its own program and maps the location
+    if (trace)
+        trace->add(GLTraceOp::GetUniformLocation, {program, location}, trace->addBlob(name, std::strlen(name)));
+    return location;
+}
+
+void GLFunctions::glShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)
+{
+    if (trace)
+    {
+        QByteArray source;
+        for (GLsizei i = 0; i < count; ++i)
+            source.append(string[i], length && length[i] >= 0 ? length[i] : static_cast<qsizetype>(std::strlen(string[i])));
+        trace->add(GLTraceOp::ShaderSource, {shader}, trace->addBlob(std::move(source)));
+    }
+    Base::glShaderSource(shader, count, string, length);
+}
+
+void GLFunctions::glTexBuffer(GLenum target, GLenum internalformat, GLuint buffer)
+{
+    record(GLTraceOp::TexBuffer, {target, internalformat, buffer});
+    Base::glTexBuffer(target, internalformat, buffer);
+    // the snapshot can not read the buffer of a buffer texture back in OpenGL 3.3, so remember it
+    GLint texture = 0;
+    Base::glGetIntegerv(GL_TEXTURE_BINDING_BUFFER, &texture);
+    if (texture != 0)
+        textureBuffers[static_cast<GLuint>(texture)] = {internalformat, buffer};
+}
+
+bool GLFunctions::initializeOpenGLFunctions()
+{
+    if (!Base::initializeOpenGLFunctions())
+        return false;
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    vertexAttrib3f = reinterpret_cast<VertexAttrib3fPtr>(context->getProcAddress("glVertexAttrib3f"));
+    vertexAttrib3fv = reinterpret_cast<VertexAttrib3fvPtr>(context->getProcAddress("glVertexAttrib3fv"));
+    return vertexAttrib3f && vertexAttrib3fv;
+}
+
+void GLFunctions::glClearBufferuiv(GLenum buffer, GLint drawbuffer, const GLuint *value)
+{
+    // only GL_COLOR takes unsigned integers, always four components
+    if (trace)
+        trace->add(GLTraceOp::ClearBufferuiv, {buffer, drawbuffer}, trace->addBlob(value, sizeof(GLuint) * 4));
+    Base::glClearBufferuiv(buffer, drawbuffer, value);
+}
+
+void GLFunctions::glDrawBuffers(GLsizei n, const GLenum *bufs)
+{
+    if (trace)
+        trace->add(GLTraceOp::DrawBuffers, {n}, trace->addBlob(bufs, sizeof(GLenum) * static_cast<size_t>(n)));
+    Base::glDrawBuffers(n, bufs);
+}
+
+void GLFunctions::glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels)
+{
+    if (trace)
+        trace->add(GLTraceOp::TexImage2D, {target, level, internalformat, width, height, border, format, type},
+                   pixels ? trace->addBlob(pixels, imageSize(width, height, format, type)) : GLTraceCommand::noBlob);
+    Base::glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+void GLFunctions::glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+    if (trace)
+        trace->add(GLTraceOp::UniformMatrix3fv, {location, count, transpose}, trace->addBlob(value, sizeof(GLfloat) * 9 * static_cast<size_t>(count)));
+    Base::glUniformMatrix3fv(location, count, transpose, value);
+}
+
+void GLFunctions::glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+    if (trace)
+        trace->add(GLTraceOp::UniformMatrix4fv, {location, count, transpose}, trace->addBlob(value, sizeof(GLfloat) * 16 * static_cast<size_t>(count)));
+    Base::glUniformMatrix4fv(location, count, transpose, value);
+}
+
+void GLFunctions::snapshot(GLTrace &trace)
+{
+    // bound state, restored after the objects were read back
+    GLint viewport[4] = {0, 0, 0, 0};
+    GLfloat clearColor[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    GLint program = 0, vertexArray = 0, arrayBuffer = 0, copyReadBuffer = 0, activeTexture = GL_TEXTURE0;
+    GLint drawFramebuffer = 0, readFramebuffer = 0, renderbuffer = 0, depthFunc = GL_LESS, textureUnits = 0;
+    Base::glGetIntegerv(GL_VIEWPORT, viewport);
+    Base::glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    Base::glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    Base::glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertexArray);
+    Base::glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &arrayBuffer);
+    Base::glGetIntegerv(GL_COPY_READ_BUFFER_BINDING, &copyReadBuffer);
+    Base::glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    Base::glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+    Base::glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    Base::glGetIntegerv(GL_RENDERBUFFER_BINDING, &renderbuffer);
+    Base::glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    Base::glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &textureUnits);
+    textureUnits = std::min(textureUnits, 16);
+    std::vector<std::pair<GLint, GLint>> boundTextures(static_cast<size_t>(textureUnits));
+    for (GLint unit = 0; unit < textureUnits; ++unit)
+    {
+        Base::glActiveTexture(GL_TEXTURE0 + unit);
+        Base::glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTextures[unit].first);
+        Base::glGetIntegerv(GL_TEXTURE_BINDING_CUBE_MAP, &boundTextures[unit].second);
+    }
+    Base::glActiveTexture(activeTexture);
+
+    trace.width = viewport[2];
+    trace.height = viewport[3];
+    trace.renderer = QString(reinterpret_cast<const char *>(Base::glGetString(GL_RENDERER)));
+
+    std::unordered_set<GLuint> shaders;
+    for (GLuint name : sortedNames(programs))
+        snapshotProgram(trace, name, shaders);
+    snapshotBuffers(trace);
+    snapshotTextures(trace);
+    snapshotRenderbuffers(trace);
+    snapshotFramebuffers(trace);
+    snapshotVertexArrays(trace);
+
+    // restore the bindings and record them for the replay
+    for (GLint unit = 0; unit < textureUnits; ++unit)
+    {
+        Base::glActiveTexture(GL_TEXTURE0 + unit);
+        Base::glBindTexture(GL_TEXTURE_2D, boundTextures[unit].first);
+        Base::glBindTexture(GL_TEXTURE_CUBE_MAP, boundTextures[unit].second);
+        // unit 0 of the replay was used to upload the textures
+        if (unit == 0 || boundTextures[unit].first != 0 || boundTextures[unit].second != 0)
+        {
+            trace.add(GLTraceOp::ActiveTexture, {GL_TEXTURE0 + unit});
+            trace.add(GLTraceOp::BindTexture, {GL_TEXTURE_2D, boundTextures[unit].first});
+            trace.add(GLTraceOp::BindTexture, {GL_TEXTURE_CUBE_MAP, boundTextures[unit].second});
+        }
+    }
+    Base::glActiveTexture(activeTexture);
+    Base::glBindVertexArray(vertexArray);
+    Base::glBindBuffer(GL_ARRAY_BUFFER, arrayBuffer);
+    Base::glBindBuffer(GL_COPY_READ_BUFFER, copyReadBuffer);
+    Base::glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+    Base::glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+    Base::glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    Base::glUseProgram(program);
+    trace.add(GLTraceOp::ActiveTexture, {activeTexture});
+    trace.add(GLTraceOp::BindVertexArray, {vertexArray});
+    trace.add(GLTraceOp::BindBuffer, {GL_ARRAY_BUFFER, arrayBuffer});
+    trace.add(GLTraceOp::BindRenderbuffer, {GL_RENDERBUFFER, renderbuffer});
+    trace.add(GLTraceOp::BindFramebuffer, {GL_DRAW_FRAMEBUFFER, drawFramebuffer});
+    trace.add(GLTraceOp::BindFramebuffer, {GL_READ_FRAMEBUFFER, readFramebuffer});
+    trace.add(GLTraceOp::UseProgram, {program});
+
+    for (GLenum cap : {GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_STENCIL_TEST, GL_SCISSOR_TEST, GL_PROGRAM_POINT_SIZE})
+        trace.add(Base::glIsEnabled(cap) ? GLTraceOp::Enable : GLTraceOp::Disable, {cap});
+    trace.add(GLTraceOp::DepthFunc, {depthFunc});
+    GLboolean depthMask = GL_TRUE, colorMask[4] = {GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE};
+    Base::glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+    Base::glGetBooleanv(GL_COLOR_WRITEMASK, colorMask);
+    trace.add(GLTraceOp::DepthMask, {depthMask});
+    trace.add(GLTraceOp::ColorMask, {colorMask[0], colorMask[1], colorMask[2], colorMask[3]});
+    GLint stencil[6] = {GL_ALWAYS, 0, 0xff, GL_KEEP, GL_KEEP, GL_KEEP};
+    const GLenum stencilStates[6] = {GL_STENCIL_FUNC, GL_STENCIL_REF, GL_STENCIL_VALUE_MASK,
+                                     GL_STENCIL_FAIL, GL_STENCIL_PASS_DEPTH_FAIL, GL_STENCIL_PASS_DEPTH_PASS};
+    for (int i = 0; i < 6; ++i)
+        Base::glGetIntegerv(stencilStates[i], &stencil[i]);
+    trace.add(GLTraceOp::StencilFunc, {stencil[0], stencil[1], static_cast<GLuint>(stencil[2])});
+    trace.add(GLTraceOp::StencilOp, {stencil[3], stencil[4], stencil[5]});
+    GLint backStencil[3] = {GL_KEEP, GL_KEEP, GL_KEEP}, blend[2] = {GL_ONE, GL_ZERO}, cullFace = GL_BACK;
+    Base::glGetIntegerv(GL_STENCIL_BACK_FAIL, &backStencil[0]);
+    Base::glGetIntegerv(GL_STENCIL_BACK_PASS_DEPTH_FAIL, &backStencil[1]);
+    Base::glGetIntegerv(GL_STENCIL_BACK_PASS_DEPTH_PASS, &backStencil[2]);
+    Base::glGetIntegerv(GL_BLEND_SRC_RGB, &blend[0]);
+    Base::glGetIntegerv(GL_BLEND_DST_RGB, &blend[1]);
+    Base::glGetIntegerv(GL_CULL_FACE_MODE, &cullFace);
+    trace.add(GLTraceOp::StencilOpSeparate, {GL_BACK, backStencil[0], backStencil[1], backStencil[2]});
+    trace.add(GLTraceOp::BlendFunc, {blend[0], blend[1]});
+    trace.add(GLTraceOp::CullFace, {cullFace});
+    trace.add(GLTraceOp::ClearColor, {GLTrace::floatArg(clearColor[0]), GLTrace::floatArg(clearColor[1]),
+                                      GLTrace::floatArg(clearColor[2]), GLTrace::floatArg(clearColor[3])});
+    trace.add(GLTraceOp::Viewport, {viewport[0], viewport[1], viewport[2], viewport[3]});
+
+    // constant vertex attributes, used for attributes without an array
+    GLint attributes = 0;
+    Base::glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &attributes);
+    for (GLint i = 0; i < std::min(attributes, 16); ++i)
+    {
+        GLfloat value[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        Base::glGetVertexAttribfv(i, GL_CURRENT_VERTEX_ATTRIB, value);
+        if (value[0] != 0.0f || value[1] != 0.0f || value[2] != 0.0f || value[3] != 1.0f)
+            trace.add(GLTraceOp::VertexAttrib4f, {i, GLTrace::floatArg(value[0]), GLTrace::floatArg(value[1]),
+                                                  GLTrace::floatArg(value[2]), GLTrace::floatArg(value[3])});
+    }
+}
+
+void GLFunctions::snapshotProgram(GLTrace &trace, GLuint program, std::unordered_set<GLuint> &shaders)
+{
+    trace.add(GLTraceOp::CreateProgram, {program});
+    // the scene deletes its shaders after linking, they live on as long as they are attached
+    GLuint attached[8];
+    GLsizei attachedCount = 0;
+    Base::glGetAttachedShaders(program, 8, &attachedCount, attached);
+    for (GLsizei i = 0; i < attachedCount; ++i)
+    {
+        const GLuint shader = attached[i];
+        if (shaders.insert(shader).second)
+        {
+            GLint type = 0, length = 0;
+            Base::glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+            Base::glGetShaderiv(shader, GL_SHADER_SOURCE_LENGTH, &length);
+            QByteArray source(std::max(length, 1), '\0');
+            GLsizei written = 0;
+            Base::glGetShaderSource(shader, static_cast<GLsizei>(source.size()), &written, source.data());
+            source.resize(written);
+            trace.add(GLTraceOp::CreateShader, {shader, type});
+            trace.add(GLTraceOp::ShaderSource, {shader}, trace.addBlob(std::move(source)));
+            trace.add(GLTraceOp::CompileShader, {shader});
+        }
+        trace.add(GLTraceOp::AttachShader, {program, shader});
+    }
+    GLint linked = GL_FALSE;
+    Base::glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+        return;
+    trace.add(GLTraceOp::LinkProgram, {program});
+
+    // uniform values set before the capture
+    Base::glUseProgram(program);
+    trace.add(GLTraceOp::UseProgram, {program});
+    GLint uniformCount = 0, maxNameLength = 0;
+    Base::glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    Base::glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<GLchar> nameBuffer(static_cast<size_t>(std::max(maxNameLength, 1)));
+    for (GLint i = 0; i < uniformCount; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        Base::glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()), &length, &size, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), static_cast<size_t>(length));
+        if (size > 1 && name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            name.resize(name.size() - 3);
+        for (GLint element = 0; element < size; ++element)
+        {
+            const std::string elementName = size > 1 ? name + "[" + std::to_string(element) + "]" : name;
+            const GLint location = Base::glGetUniformLocation(program, elementName.c_str());
+            if (location < 0)
+                continue; // part of a uniform block
+            trace.add(GLTraceOp::GetUniformLocation, {program, location}, trace.addBlob(elementName.data(), elementName.size()));
+            snapshotUniform(trace, location, type);
+        }
+    }
+}
+
+void GLFunctions::snapshotUniform(GLTrace &trace, GLint location, GLenum type)
+{
+    GLint program = 0;
+    Base::glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    switch (type)
+    {
+    case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+    {
+        GLfloat value[4];
+        Base::glGetUniformfv(program, location, value);
+        const int components = type == GL_FLOAT ? 1 : type == GL_FLOAT_VEC2 ? 2 : type == GL_FLOAT_VEC3 ? 3 : 4;
+        trace.add(GLTraceOp::Uniformfv, {location, components, 1}, trace.addBlob(value, sizeof(GLfloat) * components));
+        break;
+    }
+    case GL_FLOAT_MAT3:
+    case GL_FLOAT_MAT4:
+    {
+        GLfloat value[16];
+        Base::glGetUniformfv(program, location, value);
+        const bool mat3 = type == GL_FLOAT_MAT3;
+        trace.add(mat3 ? GLTraceOp::UniformMatrix3fv : GLTraceOp::UniformMatrix4fv, {location, 1, GL_FALSE},
+                  trace.addBlob(value, sizeof(GLfloat) * (mat3 ? 9 : 16)));
+        break;
+    }
+    case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+    {
+        GLuint value[4];
+        Base::glGetUniformuiv(program, location, value);
+        const int components = type == GL_UNSIGNED_INT ? 1 : type == GL_UNSIGNED_INT_VEC2 ? 2 : type == GL_UNSIGNED_INT_VEC3 ? 3 : 4;
+        trace.add(GLTraceOp::Uniformuiv, {location, components, 1}, trace.addBlob(value, sizeof(GLuint) * components));
+        break;
+    }
+    case GL_FLOAT_MAT2: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT3x2:
+    case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3: case GL_DOUBLE:
+        break; // not used by the exercise shaders
+    default:
+    {
+        // int and bool vectors, samplers
+        GLint value[4];
+        Base::glGetUniformiv(program, location, value);
+        const int components = (type == GL_INT_VEC2 || type == GL_BOOL_VEC2) ? 2 : (type == GL_INT_VEC3 || type == GL_BOOL_VEC3) ? 3
+                             : (type == GL_INT_VEC4 || type == GL_BOOL_VEC4) ? 4 : 1;
+        trace.add(GLTraceOp::Uniformiv, {location, components, 1}, trace.addBlob(value, sizeof(GLint) * components));
+        break;
+    }
+    }
+}
+
+void GLFunctions::snapshotBuffers(GLTrace &trace)
+{
+    for (GLuint buffer : sortedNames(buffers))
+    {
+        trace.add(GLTraceOp::GenBuffers, {1}, trace.addBlob(&buffer, sizeof(buffer)));
+        if (!Base::glIsBuffer(buffer))
+            continue; // generated but never bound
+        Base::glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        GLint size = 0, usage = GL_STATIC_DRAW;
+        Base::glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+        Base::glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_USAGE, &usage);
+        if (size <= 0)
+            continue;
+        QByteArray data(size, Qt::Uninitialized);
+        Base::glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, data.data());
+        trace.add(GLTraceOp::BindBuffer, {GL_COPY_WRITE_BUFFER, buffer});
+        trace.add(GLTraceOp::BufferData, {GL_COPY_WRITE_BUFFER, size, usage}, trace.addBlob(std::move(data)));
+    }
+}
+
+void GLFunctions::snapshotTextures(GLTrace &trace)
+{
+    for (GLuint texture : sortedNames(textures))
+    {
+        const GLenum target = textures[texture];
+        trace.add(GLTraceOp::GenTextures, {1}, trace.addBlob(&texture, sizeof(texture)));
+        if (target == GL_TEXTURE_BUFFER)
+        {
+            // no image of its own, it shows a buffer of snapshotBuffers()
+            const auto it = textureBuffers.find(texture);
+            trace.add(GLTraceOp::BindTexture, {GL_TEXTURE_BUFFER, texture});
+            if (it != textureBuffers.end())
+                trace.add(GLTraceOp::TexBuffer, {GL_TEXTURE_BUFFER, it->second.first, it->second.second});
+            continue;
+        }
+        if ((target != GL_TEXTURE_2D && target != GL_TEXTURE_CUBE_MAP) || !Base::glIsTexture(texture))
+            continue; // never bound, or a target the exercise does not use
+        Base::glBindTexture(target, texture);
+        trace.add(GLTraceOp::BindTexture, {target, texture});
+        const int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+        for (int face = 0; face < faces; ++face)
+        {
+            const GLenum imageTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+            for (GLint level = 0;; ++level)
+            {
+                GLint width = 0, height = 0, internalFormat = GL_RGBA8;
+                Base::glGetTexLevelParameteriv(imageTarget, level, GL_TEXTURE_WIDTH, &width);
+                Base::glGetTexLevelParameteriv(imageTarget, level, GL_TEXTURE_HEIGHT, &height);
+                Base::glGetTexLevelParameteriv(imageTarget, level, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+                if (width <= 0 || height <= 0)
+                    break;
+                const PixelTransfer transfer = pixelTransferFor(internalFormat);
+                QByteArray pixels(static_cast<qsizetype>(width) * height * transfer.bytesPerPixel, Qt::Uninitialized);
+                Base::glGetTexImage(imageTarget, level, transfer.format, transfer.type, pixels.data());
+                trace.add(GLTraceOp::TexImage2D, {imageTarget, level, internalFormat, width, height, 0, transfer.format, transfer.type},
+                          trace.addBlob(std::move(pixels)));
+            }
+        }
+        for (GLenum parameter : {GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T,
+                                 GL_TEXTURE_WRAP_R, GL_TEXTURE_BASE_LEVEL, GL_TEXTURE_MAX_LEVEL})
+        {
+            GLint value = 0;
+            Base::glGetTexParameteriv(target, parameter, &value);
+            trace.add(GLTraceOp::TexParameteri, {target, parameter, value});
+        }
+    }
+}
+
+void GLFunctions::snapshotRenderbuffers(GLTrace &trace)
+{
+    for (GLuint renderbuffer : sortedNames(renderbuffers))
+    {
+        trace.add(GLTraceOp::GenRenderbuffers, {1}, trace.addBlob(&renderbuffer, sizeof(renderbuffer)));
+        if (!Base::glIsRenderbuffer(renderbuffer))
+            continue;
+        Base::glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+        GLint width = 0, height = 0, internalFormat = GL_RGBA8;
+        Base::glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &width);
+        Base::glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &height);
+        Base::glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_INTERNAL_FORMAT, &internalFormat);
+        trace.add(GLTraceOp::BindRenderbuffer, {GL_RENDERBUFFER, renderbuffer});
+        if (width > 0 && height > 0)
+            trace.add(GLTraceOp::RenderbufferStorage, {GL_RENDERBUFFER, internalFormat, width, height});
+    }
+}
+
+void GLFunctions::snapshotFramebuffers(GLTrace &trace)
+{
+    for (GLuint framebuffer : sortedNames(framebuffers))
+    {
+        trace.add(GLTraceOp::GenFramebuffers, {1}, trace.addBlob(&framebuffer, sizeof(framebuffer)));
+        if (!Base::glIsFramebuffer(framebuffer))
+            continue;
+        Base::glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        trace.add(GLTraceOp::BindFramebuffer, {GL_FRAMEBUFFER, framebuffer});
+        for (GLenum attachment : {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3,
+                                  GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT})
+        {
+            GLint type = GL_NONE, name = 0;
+            Base::glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+            if (type == GL_NONE)
+                continue;
+            Base::glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &name);
+            if (type == GL_RENDERBUFFER)
+            {
+                trace.add(GLTraceOp::FramebufferRenderbuffer, {GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, name});
+            }
+            else
+            {
+                GLint level = 0, face = 0;
+                Base::glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_LEVEL, &level);
+                Base::glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_CUBE_MAP_FACE, &face);
+                trace.add(GLTraceOp::FramebufferTexture2D, {GL_FRAMEBUFFER, attachment, face != 0 ? face : GL_TEXTURE_2D, name, level});
+            }
+        }
+        std::vector<GLenum> drawBuffers;
+        for (GLenum buffer = GL_DRAW_BUFFER0; buffer <= GL_DRAW_BUFFER3; ++buffer)
+        {
+            GLint value = GL_NONE;
+            Base::glGetIntegerv(buffer, &value);
+            drawBuffers.push_back(static_cast<GLenum>(value));
+        }
+        while (drawBuffers.size() > 1 && drawBuffers.back() == GL_NONE)
+            drawBuffers.pop_back();
+        trace.add(GLTraceOp::DrawBuffers, {static_cast<int64_t>(drawBuffers.size())},
+                  trace.addBlob(drawBuffers.data(), sizeof(GLenum) * drawBuffers.size()));
+    }
+}
+
+void GLFunctions::snapshotVertexArrays(GLTrace &trace)
+{
+    GLint attributes = 0;
+    Base::glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &attributes);
+    attributes = std::min(attributes, 16);
+    for (GLuint vertexArray : sortedNames(vertexArrays))
+    {
+        trace.add(GLTraceOp::GenVertexArrays, {1}, trace.addBlob(&vertexArray, sizeof(vertexArray)));
+        if (!Base::glIsVertexArray(vertexArray))
+            continue;
+        Base::glBindVertexArray(vertexArray);
+        trace.add(GLTraceOp::BindVertexArray, {vertexArray});
+        GLint elementBuffer = 0;
+        Base::glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+        if (elementBuffer != 0)
+            trace.add(GLTraceOp::BindBuffer, {GL_ELEMENT_ARRAY_BUFFER, elementBuffer});
+        for (GLint i = 0; i < attributes; ++i)
+        {
+            const GLuint index = static_cast<GLuint>(i);
+            GLint enabled = 0, buffer = 0, size = 4, type = GL_FLOAT, normalized = 0, stride = 0, integer = 0, divisor = 0;
+            void *pointer = nullptr;
+            Base::glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+            Base::glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+            if (buffer != 0)
+            {
+                Base::glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_SIZE, &size);
+                Base::glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+                Base::glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &normalized);
+                Base::glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &stride);
+                Base::glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+                Base::glGetVertexAttribPointerv(index, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+                trace.add(GLTraceOp::BindBuffer, {GL_ARRAY_BUFFER, buffer});
+                if (integer)
+                    trace.add(GLTraceOp::VertexAttribIPointer, {i, size, type, stride, reinterpret_cast<intptr_t>(pointer)});
+                else
+                    trace.add(GLTraceOp::VertexAttribPointer, {i, size, type, normalized, stride, reinterpret_cast<intptr_t>(pointer)});
+                Base::glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_DIVISOR, &divisor);
+                if (divisor != 0)
+                    trace.add(GLTraceOp::VertexAttribDivisor, {i, divisor});
+            }
+            if (enabled)
+                trace.add(GLTraceOp::EnableVertexAttribArray, {i});
+        }
+    }
+}
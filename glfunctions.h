@@ -0,0 +1,233 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: OpenGL 3.3 core functions that can record the calls of the      //
+//          scene into a GLTrace                                             //
+// ========================================================================= //
+
+#ifndef GLFUNCTIONS_H
+#define GLFUNCTIONS_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include <QOpenGLFunctions_3_3_Core>
+
+#include "gltrace.h"
+
+/*
+ * Hides the functions of QOpenGLFunctions_3_3_Core that change state, create objects or draw,
+ * so every call through a GLFunctions pointer can be recorded. Queries are not recorded.
+ * Without a capture the only overhead is a null check and the bookkeeping of object names
+ * on creation and deletion, which the capture needs to snapshot the objects existing when it starts.
+ * Calls through a plain QOpenGLFunctions_3_3_Core pointer bypass the capture.
+ *
+ * The base class is private: only the wrapped functions and the queries listed below can be called,
+ * so a call of a function that is not recorded yet does not compile instead of missing in the traces.
+ */
+class GLFunctions : private QOpenGLFunctions_3_3_Core
+{
+public:
+    // Also resolves glVertexAttrib3f/3fv, which QOpenGLFunctions_3_3_Core leaves out as deprecated although
+    // they are core. Needs a current context.
+    bool initializeOpenGLFunctions();
+    // Queries, fences and read-backs. They change nothing a replay of the trace would draw differently.
+    using QOpenGLFunctions_3_3_Core::glBeginQuery;
+    using QOpenGLFunctions_3_3_Core::glCheckFramebufferStatus;
+    using QOpenGLFunctions_3_3_Core::glClientWaitSync;
+    using QOpenGLFunctions_3_3_Core::glDeleteQueries;
+    using QOpenGLFunctions_3_3_Core::glDeleteSync;
+    using QOpenGLFunctions_3_3_Core::glEndQuery;
+    using QOpenGLFunctions_3_3_Core::glFenceSync;
+    using QOpenGLFunctions_3_3_Core::glFinish;
+    using QOpenGLFunctions_3_3_Core::glGenQueries;
+    using QOpenGLFunctions_3_3_Core::glGetBufferParameteriv;
+    using QOpenGLFunctions_3_3_Core::glGetError;
+    using QOpenGLFunctions_3_3_Core::glGetInteger64v;
+    using QOpenGLFunctions_3_3_Core::glGetIntegerv;
+    using QOpenGLFunctions_3_3_Core::glGetProgramInfoLog;
+    using QOpenGLFunctions_3_3_Core::glGetProgramiv;
+    using QOpenGLFunctions_3_3_Core::glGetQueryObjectiv;
+    using QOpenGLFunctions_3_3_Core::glGetQueryObjectui64v;
+    using QOpenGLFunctions_3_3_Core::glGetShaderInfoLog;
+    using QOpenGLFunctions_3_3_Core::glGetShaderiv;
+    using QOpenGLFunctions_3_3_Core::glGetString;
+    using QOpenGLFunctions_3_3_Core::glMapBufferRange;
+    using QOpenGLFunctions_3_3_Core::glPixelStorei;
+    using QOpenGLFunctions_3_3_Core::glQueryCounter;
+    using QOpenGLFunctions_3_3_Core::glReadPixels;
+    using QOpenGLFunctions_3_3_Core::glUnmapBuffer;
+
+    // Snapshots all objects and the bound state into trace and records every call from now on.
+    // Needs a current context. The trace must stay alive until endCapture().
+    void beginCapture(GLTrace* trace);
+    // marks the end of a captured frame
+    void endCaptureFrame();
+    void endCapture();
+    bool isCapturing() const { return trace != nullptr; }
+
+    void glActiveTexture(GLenum texture) { record(GLTraceOp::ActiveTexture, {texture}); Base::glActiveTexture(texture); }
+    void glAttachShader(GLuint program, GLuint shader) { record(GLTraceOp::AttachShader, {program, shader}); Base::glAttachShader(program, shader); }
+    void glBindBuffer(GLenum target, GLuint buffer) { record(GLTraceOp::BindBuffer, {target, buffer}); Base::glBindBuffer(target, buffer); }
+    void glBindFramebuffer(GLenum target, GLuint framebuffer) { record(GLTraceOp::BindFramebuffer, {target, framebuffer}); Base::glBindFramebuffer(target, framebuffer); }
+    void glBindRenderbuffer(GLenum target, GLuint renderbuffer) { record(GLTraceOp::BindRenderbuffer, {target, renderbuffer}); Base::glBindRenderbuffer(target, renderbuffer); }
+    void glBindTexture(GLenum target, GLuint texture);
+    void glBindVertexArray(GLuint array) { record(GLTraceOp::BindVertexArray, {array}); Base::glBindVertexArray(array); }
+    void glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
+    {
+        record(GLTraceOp::BlitFramebuffer, {srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter});
+        Base::glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+    }
+    void glBlendFunc(GLenum sfactor, GLenum dfactor) { record(GLTraceOp::BlendFunc, {sfactor, dfactor}); Base::glBlendFunc(sfactor, dfactor); }
+    void glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+    void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+    void glClear(GLbitfield mask) { record(GLTraceOp::Clear, {mask}); Base::glClear(mask); }
+    void glClearBufferuiv(GLenum buffer, GLint drawbuffer, const GLuint* value);
+    void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+    {
+        record(GLTraceOp::ClearColor, {GLTrace::floatArg(red), GLTrace::floatArg(green), GLTrace::floatArg(blue), GLTrace::floatArg(alpha)});
+        Base::glClearColor(red, green, blue, alpha);
+    }
+    void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+    {
+        record(GLTraceOp::ColorMask, {red, green, blue, alpha});
+        Base::glColorMask(red, green, blue, alpha);
+    }
+    void glCompileShader(GLuint shader) { record(GLTraceOp::CompileShader, {shader}); Base::glCompileShader(shader); }
+    GLuint glCreateProgram();
+    GLuint glCreateShader(GLenum type);
+    void glCullFace(GLenum mode) { record(GLTraceOp::CullFace, {mode}); Base::glCullFace(mode); }
+    void glDeleteBuffers(GLsizei n, const GLuint* buffers);
+    void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+    void glDeleteProgram(GLuint program);
+    void glDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers);
+    void glDeleteShader(GLuint shader) { record(GLTraceOp::DeleteShader, {shader}); Base::glDeleteShader(shader); }
+    void glDeleteTextures(GLsizei n, const GLuint* textures);
+    void glDeleteVertexArrays(GLsizei n, const GLuint* arrays);
+    void glDepthFunc(GLenum func) { record(GLTraceOp::DepthFunc, {func}); Base::glDepthFunc(func); }
+    void glDepthMask(GLboolean flag) { record(GLTraceOp::DepthMask, {flag}); Base::glDepthMask(flag); }
+    void glDisable(GLenum cap) { record(GLTraceOp::Disable, {cap}); Base::glDisable(cap); }
+    void glDisableVertexAttribArray(GLuint index) { record(GLTraceOp::DisableVertexAttribArray, {index}); Base::glDisableVertexAttribArray(index); }
+    void glDrawArrays(GLenum mode, GLint first, GLsizei count) { record(GLTraceOp::DrawArrays, {mode, first, count}); Base::glDrawArrays(mode, first, count); }
+    void glDrawBuffers(GLsizei n, const GLenum* bufs);
+    void glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+    {
+        record(GLTraceOp::DrawElements, {mode, count, type, reinterpret_cast<intptr_t>(indices)});
+        Base::glDrawElements(mode, count, type, indices);
+    }
+    void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount)
+    {
+        record(GLTraceOp::DrawElementsInstanced, {mode, count, type, reinterpret_cast<intptr_t>(indices), instancecount});
+        Base::glDrawElementsInstanced(mode, count, type, indices, instancecount);
+    }
+    void glEnable(GLenum cap) { record(GLTraceOp::Enable, {cap}); Base::glEnable(cap); }
+    void glEnableVertexAttribArray(GLuint index) { record(GLTraceOp::EnableVertexAttribArray, {index}); Base::glEnableVertexAttribArray(index); }
+    void glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
+    {
+        record(GLTraceOp::FramebufferRenderbuffer, {target, attachment, renderbuffertarget, renderbuffer});
+        Base::glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+    }
+    void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
+    {
+        record(GLTraceOp::FramebufferTexture2D, {target, attachment, textarget, texture, level});
+        Base::glFramebufferTexture2D(target, attachment, textarget, texture, level);
+    }
+    void glGenBuffers(GLsizei n, GLuint* buffers);
+    void glGenFramebuffers(GLsizei n, GLuint* framebuffers);
+    void glGenRenderbuffers(GLsizei n, GLuint* renderbuffers);
+    void glGenTextures(GLsizei n, GLuint* textures);
+    void glGenVertexArrays(GLsizei n, GLuint* arrays);
+    void glGenerateMipmap(GLenum target) { record(GLTraceOp::GenerateMipmap, {target}); Base::glGenerateMipmap(target); }
+    GLint glGetUniformLocation(GLuint program, const GLchar* name);
+    void glLinkProgram(GLuint program) { record(GLTraceOp::LinkProgram, {program}); Base::glLinkProgram(program); }
+    void glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+    {
+        record(GLTraceOp::RenderbufferStorage, {target, internalformat, width, height});
+        Base::glRenderbufferStorage(target, internalformat, width, height);
+    }
+    void glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+    void glStencilFunc(GLenum func, GLint ref, GLuint mask) { record(GLTraceOp::StencilFunc, {func, ref, mask}); Base::glStencilFunc(func, ref, mask); }
+    void glStencilOp(GLenum fail, GLenum zfail, GLenum zpass) { record(GLTraceOp::StencilOp, {fail, zfail, zpass}); Base::glStencilOp(fail, zfail, zpass); }
+    void glStencilOpSeparate(GLenum face, GLenum sfail, GLenum dpfail, GLenum dppass)
+    {
+        record(GLTraceOp::StencilOpSeparate, {face, sfail, dpfail, dppass});
+        Base::glStencilOpSeparate(face, sfail, dpfail, dppass);
+    }
+    void glTexBuffer(GLenum target, GLenum internalformat, GLuint buffer);
+    void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels);
+    void glTexParameteri(GLenum target, GLenum pname, GLint param) { record(GLTraceOp::TexParameteri, {target, pname, param}); Base::glTexParameteri(target, pname, param); }
+    void glUniform1i(GLint location, GLint v0) { record(GLTraceOp::Uniform1i, {location, v0}); Base::glUniform1i(location, v0); }
+    void glUniform1ui(GLint location, GLuint v0) { record(GLTraceOp::Uniform1ui, {location, v0}); Base::glUniform1ui(location, v0); }
+    void glUniform2f(GLint location, GLfloat v0, GLfloat v1)
+    {
+        record(GLTraceOp::Uniform2f, {location, GLTrace::floatArg(v0), GLTrace::floatArg(v1)});
+        Base::glUniform2f(location, v0, v1);
+    }
+    void glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+    {
+        record(GLTraceOp::Uniform3f, {location, GLTrace::floatArg(v0), GLTrace::floatArg(v1), GLTrace::floatArg(v2)});
+        Base::glUniform3f(location, v0, v1, v2);
+    }
+    void glUniform3i(GLint location, GLint v0, GLint v1, GLint v2) { record(GLTraceOp::Uniform3i, {location, v0, v1, v2}); Base::glUniform3i(location, v0, v1, v2); }
+    void glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+    void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+    void glUseProgram(GLuint program) { record(GLTraceOp::UseProgram, {program}); Base::glUseProgram(program); }
+    void glVertexAttrib3f(GLuint index, GLfloat x, GLfloat y, GLfloat z)
+    {
+        record(GLTraceOp::VertexAttrib3f, {index, GLTrace::floatArg(x), GLTrace::floatArg(y), GLTrace::floatArg(z)});
+        vertexAttrib3f(index, x, y, z);
+    }
+    void glVertexAttrib3fv(GLuint index, const GLfloat* v)
+    {
+        record(GLTraceOp::VertexAttrib3fv, {index, GLTrace::floatArg(v[0]), GLTrace::floatArg(v[1]), GLTrace::floatArg(v[2])});
+        vertexAttrib3fv(index, v);
+    }
+    void glVertexAttribDivisor(GLuint index, GLuint divisor) { record(GLTraceOp::VertexAttribDivisor, {index, divisor}); Base::glVertexAttribDivisor(index, divisor); }
+    void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+    {
+        record(GLTraceOp::VertexAttribPointer, {index, size, type, normalized, stride, reinterpret_cast<intptr_t>(pointer)});
+        Base::glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+    }
+    void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) { record(GLTraceOp::Viewport, {x, y, width, height}); Base::glViewport(x, y, width, height); }
+
+private:
+    using Base = QOpenGLFunctions_3_3_Core;
+
+    GLTrace* trace = nullptr;
+
+    // not part of QOpenGLFunctions_3_3_Core, see initializeOpenGLFunctions()
+    using VertexAttrib3fPtr = void (*)(GLuint index, GLfloat x, GLfloat y, GLfloat z);
+    using VertexAttrib3fvPtr = void (*)(GLuint index, const GLfloat* v);
+    VertexAttrib3fPtr vertexAttrib3f = nullptr;
+    VertexAttrib3fvPtr vertexAttrib3fv = nullptr;
+
+    // names of all objects created through this object, textures with the target of their first binding
+    std::unordered_set<GLuint> buffers, framebuffers, renderbuffers, vertexArrays, programs;
+    std::unordered_map<GLuint, GLenum> textures;
+    // buffer textures: internal format and buffer of their last glTexBuffer()
+    std::unordered_map<GLuint, std::pair<GLenum, GLuint>> textureBuffers;
+
+    void record(GLTraceOp op, std::initializer_list<int64_t> args)
+    {
+        if (trace)
+            trace->add(op, args);
+    }
+    void recordNames(GLTraceOp op, GLsizei n, const GLuint* names);
+
+    // setup commands of a trace, see GLTrace
+    void snapshot(GLTrace& trace);
+    void snapshotProgram(GLTrace& trace, GLuint program, std::unordered_set<GLuint>& shaders);
+    void snapshotUniform(GLTrace& trace, GLint location, GLenum type);
+    void snapshotBuffers(GLTrace& trace);
+    void snapshotTextures(GLTrace& trace);
+    void snapshotRenderbuffers(GLTrace& trace);
+    void snapshotFramebuffers(GLTrace& trace);
+    void snapshotVertexArrays(GLTrace& trace);
+};
+
+#endif // GLFUNCTIONS_H
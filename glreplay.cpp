@@ -0,0 +1,769 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Replays a GLTrace on an offscreen surface and reports the time  //
+//          of every OpenGL function and the calls that change no state      //
+// ========================================================================= //
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLVersionFunctionsFactory>
+#include <QSurfaceFormat>
+
+#include "benchstats.h"
+#include "gltrace.h"
+
+namespace {
+
+constexpr size_t opCount = static_cast<size_t>(GLTraceOp::Count);
+
+const GLuint *blobNames(const GLTrace &trace, const GLTraceCommand &command)
+{
+    return reinterpret_cast<const GLuint *>(trace.blobs[command.blob].constData());
+}
+
+const void *blobData(const GLTrace &trace, const GLTraceCommand &command)
+{
+    return command.blob != GLTraceCommand::noBlob ? trace.blobs[command.blob].constData() : nullptr;
+}
+
+// Framebuffer object with color and depth renderbuffers that stands for the framebuffer of the capturing widget.
+struct OffscreenTarget {
+    GLuint fbo = 0, colorRenderbuffer = 0, depthRenderbuffer = 0;
+
+    bool create(QOpenGLFunctions_3_3_Core *f, int width, int height)
+    {
+        f->glGenRenderbuffers(1, &colorRenderbuffer);
+        f->glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+        f->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        f->glGenRenderbuffers(1, &depthRenderbuffer);
+        f->glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        f->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        f->glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        f->glGenFramebuffers(1, &fbo);
+        f->glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+        f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        return f->glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    void destroy(QOpenGLFunctions_3_3_Core *f)
+    {
+        f->glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        f->glDeleteFramebuffers(1, &fbo);
+        f->glDeleteRenderbuffers(1, &colorRenderbuffer);
+        f->glDeleteRenderbuffers(1, &depthRenderbuffer);
+        fbo = colorRenderbuffer = depthRenderbuffer = 0;
+    }
+};
+
+/*
+ * Executes the commands of a trace. Object names and uniform locations of the capturing context
+ * are mapped to those of the replay context. Framebuffers unknown to the trace are the render target.
+ */
+class Replayer {
+public:
+    // needs the current context of f
+    Replayer(QOpenGLFunctions_3_3_Core *f, const GLTrace &trace, GLuint targetFramebuffer)
+        : f(f), trace(trace), targetFramebuffer(targetFramebuffer),
+          vertexAttrib4f(reinterpret_cast<VertexAttrib4fPtr>(QOpenGLContext::currentContext()->getProcAddress("glVertexAttrib4f"))) {}
+
+    void execute(const GLTraceCommand &command);
+    // deletes all objects created by the trace
+    void cleanup();
+
+private:
+    using NameMap = std::unordered_map<GLuint, GLuint>;
+
+    QOpenGLFunctions_3_3_Core *f;
+    const GLTrace &trace;
+    GLuint targetFramebuffer;
+    // QOpenGLFunctions_3_3_Core leaves out glVertexAttrib*f as deprecated, although they are core
+    using VertexAttrib4fPtr = void (*)(GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+    VertexAttrib4fPtr vertexAttrib4f;
+    NameMap buffers, textures, renderbuffers, framebuffers, vertexArrays, programs, shaders;
+    // replay locations by captured program and location
+    std::unordered_map<uint64_t, GLint> uniformLocations;
+    GLuint capturedProgram = 0;
+
+    static GLuint map(const NameMap &names, int64_t captured)
+    {
+        const auto it = names.find(static_cast<GLuint>(captured));
+        return it != names.end() ? it->second : 0;
+    }
+    GLuint mapFramebuffer(int64_t captured) const
+    {
+        const auto it = framebuffers.find(static_cast<GLuint>(captured));
+        return it != framebuffers.end() ? it->second : targetFramebuffer;
+    }
+    GLint mapLocation(int64_t captured) const
+    {
+        const auto it = uniformLocations.find(uniformKey(capturedProgram, static_cast<GLint>(captured)));
+        return it != uniformLocations.end() ? it->second : -1;
+    }
+    static uint64_t uniformKey(GLuint program, GLint location)
+    {
+        return (static_cast<uint64_t>(program) << 32) | static_cast<uint32_t>(location);
+    }
+
+    template <typename Generate>
+    void generate(NameMap &names, const GLTraceCommand &command, Generate generateNames);
+    template <typename Delete>
+    void remove(NameMap &names, const GLTraceCommand &command, Delete deleteNames);
+};
+
+template <typename Generate>
+void Replayer::generate(NameMap &names, const GLTraceCommand &command, Generate generateNames)
+{
+    const GLsizei n = static_cast<GLsizei>(command.args[0]);
+    std::vector<GLuint> created(static_cast<size_t>(n));
+    generateNames(n, created.data());
+    const GLuint *captured = blobNames(trace, command);
+    for (GLsizei i = 0; i < n; ++i)
+        names[captured[i]] = created[i];
+}
+
+template <typename Delete>
+void Replayer::remove(NameMap &names, const GLTraceCommand &command, Delete deleteNames)
+{
+    const GLsizei n = static_cast<GLsizei>(command.args[0]);
+    std::vector<GLuint> deleted;
+    deleted.reserve(static_cast<size_t>(n));
+    const GLuint *captured = blobNames(trace, command);
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        const auto it = names.find(captured[i]);
+        if (it == names.end())
+            continue;
+        deleted.push_back(it->second);
+        names.erase(it);
+    }
+    deleteNames(static_cast<GLsizei>(deleted.size()), deleted.data());
+}
+
+void Replayer::execute(const GLTraceCommand &command)
+{
+    const auto &a = command.args;
+    const auto u = [&a](int i) { return static_cast<GLuint>(a[i]); };
+    const auto i32 = [&a](int i) { return static_cast<GLint>(a[i]); };
+    const auto fl = [&a](int i) { return GLTrace::argFloat(a[i]); };
+    const auto offset = [&a](int i) { return reinterpret_cast<const void *>(static_cast<intptr_t>(a[i])); };
+    const void *blob = blobData(trace, command);
+
+    switch (command.op)
+    {
+    case GLTraceOp::ActiveTexture: f->glActiveTexture(u(0)); break;
+    case GLTraceOp::AttachShader: f->glAttachShader(map(programs, a[0]), map(shaders, a[1])); break;
+    case GLTraceOp::BindBuffer: f->glBindBuffer(u(0), map(buffers, a[1])); break;
+    case GLTraceOp::BindFramebuffer: f->glBindFramebuffer(u(0), mapFramebuffer(a[1])); break;
+    case GLTraceOp::BindRenderbuffer: f->glBindRenderbuffer(u(0), map(renderbuffers, a[1])); break;
+    case GLTraceOp::BindTexture: f->glBindTexture(u(0), map(textures, a[1])); break;
+    case GLTraceOp::BindVertexArray: f->glBindVertexArray(map(vertexArrays, a[0])); break;
+    case GLTraceOp::BlendFunc: f->glBlendFunc(u(0), u(1)); break;
+    case GLTraceOp::BlitFramebuffer:
+        f->glBlitFramebuffer(i32(0), i32(1), i32(2), i32(3), i32(4), i32(5), i32(6), i32(7), u(8), u(9));
+        break;
+    case GLTraceOp::BufferData: f->glBufferData(u(0), static_cast<GLsizeiptr>(a[1]), blob, u(2)); break;
+    case GLTraceOp::BufferSubData: f->glBufferSubData(u(0), static_cast<GLintptr>(a[1]), static_cast<GLsizeiptr>(a[2]), blob); break;
+    case GLTraceOp::Clear: f->glClear(u(0)); break;
+    case GLTraceOp::ClearBufferuiv: f->glClearBufferuiv(u(0), i32(1), static_cast<const GLuint *>(blob)); break;
+    case GLTraceOp::ClearColor: f->glClearColor(fl(0), fl(1), fl(2), fl(3)); break;
+    case GLTraceOp::ColorMask:
+        f->glColorMask(static_cast<GLboolean>(a[0]), static_cast<GLboolean>(a[1]), static_cast<GLboolean>(a[2]), static_cast<GLboolean>(a[3]));
+        break;
+    case GLTraceOp::CompileShader: f->glCompileShader(map(shaders, a[0])); break;
+    case GLTraceOp::CreateProgram: programs[u(0)] = f->glCreateProgram(); break;
+    case GLTraceOp::CreateShader: shaders[u(0)] = f->glCreateShader(u(1)); break;
+    case GLTraceOp::DeleteBuffers: remove(buffers, command, [this](GLsizei n, const GLuint *names) { f->glDeleteBuffers(n, names); }); break;
+    case GLTraceOp::DeleteFramebuffers: remove(framebuffers, command, [this](GLsizei n, const GLuint *names) { f->glDeleteFramebuffers(n, names); }); break;
+    case GLTraceOp::DeleteProgram:
+        f->glDeleteProgram(map(programs, a[0]));
+        programs.erase(u(0));
+        break;
+    case GLTraceOp::DeleteRenderbuffers: remove(renderbuffers, command, [this](GLsizei n, const GLuint *names) { f->glDeleteRenderbuffers(n, names); }); break;
+    case GLTraceOp::DeleteShader:
+        f->glDeleteShader(map(shaders, a[0]));
+        shaders.erase(u(0));
+        break;
+    case GLTraceOp::DeleteTextures: remove(textures, command, [this](GLsizei n, const GLuint *names) { f->glDeleteTextures(n, names); }); break;
+    case GLTraceOp::DeleteVertexArrays: remove(vertexArrays, command, [this](GLsizei n, const GLuint *names) { f->glDeleteVertexArrays(n, names); }); break;
+    case GLTraceOp::CullFace: f->glCullFace(u(0)); break;
+    case GLTraceOp::DepthFunc: f->glDepthFunc(u(0)); break;
+    case GLTraceOp::DepthMask: f->glDepthMask(static_cast<GLboolean>(a[0])); break;
+    case GLTraceOp::Disable: f->glDisable(u(0)); break;
+    case GLTraceOp::DisableVertexAttribArray: f->glDisableVertexAttribArray(u(0)); break;
+    case GLTraceOp::DrawArrays: f->glDrawArrays(u(0), i32(1), i32(2)); break;
+    case GLTraceOp::DrawBuffers: f->glDrawBuffers(i32(0), static_cast<const GLenum *>(blob)); break;
+    case GLTraceOp::DrawElements: f->glDrawElements(u(0), i32(1), u(2), offset(3)); break;
+    case GLTraceOp::DrawElementsInstanced: f->glDrawElementsInstanced(u(0), i32(1), u(2), offset(3), i32(4)); break;
+    case GLTraceOp::Enable: f->glEnable(u(0)); break;
+    case GLTraceOp::EnableVertexAttribArray: f->glEnableVertexAttribArray(u(0)); break;
+    case GLTraceOp::FramebufferRenderbuffer: f->glFramebufferRenderbuffer(u(0), u(1), u(2), map(renderbuffers, a[3])); break;
+    case GLTraceOp::FramebufferTexture2D: f->glFramebufferTexture2D(u(0), u(1), u(2), map(textures, a[3]), i32(4)); break;
+    case GLTraceOp::GenBuffers: generate(buffers, command, [this](GLsizei n, GLuint *names) { f->glGenBuffers(n, names); }); break;
+    case GLTraceOp::GenFramebuffers: generate(framebuffers, command, [this](GLsizei n, GLuint *names) { f->glGenFramebuffers(n, names); }); break;
+    case GLTraceOp::GenRenderbuffers: generate(renderbuffers, command, [this](GLsizei n, GLuint *names) { f->glGenRenderbuffers(n, names); }); break;
+    case GLTraceOp::GenTextures: generate(textures, command, [this](GLsizei n, GLuint *names) { f->glGenTextures(n, names); }); break;
+    case GLTraceOp::GenVertexArrays: generate(vertexArrays, command, [this](GLsizei n, GLuint *names) { f->glGenVertexArrays(n, names); }); break;
+    case GLTraceOp::GenerateMipmap: f->glGenerateMipmap(u(0)); break;
+    case GLTraceOp::GetUniformLocation:
+    {
+        const QByteArray &name = trace.blobs[command.blob];
+        uniformLocations[uniformKey(u(0), i32(1))] = f->glGetUniformLocation(map(programs, a[0]), name.constData());
+        break;
+    }
+    case GLTraceOp::LinkProgram: f->glLinkProgram(map(programs, a[0])); break;
+    case GLTraceOp::RenderbufferStorage: f->glRenderbufferStorage(u(0), u(1), i32(2), i32(3)); break;
+    case GLTraceOp::ShaderSource:
+    {
+        const QByteArray &source = trace.blobs[command.blob];
+        const GLchar *string = source.constData();
+        const GLint length = static_cast<GLint>(source.size());
+        f->glShaderSource(map(shaders, a[0]), 1, &string, &length);
+        break;
+    }
+    case GLTraceOp::StencilFunc: f->glStencilFunc(u(0), i32(1), u(2)); break;
+    case GLTraceOp::StencilOp: f->glStencilOp(u(0), u(1), u(2)); break;
+    case GLTraceOp::StencilOpSeparate: f->glStencilOpSeparate(u(0), u(1), u(2), u(3)); break;
+    case GLTraceOp::TexBuffer: f->glTexBuffer(u(0), u(1), map(buffers, a[2])); break;
+    case GLTraceOp::TexImage2D: f->glTexImage2D(u(0), i32(1), i32(2), i32(3), i32(4), i32(5), u(6), u(7), blob); break;
+    case GLTraceOp::TexParameteri: f->glTexParameteri(u(0), u(1), i32(2)); break;
+    case GLTraceOp::Uniform1i: f->glUniform1i(mapLocation(a[0]), i32(1)); break;
+    case GLTraceOp::Uniform1ui: f->glUniform1ui(mapLocation(a[0]), u(1)); break;
+    case GLTraceOp::Uniform2f: f->glUniform2f(mapLocation(a[0]), fl(1), fl(2)); break;
+    case GLTraceOp::Uniform3f: f->glUniform3f(mapLocation(a[0]), fl(1), fl(2), fl(3)); break;
+    case GLTraceOp::Uniform3i: f->glUniform3i(mapLocation(a[0]), i32(1), i32(2), i32(3)); break;
+    case GLTraceOp::UniformMatrix3fv:
+        f->glUniformMatrix3fv(mapLocation(a[0]), i32(1), static_cast<GLboolean>(a[2]), static_cast<const GLfloat *>(blob));
+        break;
+    case GLTraceOp::UniformMatrix4fv:
+        f->glUniformMatrix4fv(mapLocation(a[0]), i32(1), static_cast<GLboolean>(a[2]), static_cast<const GLfloat *>(blob));
+        break;
+    case GLTraceOp::Uniformfv:
+    case GLTraceOp::Uniformiv:
+    case GLTraceOp::Uniformuiv:
+    {
+        // {location, components, count}
+        const GLint location = mapLocation(a[0]);
+        const GLsizei count = i32(2);
+        const int components = i32(1);
+        if (command.op == GLTraceOp::Uniformfv)
+        {
+            const auto *value = static_cast<const GLfloat *>(blob);
+            switch (components)
+            {
+            case 1: f->glUniform1fv(location, count, value); break;
+            case 2: f->glUniform2fv(location, count, value); break;
+            case 3: f->glUniform3fv(location, count, value); break;
+            default: f->glUniform4fv(location, count, value); break;
+            }
+        }
+        else if (command.op == GLTraceOp::Uniformiv)
+        {
+            const auto *value = static_cast<const GLint *>(blob);
+            switch (components)
+            {
+            case 1: f->glUniform1iv(location, count, value); break;
+            case 2: f->glUniform2iv(location, count, value); break;
+            case 3: f->glUniform3iv(location, count, value); break;
+            default: f->glUniform4iv(location, count, value); break;
+            }
+        }
+        else
+        {
+            const auto *value = static_cast<const GLuint *>(blob);
+            switch (components)
+            {
+            case 1: f->glUniform1uiv(location, count, value); break;
+            case 2: f->glUniform2uiv(location, count, value); break;
+            case 3: f->glUniform3uiv(location, count, value); break;
+            default: f->glUniform4uiv(location, count, value); break;
+            }
+        }
+        break;
+    }
+    case GLTraceOp::UseProgram:
+        capturedProgram = u(0);
+        f->glUseProgram(map(programs, a[0]));
+        break;
+    case GLTraceOp::VertexAttrib3f:
+    case GLTraceOp::VertexAttrib3fv:
+        vertexAttrib4f(u(0), fl(1), fl(2), fl(3), 1.0f);
+        break;
+    case GLTraceOp::VertexAttrib4f: vertexAttrib4f(u(0), fl(1), fl(2), fl(3), fl(4)); break;
+    case GLTraceOp::VertexAttribDivisor: f->glVertexAttribDivisor(u(0), u(1)); break;
+    case GLTraceOp::VertexAttribIPointer: f->glVertexAttribIPointer(u(0), i32(1), u(2), i32(3), offset(4)); break;
+    case GLTraceOp::VertexAttribPointer:
+        f->glVertexAttribPointer(u(0), i32(1), u(2), static_cast<GLboolean>(a[3]), i32(4), offset(5));
+        break;
+    case GLTraceOp::Viewport: f->glViewport(i32(0), i32(1), i32(2), i32(3)); break;
+    case GLTraceOp::FrameEnd:
+    case GLTraceOp::Count:
+        break;
+    }
+}
+
+void Replayer::cleanup()
+{
+    f->glUseProgram(0);
+    f->glBindVertexArray(0);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    for (const auto &program : programs)
+        f->glDeleteProgram(program.second);
+    for (const auto &shader : shaders)
+        f->glDeleteShader(shader.second);
+    for (const auto &buffer : buffers)
+        f->glDeleteBuffers(1, &buffer.second);
+    for (const auto &texture : textures)
+        f->glDeleteTextures(1, &texture.second);
+    for (const auto &renderbuffer : renderbuffers)
+        f->glDeleteRenderbuffers(1, &renderbuffer.second);
+    for (const auto &framebuffer : framebuffers)
+        f->glDeleteFramebuffers(1, &framebuffer.second);
+    for (const auto &vertexArray : vertexArrays)
+        f->glDeleteVertexArrays(1, &vertexArray.second);
+    programs.clear();
+    shaders.clear();
+    buffers.clear();
+    textures.clear();
+    renderbuffers.clear();
+    framebuffers.clear();
+    vertexArrays.clear();
+}
+
+/*
+ * Follows the state of the capturing context through the trace with the captured names and finds the
+ * calls that set a value the state already has. State that was never set is unknown, so the first
+ * call after the setup is only redundant if the setup already made the same call.
+ */
+class RedundancyAnalyzer {
+public:
+    explicit RedundancyAnalyzer(const GLTrace &trace) : trace(trace) {}
+
+    bool isRedundant(const GLTraceCommand &command);
+
+private:
+    const GLTrace &trace;
+    GLuint activeTexture = GL_TEXTURE0;
+    GLuint vertexArray = 0, program = 0;
+    std::unordered_map<uint64_t, GLuint> bindings;       // by target, element buffers by target and vertex array
+    std::unordered_map<uint64_t, GLuint> textureBindings; // by unit and target
+    std::unordered_map<uint64_t, bool> capabilities;
+    std::unordered_map<uint64_t, bool> attributeArrays;   // by vertex array and index
+    std::unordered_map<uint64_t, int64_t> textureParameters; // by texture and parameter
+    std::unordered_map<uint64_t, QByteArray> uniforms;    // by program and location
+    std::unordered_map<uint32_t, QByteArray> fixedState;  // by op: clear color, viewport, blend, cull, depth and stencil state
+
+    template <typename Key, typename Value>
+    static bool assign(std::unordered_map<Key, Value> &state, Key key, const Value &value)
+    {
+        const auto result = state.emplace(key, value);
+        if (result.second)
+            return false;
+        if (result.first->second == value)
+            return true;
+        result.first->second = value;
+        return false;
+    }
+    static uint64_t key(uint64_t high, uint64_t low) { return (high << 32) | (low & 0xffffffffu); }
+    QByteArray argBytes(const GLTraceCommand &command, int first, int count) const
+    {
+        return QByteArray(reinterpret_cast<const char *>(&command.args[first]), static_cast<qsizetype>(sizeof(int64_t) * count));
+    }
+    // the value of a uniform as the bytes of 32 bit components, so glUniform3f and glUniform3fv compare equal
+    QByteArray uniformValue(const GLTraceCommand &command) const;
+    void forget(const GLTraceCommand &deleteCommand);
+};
+
+QByteArray RedundancyAnalyzer::uniformValue(const GLTraceCommand &command) const
+{
+    if (command.blob != GLTraceCommand::noBlob)
+        return trace.blobs[command.blob];
+    const int components = command.op == GLTraceOp::Uniform2f ? 2 : command.op == GLTraceOp::Uniform3f || command.op == GLTraceOp::Uniform3i ? 3 : 1;
+    QByteArray value(static_cast<qsizetype>(sizeof(uint32_t) * components), Qt::Uninitialized);
+    for (int i = 0; i < components; ++i)
+    {
+        const uint32_t bits = static_cast<uint32_t>(command.args[i + 1]);
+        std::memcpy(value.data() + sizeof(uint32_t) * i, &bits, sizeof(bits));
+    }
+    return value;
+}
+
+void RedundancyAnalyzer::forget(const GLTraceCommand &deleteCommand)
+{
+    // deleting a bound object binds 0 in its place
+    const GLuint *names = blobNames(trace, deleteCommand);
+    const GLuint *end = names + deleteCommand.args[0];
+    const auto deleted = [names, end](GLuint name) { return std::find(names, end, name) != end; };
+    for (auto &binding : bindings)
+    {
+        if (deleted(binding.second))
+            binding.second = 0;
+    }
+    for (auto &binding : textureBindings)
+    {
+        if (deleted(binding.second))
+            binding.second = 0;
+    }
+    if (deleteCommand.op == GLTraceOp::DeleteVertexArrays && deleted(vertexArray))
+        vertexArray = 0;
+}
+
+bool RedundancyAnalyzer::isRedundant(const GLTraceCommand &command)
+{
+    const auto &a = command.args;
+    const uint32_t op = static_cast<uint32_t>(command.op);
+    switch (command.op)
+    {
+    case GLTraceOp::ActiveTexture:
+    {
+        const bool redundant = activeTexture == static_cast<GLuint>(a[0]);
+        activeTexture = static_cast<GLuint>(a[0]);
+        return redundant;
+    }
+    case GLTraceOp::BindBuffer:
+    {
+        // the element buffer belongs to the vertex array
+        const uint64_t target = a[0] == GL_ELEMENT_ARRAY_BUFFER ? key(vertexArray, GL_ELEMENT_ARRAY_BUFFER) : static_cast<uint64_t>(a[0]);
+        return assign(bindings, target, static_cast<GLuint>(a[1]));
+    }
+    case GLTraceOp::BindFramebuffer:
+        if (a[0] == GL_FRAMEBUFFER)
+        {
+            const bool draw = assign(bindings, uint64_t(GL_DRAW_FRAMEBUFFER), static_cast<GLuint>(a[1]));
+            const bool read = assign(bindings, uint64_t(GL_READ_FRAMEBUFFER), static_cast<GLuint>(a[1]));
+            return draw && read;
+        }
+        return assign(bindings, static_cast<uint64_t>(a[0]), static_cast<GLuint>(a[1]));
+    case GLTraceOp::BindRenderbuffer:
+        return assign(bindings, static_cast<uint64_t>(a[0]), static_cast<GLuint>(a[1]));
+    case GLTraceOp::BindTexture:
+        return assign(textureBindings, key(activeTexture, static_cast<uint64_t>(a[0])), static_cast<GLuint>(a[1]));
+    case GLTraceOp::BindVertexArray:
+    {
+        const bool redundant = vertexArray == static_cast<GLuint>(a[0]);
+        vertexArray = static_cast<GLuint>(a[0]);
+        return redundant;
+    }
+    case GLTraceOp::UseProgram:
+    {
+        const bool redundant = program == static_cast<GLuint>(a[0]);
+        program = static_cast<GLuint>(a[0]);
+        return redundant;
+    }
+    case GLTraceOp::Enable:
+    case GLTraceOp::Disable:
+        return assign(capabilities, static_cast<uint64_t>(a[0]), command.op == GLTraceOp::Enable);
+    case GLTraceOp::EnableVertexAttribArray:
+    case GLTraceOp::DisableVertexAttribArray:
+        // attribute arrays belong to the vertex array
+        return assign(attributeArrays, key(vertexArray, static_cast<uint64_t>(a[0])), command.op == GLTraceOp::EnableVertexAttribArray);
+    case GLTraceOp::TexParameteri:
+    {
+        const auto bound = textureBindings.find(key(activeTexture, static_cast<uint64_t>(a[0])));
+        if (bound == textureBindings.end())
+            return false;
+        return assign(textureParameters, key(bound->second, static_cast<uint64_t>(a[1])), a[2]);
+    }
+    case GLTraceOp::BlendFunc:
+    case GLTraceOp::ClearColor:
+    case GLTraceOp::ColorMask:
+    case GLTraceOp::CullFace:
+    case GLTraceOp::DepthFunc:
+    case GLTraceOp::DepthMask:
+    case GLTraceOp::StencilFunc:
+    case GLTraceOp::StencilOp:
+    case GLTraceOp::Viewport:
+        return assign(fixedState, op, argBytes(command, 0, 4));
+    case GLTraceOp::VertexAttrib3f:
+    case GLTraceOp::VertexAttrib3fv:
+    case GLTraceOp::VertexAttrib4f:
+    {
+        // a constant attribute set by glVertexAttrib3f has w = 1
+        GLTraceCommand value = command;
+        if (command.op != GLTraceOp::VertexAttrib4f)
+            value.args[4] = GLTrace::floatArg(1.0f);
+        return assign(fixedState, static_cast<uint32_t>(opCount) + static_cast<uint32_t>(a[0]), argBytes(value, 1, 4));
+    }
+    case GLTraceOp::Uniform1i:
+    case GLTraceOp::Uniform1ui:
+    case GLTraceOp::Uniform2f:
+    case GLTraceOp::Uniform3f:
+    case GLTraceOp::Uniform3i:
+    case GLTraceOp::UniformMatrix3fv:
+    case GLTraceOp::UniformMatrix4fv:
+    case GLTraceOp::Uniformfv:
+    case GLTraceOp::Uniformiv:
+    case GLTraceOp::Uniformuiv:
+        if (a[0] < 0)
+            return true; // the location does not exist, the call does nothing at all
+        return assign(uniforms, key(program, static_cast<uint64_t>(a[0])), uniformValue(command));
+    case GLTraceOp::LinkProgram:
+    {
+        // linking resets the uniforms of the program
+        for (auto it = uniforms.begin(); it != uniforms.end();)
+            it = (it->first >> 32) == static_cast<uint64_t>(a[0]) ? uniforms.erase(it) : std::next(it);
+        return false;
+    }
+    case GLTraceOp::DeleteBuffers:
+    case GLTraceOp::DeleteFramebuffers:
+    case GLTraceOp::DeleteRenderbuffers:
+    case GLTraceOp::DeleteTextures:
+    case GLTraceOp::DeleteVertexArrays:
+        forget(command);
+        return false;
+    default:
+        return false;
+    }
+}
+
+struct CallStats {
+    size_t count = 0, redundant = 0;
+    qint64 totalNs = 0, maxNs = 0;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Same platform and driver selection as headless_bench
+    bool useHardware = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--hardware") == 0)
+            useHardware = true;
+    }
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    if (!useHardware)
+    {
+        qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+        qputenv("GALLIUM_DRIVER", "llvmpipe");
+    }
+
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setRenderableType(QSurfaceFormat::RenderableType::OpenGL);
+    format.setDepthBufferSize(24);
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::OpenGLContextProfile::CoreProfile);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QGuiApplication app(argc, argv);
+    QGuiApplication::setApplicationName(QStringLiteral("glreplay"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Replays an OpenGL trace of uebung_03 offscreen and reports per call timings and redundant calls as JSON."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("trace"), QStringLiteral("Trace written with F12 in uebung_03."));
+    const QCommandLineOption loopsOption(QStringLiteral("loops"), QStringLiteral("How often the captured frames are replayed and measured."), QStringLiteral("n"), QStringLiteral("20"));
+    const QCommandLineOption warmupOption(QStringLiteral("warmup"), QStringLiteral("Number of unmeasured replays of the captured frames."), QStringLiteral("n"), QStringLiteral("2"));
+    const QCommandLineOption syncOption(QStringLiteral("sync"), QStringLiteral("Call glFinish after every call, so the time of a call includes its GPU work."));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Write the JSON report to this file instead of stdout."), QStringLiteral("file"));
+    const QCommandLineOption hardwareOption(QStringLiteral("hardware"), QStringLiteral("Do not force Mesa llvmpipe."));
+    parser.addOption(loopsOption);
+    parser.addOption(warmupOption);
+    parser.addOption(syncOption);
+    parser.addOption(outputOption);
+    parser.addOption(hardwareOption);
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+    const QString traceFileName = parser.positionalArguments().first();
+    GLTrace trace;
+    if (!trace.load(traceFileName))
+    {
+        std::cerr << "glreplay: could not load trace " << qPrintable(traceFileName) << std::endl;
+        return 1;
+    }
+    const size_t frames = trace.frameCount();
+    if (frames == 0)
+    {
+        std::cerr << "glreplay: " << qPrintable(traceFileName) << " contains no frame" << std::endl;
+        return 1;
+    }
+    const int loops = std::max(1, parser.value(loopsOption).toInt());
+    const int warmupLoops = std::max(0, parser.value(warmupOption).toInt());
+    const bool sync = parser.isSet(syncOption);
+
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create() || !context.makeCurrent(&surface))
+    {
+        std::cerr << "glreplay: could not create an OpenGL 3.3 core context" << std::endl;
+        return 1;
+    }
+    auto *f = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_3_Core>(&context);
+    if (!f)
+    {
+        std::cerr << "glreplay: OpenGL 3.3 core functions are not available" << std::endl;
+        return 1;
+    }
+
+    OffscreenTarget target;
+    if (!target.create(f, std::max(1, trace.width), std::max(1, trace.height)))
+    {
+        std::cerr << "glreplay: framebuffer object is incomplete" << std::endl;
+        return 1;
+    }
+
+    Replayer replayer(f, trace, target.fbo);
+    RedundancyAnalyzer analyzer(trace);
+    std::vector<bool> redundant(trace.commands.size(), false);
+    for (size_t i = 0; i < trace.commands.size(); ++i)
+        redundant[i] = analyzer.isRedundant(trace.commands[i]) && i >= trace.setupCommands;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (size_t i = 0; i < trace.setupCommands; ++i)
+        replayer.execute(trace.commands[i]);
+    f->glFinish();
+    const double setupMs = timer.nsecsElapsed() / 1e6;
+
+    GLuint timeQuery = 0;
+    f->glGenQueries(1, &timeQuery);
+
+    // Every loop replays all captured frames. The state at the end of the last frame is the
+    // state of the next frame of the application, so later loops see the same state changes.
+    std::vector<CallStats> stats(opCount);
+    std::vector<double> cpuMs, gpuMs, frameMs;
+    for (int loop = 0; loop < warmupLoops + loops; ++loop)
+    {
+        const bool measured = loop >= warmupLoops;
+        size_t index = trace.setupCommands;
+        for (size_t frame = 0; frame < frames; ++frame)
+        {
+            qint64 cpuNs = 0;
+            timer.start();
+            f->glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+            for (; index < trace.commands.size() && trace.commands[index].op != GLTraceOp::FrameEnd; ++index)
+            {
+                const GLTraceCommand &command = trace.commands[index];
+                const qint64 begin = timer.nsecsElapsed();
+                replayer.execute(command);
+                if (sync)
+                    f->glFinish();
+                const qint64 ns = timer.nsecsElapsed() - begin;
+                cpuNs += ns;
+                if (!measured)
+                    continue;
+                CallStats &call = stats[static_cast<size_t>(command.op)];
+                call.count++;
+                if (redundant[index])
+                    call.redundant++;
+                call.totalNs += ns;
+                call.maxNs = std::max(call.maxNs, ns);
+            }
+            ++index; // FrameEnd
+            f->glEndQuery(GL_TIME_ELAPSED);
+            f->glFinish();
+            const qint64 frameNs = timer.nsecsElapsed();
+            if (!measured)
+                continue;
+            GLuint64 gpuNs = 0;
+            f->glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &gpuNs);
+            cpuMs.push_back(cpuNs / 1e6);
+            gpuMs.push_back(gpuNs / 1e6);
+            frameMs.push_back(frameNs / 1e6);
+        }
+    }
+
+    std::vector<size_t> order;
+    for (size_t op = 0; op < opCount; ++op)
+    {
+        if (stats[op].count > 0)
+            order.push_back(op);
+    }
+    std::sort(order.begin(), order.end(), [&stats](size_t a, size_t b) { return stats[a].totalNs > stats[b].totalNs; });
+
+    QJsonArray calls;
+    size_t callCount = 0, redundantCount = 0;
+    std::fprintf(stderr, "%-28s %10s %12s %10s %10s\n", "call", "per frame", "total ms", "mean us", "redundant");
+    for (size_t op : order)
+    {
+        const CallStats &call = stats[op];
+        const char *name = GLTrace::opName(static_cast<GLTraceOp>(op));
+        const double perFrame = static_cast<double>(call.count) / static_cast<double>(cpuMs.size());
+        const double meanUs = call.totalNs / 1e3 / static_cast<double>(call.count);
+        std::fprintf(stderr, "%-28s %10.1f %12.3f %10.3f %9.1f%%\n", name, perFrame, call.totalNs / 1e6, meanUs,
+                     100.0 * static_cast<double>(call.redundant) / static_cast<double>(call.count));
+        QJsonObject entry;
+        entry["name"] = QString(name);
+        entry["callsPerFrame"] = perFrame;
+        entry["totalMs"] = call.totalNs / 1e6;
+        entry["meanUs"] = meanUs;
+        entry["maxUs"] = call.maxNs / 1e3;
+        entry["redundantPerFrame"] = static_cast<double>(call.redundant) / static_cast<double>(cpuMs.size());
+        calls.append(entry);
+        callCount += call.count;
+        redundantCount += call.redundant;
+    }
+
+    QJsonObject report;
+    report["trace"] = traceFileName;
+    report["capturedRenderer"] = trace.renderer;
+    report["renderer"] = QString(reinterpret_cast<const char *>(f->glGetString(GL_RENDERER)));
+    QJsonArray resolution;
+    resolution.append(trace.width);
+    resolution.append(trace.height);
+    report["resolution"] = resolution;
+    report["capturedFrames"] = static_cast<qint64>(frames);
+    report["loops"] = loops;
+    report["warmupLoops"] = warmupLoops;
+    report["syncEveryCall"] = sync;
+    report["setupCommands"] = static_cast<qint64>(trace.setupCommands);
+    report["frameCommands"] = static_cast<qint64>(trace.commands.size() - trace.setupCommands - frames);
+    report["blobBytes"] = static_cast<qint64>(trace.blobBytes());
+    report["setupMs"] = setupMs;
+    report["cpuFrameMs"] = toJson(summarize(cpuMs));
+    report["gpuFrameMs"] = toJson(summarize(gpuMs));
+    report["frameMs"] = toJson(summarize(frameMs));
+    report["redundantPercent"] = callCount > 0 ? 100.0 * static_cast<double>(redundantCount) / static_cast<double>(callCount) : 0.0;
+    report["calls"] = calls;
+
+    f->glDeleteQueries(1, &timeQuery);
+    replayer.cleanup();
+    target.destroy(f);
+    context.doneCurrent();
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOption))
+    {
+        QFile outputFile(parser.value(outputOption));
+        if (!outputFile.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate))
+        {
+            std::cerr << "glreplay: could not open " << qPrintable(parser.value(outputOption)) << std::endl;
+            return 1;
+        }
+        outputFile.write(json);
+    }
+    else
+    {
+        std::cout << json.constData() << std::endl;
+    }
+    return 0;
+}
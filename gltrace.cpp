@@ -0,0 +1,185 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Captured OpenGL commands of one or more frames together with    //
+//          the buffer, texture and shader data they reference               //
+// ========================================================================= //
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDataStream>
+#include <QFile>
+
+#include "gltrace.h"
+
+namespace {
+
+const char fileMagic[8] = {'G', 'D', 'V', 'G', 'L', 'T', 'R', '\0'};
+
+} // namespace
+
+void GLTrace::clear()
+{
+    width = height = 0;
+    renderer.clear();
+    setupCommands = 0;
+    commands.clear();
+    blobs.clear();
+}
+
+GLTraceCommand &GLTrace::add(GLTraceOp op, std::initializer_list<int64_t> args, uint32_t blob)
+{
+    GLTraceCommand command;
+    command.op = op;
+    command.blob = blob;
+    std::copy_n(args.begin(), std::min<size_t>(args.size(), GLTraceCommand::maxArgs), command.args.begin());
+    commands.push_back(command);
+    return commands.back();
+}
+
+uint32_t GLTrace::addBlob(const void *data, size_t size)
+{
+    return addBlob(QByteArray(static_cast<const char *>(data), static_cast<qsizetype>(size)));
+}
+
+uint32_t GLTrace::addBlob(QByteArray data)
+{
+    blobs.push_back(std::move(data));
+    return static_cast<uint32_t>(blobs.size() - 1);
+}
+
+size_t GLTrace::frameCount() const
+{
+    return static_cast<size_t>(std::count_if(commands.begin() + static_cast<std::ptrdiff_t>(setupCommands), commands.end(),
+                                             [](const GLTraceCommand &command) { return command.op == GLTraceOp::FrameEnd; }));
+}
+
+size_t GLTrace::blobBytes() const
+{
+    size_t bytes = 0;
+    for (const QByteArray &blob : blobs)
+        bytes += static_cast<size_t>(blob.size());
+    return bytes;
+}
+
+bool GLTrace::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate))
+        return false;
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    out.writeRawData(fileMagic, sizeof(fileMagic));
+    out << fileVersion << static_cast<int32_t>(width) << static_cast<int32_t>(height) << renderer.toUtf8();
+    out << static_cast<uint64_t>(setupCommands) << static_cast<uint64_t>(commands.size()) << static_cast<uint64_t>(blobs.size());
+    for (const GLTraceCommand &command : commands)
+    {
+        // only the arguments up to the last non-zero one are stored
+        uint8_t argCount = GLTraceCommand::maxArgs;
+        while (argCount > 0 && command.args[argCount - 1] == 0)
+            argCount--;
+        out << static_cast<uint16_t>(command.op) << command.blob << argCount;
+        for (uint8_t i = 0; i < argCount; ++i)
+            out << static_cast<qint64>(command.args[i]);
+    }
+    for (const QByteArray &blob : blobs)
+        out << qCompress(blob);
+    return out.status() == QDataStream::Ok && file.flush();
+}
+
+bool GLTrace::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::OpenModeFlag::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    char magic[sizeof(fileMagic)];
+    if (in.readRawData(magic, sizeof(magic)) != sizeof(magic) || !std::equal(magic, magic + sizeof(magic), fileMagic))
+        return false;
+    uint32_t version = 0;
+    int32_t fileWidth = 0, fileHeight = 0;
+    QByteArray fileRenderer;
+    uint64_t fileSetupCommands = 0, commandCount = 0, blobCount = 0;
+    in >> version;
+    if (version != fileVersion)
+        return false;
+    in >> fileWidth >> fileHeight >> fileRenderer >> fileSetupCommands >> commandCount >> blobCount;
+    if (in.status() != QDataStream::Ok || fileSetupCommands > commandCount)
+        return false;
+
+    std::vector<GLTraceCommand> loadedCommands;
+    loadedCommands.reserve(commandCount);
+    for (uint64_t i = 0; i < commandCount && in.status() == QDataStream::Ok; ++i)
+    {
+        GLTraceCommand command;
+        uint16_t op = 0;
+        uint8_t argCount = 0;
+        in >> op >> command.blob >> argCount;
+        if (op >= static_cast<uint16_t>(GLTraceOp::Count) || argCount > GLTraceCommand::maxArgs)
+            return false;
+        command.op = static_cast<GLTraceOp>(op);
+        for (uint8_t arg = 0; arg < argCount; ++arg)
+        {
+            qint64 value = 0;
+            in >> value;
+            command.args[arg] = value;
+        }
+        loadedCommands.push_back(command);
+    }
+    std::vector<QByteArray> loadedBlobs;
+    loadedBlobs.reserve(blobCount);
+    for (uint64_t i = 0; i < blobCount && in.status() == QDataStream::Ok; ++i)
+    {
+        QByteArray compressed;
+        in >> compressed;
+        loadedBlobs.push_back(qUncompress(compressed));
+    }
+    if (in.status() != QDataStream::Ok)
+        return false;
+    for (const GLTraceCommand &command : loadedCommands)
+    {
+        if (command.blob != GLTraceCommand::noBlob && command.blob >= loadedBlobs.size())
+            return false;
+    }
+
+    width = fileWidth;
+    height = fileHeight;
+    renderer = QString::fromUtf8(fileRenderer);
+    setupCommands = fileSetupCommands;
+    commands = std::move(loadedCommands);
+    blobs = std::move(loadedBlobs);
+    return true;
+}
+
+const char *GLTrace::opName(GLTraceOp op)
+{
+    static const char *names[] = {
+#define GDV_GL_TRACE_NAME(name) "gl" #name,
+        GDV_GL_TRACE_OPS(GDV_GL_TRACE_NAME)
+#undef GDV_GL_TRACE_NAME
+    };
+    const size_t index = static_cast<size_t>(op);
+    return index < static_cast<size_t>(GLTraceOp::Count) ? names[index] : "unknown";
+}
+
+int64_t GLTrace::floatArg(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float GLTrace::argFloat(int64_t arg)
+{
+    const uint32_t bits = static_cast<uint32_t>(arg);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
@@ -0,0 +1,90 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Captured OpenGL commands of one or more frames together with    //
+//          the buffer, texture and shader data they reference               //
+// ========================================================================= //
+
+#ifndef GLTRACE_H
+#define GLTRACE_H
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+// Every recorded command, named after the OpenGL function without the "gl" prefix.
+// Uniformfv/iv/uiv and VertexAttrib4f only appear in the setup of a trace, FrameEnd separates the frames.
+#define GDV_GL_TRACE_OPS(X) \
+    X(ActiveTexture) X(AttachShader) X(BindBuffer) X(BindFramebuffer) X(BindRenderbuffer) X(BindTexture) \
+    X(BindVertexArray) X(BlendFunc) X(BlitFramebuffer) X(BufferData) X(BufferSubData) X(Clear) X(ClearBufferuiv) \
+    X(ClearColor) X(ColorMask) X(CompileShader) X(CreateProgram) X(CreateShader) X(CullFace) X(DeleteBuffers) \
+    X(DeleteFramebuffers) X(DeleteProgram) X(DeleteRenderbuffers) X(DeleteShader) X(DeleteTextures) \
+    X(DeleteVertexArrays) X(DepthFunc) X(DepthMask) X(Disable) X(DisableVertexAttribArray) X(DrawArrays) \
+    X(DrawBuffers) X(DrawElements) X(DrawElementsInstanced) X(Enable) X(EnableVertexAttribArray) \
+    X(FramebufferRenderbuffer) X(FramebufferTexture2D) X(GenBuffers) X(GenFramebuffers) X(GenRenderbuffers) \
+    X(GenTextures) X(GenVertexArrays) X(GenerateMipmap) X(GetUniformLocation) X(LinkProgram) X(RenderbufferStorage) \
+    X(ShaderSource) X(StencilFunc) X(StencilOp) X(StencilOpSeparate) X(TexBuffer) X(TexImage2D) X(TexParameteri) \
+    X(Uniform1i) X(Uniform1ui) X(Uniform2f) X(Uniform3f) X(Uniform3i) X(UniformMatrix3fv) X(UniformMatrix4fv) \
+    X(Uniformfv) X(Uniformiv) X(Uniformuiv) X(UseProgram) X(VertexAttrib3f) X(VertexAttrib3fv) X(VertexAttrib4f) \
+    X(VertexAttribDivisor) X(VertexAttribIPointer) X(VertexAttribPointer) X(Viewport) X(FrameEnd)
+
+enum class GLTraceOp : uint16_t {
+#define GDV_GL_TRACE_ENUM(name) name,
+    GDV_GL_TRACE_OPS(GDV_GL_TRACE_ENUM)
+#undef GDV_GL_TRACE_ENUM
+    Count
+};
+
+// One call with its arguments in the order of the OpenGL function. Floats are stored bitwise,
+// pointers to arrays (names, uniform values, pixels, sources) are stored as blob.
+struct GLTraceCommand {
+    static constexpr uint32_t noBlob = 0xffffffffu;
+    static constexpr int maxArgs = 10;
+
+    GLTraceOp op = GLTraceOp::FrameEnd;
+    uint32_t blob = noBlob;
+    std::array<int64_t, maxArgs> args{};
+};
+
+/*
+ * A trace starts with setup commands that rebuild all objects that existed when the capture began
+ * (with their contents read back from the GPU) and the bound state. The captured frames follow,
+ * each terminated by FrameEnd. Object names are those of the capturing context; a replayer maps
+ * them to its own names. Framebuffers that were not created through GLFunctions (like the one of
+ * the QOpenGLWidget) stand for the replayer's render target.
+ */
+class GLTrace {
+public:
+    static constexpr uint32_t fileVersion = 8;
+
+    int width = 0, height = 0; // viewport at the start of the capture
+    QString renderer;
+    size_t setupCommands = 0;
+    std::vector<GLTraceCommand> commands;
+    std::vector<QByteArray> blobs;
+
+    void clear();
+    GLTraceCommand& add(GLTraceOp op, std::initializer_list<int64_t> args, uint32_t blob = GLTraceCommand::noBlob);
+    uint32_t addBlob(const void* data, size_t size);
+    uint32_t addBlob(QByteArray data);
+
+    size_t frameCount() const;
+    size_t blobBytes() const;
+
+    // blobs are compressed. Return false if the file could not be written or is no valid trace.
+    bool save(const QString& fileName) const;
+    bool load(const QString& fileName);
+
+    static const char* opName(GLTraceOp op);
+    static int64_t floatArg(float value);
+    static float argFloat(int64_t arg);
+};
+
+#endif // GLTRACE_H
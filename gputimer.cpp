@@ -0,0 +1,224 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: GPU time per render pass, measured with GL_TIMESTAMP queries     //
+//          and read back without stalling the pipeline                      //
+// ========================================================================= //
+
+#include <cstring>
+
+#include "gputimer.h"
+#include "log.h"
+#include "profiler.h"
+
+void GpuTimer::PassStatistics::add(double ms)
+{
+    if (sampleCount == averageWindow)
+        sum -= samples[nextSample];
+    else
+        sampleCount++;
+    samples[nextSample] = ms;
+    sum += ms;
+    nextSample = (nextSample + 1) % averageWindow;
+}
+
+void GpuTimer::initialize(GLFunctions *f)
+{
+    this->f = f;
+    for (auto &frame : frames)
+    {
+        f->glGenQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        frame.passCount = 0;
+        frame.pending = false;
+    }
+    calibrate();
+}
+
+void GpuTimer::cleanup()
+{
+    if (!f)
+        return;
+    for (auto &frame : frames)
+    {
+        f->glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        frame.queries.fill(0);
+        frame.pending = false;
+    }
+    f = nullptr;
+}
+
+void GpuTimer::calibrate()
+{
+    GLint64 gpuNow = 0;
+    f->glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuClockOffset = gpuNow - static_cast<int64_t>(Profiler::now());
+    framesSinceCalibration = 0;
+}
+
+void GpuTimer::beginFrame()
+{
+    recording = false;
+    if (!f || !enabled)
+        return;
+
+    // read back all finished frames, oldest first
+    for (int i = 1; i <= framesInFlight; ++i)
+    {
+        FrameQueries &frame = frames[(currentFrame + i) % framesInFlight];
+        if (frame.pending && !collect(frame))
+            break;
+    }
+
+    // the clocks of CPU and GPU drift apart, so the trace offset is refreshed regularly
+    if (++framesSinceCalibration >= 300)
+        calibrate();
+
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    FrameQueries &frame = frames[currentFrame];
+    if (frame.pending)
+        return; // the GPU is more than framesInFlight frames behind, skip this frame
+    frame.passCount = 0;
+    recording = true;
+}
+
+void GpuTimer::endFrame()
+{
+    if (passOpen)
+        endPass();
+    if (recording && frames[currentFrame].passCount > 0)
+        frames[currentFrame].pending = true;
+    recording = false;
+}
+
+void GpuTimer::beginPass(const char *name)
+{
+    FrameQueries &frame = frames[currentFrame];
+    if (!recording || passOpen)
+        return;
+    if (frame.passCount == maxPasses)
+    {
+        if (!passesDropped)
+            LOG_WARNING(Render, "GpuTimer: more than {} passes in a frame, {} and the following are not measured",
+                        maxPasses, name);
+        passesDropped = true;
+        return;
+    }
+    frame.names[frame.passCount] = name;
+    f->glQueryCounter(frame.queries[2 * frame.passCount], GL_TIMESTAMP);
+    passOpen = true;
+}
+
+void GpuTimer::endPass()
+{
+    if (!passOpen)
+        return;
+    FrameQueries &frame = frames[currentFrame];
+    f->glQueryCounter(frame.queries[2 * frame.passCount + 1], GL_TIMESTAMP);
+    frame.passCount++;
+    passOpen = false;
+}
+
+bool GpuTimer::collect(FrameQueries &frame)
+{
+    // queries finish in order, so the last one tells whether the whole frame is done
+    GLint available = 0;
+    f->glGetQueryObjectiv(frame.queries[2 * frame.passCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return false;
+
+    const bool trace = Profiler::isEnabled();
+    lastFrameMs = 0.0;
+    collectedFrames++;
+    for (int pass = 0; pass < frame.passCount; ++pass)
+    {
+        GLuint64 begin = 0, end = 0;
+        f->glGetQueryObjectui64v(frame.queries[2 * pass], GL_QUERY_RESULT, &begin);
+        f->glGetQueryObjectui64v(frame.queries[2 * pass + 1], GL_QUERY_RESULT, &end);
+        if (end < begin)
+            continue;
+        const double ms = (end - begin) / 1e6;
+        PassStatistics &passStatistics = statisticsFor(frame.names[pass]);
+        passStatistics.add(ms);
+        passStatistics.lastFrame = collectedFrames;
+        lastFrameMs += ms;
+        if (trace)
+            Profiler::recordGpuEvent(frame.names[pass], static_cast<uint64_t>(static_cast<int64_t>(begin) - gpuClockOffset),
+                                     static_cast<uint64_t>(static_cast<int64_t>(end) - gpuClockOffset));
+    }
+    frame.pending = false;
+    return true;
+}
+
+GpuTimer::PassStatistics &GpuTimer::statisticsFor(const char *name)
+{
+    for (auto &pass : statistics)
+    {
+        if (pass.name == name || std::strcmp(pass.name, name) == 0)
+            return pass;
+    }
+    statistics.emplace_back();
+    statistics.back().name = name;
+    return statistics.back();
+}
+
+std::vector<GpuTimer::PassTime> GpuTimer::getPassTimes() const
+{
+    std::vector<PassTime> result;
+    result.reserve(statistics.size());
+    for (const auto &pass : statistics)
+    {
+        if (isCurrent(pass))
+            result.push_back({pass.name, pass.sum / pass.sampleCount, pass.sampleCount});
+    }
+    return result;
+}
+
+GpuTimer::PassTime GpuTimer::getPassTime(const char *name) const
+{
+    for (const auto &pass : statistics)
+    {
+        if ((pass.name == name || std::strcmp(pass.name, name) == 0) && isCurrent(pass))
+            return {pass.name, pass.sum / pass.sampleCount, pass.sampleCount};
+    }
+    return {name, 0.0, 0};
+}
+
+void GpuTimer::resetPass(const char *name)
+{
+    for (auto &pass : statistics)
+    {
+        if (pass.name == name || std::strcmp(pass.name, name) == 0)
+        {
+            const char *passName = pass.name;
+            pass = PassStatistics();
+            pass.name = passName;
+            return;
+        }
+    }
+}
+
+double GpuTimer::getTotalMs() const
+{
+    double total = 0.0;
+    for (const auto &pass : getPassTimes())
+        total += pass.averageMs;
+    return total;
+}
+
+QString GpuTimer::summary() const
+{
+    const std::vector<PassTime> passes = getPassTimes();
+    if (passes.empty())
+        return QString();
+    QString details;
+    for (const auto &pass : passes)
+    {
+        if (!details.isEmpty())
+            details += QStringLiteral(", ");
+        details += QStringLiteral("%1 %2").arg(QString(pass.name)).arg(pass.averageMs, 0, 'f', 2);
+    }
+    return QStringLiteral("GPU %1 ms (%2)").arg(getTotalMs(), 0, 'f', 2).arg(details);
+}
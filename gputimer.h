@@ -0,0 +1,123 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: GPU time per render pass, measured with GL_TIMESTAMP queries     //
+//          and read back without stalling the pipeline                      //
+// ========================================================================= //
+
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <array>
+#include <vector>
+
+#include <QString>
+
+#include "glfunctions.h"
+
+/*
+ * Every pass is enclosed by two glQueryCounter(GL_TIMESTAMP) queries. The queries of a frame are read
+ * when the GPU has finished that frame, usually two or three frames later, so the CPU never waits for
+ * a result. If all query sets are still in flight, the frame is simply not measured.
+ * Finished passes are averaged over the last frames and added to the "GPU" track of the CPU profiler.
+ * Passes that were not part of the last averageWindow frames read back, e.g. the variant of a pass that
+ * is currently not drawn, no longer count.
+ */
+class GpuTimer
+{
+public:
+    // Scene::render() opens up to 15 passes per frame; later ones are not measured
+    static constexpr int maxPasses = 32;
+    static constexpr int framesInFlight = 4;
+    static constexpr int averageWindow = 60;
+
+    struct PassTime {
+        const char* name;
+        double averageMs;
+        int samples; // frames in the average
+    };
+
+    // creates the query objects. Needs a current OpenGL context.
+    void initialize(GLFunctions* f);
+    void cleanup();
+
+    void setEnabled(bool enable) { enabled = enable; }
+    bool isEnabled() const { return enabled; }
+
+    // beginFrame() collects the results of finished frames, so call it once per frame before the first pass
+    void beginFrame();
+    void endFrame();
+    // name must be a string literal. Passes must not be nested.
+    void beginPass(const char* name);
+    void endPass();
+
+    // rolling averages in the order the passes were first seen
+    std::vector<PassTime> getPassTimes() const;
+    // average of one pass, no samples if it was not measured recently
+    PassTime getPassTime(const char* name) const;
+    // forgets the samples of a pass, e.g. when the way it is drawn changed
+    void resetPass(const char* name);
+    // sum of the averages of all passes
+    double getTotalMs() const;
+    // sum of all passes of the latest frame read back
+    double getLastFrameMs() const { return lastFrameMs; }
+    // short text for the status bar, e.g. "GPU 2.10 ms (skybox 0.20, objects 1.90)"
+    QString summary() const;
+
+private:
+    struct FrameQueries {
+        std::array<GLuint, 2 * maxPasses> queries{};
+        std::array<const char*, maxPasses> names{};
+        int passCount = 0;
+        bool pending = false;
+    };
+
+    struct PassStatistics {
+        const char* name = nullptr;
+        std::array<double, averageWindow> samples{};
+        int sampleCount = 0;
+        int nextSample = 0;
+        double sum = 0.0;
+        uint64_t lastFrame = 0; // collectedFrames when the latest sample was added
+
+        void add(double ms);
+    };
+
+    GLFunctions* f = nullptr;
+    bool enabled = true;
+    std::array<FrameQueries, framesInFlight> frames;
+    int currentFrame = 0;
+    bool recording = false; // whether the current frame is measured
+    bool passOpen = false;
+    bool passesDropped = false; // whether the warning about a frame with more than maxPasses was logged
+    std::vector<PassStatistics> statistics;
+    uint64_t collectedFrames = 0;
+    double lastFrameMs = 0.0;
+
+    // GPU timestamp minus profiler time, updated every few frames
+    int64_t gpuClockOffset = 0;
+    int framesSinceCalibration = 0;
+
+    bool collect(FrameQueries& frame);
+    PassStatistics& statisticsFor(const char* name);
+    bool isCurrent(const PassStatistics& pass) const { return pass.sampleCount > 0 && collectedFrames - pass.lastFrame < averageWindow; }
+    void calibrate();
+};
+
+// Measures a pass from construction to destruction.
+class GpuPassScope
+{
+public:
+    GpuPassScope(GpuTimer& timer, const char* name) : timer(timer) { timer.beginPass(name); }
+    ~GpuPassScope() { timer.endPass(); }
+    GpuPassScope(const GpuPassScope& other) = delete;
+    GpuPassScope& operator= (const GpuPassScope& other) = delete;
+
+private:
+    GpuTimer& timer;
+};
+
+#endif // GPUTIMER_H
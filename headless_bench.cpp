@@ -0,0 +1,599 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Headless benchmark. Renders the scene of OpenGLView into an FBO //
+//          on an offscreen surface along a scripted camera path and prints  //
+//          frame time percentiles, draw and culling statistics as JSON      //
+// ========================================================================= //
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+
+#include "benchstats.h"
+#include "camerapath.h"
+#include "glfunctions.h"
+#include "hitchdetector.h"
+#include "profiler.h"
+#include "qualitygovernor.h"
+#include "scene.h"
+#include "utilities.h"
+
+namespace {
+
+struct CameraSample {
+    QVector3D pos;
+    QVector3D dir;
+};
+
+// Built-in camera paths, parametrized by t in [0, 1).
+CameraSample sampleCameraPath(const QString &path, float t)
+{
+    const float pi = static_cast<float>(M_PI);
+    if (path == QStringLiteral("orbit"))
+    {
+        // circle around the doppeldecker field, always looking at the origin
+        const float angle = t * 2.0f * pi;
+        QVector3D pos(15.0f * std::sin(angle), 5.0f, 15.0f * std::cos(angle));
+        return {pos, (-pos).normalized()};
+    }
+    if (path == QStringLiteral("flythrough"))
+    {
+        // straight flight through the field with a slight sway
+        QVector3D pos(2.0f * std::sin(t * 4.0f * pi), 1.0f, 20.0f - 60.0f * t);
+        return {pos, QVector3D(0.0f, 0.0f, -1.0f)};
+    }
+    // "static": the default view of OpenGLView::setDefaults()
+    return {QVector3D(0.0f, 0.0f, -3.0f), QVector3D(0.0f, 0.0f, -1.0f)};
+}
+
+// Framebuffer object with color and depth renderbuffers of fixed size.
+struct OffscreenTarget {
+    GLuint fbo = 0, colorRenderbuffer = 0, depthRenderbuffer = 0;
+
+    bool create(GLFunctions *f, int width, int height)
+    {
+        f->glGenRenderbuffers(1, &colorRenderbuffer);
+        f->glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+        f->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        f->glGenRenderbuffers(1, &depthRenderbuffer);
+        f->glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        f->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        f->glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        f->glGenFramebuffers(1, &fbo);
+        f->glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+        f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        return f->glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    void destroy(GLFunctions *f)
+    {
+        f->glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        f->glDeleteFramebuffers(1, &fbo);
+        f->glDeleteRenderbuffers(1, &colorRenderbuffer);
+        f->glDeleteRenderbuffers(1, &depthRenderbuffer);
+        fbo = colorRenderbuffer = depthRenderbuffer = 0;
+    }
+};
+
+QJsonObject countSummary(const std::vector<double> &samples)
+{
+    const SampleSummary summary = summarize(samples);
+    QJsonObject result;
+    result["mean"] = summary.mean;
+    result["min"] = summary.min;
+    result["max"] = summary.max;
+    return result;
+}
+
+bool parseDepthPrepassMode(const QString &text, DepthPrepassMode &mode)
+{
+    if (text == QStringLiteral("off"))
+        mode = DepthPrepassMode::Off;
+    else if (text == QStringLiteral("on"))
+        mode = DepthPrepassMode::On;
+    else if (text == QStringLiteral("auto"))
+        mode = DepthPrepassMode::Auto;
+    else
+        return false;
+    return true;
+}
+
+// "off", "on" or "auto" for all passes, or a list like "sphere=on,objects=auto"
+bool applyDepthPrepass(const QString &value, Scene &scene)
+{
+    DepthPrepassMode mode;
+    if (parseDepthPrepassMode(value, mode))
+    {
+        scene.setDepthPrepass(mode);
+        return true;
+    }
+    for (const QString &entry : value.split(QLatin1Char(',')))
+    {
+        const QStringList parts = entry.split(QLatin1Char('='));
+        if (parts.size() != 2 || !parseDepthPrepassMode(parts[1], mode))
+            return false;
+        if (parts[0] == QStringLiteral("sphere"))
+            scene.setDepthPrepass(Scene::ShadedPass::BumpSphere, mode);
+        else if (parts[0] == QStringLiteral("objects"))
+            scene.setDepthPrepass(Scene::ShadedPass::Objects, mode);
+        else if (parts[0] == QStringLiteral("terrain"))
+            scene.setDepthPrepass(Scene::ShadedPass::Terrain, mode);
+        else
+            return false;
+    }
+    return true;
+}
+
+QJsonObject depthPrepassReport(const Scene &scene)
+{
+    static const char *const modes[] = {"off", "on", "auto"};
+    QJsonObject result;
+    for (int i = 0; i < Scene::shadedPassCount; ++i)
+    {
+        const auto pass = static_cast<Scene::ShadedPass>(i);
+        const DepthPrepassSelector &selector = scene.getDepthPrepass(pass);
+        QJsonObject entry;
+        entry["mode"] = modes[static_cast<int>(selector.getMode())];
+        entry["prepass"] = selector.usePrepass();
+        // the GPU time of the pass with and without pre-pass as measured by auto
+        if (selector.getMode() == DepthPrepassMode::Auto && selector.getMsWith() > 0.0)
+        {
+            entry["msWithout"] = selector.getMsWithout();
+            entry["msWith"] = selector.getMsWith();
+            entry["msSaved"] = selector.getMsWithout() - selector.getMsWith();
+        }
+        result[scene.getShadedPassName(pass)] = entry;
+    }
+    return result;
+}
+
+// shaded fragments per pixel of each pass, averaged over the measured frames
+QJsonObject overdrawReport(const OverdrawMeter &meter)
+{
+    const auto mean = meter.getMean();
+    QJsonObject result;
+    result["frames"] = static_cast<qint64>(meter.getMeasuredFrames());
+    for (int pass = 0; pass <= OverdrawMeter::passCount; ++pass)
+    {
+        QJsonObject entry;
+        entry["average"] = mean[pass].average;
+        entry["averageCovered"] = mean[pass].averageCovered;
+        entry["coverage"] = mean[pass].coverage;
+        entry["max"] = static_cast<int>(mean[pass].max);
+        result[OverdrawMeter::passName(pass)] = entry;
+    }
+    return result;
+}
+
+// binning time and lights per cluster averaged over the measured frames, lights per pixel over the
+// frames measureClusterLightsPerPixel() read back
+QJsonObject clusterReport(const LightClusters &clusters)
+{
+    const LightClusters::Stats mean = clusters.getMean();
+    QJsonObject result;
+    result["frames"] = static_cast<qint64>(clusters.getBinnedFrames());
+    QJsonArray grid;
+    grid.append(LightClusters::tilesX);
+    grid.append(LightClusters::tilesY);
+    grid.append(LightClusters::slices);
+    result["grid"] = grid;
+    result["binningMs"] = mean.binningMs;
+    result["lightsPerCluster"] = mean.lightsPerCluster;
+    result["occupancy"] = mean.occupancy;
+    result["maxLightsPerCluster"] = static_cast<int>(mean.max);
+    result["pixelFrames"] = static_cast<qint64>(clusters.getPixelMeasurements());
+    result["lightsPerPixel"] = clusters.getLightsPerPixel();
+    result["pixelCoverage"] = clusters.getPixelCoverage();
+    return result;
+}
+
+// Bytes of the per pixel buffers the geometry passes of the last frame wrote, for a comparison of the paths
+// together with the GPU pass times: none in the forward path, the G-buffer of the deferred one and the IDs
+// and depth of the visibility buffer, plus its instance records.
+QJsonObject shadingReport(const Scene &scene)
+{
+    QJsonObject result;
+    switch (scene.getLastShadingPath())
+    {
+    case Scene::ShadingPath::Forward:
+        result["path"] = QStringLiteral("forward");
+        result["bufferBytes"] = 0;
+        break;
+    case Scene::ShadingPath::Deferred:
+        result["path"] = QStringLiteral("deferred");
+        result["bufferBytes"] = static_cast<qint64>(scene.getDeferredRenderer().getGBufferBytes());
+        result["bytesPerPixel"] = 12;
+        break;
+    case Scene::ShadingPath::Visibility:
+        result["path"] = QStringLiteral("visibility");
+        result["bufferBytes"] = static_cast<qint64>(scene.getVisibilityBuffer().getBufferBytes());
+        result["bytesPerPixel"] = 8;
+        result["instances"] = static_cast<int>(scene.getVisibilityBuffer().getInstanceCount());
+        result["instanceBytes"] = static_cast<qint64>(scene.getVisibilityBuffer().getInstanceBytes());
+        break;
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Without a display we render through the offscreen platform plugin. Unless asked otherwise,
+    // force Mesa's llvmpipe so that numbers of different build machines are comparable.
+    bool useHardware = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--hardware") == 0)
+            useHardware = true;
+    }
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    if (!useHardware)
+    {
+        qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+        qputenv("GALLIUM_DRIVER", "llvmpipe");
+    }
+
+    //Same format as the interactive application, see main.cpp
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setRenderableType(QSurfaceFormat::RenderableType::OpenGL);
+    format.setDepthBufferSize(24);
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::OpenGLContextProfile::CoreProfile);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    QGuiApplication app(argc, argv);
+    QGuiApplication::setApplicationName(QStringLiteral("headless_bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Renders the exercise scene offscreen along a camera path and reports frame statistics as JSON."));
+    parser.addHelpOption();
+    const QCommandLineOption framesOption(QStringLiteral("frames"), QStringLiteral("Number of measured frames."), QStringLiteral("n"), QStringLiteral("300"));
+    const QCommandLineOption warmupOption(QStringLiteral("warmup"), QStringLiteral("Number of unmeasured warmup frames."), QStringLiteral("n"), QStringLiteral("30"));
+    const QCommandLineOption widthOption(QStringLiteral("width"), QStringLiteral("Framebuffer width."), QStringLiteral("pixels"), QStringLiteral("1280"));
+    const QCommandLineOption heightOption(QStringLiteral("height"), QStringLiteral("Framebuffer height."), QStringLiteral("pixels"), QStringLiteral("720"));
+    const QCommandLineOption gridSizeOption(QStringLiteral("grid-size"), QStringLiteral("Grid size, 5 doppeldeckers per step."), QStringLiteral("n"), QStringLiteral("20"));
+    const QCommandLineOption pathOption(QStringLiteral("path"), QStringLiteral("Camera path: orbit, flythrough or static."), QStringLiteral("name"), QStringLiteral("orbit"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Write the JSON report to this file instead of stdout."), QStringLiteral("file"));
+    const QCommandLineOption hardwareOption(QStringLiteral("hardware"), QStringLiteral("Do not force Mesa llvmpipe."));
+    const QCommandLineOption hitchOption(QStringLiteral("hitch-factor"), QStringLiteral("A frame slower than this multiple of the median frame is a hitch."), QStringLiteral("factor"), QStringLiteral("2"));
+    const QCommandLineOption qualityOption(QStringLiteral("target-fps"), QStringLiteral("Let the quality governor keep the frame rate at this target."), QStringLiteral("fps"));
+    const QCommandLineOption traceOption(QStringLiteral("trace"), QStringLiteral("Write a Chrome trace of the CPU profiler zones to this file."), QStringLiteral("file"));
+    const QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("Seed of the object positions and terrain, random if not set."), QStringLiteral("n"));
+    const QCommandLineOption replayOption(QStringLiteral("replay"), QStringLiteral("Render the frames of a recorded camera path instead of --path. Overrides --frames and --seed."), QStringLiteral("file"));
+    const QCommandLineOption staticBatchingOption(QStringLiteral("static-batching"), QStringLiteral("Draw the doppeldeckers from merged, pre-transformed clusters instead of one draw per instance."));
+    const QCommandLineOption vertexPullingOption(QStringLiteral("vertex-pulling"), QStringLiteral("Draw the meshes with the built-in shaders by fetching their attributes from buffer textures."));
+    const QCommandLineOption depthPrepassOption(QStringLiteral("depth-prepass"), QStringLiteral("Depth pre-pass before shading: off, on or auto for all passes, or per pass, e.g. sphere=on,objects=auto,terrain=off."), QStringLiteral("mode"), QStringLiteral("off"));
+    const QCommandLineOption overdrawOption(QStringLiteral("overdraw"), QStringLiteral("Count the shaded fragments per pixel of the skybox, bump sphere, objects and terrain."));
+    const QCommandLineOption shaderOption(QStringLiteral("shader"), QStringLiteral("Built-in shader of the meshes: 0 constant color, 1 Lambert."), QStringLiteral("index"), QStringLiteral("0"));
+    const QCommandLineOption deferredOption(QStringLiteral("deferred"), QStringLiteral("Shade the built-in materials in light passes over a G-buffer instead of in the geometry passes."));
+    const QCommandLineOption visibilityOption(QStringLiteral("visibility"), QStringLiteral("Draw instance and triangle IDs into a visibility buffer and shade every pixel once in a full-screen resolve. Takes precedence over --deferred."));
+    const QCommandLineOption displacementOption(QStringLiteral("displacement"), QStringLiteral("Displacement of the bump sphere: off, vertex (bump.vert on a fine sphere) or parallax (parallax occlusion mapping on the coarsest sphere). Other than off also enables its diffuse and normal maps."), QStringLiteral("mode"), QStringLiteral("off"));
+    const QCommandLineOption clusteredOption(QStringLiteral("clustered"), QStringLiteral("Bin the point lights into view frustum clusters, the forward shaders only evaluate the lights of their cluster."));
+    const QCommandLineOption pointLightsOption(QStringLiteral("point-lights"), QStringLiteral("Number of animated point lights over the terrain, in all shading paths."), QStringLiteral("n"), QStringLiteral("0"));
+    const QCommandLineOption recordOption(QStringLiteral("record-output"), QStringLiteral("Write the measured frames as camera path to this file, for camerapath_diff."), QStringLiteral("file"));
+    parser.addOption(framesOption);
+    parser.addOption(warmupOption);
+    parser.addOption(widthOption);
+    parser.addOption(heightOption);
+    parser.addOption(gridSizeOption);
+    parser.addOption(pathOption);
+    parser.addOption(outputOption);
+    parser.addOption(hardwareOption);
+    parser.addOption(hitchOption);
+    parser.addOption(qualityOption);
+    parser.addOption(traceOption);
+    parser.addOption(seedOption);
+    parser.addOption(replayOption);
+    parser.addOption(recordOption);
+    parser.addOption(staticBatchingOption);
+    parser.addOption(vertexPullingOption);
+    parser.addOption(depthPrepassOption);
+    parser.addOption(overdrawOption);
+    parser.addOption(shaderOption);
+    parser.addOption(deferredOption);
+    parser.addOption(visibilityOption);
+    parser.addOption(pointLightsOption);
+    parser.addOption(clusteredOption);
+    parser.addOption(displacementOption);
+    parser.process(app);
+
+    CameraPath replay;
+    if (parser.isSet(replayOption) && (!replay.load(parser.value(replayOption)) || replay.frames.empty()))
+    {
+        std::cerr << "headless_bench: could not load camera path " << qPrintable(parser.value(replayOption)) << std::endl;
+        return 1;
+    }
+    const bool replaying = !replay.frames.empty();
+
+    const int frames = replaying ? static_cast<int>(replay.frames.size()) : std::max(1, parser.value(framesOption).toInt());
+    const int warmupFrames = std::max(0, parser.value(warmupOption).toInt());
+    const int width = std::max(1, parser.value(widthOption).toInt());
+    const int height = std::max(1, parser.value(heightOption).toInt());
+    const int gridSize = std::max(1, parser.value(gridSizeOption).toInt());
+    const QString path = parser.value(pathOption);
+    Profiler::setThreadName("main");
+
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create() || !context.makeCurrent(&surface))
+    {
+        std::cerr << "headless_bench: could not create an OpenGL 3.3 core context" << std::endl;
+        return 1;
+    }
+    GLFunctions functions;
+    if (!functions.initializeOpenGLFunctions())
+    {
+        std::cerr << "headless_bench: OpenGL 3.3 core functions are not available" << std::endl;
+        return 1;
+    }
+    GLFunctions *f = &functions;
+
+    OffscreenTarget target;
+    if (!target.create(f, width, height))
+    {
+        std::cerr << "headless_bench: framebuffer object is incomplete" << std::endl;
+        return 1;
+    }
+
+    Scene scene;
+    if (replaying)
+        scene.setSeed(replay.seed);
+    else if (parser.isSet(seedOption))
+        scene.setSeed(parser.value(seedOption).toUInt());
+    scene.setGridSize(gridSize);
+    scene.toggleStaticBatching(parser.isSet(staticBatchingOption));
+    scene.toggleVertexPulling(parser.isSet(vertexPullingOption));
+    if (!applyDepthPrepass(parser.value(depthPrepassOption), scene))
+    {
+        std::cerr << "headless_bench: invalid --depth-prepass " << qPrintable(parser.value(depthPrepassOption)) << std::endl;
+        return 1;
+    }
+    scene.setOverdrawMeasurement(parser.isSet(overdrawOption));
+    scene.toggleDeferredShading(parser.isSet(deferredOption));
+    scene.toggleVisibilityBuffer(parser.isSet(visibilityOption));
+    scene.setPointLightCount(parser.value(pointLightsOption).toUInt());
+    scene.toggleClusteredLighting(parser.isSet(clusteredOption));
+    const QString displacement = parser.value(displacementOption);
+    if (displacement != QStringLiteral("off") && displacement != QStringLiteral("vertex") && displacement != QStringLiteral("parallax"))
+    {
+        std::cerr << "headless_bench: invalid --displacement " << qPrintable(displacement) << std::endl;
+        return 1;
+    }
+    // the parallax offset only shows in the texture lookups
+    const bool bumpMaps = displacement != QStringLiteral("off");
+    scene.toggleDiffuse(bumpMaps);
+    scene.toggleNormalMapping(bumpMaps);
+    scene.toggleDisplacementMapping(bumpMaps);
+    scene.toggleParallaxMapping(displacement == QStringLiteral("parallax"));
+    scene.initialize(f);
+    try
+    {
+        scene.setCurrentProgram(parser.value(shaderOption).toUInt());
+    }
+    catch (const std::out_of_range &)
+    {
+        std::cerr << "headless_bench: invalid --shader " << qPrintable(parser.value(shaderOption)) << std::endl;
+        return 1;
+    }
+    scene.resize(width, height);
+    Profiler::markStartupComplete();
+
+    GLuint timeQuery = 0;
+    f->glGenQueries(1, &timeQuery);
+
+    std::vector<double> cpuMs, gpuMs, frameMs;
+    std::vector<double> drawCalls, triangles, objectsDrawn, objectsCulled, sphereTriangles;
+    cpuMs.reserve(frames);
+    gpuMs.reserve(frames);
+    frameMs.reserve(frames);
+
+    QualityGovernor qualityGovernor;
+    if (parser.isSet(qualityOption))
+    {
+        qualityGovernor.setEnabled(true);
+        qualityGovernor.setFrameBudgetMs(1000.0 / std::max(1, parser.value(qualityOption).toInt()));
+    }
+    std::vector<double> qualityLevels;
+
+    CameraPath recorded;
+    recorded.seed = scene.getSeed();
+    recorded.frames.reserve(frames);
+
+    HitchDetector hitchDetector;
+    hitchDetector.setThresholdFactor(std::max(1.0, parser.value(hitchOption).toDouble()));
+    hitchDetector.reset(); // uploads of scene.initialize() are not part of the first frame
+
+    QElapsedTimer timer, measuredTimer;
+    double cpuSecondsAtStart = 0.0;
+    for (int frame = 0; frame < warmupFrames + frames; ++frame)
+    {
+        const bool measured = frame >= warmupFrames;
+        if (frame == warmupFrames)
+        {
+            measuredTimer.start();
+            cpuSecondsAtStart = processCpuSeconds();
+            scene.getOverdrawMeter().resetStatistics();
+            scene.getLightClusters().resetStatistics();
+            hitchDetector.reset(); // the hitches of the warmup are not part of the report
+        }
+        const float t = measured ? static_cast<float>(frame - warmupFrames) / static_cast<float>(frames)
+                                 : static_cast<float>(frame) / static_cast<float>(std::max(1, warmupFrames));
+        CameraSample camera;
+        CameraPathFrame pathFrame;
+        if (replaying)
+        {
+            // the warmup renders the start of the recording, the measured frames all of it
+            pathFrame = replay.frames[measured ? frame - warmupFrames : frame % replay.frames.size()];
+            camera = {pathFrame.cameraPos, pathFrame.cameraDir};
+            scene.applyState(pathFrame);
+        }
+        else
+        {
+            camera = sampleCameraPath(path, t);
+        }
+
+        PROFILE_SCOPE("frame");
+        const uint64_t frameBegin = Profiler::now();
+        timer.start();
+        f->glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+        const Scene::FrameStats stats = scene.render(camera.pos, camera.dir);
+        f->glEndQuery(GL_TIME_ELAPSED);
+        const qint64 cpuNs = timer.nsecsElapsed();
+        if (qualityGovernor.update(cpuNs / 1e6, scene.getGpuTimer().getLastFrameMs()))
+            scene.setQualitySettings(qualityGovernor.getSettings());
+        // Finishing every frame keeps the frames independent of each other, so the percentiles
+        // describe single frames instead of the pipelining of the driver.
+        {
+            PROFILE_SCOPE("glFinish");
+            f->glFinish();
+        }
+        const qint64 frameNs = timer.nsecsElapsed();
+
+        if (!measured)
+            continue;
+        hitchDetector.frameFinished(frameBegin, Profiler::now());
+        GLuint64 gpuNs = 0;
+        f->glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &gpuNs);
+        cpuMs.push_back(cpuNs / 1e6);
+        gpuMs.push_back(gpuNs / 1e6);
+        frameMs.push_back(frameNs / 1e6);
+        drawCalls.push_back(stats.drawCalls);
+        triangles.push_back(stats.trianglesDrawn);
+        sphereTriangles.push_back(stats.bumpSphereTriangles);
+        objectsDrawn.push_back(stats.objectsDrawn);
+        objectsCulled.push_back(stats.objectsCulled);
+        qualityLevels.push_back(qualityGovernor.getLevel());
+        // the depth read back waits for the GPU, after the frame has been timed and only every 30th frame
+        if ((frame - warmupFrames) % 30 == 0)
+            scene.measureClusterLightsPerPixel();
+
+        if (parser.isSet(recordOption))
+        {
+            if (!replaying)
+            {
+                pathFrame.timeMs = static_cast<float>(measuredTimer.nsecsElapsed() / 1e6);
+                pathFrame.cameraPos = camera.pos;
+                pathFrame.cameraDir = camera.dir;
+                scene.storeState(pathFrame);
+            }
+            pathFrame.frameMs = static_cast<float>(frameMs.back());
+            pathFrame.cpuMs = static_cast<float>(cpuMs.back());
+            pathFrame.gpuMs = static_cast<float>(gpuMs.back());
+            pathFrame.triangles = stats.trianglesDrawn;
+            pathFrame.drawCalls = stats.drawCalls;
+            pathFrame.objectsCulled = stats.objectsCulled;
+            recorded.frames.push_back(pathFrame);
+        }
+    }
+
+    // CPU time of all threads of the process in percent of one core
+    const double cpuUtilization = 100.0 * (processCpuSeconds() - cpuSecondsAtStart) / (measuredTimer.nsecsElapsed() / 1e9);
+
+    QJsonObject report;
+    report["renderer"] = QString(reinterpret_cast<const char *>(f->glGetString(GL_RENDERER)));
+    report["glVersion"] = QString(reinterpret_cast<const char *>(f->glGetString(GL_VERSION)));
+    report["path"] = replaying ? parser.value(replayOption) : path;
+    report["seed"] = static_cast<qint64>(scene.getSeed());
+    report["frames"] = frames;
+    report["warmupFrames"] = warmupFrames;
+    QJsonArray resolution;
+    resolution.append(width);
+    resolution.append(height);
+    report["resolution"] = resolution;
+    report["gridSize"] = gridSize;
+    report["staticBatching"] = scene.isStaticBatchingEnabled();
+    report["vertexPulling"] = scene.isVertexPullingEnabled();
+    report["depthPrepass"] = depthPrepassReport(scene);
+    report["shader"] = parser.value(shaderOption).toInt();
+    report["deferred"] = scene.isDeferredShadingEnabled();
+    report["visibility"] = scene.isVisibilityBufferEnabled();
+    report["shading"] = shadingReport(scene);
+    report["pointLights"] = static_cast<qint64>(scene.getPointLightCount());
+    if (scene.isOverdrawMeasured())
+        report["overdraw"] = overdrawReport(scene.getOverdrawMeter());
+    if (scene.isClusteredLightingEnabled())
+        report["clusters"] = clusterReport(scene.getLightClusters());
+    report["cpuFrameMs"] = toJson(summarize(cpuMs));
+    report["gpuFrameMs"] = toJson(summarize(gpuMs));
+    report["frameMs"] = toJson(summarize(frameMs));
+    report["cpuUtilizationPercent"] = cpuUtilization;
+    report["drawCalls"] = countSummary(drawCalls);
+    report["triangles"] = countSummary(triangles);
+    QJsonObject culling;
+    culling["objects"] = static_cast<int>(scene.getObjectCount());
+    culling["drawn"] = countSummary(objectsDrawn);
+    culling["culled"] = countSummary(objectsCulled);
+    report["culling"] = culling;
+    // vertex cost of the bump sphere in triangles, its fragment cost in the GPU time of its pass and, with
+    // --overdraw, the fragments per pixel of "bump sphere"
+    QJsonObject bumpSphere;
+    bumpSphere["displacement"] = displacement;
+    bumpSphere["triangles"] = countSummary(sphereTriangles);
+    bumpSphere["gpuMs"] = scene.getGpuTimer().getPassTime(scene.getShadedPassName(Scene::ShadedPass::BumpSphere)).averageMs;
+    report["bumpSphere"] = bumpSphere;
+    // rolling averages over the last frames, see GpuTimer
+    QJsonObject gpuPasses;
+    for (const auto &pass : scene.getGpuTimer().getPassTimes())
+        gpuPasses[QString(pass.name)] = pass.averageMs;
+    report["gpuPassMs"] = gpuPasses;
+    report["hitches"] = hitchDetector.report();
+    QJsonObject quality;
+    quality["enabled"] = qualityGovernor.isEnabled();
+    quality["budgetMs"] = qualityGovernor.getFrameBudgetMs();
+    quality["level"] = countSummary(qualityLevels);
+    quality["finalLevel"] = qualityGovernor.getLevel();
+    quality["finalRenderScale"] = qualityGovernor.getSettings().renderScale;
+    report["quality"] = quality;
+
+    if (parser.isSet(recordOption) && !recorded.save(parser.value(recordOption)))
+        std::cerr << "headless_bench: could not write " << qPrintable(parser.value(recordOption)) << std::endl;
+    if (parser.isSet(traceOption) && !Profiler::writeChromeTrace(parser.value(traceOption).toStdString()))
+        std::cerr << "headless_bench: could not write " << qPrintable(parser.value(traceOption)) << std::endl;
+
+    f->glDeleteQueries(1, &timeQuery);
+    scene.cleanup();
+    target.destroy(f);
+    context.doneCurrent();
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOption))
+    {
+        QFile outputFile(parser.value(outputOption));
+        if (!outputFile.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate))
+        {
+            std::cerr << "headless_bench: could not open " << qPrintable(parser.value(outputOption)) << std::endl;
+            return 1;
+        }
+        outputFile.write(json);
+    }
+    else
+    {
+        std::cout << json.constData() << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Detects frames that take much longer than the median frame and  //
+//          records what happened during them                                //
+// ========================================================================= //
+
+#include <algorithm>
+
+#include <QJsonArray>
+
+#include "hitchdetector.h"
+#include "profiler.h"
+
+std::atomic<unsigned int> HitchDetector::uploads{0};
+std::atomic<size_t> HitchDetector::uploadBytes{0};
+std::atomic<unsigned int> HitchDetector::shaderCompiles{0};
+
+void HitchDetector::countUpload(size_t bytes)
+{
+    uploads.fetch_add(1, std::memory_order_relaxed);
+    uploadBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void HitchDetector::countShaderCompile()
+{
+    shaderCompiles.fetch_add(1, std::memory_order_relaxed);
+}
+
+double HitchDetector::median() const
+{
+    std::array<double, historySize> sorted = history;
+    auto middle = sorted.begin() + historyCount / 2;
+    std::nth_element(sorted.begin(), middle, sorted.begin() + historyCount);
+    return *middle;
+}
+
+bool HitchDetector::frameFinished(uint64_t begin, uint64_t end)
+{
+    const double ms = (end - begin) / 1e6;
+    frameCount++;
+
+    Hitch hitch;
+    hitch.frame = frameCount;
+    hitch.ms = ms;
+    hitch.uploads = uploads.exchange(0, std::memory_order_relaxed);
+    hitch.uploadBytes = uploadBytes.exchange(0, std::memory_order_relaxed);
+    hitch.shaderCompiles = shaderCompiles.exchange(0, std::memory_order_relaxed);
+
+    const size_t bucket = std::upper_bound(bucketLimits.begin(), bucketLimits.end(), ms) - bucketLimits.begin();
+    histogram[bucket]++;
+
+    bool isHitch = false;
+    if (historyCount >= minimumHistory)
+    {
+        hitch.medianMs = median();
+        isHitch = ms > thresholdFactor * hitch.medianMs;
+    }
+    // hitches stay in the history, otherwise a permanent slowdown would be reported forever
+    history[nextHistory] = ms;
+    nextHistory = (nextHistory + 1) % historySize;
+    historyCount = std::min(historyCount + 1, historySize);
+
+    if (isHitch)
+    {
+        hitchCount++;
+        addHitch(std::move(hitch), begin, end);
+    }
+    return isHitch;
+}
+
+void HitchDetector::addHitch(Hitch &&hitch, uint64_t begin, uint64_t end)
+{
+    if (worstFrames.size() == worstFramesKept && worstFrames.back().ms >= hitch.ms)
+        return;
+
+    // the zones are only collected for frames that make it into the list, the ring buffer copy is not cheap
+    if (Profiler::isEnabled())
+    {
+        std::vector<Profiler::Zone> zones = Profiler::zonesOfCurrentThread(begin, end);
+        std::sort(zones.begin(), zones.end(), [](const Profiler::Zone &a, const Profiler::Zone &b) {
+            return a.end - a.begin > b.end - b.begin;
+        });
+        for (size_t i = 0; i < zones.size() && i < zonesPerHitch; ++i)
+        {
+            // clip zones that started before the frame
+            const uint64_t zoneBegin = std::max(zones[i].begin, begin);
+            const uint64_t zoneEnd = std::min(zones[i].end, end);
+            hitch.zones.push_back({zones[i].name, (zoneEnd - zoneBegin) / 1e6});
+        }
+    }
+
+    auto position = std::upper_bound(worstFrames.begin(), worstFrames.end(), hitch.ms,
+                                     [](double ms, const Hitch &other) { return ms > other.ms; });
+    worstFrames.insert(position, std::move(hitch));
+    if (worstFrames.size() > worstFramesKept)
+        worstFrames.pop_back();
+}
+
+QJsonObject HitchDetector::report() const
+{
+    QJsonObject result;
+    result["frames"] = static_cast<double>(frameCount);
+    result["hitches"] = static_cast<double>(hitchCount);
+    result["thresholdFactor"] = thresholdFactor;
+    if (historyCount > 0)
+        result["medianMs"] = median();
+
+    QJsonArray buckets;
+    for (size_t i = 0; i < histogram.size(); ++i)
+    {
+        QJsonObject bucket;
+        bucket["fromMs"] = i == 0 ? 0.0 : bucketLimits[i - 1];
+        if (i < bucketLimits.size())
+            bucket["toMs"] = bucketLimits[i];
+        bucket["frames"] = static_cast<double>(histogram[i]);
+        buckets.append(bucket);
+    }
+    result["histogram"] = buckets;
+
+    QJsonArray worst;
+    for (const Hitch &hitch : worstFrames)
+    {
+        QJsonObject frame;
+        frame["frame"] = static_cast<double>(hitch.frame);
+        frame["ms"] = hitch.ms;
+        frame["medianMs"] = hitch.medianMs;
+        frame["uploads"] = static_cast<int>(hitch.uploads);
+        frame["uploadBytes"] = static_cast<double>(hitch.uploadBytes);
+        frame["shaderCompiles"] = static_cast<int>(hitch.shaderCompiles);
+        QJsonArray zones;
+        for (const Cause &cause : hitch.zones)
+        {
+            QJsonObject zone;
+            zone["name"] = QString(cause.zone);
+            zone["ms"] = cause.ms;
+            zones.append(zone);
+        }
+        frame["zones"] = zones;
+        worst.append(frame);
+    }
+    result["worstFrames"] = worst;
+    return result;
+}
+
+void HitchDetector::reset()
+{
+    histogram.fill(0);
+    historyCount = 0;
+    nextHistory = 0;
+    frameCount = 0;
+    hitchCount = 0;
+    worstFrames.clear();
+    uploads = 0;
+    uploadBytes = 0;
+    shaderCompiles = 0;
+}
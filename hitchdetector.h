@@ -0,0 +1,91 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Detects frames that take much longer than the median frame and  //
+//          records what happened during them                                //
+// ========================================================================= //
+
+#ifndef HITCHDETECTOR_H
+#define HITCHDETECTOR_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <QJsonObject>
+
+/*
+ * A frame is a hitch if it takes longer than thresholdFactor times the median of the last historySize
+ * frames. For a hitch the detector keeps the GL uploads and shader compilations counted during the frame
+ * and the longest profiler zones of the calling thread (only if the profiler is recording).
+ * All frames also go into a frame time histogram.
+ */
+class HitchDetector
+{
+public:
+    static constexpr int historySize = 240;
+    static constexpr int minimumHistory = 30; // no detection before the median is meaningful
+    static constexpr int worstFramesKept = 10;
+    static constexpr int zonesPerHitch = 8;
+
+    struct Cause {
+        const char* zone;
+        double ms;
+    };
+
+    struct Hitch {
+        uint64_t frame = 0;
+        double ms = 0.0;
+        double medianMs = 0.0;
+        unsigned int uploads = 0;
+        size_t uploadBytes = 0;
+        unsigned int shaderCompiles = 0;
+        std::vector<Cause> zones; // longest first
+    };
+
+    // Called by the resource code on the render thread, counted for the current frame.
+    static void countUpload(size_t bytes);
+    static void countShaderCompile();
+
+    void setThresholdFactor(double factor) { thresholdFactor = factor; }
+    double getThresholdFactor() const { return thresholdFactor; }
+
+    // Ends the current frame and starts the next one. begin and end are Profiler::now() timestamps.
+    // Returns true if the finished frame was a hitch.
+    bool frameFinished(uint64_t begin, uint64_t end);
+
+    uint64_t getFrameCount() const { return frameCount; }
+    uint64_t getHitchCount() const { return hitchCount; }
+    const std::vector<Hitch>& getWorstFrames() const { return worstFrames; }
+
+    // histogram, worst frames and their causes
+    QJsonObject report() const;
+    void reset();
+
+private:
+    static std::atomic<unsigned int> uploads;
+    static std::atomic<size_t> uploadBytes;
+    static std::atomic<unsigned int> shaderCompiles;
+
+    // upper bounds of the histogram buckets in ms, the last bucket is open
+    static constexpr std::array<double, 10> bucketLimits = {{4.0, 8.0, 12.0, 16.7, 20.0, 25.0, 33.3, 50.0, 66.7, 100.0}};
+    std::array<uint64_t, bucketLimits.size() + 1> histogram{};
+
+    double thresholdFactor = 2.0;
+    std::array<double, historySize> history{};
+    int historyCount = 0;
+    int nextHistory = 0;
+    uint64_t frameCount = 0;
+    uint64_t hitchCount = 0;
+    std::vector<Hitch> worstFrames; // sorted, slowest first
+
+    double median() const;
+    void addHitch(Hitch&& hitch, uint64_t begin, uint64_t end);
+};
+
+#endif // HITCHDETECTOR_H
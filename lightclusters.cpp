@@ -0,0 +1,297 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Point lights binned into a grid of view frustum clusters for     //
+//          the forward shaders                                              //
+// ========================================================================= //
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "lightclusters.h"
+#include "meshkernels.h"
+#include "pointlights.h"
+#include "profiler.h"
+
+LightClusters::~LightClusters()
+{
+    release();
+}
+
+bool LightClusters::bin(GLFunctions *f, const std::vector<float> &lights, const QMatrix4x4 &projection, int width, int height)
+{
+    PROFILE_FUNCTION();
+    const uint64_t begin = Profiler::now();
+    this->f = f;
+    this->width = width;
+    this->height = height;
+
+    const size_t count = lights.size() / PointLights::floatsPerLight;
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    radius.resize(count);
+    float farthest = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float *light = lights.data() + i * PointLights::floatsPerLight;
+        x[i] = light[0];
+        y[i] = light[1];
+        z[i] = light[2];
+        radius[i] = light[3];
+        farthest = std::max(farthest, radius[i] - z[i]);
+    }
+
+    // depth = -z in camera coordinates. The slices end where the farthest light does, not at the far
+    // plane, so none of them is wasted on the empty distance.
+    const float *p = projection.constData();
+    depthA = p[10];
+    depthB = p[14];
+    nearDepth = depthB / (depthA - 1.0f);
+    const float farDepth = std::max(std::min(farthest, depthB / (depthA + 1.0f)), 2.0f * nearDepth);
+    sliceScale = static_cast<float>(slices) / std::log(farDepth / nearDepth);
+
+    // x / depth and y / depth of the tile borders, from left to right and from bottom to top
+    float slopesX[tilesX + 1], slopesY[tilesY + 1];
+    for (int i = 0; i <= tilesX; ++i)
+        slopesX[i] = (2.0f * i / tilesX - 1.0f + p[8]) / p[0];
+    for (int i = 0; i <= tilesY; ++i)
+        slopesY[i] = (2.0f * i / tilesY - 1.0f + p[9]) / p[5];
+
+    ranges.resize(2 * clusterCount);
+    parallelFor(slices, 1, [&](size_t first, size_t last) {
+        for (size_t slice = first; slice < last; ++slice)
+        {
+            const float depth0 = nearDepth * std::exp(slice / sliceScale);
+            const float depth1 = nearDepth * std::exp((slice + 1) / sliceScale);
+            binSlice(static_cast<int>(slice), slopesX, slopesY, depth0, depth1);
+        }
+    });
+
+    // the slices only know the offsets within their own list
+    indices.clear();
+    unsigned int occupied = 0, total = 0;
+    latest.max = 0;
+    for (int slice = 0; slice < slices; ++slice)
+    {
+        const uint32_t base = static_cast<uint32_t>(indices.size());
+        for (int cluster = slice * tilesX * tilesY; cluster < (slice + 1) * tilesX * tilesY; ++cluster)
+        {
+            ranges[2 * cluster] += base;
+            const uint32_t lightCount = ranges[2 * cluster + 1];
+            occupied += lightCount > 0 ? 1 : 0;
+            total += lightCount;
+            latest.max = std::max(latest.max, lightCount);
+        }
+        indices.insert(indices.end(), sliceLists[slice].indices.begin(), sliceLists[slice].indices.end());
+    }
+    // never empty, the buffer needs a store
+    indices.push_back(0);
+
+    latest.binningMs = (Profiler::now() - begin) / 1e6;
+    latest.lightsPerCluster = occupied > 0 ? static_cast<double>(total) / occupied : 0.0;
+    latest.occupancy = static_cast<double>(occupied) / clusterCount;
+    sums.binningMs += latest.binningMs;
+    sums.lightsPerCluster += latest.lightsPerCluster;
+    sums.occupancy += latest.occupancy;
+    sums.max = std::max(sums.max, latest.max);
+    ++binnedFrames;
+
+    if (maxTexels == 0)
+        f->glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if (indices.size() > static_cast<size_t>(maxTexels))
+        return false;
+    upload();
+    return true;
+}
+
+void LightClusters::binSlice(int slice, const float *slopesX, const float *slopesY, float depth0, float depth1)
+{
+    const MeshKernels &kernels = meshKernels();
+    Slice &lists = sliceLists[slice];
+    lists.indices.clear();
+
+    // the lights between the two depths, unbounded in x and y
+    const size_t count = x.size();
+    const float slabMin[3] = {-FLT_MAX, -FLT_MAX, -depth1};
+    const float slabMax[3] = {FLT_MAX, FLT_MAX, -depth0};
+    lists.candidates.resize(count);
+    const size_t candidateCount = kernels.spheresTouchingBox(x.data(), y.data(), z.data(), radius.data(), count,
+                                                             slabMin, slabMax, lists.candidates.data());
+    lists.x.resize(candidateCount);
+    lists.y.resize(candidateCount);
+    lists.z.resize(candidateCount);
+    lists.radius.resize(candidateCount);
+    for (size_t i = 0; i < candidateCount; ++i)
+    {
+        const uint32_t light = lists.candidates[i];
+        lists.x[i] = x[light];
+        lists.y[i] = y[light];
+        lists.z[i] = z[light];
+        lists.radius[i] = radius[light];
+    }
+    lists.hits.resize(candidateCount);
+
+    // bounding box of the part of the tile between the depths
+    for (int tileY = 0; tileY < tilesY; ++tileY)
+    {
+        for (int tileX = 0; tileX < tilesX; ++tileX)
+        {
+            const float boxMin[3] = {std::min(slopesX[tileX] * depth0, slopesX[tileX] * depth1),
+                                     std::min(slopesY[tileY] * depth0, slopesY[tileY] * depth1), -depth1};
+            const float boxMax[3] = {std::max(slopesX[tileX + 1] * depth0, slopesX[tileX + 1] * depth1),
+                                     std::max(slopesY[tileY + 1] * depth0, slopesY[tileY + 1] * depth1), -depth0};
+            const size_t hitCount = kernels.spheresTouchingBox(lists.x.data(), lists.y.data(), lists.z.data(), lists.radius.data(),
+                                                               candidateCount, boxMin, boxMax, lists.hits.data());
+            const int cluster = (slice * tilesY + tileY) * tilesX + tileX;
+            ranges[2 * cluster] = static_cast<uint32_t>(lists.indices.size());
+            ranges[2 * cluster + 1] = static_cast<uint32_t>(hitCount);
+            for (size_t i = 0; i < hitCount; ++i)
+                lists.indices.push_back(lists.candidates[lists.hits[i]]);
+        }
+    }
+}
+
+void LightClusters::upload()
+{
+    PROFILE_FUNCTION();
+    if (rangesBuffer == 0)
+    {
+        // the buffer textures keep referring to the buffers when their stores are replaced
+        f->glGenBuffers(1, &rangesBuffer);
+        f->glGenBuffers(1, &indicesBuffer);
+        f->glGenTextures(1, &rangesTexture);
+        f->glGenTextures(1, &indicesTexture);
+        f->glBindBuffer(GL_TEXTURE_BUFFER, rangesBuffer);
+        f->glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(ranges.size() * sizeof(uint32_t)), nullptr, GL_STREAM_DRAW);
+        f->glBindBuffer(GL_TEXTURE_BUFFER, indicesBuffer);
+        f->glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(uint32_t)), nullptr, GL_STREAM_DRAW);
+        f->glActiveTexture(GL_TEXTURE0 + rangesUnit);
+        f->glBindTexture(GL_TEXTURE_BUFFER, rangesTexture);
+        f->glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, rangesBuffer);
+        f->glActiveTexture(GL_TEXTURE0 + indicesUnit);
+        f->glBindTexture(GL_TEXTURE_BUFFER, indicesTexture);
+        f->glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indicesBuffer);
+        f->glActiveTexture(GL_TEXTURE0);
+    }
+    // new buffer stores every frame, like PointLights::upload()
+    f->glBindBuffer(GL_TEXTURE_BUFFER, rangesBuffer);
+    f->glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(ranges.size() * sizeof(uint32_t)), ranges.data(), GL_STREAM_DRAW);
+    f->glBindBuffer(GL_TEXTURE_BUFFER, indicesBuffer);
+    f->glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(uint32_t)), indices.data(), GL_STREAM_DRAW);
+    f->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::bindTextures() const
+{
+    if (!f)
+        return;
+    f->glActiveTexture(GL_TEXTURE0 + rangesUnit);
+    f->glBindTexture(GL_TEXTURE_BUFFER, rangesTexture);
+    f->glActiveTexture(GL_TEXTURE0 + indicesUnit);
+    f->glBindTexture(GL_TEXTURE_BUFFER, indicesTexture);
+    f->glActiveTexture(GL_TEXTURE0);
+}
+
+LightClusters::Uniforms LightClusters::uniformLocations(GLFunctions* f, GLuint program)
+{
+    Uniforms uniforms;
+    uniforms.tileSize = f->glGetUniformLocation(program, "clusterTileSize");
+    uniforms.depth = f->glGetUniformLocation(program, "clusterDepth");
+    uniforms.count = f->glGetUniformLocation(program, "clusterCount");
+    return uniforms;
+}
+
+void LightClusters::setUniforms(const Uniforms& uniforms) const
+{
+    if (!f)
+        return;
+    f->glUniform2f(uniforms.tileSize, static_cast<float>(width) / tilesX, static_cast<float>(height) / tilesY);
+    f->glUniform2f(uniforms.depth, nearDepth, sliceScale);
+    f->glUniform3i(uniforms.count, tilesX, tilesY, slices);
+}
+
+void LightClusters::measureLightsPerPixel()
+{
+    PROFILE_FUNCTION();
+    if (!f || width <= 0 || height <= 0)
+        return;
+    depthPixels.resize(static_cast<size_t>(width) * static_cast<size_t>(height));
+    f->glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, depthPixels.data());
+
+    // the same cluster lookup as in lambert.frag, at the pixel centers
+    const float tileWidth = static_cast<float>(width) / tilesX, tileHeight = static_cast<float>(height) / tilesY;
+    uint64_t lights = 0, covered = 0;
+    for (int row = 0; row < height; ++row)
+    {
+        const int tileY = std::min(static_cast<int>((row + 0.5f) / tileHeight), tilesY - 1);
+        for (int column = 0; column < width; ++column)
+        {
+            const float windowDepth = depthPixels[static_cast<size_t>(row) * width + column];
+            if (windowDepth >= 1.0f)
+                continue;
+            ++covered;
+            const float depth = depthB / (2.0f * windowDepth - 1.0f + depthA);
+            const int slice = std::max(static_cast<int>(std::log(depth / nearDepth) * sliceScale), 0);
+            if (slice >= slices)
+                continue;
+            const int tileX = std::min(static_cast<int>((column + 0.5f) / tileWidth), tilesX - 1);
+            lights += ranges[2 * ((slice * tilesY + tileY) * tilesX + tileX) + 1];
+        }
+    }
+    lightsPerPixelSum += covered > 0 ? static_cast<double>(lights) / covered : 0.0;
+    coverageSum += static_cast<double>(covered) / depthPixels.size();
+    ++pixelMeasurements;
+}
+
+void LightClusters::release()
+{
+    if (f)
+    {
+        for (GLuint *buffer : {&rangesBuffer, &indicesBuffer})
+        {
+            if (*buffer != 0)
+                f->glDeleteBuffers(1, buffer);
+        }
+        for (GLuint *texture : {&rangesTexture, &indicesTexture})
+        {
+            if (*texture != 0)
+                f->glDeleteTextures(1, texture);
+        }
+    }
+    rangesBuffer = rangesTexture = indicesBuffer = indicesTexture = 0;
+    maxTexels = 0;
+    f = nullptr;
+}
+
+LightClusters::Stats LightClusters::getMean() const
+{
+    Stats mean;
+    if (binnedFrames == 0)
+        return mean;
+    mean.binningMs = sums.binningMs / binnedFrames;
+    mean.lightsPerCluster = sums.lightsPerCluster / binnedFrames;
+    mean.occupancy = sums.occupancy / binnedFrames;
+    mean.max = sums.max;
+    return mean;
+}
+
+void LightClusters::resetStatistics()
+{
+    sums = Stats();
+    binnedFrames = 0;
+    lightsPerPixelSum = coverageSum = 0.0;
+    pixelMeasurements = 0;
+}
+
+QString LightClusters::summary() const
+{
+    if (binnedFrames == 0)
+        return QString();
+    return QStringLiteral("Cluster %1 ms, %2 lights (max %3)").arg(latest.binningMs, 0, 'f', 2)
+        .arg(latest.lightsPerCluster, 0, 'f', 2).arg(latest.max);
+}
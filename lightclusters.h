@@ -0,0 +1,128 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Point lights binned into a grid of view frustum clusters for     //
+//          the forward shaders                                              //
+// ========================================================================= //
+
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QString>
+
+#include "glfunctions.h"
+
+/*
+ * Splits the view frustum into tilesX x tilesY screen tiles and slices depth slices, whose depth grows
+ * exponentially from the near plane to the farthest point any light reaches, and lists for every cluster
+ * the point lights whose sphere touches its bounding box. The forward shaders (lambert.frag, bump.frag)
+ * look up the cluster of a fragment from gl_FragCoord and its depth and only evaluate the lights listed
+ * there, instead of all of them.
+ *
+ * bin() runs on the CPU every frame, after PointLights::upload(): for each slice on its own thread, the
+ * lights are first tested against the whole slice and then the remaining ones against each of its tiles,
+ * both with MeshKernels::spheresTouchingBox. The result is streamed into two buffer textures:
+ *   - ranges on rangesUnit, GL_RG32UI: offset into the index list and number of lights, per cluster
+ *   - light indices on indicesUnit, GL_R32UI: the lights of all clusters, in cluster order
+ * The index of the cluster of tile (x, y) in slice z is (z * tilesY + y) * tilesX + x.
+ */
+class LightClusters
+{
+public:
+    static constexpr int tilesX = 16, tilesY = 9, slices = 24;
+    static constexpr int clusterCount = tilesX * tilesY * slices;
+    // texture units of the buffer textures, above the one of PointLights
+    static constexpr GLuint rangesUnit = 8, indicesUnit = 9;
+
+    // locations of the cluster uniforms in a program, -1 if it has none
+    struct Uniforms {
+        GLint tileSize = -1, depth = -1, count = -1;
+    };
+
+    struct Stats {
+        double binningMs = 0.0;        // time of bin() without the upload
+        double lightsPerCluster = 0.0; // lights per cluster that has any
+        double occupancy = 0.0;        // part of the clusters with lights
+        unsigned int max = 0;          // lights of the fullest cluster
+    };
+
+    LightClusters() = default;
+    ~LightClusters();
+    LightClusters(const LightClusters& other) = delete;
+    LightClusters& operator= (const LightClusters& other) = delete;
+
+    // Bins the lights of PointLights::getUploadedData() for the perspective projection and a render target
+    // of width x height pixels and uploads the lists. False if they do not fit into a buffer texture, the
+    // shaders have to loop over all lights then. The first call needs a current OpenGL context, later
+    // ones the same context.
+    bool bin(GLFunctions* f, const std::vector<float>& lights, const QMatrix4x4& projection, int width, int height);
+    // binds the buffer textures to their units
+    void bindTextures() const;
+    // looks up the cluster uniforms of program, once per linked program; works before the first bin()
+    static Uniforms uniformLocations(GLFunctions* f, GLuint program);
+    // sets the cluster uniforms of the shaders on the current program, whose locations are uniforms
+    void setUniforms(const Uniforms& uniforms) const;
+    // Reads back the depth buffer of the current read framebuffer, which must be the one of the last bin(),
+    // and averages the lights of the clusters of its pixels that are not at the far plane: the lights each
+    // shaded fragment loops over, if every pixel is shaded once. Waits for the GPU, so keep it out of timings.
+    void measureLightsPerPixel();
+    // deletes the GPU objects
+    void release();
+
+    const Stats& getLatest() const { return latest; }
+    // Averages over all frames binned since resetStatistics(); max is the largest of them.
+    Stats getMean() const;
+    uint64_t getBinnedFrames() const { return binnedFrames; }
+    // averages of measureLightsPerPixel() since resetStatistics()
+    double getLightsPerPixel() const { return pixelMeasurements > 0 ? lightsPerPixelSum / pixelMeasurements : 0.0; }
+    double getPixelCoverage() const { return pixelMeasurements > 0 ? coverageSum / pixelMeasurements : 0.0; }
+    uint64_t getPixelMeasurements() const { return pixelMeasurements; }
+    void resetStatistics();
+    // short text for the status bar, e.g. "Cluster 0.41 ms, 3.20 lights (max 17)"
+    QString summary() const;
+
+private:
+    // lights of one slice, filled by the thread of the slice
+    struct Slice {
+        std::vector<float> x, y, z, radius;    // lights touching the slice
+        std::vector<uint32_t> candidates;      // their indices
+        std::vector<uint32_t> hits;            // per tile, indices into candidates
+        std::vector<uint32_t> indices;         // light indices of all tiles of the slice
+    };
+
+    std::vector<float> x, y, z, radius; // the lights in structure of arrays layout
+    std::array<Slice, slices> sliceLists;
+    std::vector<uint32_t> ranges;       // 2 per cluster
+    std::vector<uint32_t> indices;
+
+    // cluster geometry of the last bin()
+    float nearDepth = 1.0f, sliceScale = 0.0f; // slice = log(depth / nearDepth) * sliceScale
+    float depthA = 0.0f, depthB = 0.0f;        // view depth = depthB / (ndc depth + depthA)
+    int width = 0, height = 0;
+
+    Stats latest;
+    Stats sums; // max holds the largest instead of the sum
+    uint64_t binnedFrames = 0;
+    double lightsPerPixelSum = 0.0, coverageSum = 0.0;
+    uint64_t pixelMeasurements = 0;
+    std::vector<float> depthPixels;
+
+    GLFunctions* f = nullptr;
+    GLuint rangesBuffer = 0, rangesTexture = 0;
+    GLuint indicesBuffer = 0, indicesTexture = 0;
+    GLint maxTexels = 0;
+
+    void binSlice(int slice, const float* slopesX, const float* slopesY, float depth0, float depth1);
+    void upload();
+};
+
+#endif // LIGHTCLUSTERS_H
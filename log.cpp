@@ -0,0 +1,353 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Asynchronous logging with levels, categories and rate limiting   //
+// ========================================================================= //
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "log.h"
+#include "profiler.h"
+
+namespace {
+
+// Start of every record in a ring buffer. The LogArgs follow, then the bytes of the string arguments.
+struct RecordHeader {
+    uint32_t size;  // of the whole record including padding to 8 bytes
+    uint8_t skip;   // padding at the end of the ring, no message
+    uint8_t level, category, argCount;
+    uint32_t suppressed;
+    uint32_t reserved;
+    const char* format;
+    uint64_t timestamp;
+};
+
+// Single producer, single consumer byte ring. Only the owning thread writes, and only the thread holding
+// drainMutex reads. A record never wraps around the end, the rest of the ring is skipped instead.
+struct ThreadRing {
+    static constexpr uint64_t capacity = 1 << 18;
+    static constexpr uint64_t mask = capacity - 1;
+    static constexpr uint64_t maxRecordSize = capacity / 8;
+
+    std::unique_ptr<unsigned char[]> data{new unsigned char[capacity]};
+    std::atomic<uint64_t> head{0}; // bytes written
+    std::atomic<uint64_t> tail{0}; // bytes consumed
+    std::atomic<uint64_t> dropped{0};
+    unsigned int threadId = 0;
+
+    // returns the space for a record of size bytes, or nullptr if the ring is full
+    unsigned char* reserve(uint64_t size, uint64_t& newHead)
+    {
+        uint64_t position = head.load(std::memory_order_relaxed);
+        const uint64_t available = capacity - (position - tail.load(std::memory_order_acquire));
+        const uint64_t contiguous = capacity - (position & mask);
+        const uint64_t needed = contiguous < size ? contiguous + size : size;
+        if (needed > available)
+            return nullptr;
+        if (contiguous < size)
+        {
+            RecordHeader padding{};
+            padding.size = static_cast<uint32_t>(contiguous);
+            padding.skip = 1;
+            std::memcpy(&data[position & mask], &padding, std::min<uint64_t>(contiguous, sizeof(padding)));
+            position += contiguous;
+        }
+        newHead = position + size;
+        return &data[position & mask];
+    }
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadRing>> registry; // rings live until program end, threads may exit earlier
+thread_local ThreadRing* currentRing = nullptr;
+
+std::mutex drainMutex;
+std::string formatted; // reused by drain(), guarded by drainMutex
+
+void appendMessage(std::string& out, const char* format, const LogArg* args, size_t argCount, const char* strings)
+{
+    char number[64];
+    size_t nextArg = 0;
+    for (const char* c = format; *c; ++c)
+    {
+        if (c[0] != '{' || c[1] != '}' || nextArg >= argCount)
+        {
+            out.push_back(*c);
+            continue;
+        }
+        ++c;
+        const LogArg& arg = args[nextArg++];
+        switch (arg.type)
+        {
+        case LogArg::Type::Int:
+            std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(arg.i));
+            out += number;
+            break;
+        case LogArg::Type::UInt:
+            std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(arg.u));
+            out += number;
+            break;
+        case LogArg::Type::Double:
+            std::snprintf(number, sizeof(number), "%g", arg.d);
+            out += number;
+            break;
+        case LogArg::Type::Bool:
+            out += arg.u ? "true" : "false";
+            break;
+        case LogArg::Type::Pointer:
+            std::snprintf(number, sizeof(number), "%p", arg.p);
+            out += number;
+            break;
+        case LogArg::Type::String:
+            out.append(strings, arg.length);
+            strings += arg.length;
+            break;
+        }
+    }
+}
+
+// formats and prints all messages of all rings
+void drain()
+{
+    std::lock_guard<std::mutex> drainLock(drainMutex);
+    std::vector<ThreadRing*> rings;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& ring : registry)
+            rings.push_back(ring.get());
+    }
+    formatted.clear();
+    char prefix[96];
+    for (ThreadRing* ring : rings)
+    {
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        while (tail < head)
+        {
+            const unsigned char* record = &ring->data[tail & ThreadRing::mask];
+            RecordHeader header;
+            std::memcpy(&header, record, sizeof(header.size) + sizeof(header.skip));
+            if (!header.skip)
+            {
+                std::memcpy(&header, record, sizeof(header));
+                const auto level = static_cast<LogLevel>(header.level);
+                std::snprintf(prefix, sizeof(prefix), "[%10.3f] %-7s %-7s (%u) ", header.timestamp / 1e9,
+                              Log::levelName(level), Log::categoryName(static_cast<LogCategory>(header.category)), ring->threadId);
+                formatted += prefix;
+                const auto* args = reinterpret_cast<const LogArg*>(record + sizeof(RecordHeader));
+                appendMessage(formatted, header.format, args, header.argCount,
+                              reinterpret_cast<const char*>(args + header.argCount));
+                if (header.suppressed > 0)
+                    formatted += " (" + std::to_string(header.suppressed) + " similar messages suppressed)";
+                formatted.push_back('\n');
+            }
+            tail += header.size;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+        const uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+            formatted += "log: " + std::to_string(dropped) + " messages of thread " + std::to_string(ring->threadId) + " dropped, ring buffer full\n";
+    }
+    if (!formatted.empty())
+    {
+        std::fwrite(formatted.data(), 1, formatted.size(), stderr);
+        std::fflush(stderr);
+    }
+}
+
+// Prints the messages every few milliseconds, or immediately after an error
+class Writer {
+public:
+    void start()
+    {
+        std::call_once(started, [this] { thread = std::thread([this] { run(); }); });
+    }
+    void wake() { condition.notify_one(); }
+
+    ~Writer()
+    {
+        if (thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            condition.notify_one();
+            thread.join();
+        }
+        drain();
+    }
+
+private:
+    std::once_flag started;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stop = false;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stop)
+        {
+            condition.wait_for(lock, std::chrono::milliseconds(10));
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    }
+};
+
+// declared after the registry, so it is destroyed (and prints the last messages) before the rings
+Writer writer;
+
+ThreadRing& threadRing()
+{
+    if (!currentRing)
+    {
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            registry.emplace_back(new ThreadRing);
+            currentRing = registry.back().get();
+            currentRing->threadId = static_cast<unsigned int>(registry.size());
+        }
+        writer.start();
+    }
+    return *currentRing;
+}
+
+uint8_t levelFromEnvironment()
+{
+    const char* value = std::getenv("GDV_LOG");
+    if (!value)
+        return static_cast<uint8_t>(LogLevel::Info);
+    for (uint8_t level = 0; level <= static_cast<uint8_t>(LogLevel::Error); ++level)
+    {
+        if (std::strcmp(value, Log::levelName(static_cast<LogLevel>(level))) == 0)
+            return level;
+    }
+    return static_cast<uint8_t>(LogLevel::Info);
+}
+
+} // namespace
+
+static_assert(static_cast<size_t>(LogCategory::Count) == 5, "initialize the level of every category");
+std::atomic<uint8_t> Log::levels[static_cast<size_t>(LogCategory::Count)] = {
+    levelFromEnvironment(), levelFromEnvironment(), levelFromEnvironment(), levelFromEnvironment(), levelFromEnvironment()};
+
+void Log::setLevel(LogLevel level)
+{
+    for (auto& categoryLevel : levels)
+        categoryLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+void Log::commit(LogLevel level, LogCategory category, uint32_t suppressed, const char* format, const LogArg* args, size_t argCount)
+{
+    const uint64_t timestamp = Profiler::now();
+    ThreadRing& ring = threadRing();
+
+    // long strings are cut, so every record fits into the ring
+    LogArg stored[16];
+    argCount = std::min<size_t>(argCount, 16);
+    uint64_t size = sizeof(RecordHeader) + sizeof(LogArg) * argCount;
+    for (size_t i = 0; i < argCount; ++i)
+    {
+        stored[i] = args[i];
+        if (stored[i].type == LogArg::Type::String)
+        {
+            stored[i].length = static_cast<uint32_t>(std::min<uint64_t>(stored[i].length, ThreadRing::maxRecordSize - size));
+            size += stored[i].length;
+        }
+    }
+    size = (size + 7) & ~uint64_t(7);
+
+    uint64_t newHead = 0;
+    unsigned char* record = ring.reserve(size, newHead);
+    if (!record)
+    {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    RecordHeader header{};
+    header.size = static_cast<uint32_t>(size);
+    header.level = static_cast<uint8_t>(level);
+    header.category = static_cast<uint8_t>(category);
+    header.argCount = static_cast<uint8_t>(argCount);
+    header.suppressed = suppressed;
+    header.format = format;
+    header.timestamp = timestamp;
+    std::memcpy(record, &header, sizeof(header));
+    std::memcpy(record + sizeof(header), stored, sizeof(LogArg) * argCount);
+    unsigned char* strings = record + sizeof(header) + sizeof(LogArg) * argCount;
+    for (size_t i = 0; i < argCount; ++i)
+    {
+        if (stored[i].type != LogArg::Type::String)
+            continue;
+        std::memcpy(strings, stored[i].s, stored[i].length);
+        strings += stored[i].length;
+    }
+    ring.head.store(newHead, std::memory_order_release);
+
+    if (level >= LogLevel::Error)
+        writer.wake();
+}
+
+void Log::flush()
+{
+    drain();
+}
+
+LogArg Log::stringArg(const char* string)
+{
+    return stringArg(string ? string : "(null)", string ? std::strlen(string) : 6);
+}
+
+LogArg Log::stringArg(const char* string, size_t length)
+{
+    LogArg arg{};
+    arg.type = LogArg::Type::String;
+    arg.length = static_cast<uint32_t>(std::min<size_t>(length, UINT32_MAX));
+    arg.s = string;
+    return arg;
+}
+
+const char* Log::levelName(LogLevel level)
+{
+    static const char* names[] = {"trace", "debug", "info", "warning", "error"};
+    return names[static_cast<size_t>(level)];
+}
+
+const char* Log::categoryName(LogCategory category)
+{
+    static const char* names[] = {"general", "render", "mesh", "shader", "capture"};
+    return category < LogCategory::Count ? names[static_cast<size_t>(category)] : "unknown";
+}
+
+bool LogSite::allow(uint32_t& suppressed)
+{
+    const uint64_t now = Profiler::now();
+    if (now - windowBegin.load(std::memory_order_relaxed) >= 1000000000u)
+    {
+        windowBegin.store(now, std::memory_order_relaxed);
+        messages.store(0, std::memory_order_relaxed);
+    }
+    if (messages.fetch_add(1, std::memory_order_relaxed) < maxPerSecond)
+    {
+        suppressed = suppressedMessages.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    suppressedMessages.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
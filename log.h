@@ -0,0 +1,163 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Asynchronous logging with levels, categories and rate limiting   //
+// ========================================================================= //
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// Lowest level that is compiled in: 0 trace, 1 debug, 2 info, 3 warning, 4 error (CMake option LOG_LEVEL)
+#ifndef GDV_LOG_LEVEL
+#define GDV_LOG_LEVEL 1
+#endif
+
+enum class LogLevel : uint8_t { Trace, Debug, Info, Warning, Error };
+
+enum class LogCategory : uint8_t { General, Render, Mesh, Shader, Capture, Count };
+
+// One argument of a message. Strings are copied into the ring buffer, everything else is formatted later.
+struct LogArg {
+    enum class Type : uint32_t { Int, UInt, Double, Bool, Pointer, String };
+
+    Type type;
+    uint32_t length; // of a string
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void* p;
+        const char* s;
+    };
+};
+
+/*
+ * A message stores the pointer to its format string (a string literal, "{}" stands for the next argument)
+ * and the raw arguments into a ring buffer of the calling thread. Writing needs neither locks nor
+ * allocations; only the first message of a thread registers its buffer under a mutex. A background thread
+ * formats the messages and writes them to stderr every few milliseconds. If a ring buffer is full, the
+ * message is dropped and counted.
+ *
+ * The LOG_* macros of levels below GDV_LOG_LEVEL compile to nothing. At runtime, the level of every
+ * category can be raised with Log::setLevel() or by starting with GDV_LOG=trace|debug|info|warning|error.
+ * Every call site prints at most LogSite::maxPerSecond messages per second, the rest are counted and the
+ * count is appended to the next printed message of the site.
+ */
+class Log {
+public:
+    static bool isEnabled(LogLevel level, LogCategory category) {
+        return static_cast<uint8_t>(level) >= levels[static_cast<size_t>(category)].load(std::memory_order_relaxed);
+    }
+    static void setLevel(LogCategory category, LogLevel level) {
+        levels[static_cast<size_t>(category)].store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    }
+    static void setLevel(LogLevel level);
+
+    template <typename... Args>
+    static void write(LogLevel level, LogCategory category, uint32_t suppressed, const char* format, const Args&... args) {
+        const LogArg packed[sizeof...(Args) + 1] = {makeArg(args)...};
+        commit(level, category, suppressed, format, packed, sizeof...(Args));
+    }
+
+    // blocks until all messages written so far are printed
+    static void flush();
+
+    static const char* levelName(LogLevel level);
+    static const char* categoryName(LogCategory category);
+
+private:
+    static std::atomic<uint8_t> levels[static_cast<size_t>(LogCategory::Count)];
+
+    static void commit(LogLevel level, LogCategory category, uint32_t suppressed, const char* format, const LogArg* args, size_t argCount);
+
+    template <typename T>
+    static LogArg makeArg(const T& value) {
+        LogArg arg{};
+        if constexpr (std::is_same_v<T, bool>) {
+            arg.type = LogArg::Type::Bool;
+            arg.u = value;
+        } else if constexpr (std::is_enum_v<T>) {
+            arg.type = LogArg::Type::Int;
+            arg.i = static_cast<int64_t>(value);
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            arg.type = LogArg::Type::Int;
+            arg.i = value;
+        } else if constexpr (std::is_integral_v<T>) {
+            arg.type = LogArg::Type::UInt;
+            arg.u = value;
+        } else if constexpr (std::is_floating_point_v<T>) {
+            arg.type = LogArg::Type::Double;
+            arg.d = value;
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            arg = stringArg(value.data(), value.size());
+        } else if constexpr (std::is_convertible_v<const T&, const char*>) {
+            arg = stringArg(value);
+        } else if constexpr (std::is_convertible_v<const T&, const unsigned char*>) {
+            // strings of glGetString()
+            arg = stringArg(reinterpret_cast<const char*>(static_cast<const unsigned char*>(value)));
+        } else {
+            static_assert(std::is_pointer_v<T>, "Log: unsupported argument type");
+            arg.type = LogArg::Type::Pointer;
+            arg.p = value;
+        }
+        return arg;
+    }
+    static LogArg stringArg(const char* string);
+    static LogArg stringArg(const char* string, size_t length);
+};
+
+// Rate limit of one call site
+class LogSite {
+public:
+    static constexpr uint32_t maxPerSecond = 10;
+
+    // Returns false if the message is suppressed. Otherwise, suppressed is the number of messages suppressed since the last one.
+    bool allow(uint32_t& suppressed);
+
+private:
+    std::atomic<uint64_t> windowBegin{0};
+    std::atomic<uint32_t> messages{0};
+    std::atomic<uint32_t> suppressedMessages{0};
+};
+
+#define GDV_LOG(level, category, ...) \
+    do { \
+        if (Log::isEnabled(level, category)) { \
+            static LogSite logSite; \
+            uint32_t logSuppressed = 0; \
+            if (logSite.allow(logSuppressed)) \
+                Log::write(level, category, logSuppressed, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if GDV_LOG_LEVEL <= 0
+#define LOG_TRACE(category, ...) GDV_LOG(LogLevel::Trace, LogCategory::category, __VA_ARGS__)
+#else
+#define LOG_TRACE(category, ...) do {} while (0)
+#endif
+#if GDV_LOG_LEVEL <= 1
+#define LOG_DEBUG(category, ...) GDV_LOG(LogLevel::Debug, LogCategory::category, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) do {} while (0)
+#endif
+#if GDV_LOG_LEVEL <= 2
+#define LOG_INFO(category, ...) GDV_LOG(LogLevel::Info, LogCategory::category, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) do {} while (0)
+#endif
+#if GDV_LOG_LEVEL <= 3
+#define LOG_WARNING(category, ...) GDV_LOG(LogLevel::Warning, LogCategory::category, __VA_ARGS__)
+#else
+#define LOG_WARNING(category, ...) do {} while (0)
+#endif
+#define LOG_ERROR(category, ...) GDV_LOG(LogLevel::Error, LogCategory::category, __VA_ARGS__)
+
+#endif // LOG_H
@@ -10,10 +10,14 @@
 // ========================================================================= //
 
 #include "mainwindow.h"
+#include "profiler.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QSurfaceFormat>
 
+#include <iostream>
+
 int main(int argc, char *argv[])
 {
     //Change default QSurfaceFormat in order to enforce OpenGL version required for the exercise
@@ -27,8 +31,25 @@ int main(int argc, char *argv[])
     //format.setOption(QSurfaceFormat::FormatOption::DebugContext);
     QSurfaceFormat::setDefaultFormat(format);
 
+    Profiler::setThreadName("main");
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption replayOption("replay", "Replays a recorded camera path (F11) and quits.", "file");
+    const QCommandLineOption replayOutputOption("replay-output", "Writes the replayed frames with their timings to <file>.", "file");
+    const QCommandLineOption seedOption("seed", "Seed of the object positions and terrain.", "n");
+    parser.addOptions({replayOption, replayOutputOption, seedOption});
+    parser.process(a);
+
     MainWindow w;
+    if (parser.isSet(seedOption))
+        w.setSeed(parser.value(seedOption).toUInt());
     w.show();
+    if (parser.isSet(replayOption) && !w.startReplay(parser.value(replayOption), parser.value(replayOutputOption)))
+    {
+        std::cerr << "Could not load camera path " << parser.value(replayOption).toStdString() << std::endl;
+        return 1;
+    }
     return a.exec();
 }
@@ -11,14 +11,40 @@
 
 #include <functional>
 
+#include <QDateTime>
 #include <QFileDialog>
 #include <QMouseEvent>
 
+#include "log.h"
 #include "mainwindow.h"
+#include "profiler.h"
 #include "./ui_mainwindow.h"
 
 void MainWindow::refreshStatusBarMessage() const {
-    statusBar()->showMessage(tr("FPS: %1, Triangles: %2").arg(fpsCount).arg(triangleCount));
+    QString message = tr("FPS: %1, CPU: %2%, Triangles: %3, Qualität: %4 (%5%)").arg(fpsCount).arg(cpuUsage, 0, 'f', 0).arg(triangleCount)
+            .arg(qualityLevel).arg(renderScale * 100.0, 0, 'f', 0);
+    if (!gpuTimes.isEmpty())
+        message += QStringLiteral(", ") + gpuTimes;
+    if (!profilerStatus.isEmpty())
+        message += QStringLiteral(", ") + profilerStatus;
+    statusBar()->showMessage(message);
+}
+
+void MainWindow::toggleProfiler()
+{
+    Profiler::setEnabled(!Profiler::isEnabled());
+    profilerStatus = Profiler::isEnabled() ? tr("Profiler an") : tr("Profiler aus");
+    refreshStatusBarMessage();
+}
+
+void MainWindow::writeProfilerTrace()
+{
+    const QString fileName = QStringLiteral("trace_%1.json").arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd_HHmmss")));
+    if (Profiler::writeChromeTrace(fileName.toStdString()))
+        profilerStatus = tr("Trace geschrieben: %1").arg(fileName);
+    else
+        profilerStatus = tr("Trace konnte nicht geschrieben werden: %1").arg(fileName);
+    refreshStatusBarMessage();
 }
 
 void MainWindow::changeTriangleCount(unsigned int triangles)
@@ -33,6 +59,84 @@ void MainWindow::changeFpsCount(unsigned int fps)
     refreshStatusBarMessage();
 }
 
+void MainWindow::writeHitchReport()
+{
+    const QString fileName = QStringLiteral("hitches_%1.json").arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd_HHmmss")));
+    if (ui->openGLWidget->writeHitchReport(fileName))
+        profilerStatus = tr("Hitch-Report geschrieben: %1").arg(fileName);
+    else
+        profilerStatus = tr("Hitch-Report konnte nicht geschrieben werden: %1").arg(fileName);
+    refreshStatusBarMessage();
+}
+
+void MainWindow::toggleRecording()
+{
+    if (!ui->openGLWidget->isRecording())
+    {
+        ui->openGLWidget->startRecording();
+        profilerStatus = tr("Kamerapfad wird aufgenommen");
+        refreshStatusBarMessage();
+        return;
+    }
+    const QString fileName = QStringLiteral("camera_%1.gdvcam").arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd_HHmmss")));
+    if (ui->openGLWidget->stopRecording(fileName))
+        profilerStatus = tr("Kamerapfad geschrieben: %1").arg(fileName);
+    else
+        profilerStatus = tr("Kamerapfad konnte nicht geschrieben werden: %1").arg(fileName);
+    refreshStatusBarMessage();
+}
+
+void MainWindow::captureGLFrames()
+{
+    const QString fileName = QStringLiteral("capture_%1.gdvgl").arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd_HHmmss")));
+    ui->openGLWidget->captureFrames(1, fileName);
+    profilerStatus = tr("OpenGL-Aufzeichnung läuft");
+    refreshStatusBarMessage();
+}
+
+void MainWindow::showCaptureResult(const QString &fileName, bool success)
+{
+    if (success)
+        profilerStatus = tr("OpenGL-Trace geschrieben: %1").arg(fileName);
+    else
+        profilerStatus = tr("OpenGL-Trace konnte nicht geschrieben werden: %1").arg(fileName);
+    refreshStatusBarMessage();
+}
+
+void MainWindow::setSeed(unsigned int seed)
+{
+    ui->openGLWidget->setSeed(seed);
+}
+
+bool MainWindow::startReplay(const QString &fileName, const QString &outputFileName)
+{
+    if (!ui->openGLWidget->startReplay(fileName, outputFileName))
+        return false;
+    connect(ui->openGLWidget, &OpenGLView::replayFinished, qApp, [](bool success) { QApplication::exit(success ? 0 : 1); });
+    profilerStatus = tr("Kamerapfad wird abgespielt: %1").arg(fileName);
+    refreshStatusBarMessage();
+    return true;
+}
+
+void MainWindow::changeCpuUsage(double percent)
+{
+    cpuUsage = percent;
+    refreshStatusBarMessage();
+}
+
+void MainWindow::changeQualityLevel(int level, float renderScale)
+{
+    qualityLevel = level;
+    this->renderScale = renderScale;
+    refreshStatusBarMessage();
+}
+
+void MainWindow::changeGpuTimes(const QString &summary)
+{
+    gpuTimes = summary;
+    refreshStatusBarMessage();
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
@@ -47,16 +151,35 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->loadNewShaderButton, &QPushButton::clicked, this, &MainWindow::openShaderLoadingDialog);
     connect(ui->diffuseEnableCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleDiffuse);
     connect(ui->displacementEnableCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleDisplacementMapping);
+    connect(ui->parallaxEnableCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleParallaxMapping);
     connect(ui->bumpEnableCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleNormalMapping);
     connect(ui->drawBBCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleBoundingBox);
     connect(ui->drawNormalCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleNormals);
+    connect(ui->staticBatchingCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleStaticBatching);
+    connect(ui->vertexPullingCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleVertexPulling);
+    connect(ui->depthPrepassComboBox, &QComboBox::currentIndexChanged, ui->openGLWidget, &OpenGLView::setDepthPrepass);
+    connect(ui->overdrawComboBox, &QComboBox::currentIndexChanged, ui->openGLWidget, &OpenGLView::setOverdrawMode);
+    connect(ui->deferredShadingCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleDeferredShading);
+    connect(ui->visibilityBufferCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleVisibilityBuffer);
+    connect(ui->pointLightsSpinBox, &QSpinBox::valueChanged, ui->openGLWidget, &OpenGLView::setPointLightCount);
+    connect(ui->clusteredLightingCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleClusteredLighting);
     connect(ui->genTerrainButton, &QPushButton::clicked, ui->openGLWidget, &OpenGLView::recreateTerrain);
+    connect(ui->renderPolicyComboBox, &QComboBox::currentIndexChanged, ui->openGLWidget, &OpenGLView::setRenderPolicy);
+    connect(ui->frameRateSpinBox, &QSpinBox::valueChanged, ui->openGLWidget, &OpenGLView::setTargetFrameRate);
+    connect(ui->adaptiveQualityCheckBox, &QCheckBox::clicked, ui->openGLWidget, &OpenGLView::toggleAdaptiveQuality);
+    connect(ui->qualityTargetSpinBox, &QSpinBox::valueChanged, ui->openGLWidget, &OpenGLView::setQualityTargetFrameRate);
 
     connect(ui->openGLWidget, &OpenGLView::triangleCountChanged, this, &MainWindow::changeTriangleCount);
     connect(ui->openGLWidget, &OpenGLView::fpsCountChanged, this, &MainWindow::changeFpsCount);
+    connect(ui->openGLWidget, &OpenGLView::gpuTimesChanged, this, &MainWindow::changeGpuTimes);
+    connect(ui->openGLWidget, &OpenGLView::cpuUsageChanged, this, &MainWindow::changeCpuUsage);
+    connect(ui->openGLWidget, &OpenGLView::qualityLevelChanged, this, &MainWindow::changeQualityLevel);
     connect(ui->openGLWidget, &OpenGLView::shaderCompiled, this, &MainWindow::addShaderToList);
+    connect(ui->openGLWidget, &OpenGLView::captureFinished, this, &MainWindow::showCaptureResult);
 
     ui->openGLWidget->setGridSize(ui->gridSizeSpinBox->value());
+    ui->openGLWidget->setTargetFrameRate(ui->frameRateSpinBox->value());
+    ui->openGLWidget->setQualityTargetFrameRate(ui->qualityTargetSpinBox->value());
 
     statusBar()->showMessage(tr("OpenGL-Fenster geöffnet."));
 }
@@ -98,6 +221,21 @@ void MainWindow::keyPressEvent(QKeyEvent *ev)
     case Qt::Key_Plus:
         movementSpeed *= 2.f;
         break;
+    case Qt::Key_F8:
+        toggleProfiler();
+        break;
+    case Qt::Key_F9:
+        writeProfilerTrace();
+        break;
+    case Qt::Key_F10:
+        writeHitchReport();
+        break;
+    case Qt::Key_F11:
+        toggleRecording();
+        break;
+    case Qt::Key_F12:
+        captureGLFrames();
+        break;
     case Qt::Key_Minus:
         movementSpeed /= 2.f;
     default:
@@ -124,7 +262,7 @@ void MainWindow::setColoringMode(unsigned int index)
     TriangleMesh::ColoringType type;
     switch (index) {
     default:
-        qDebug() << "Error: Falscher Index. Setze Standardwert...\n";
+        LOG_WARNING(General, "Falscher Index {}. Setze Standardwert...", index);
         // [[fallthrough]];
     case 0:
         type = TriangleMesh::ColoringType::COLOR_ARRAY;
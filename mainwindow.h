@@ -31,11 +31,19 @@ private slots:
 public slots:
     void changeTriangleCount(unsigned int triangles);
     void changeFpsCount(unsigned int fps);
+    void changeGpuTimes(const QString& summary);
+    void changeCpuUsage(double percent);
+    void changeQualityLevel(int level, float renderScale);
+    void showCaptureResult(const QString& fileName, bool success);
 
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    void setSeed(unsigned int seed);
+    // replays a recorded camera path and quits the application with exit code 1 if it fails
+    bool startReplay(const QString& fileName, const QString& outputFileName);
+
 protected:
     void mousePressEvent(QMouseEvent* ev) override;
     void mouseMoveEvent(QMouseEvent* ev) override;
@@ -45,7 +53,17 @@ private:
     Ui::MainWindow *ui;
     unsigned int fpsCount = 0;
     unsigned int triangleCount = 0;
+    QString gpuTimes;
+    double cpuUsage = 0.0;
+    int qualityLevel = 0;
+    float renderScale = 1.0f;
+    QString profilerStatus;
     void refreshStatusBarMessage() const;
+    void toggleProfiler();
+    void writeProfilerTrace();
+    void writeHitchReport();
+    void toggleRecording();
+    void captureGLFrames();
 
     // mouse information
     QPoint mousePos;
@@ -0,0 +1,193 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Fixed-capacity matrix stack with cached normal matrices         //
+// ========================================================================= //
+
+#ifndef MATRIXSTACK_H
+#define MATRIXSTACK_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+#include <QMatrix3x3>
+#include <QMatrix4x4>
+#include <QVector3D>
+
+#include "log.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define GDV_MATRIX_SSE
+#endif
+
+// result = a * b for column-major 4x4 matrices. result may alias a or b.
+inline void multiplyMatrices(const float* a, const float* b, float* result)
+{
+#ifdef GDV_MATRIX_SSE
+    const __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+    __m128 columns[4];
+    for (int j = 0; j < 4; ++j)
+    {
+        const float* bj = b + 4 * j;
+        columns[j] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(bj[0])), _mm_mul_ps(a1, _mm_set1_ps(bj[1]))),
+                                _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(bj[2])), _mm_mul_ps(a3, _mm_set1_ps(bj[3]))));
+    }
+    for (int j = 0; j < 4; ++j)
+        _mm_storeu_ps(result + 4 * j, columns[j]);
+#else
+    float columns[16];
+    for (int j = 0; j < 4; ++j)
+        for (int i = 0; i < 4; ++i)
+            columns[4 * j + i] = a[i] * b[4 * j] + a[4 + i] * b[4 * j + 1] + a[8 + i] * b[4 * j + 2] + a[12 + i] * b[4 * j + 3];
+    for (int i = 0; i < 16; ++i)
+        result[i] = columns[i];
+#endif
+}
+
+inline QMatrix4x4 multiplyMatrices(const QMatrix4x4& a, const QMatrix4x4& b)
+{
+    QMatrix4x4 result(Qt::Uninitialized);
+    multiplyMatrices(a.constData(), b.constData(), result.data());
+    return result;
+}
+
+/*
+ * Stack of 4x4 matrices without allocations. Every entry knows whether its matrix is a rotation and
+ * translation only (Rigid), additionally scaled by the same factor on all axes (UniformScale), or anything
+ * else (General). The normal matrix (inverse transpose of the upper 3x3) is cached per entry: a translation
+ * keeps it, pushing copies it, and for Rigid and UniformScale matrices it is the upper 3x3 divided by the
+ * squared scale instead of a full inverse. Changes through modify() make the entry General.
+ */
+class MatrixStack {
+public:
+    enum class Kind : uint8_t { Rigid, UniformScale, General };
+    static constexpr int capacity = 32;
+
+    // More than capacity matrices are an error: the levels beyond it share one spare entry, so their
+    // transforms are wrong, but the matching pops stay balanced and the matrices below stay intact.
+    void push() {
+        assert(depth + 1 < capacity && "MatrixStack overflow");
+        if (depth + 1 < capacity) {
+            entries[depth + 1] = entries[depth];
+            ++depth;
+            return;
+        }
+        if (depth + 1 == capacity) {
+            entries[capacity] = entries[depth];
+            ++depth;
+        } else {
+            ++overflow;
+        }
+        LOG_ERROR(Render, "MatrixStack: push beyond the capacity of {} matrices, depth {}", capacity, size());
+    }
+    // pops the top matrix, or loads the identity if it is the last one
+    void pop() {
+        if (overflow > 0)
+            --overflow;
+        else if (depth > 0)
+            --depth;
+        else
+            loadIdentity();
+    }
+    int size() const { return depth + 1 + overflow; }
+
+    void loadIdentity() { set(QMatrix4x4(), Kind::Rigid); }
+    void set(const QMatrix4x4& matrix, Kind kind) {
+        Entry& entry = entries[depth];
+        entry.matrix = matrix;
+        entry.kind = kind;
+        entry.normalValid = false;
+    }
+
+    const QMatrix4x4& top() const { return entries[depth].matrix; }
+    Kind kind() const { return entries[depth].kind; }
+    // direct access for changes of unknown kind
+    QMatrix4x4& modify() {
+        Entry& entry = entries[depth];
+        entry.kind = Kind::General;
+        entry.normalValid = false;
+        return entry.matrix;
+    }
+
+    // top = top * translation. The normal matrix stays valid.
+    void translate(float x, float y, float z) {
+        float* m = entries[depth].matrix.data();
+#ifdef GDV_MATRIX_SSE
+        const __m128 column = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(x)), _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(y))),
+                                         _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(z)), _mm_loadu_ps(m + 12)));
+        _mm_storeu_ps(m + 12, column);
+#else
+        for (int i = 0; i < 4; ++i)
+            m[12 + i] += m[i] * x + m[4 + i] * y + m[8 + i] * z;
+#endif
+    }
+    // top = top * scale
+    void scale(float x, float y, float z) {
+        Entry& entry = entries[depth];
+        float* m = entry.matrix.data();
+        for (int i = 0; i < 4; ++i) {
+            m[i] *= x;
+            m[4 + i] *= y;
+            m[8 + i] *= z;
+        }
+        const bool uniform = x == y && y == z;
+        if (!uniform)
+            entry.kind = Kind::General;
+        else if (entry.kind == Kind::Rigid && x != 1.0f)
+            entry.kind = Kind::UniformScale;
+        entry.normalValid = entry.normalValid && uniform && x == 1.0f;
+    }
+    // top = top * matrix, where matrix is of the given kind
+    void multiply(const QMatrix4x4& matrix, Kind kind) {
+        Entry& entry = entries[depth];
+        multiplyMatrices(entry.matrix.constData(), matrix.constData(), entry.matrix.data());
+        entry.kind = std::max(entry.kind, kind);
+        entry.normalValid = false;
+    }
+    void lookAt(const QVector3D& eye, const QVector3D& center, const QVector3D& up) {
+        QMatrix4x4 view;
+        view.lookAt(eye, center, up);
+        multiply(view, Kind::Rigid);
+    }
+
+    const QMatrix3x3& normalMatrix() const {
+        const Entry& entry = entries[depth];
+        if (!entry.normalValid) {
+            if (entry.kind == Kind::General) {
+                entry.normal = entry.matrix.normalMatrix();
+            } else {
+                // the inverse of s * R is R^T / s, its transpose R / s = (s * R) / s^2
+                const float* m = entry.matrix.constData();
+                const float squaredScale = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+                const float inverse = entry.kind == Kind::Rigid || squaredScale == 0.0f ? 1.0f : 1.0f / squaredScale;
+                float* n = entry.normal.data();
+                for (int column = 0; column < 3; ++column)
+                    for (int row = 0; row < 3; ++row)
+                        n[3 * column + row] = m[4 * column + row] * inverse;
+            }
+            entry.normalValid = true;
+        }
+        return entry.normal;
+    }
+
+private:
+    struct alignas(16) Entry {
+        QMatrix4x4 matrix;
+        mutable QMatrix3x3 normal;
+        Kind kind = Kind::Rigid;
+        mutable bool normalValid = false;
+    };
+
+    // one spare entry for the levels beyond the capacity
+    std::array<Entry, capacity + 1> entries;
+    int depth = 0;
+    int overflow = 0; // pushes beyond the spare entry
+};
+
+#endif // MATRIXSTACK_H
@@ -0,0 +1,173 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: GPU buffers of a mesh, created from MeshData on the GL thread    //
+// ========================================================================= //
+
+#include "hitchdetector.h"
+#include "log.h"
+#include "meshbuffers.h"
+#include "meshdata.h"
+#include "profiler.h"
+#include "shader.h"
+
+MeshBuffers::~MeshBuffers()
+{
+    release();
+}
+
+bool MeshBuffers::upload(GLFunctions *f, const MeshData &data)
+{
+    PROFILE_FUNCTION();
+    release();
+    this->f.val = f;
+    if (!f || data.vertices.empty())
+        return false;
+    const size_t numVertices = data.vertices.size();
+    // create VAOs
+    f->glGenVertexArrays(1, &VAO.val);
+
+    // create VBOs
+    VBOf.val = createVBO(data.triangles.data(), data.triangles.size() * sizeof(Vec3ui), GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW);
+    VBOv.val = createVBO(data.vertices.data(), numVertices * sizeof(Vec3f), GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+    VBOn.val = createVBO(data.normals.data(), data.normals.size() * sizeof(Vec3f), GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+    if (data.colors.size() == numVertices)
+        VBOc.val = createVBO(data.colors.data(), numVertices * sizeof(Vec3f), GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+    if (data.texCoords.size() == numVertices)
+        VBOt.val = createVBO(data.texCoords.data(), numVertices * sizeof(MeshData::TexCoord), GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+    if (data.tangents.size() == numVertices)
+        VBOtan.val = createVBO(data.tangents.data(), numVertices * sizeof(Vec3f), GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+
+    // bind VBOs to VAO object
+    f->glBindVertexArray(VAO.val);
+    f->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBOf.val);
+    f->glBindBuffer(GL_ARRAY_BUFFER, VBOv.val);
+    f->glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    f->glEnableVertexAttribArray(POSITION_LOCATION);
+    f->glBindBuffer(GL_ARRAY_BUFFER, VBOn.val);
+    f->glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    f->glEnableVertexAttribArray(NORMAL_LOCATION);
+    if (VBOc.val)
+    {
+        f->glBindBuffer(GL_ARRAY_BUFFER, VBOc.val);
+        f->glVertexAttribPointer(COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+        f->glEnableVertexAttribArray(COLOR_LOCATION);
+    }
+    if (VBOt.val)
+    {
+        f->glBindBuffer(GL_ARRAY_BUFFER, VBOt.val);
+        f->glVertexAttribPointer(TEXCOORD_LOCATION, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+        f->glEnableVertexAttribArray(TEXCOORD_LOCATION);
+    }
+    if (VBOtan.val)
+    {
+        f->glBindBuffer(GL_ARRAY_BUFFER, VBOtan.val);
+        f->glVertexAttribPointer(TANGENT_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+        f->glEnableVertexAttribArray(TANGENT_LOCATION);
+    }
+
+    // the position stream alone for depth-only passes, a fraction of the vertex fetches of the full VAO
+    f->glGenVertexArrays(1, &depthVAO.val);
+    f->glBindVertexArray(depthVAO.val);
+    f->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBOf.val);
+    f->glBindBuffer(GL_ARRAY_BUFFER, VBOv.val);
+    f->glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    f->glEnableVertexAttribArray(POSITION_LOCATION);
+    f->glBindVertexArray(0);
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    indexCount = static_cast<unsigned int>(3 * data.triangles.size());
+    vertexCount = static_cast<unsigned int>(numVertices);
+    LOG_DEBUG(Mesh, "uploaded {} vertices, {} bytes of VBOs, {} bytes of debug geometry not created", vertexCount, gpuBytes, getDebugBytesSaved());
+
+    return VBOv.val != 0 && VBOf.val != 0;
+}
+
+void MeshBuffers::uploadTexCoords(const MeshData &data)
+{
+    if (!f.val || VAO.val == 0 || VBOt.val != 0 || data.texCoords.size() != vertexCount)
+        return;
+    GLFunctions *f = this->f.val;
+    VBOt.val = createVBO(data.texCoords.data(), vertexCount * sizeof(MeshData::TexCoord), GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+    f->glBindVertexArray(VAO.val);
+    f->glBindBuffer(GL_ARRAY_BUFFER, VBOt.val);
+    f->glVertexAttribPointer(TEXCOORD_LOCATION, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    f->glEnableVertexAttribArray(TEXCOORD_LOCATION);
+    f->glBindVertexArray(0);
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshBuffers::updateNormals(const MeshData &data)
+{
+    if (!f.val || VBOn.val == 0 || data.normals.size() != vertexCount)
+        return;
+    GLFunctions *f = this->f.val;
+    f->glBindBuffer(GL_ARRAY_BUFFER, VBOn.val);
+    f->glBufferSubData(GL_ARRAY_BUFFER, 0, vertexCount * sizeof(Vec3f), data.normals.data());
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    HitchDetector::countUpload(vertexCount * sizeof(Vec3f));
+}
+
+GLuint MeshBuffers::createVBO(const void *data, size_t dataSize, GLenum target, GLenum usage)
+{
+    GLFunctions *f = this->f.val;
+    // 0 is reserved, glGenBuffers() will return non-zero id if success
+    GLuint id = 0;
+    // create a vbo
+    f->glGenBuffers(1, &id);
+    // activate vbo id to use
+    f->glBindBuffer(target, id);
+    // upload data to video card
+    f->glBufferData(target, dataSize, data, usage);
+    HitchDetector::countUpload(dataSize);
+    // check data size in VBO is same as input array, if not return 0 and delete VBO
+    GLint bufferSize = 0;
+    f->glGetBufferParameteriv(target, GL_BUFFER_SIZE, &bufferSize);
+    if (dataSize != static_cast<size_t>(bufferSize))
+    {
+        f->glDeleteBuffers(1, &id);
+        id = 0;
+        LOG_ERROR(Mesh, "createVBO() ERROR: Data size ({}) is mismatch with input array ({}).", dataSize, bufferSize);
+    }
+    else
+    {
+        gpuBytes += dataSize;
+    }
+    // unbind after copying data
+    f->glBindBuffer(target, 0);
+    return id;
+}
+
+size_t MeshBuffers::getDebugBytesSaved() const
+{
+    const size_t normalArrowBytes = 2 * size_t(vertexCount) * sizeof(Vec3f);
+    return normalArrowBytes + BoxVerticesSize + BoxLineIndicesSize;
+}
+
+void MeshBuffers::release()
+{
+    GLFunctions *f = this->f.val;
+    if (f)
+    {
+        // delete VAOs
+        for (autoMoved<GLuint> *vao : {&VAO, &depthVAO})
+        {
+            if (vao->val != 0)
+                f->glDeleteVertexArrays(1, &vao->val);
+        }
+        // delete VBOs
+        for (autoMoved<GLuint> *vbo : {&VBOv, &VBOn, &VBOf, &VBOc, &VBOt, &VBOtan})
+        {
+            if (vbo->val != 0)
+                f->glDeleteBuffers(1, &vbo->val);
+        }
+    }
+    for (autoMoved<GLuint> *id : {&VAO, &depthVAO, &VBOv, &VBOn, &VBOf, &VBOc, &VBOt, &VBOtan})
+        id->val = 0;
+    indexCount = 0;
+    vertexCount = 0;
+    gpuBytes = 0;
+}
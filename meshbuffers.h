@@ -0,0 +1,81 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: GPU buffers of a mesh, created from MeshData on the GL thread    //
+// ========================================================================= //
+
+#ifndef MESHBUFFERS_H
+#define MESHBUFFERS_H
+
+#include <cstddef>
+
+#include "utilities.h"
+
+struct MeshData;
+
+/*
+ * VAO and VBOs of one mesh. All functions need the OpenGL context of upload(). Debug geometry has no
+ * buffers here: DebugDraw draws bounding boxes as instances of one unit box and normals from the normal VBO
+ * with a geometry shader. The buffers only keep the counts needed for drawing, so the MeshData they were
+ * created from can be released afterwards. Movable like TriangleMesh, the destructor releases the buffers.
+ */
+class MeshBuffers {
+public:
+    MeshBuffers() = default;
+    ~MeshBuffers();
+    MeshBuffers(const MeshBuffers& other) = delete;
+    MeshBuffers& operator= (const MeshBuffers& other) = delete;
+    MeshBuffers(MeshBuffers&& other) noexcept = default;
+    MeshBuffers& operator= (MeshBuffers&& other) noexcept = default;
+
+    // releases the current buffers and creates VBOs for all attributes of data with as many entries as
+    // vertices. Returns false if the VBOs could not be created.
+    bool upload(GLFunctions* f, const MeshData& data);
+    // creates the texCoord VBO after upload(), e.g. for texture coordinates calculated later
+    void uploadTexCoords(const MeshData& data);
+    // overwrites the normal VBO, data must have as many normals as were uploaded
+    void updateNormals(const MeshData& data);
+    // deletes all buffers (from gpu memory)
+    void release();
+
+    bool isUploaded() const { return VAO.val != 0; }
+    bool hasColors() const { return VBOc.val != 0; }
+    bool hasTexCoords() const { return VBOt.val != 0; }
+
+    GLuint getVAO() const { return VAO.val; }
+    // positions and triangles only, for depth-only passes
+    GLuint getDepthVAO() const { return depthVAO.val; }
+    GLuint getVertexBuffer() const { return VBOv.val; }
+    GLuint getNormalBuffer() const { return VBOn.val; }
+    GLuint getIndexBuffer() const { return VBOf.val; }
+
+    // number of indices for glDrawElements, 3 per triangle
+    unsigned int getIndexCount() const { return indexCount; }
+    unsigned int getVertexCount() const { return vertexCount; }
+    unsigned int getTriangleCount() const { return indexCount / 3; }
+    // bytes of all VBOs
+    size_t getGpuBytes() const { return gpuBytes; }
+    // bytes of debug geometry not created: the normal arrow VBO (two vertices per vertex) that the geometry
+    // shader replaces and the bounding box VBOs that the DebugDraw instances replace
+    size_t getDebugBytesSaved() const;
+
+private:
+    // create VBO
+    GLuint createVBO(const void* data, size_t dataSize, GLenum target, GLenum usage);
+
+    // VAO and VBO ids for vertices, normals, faces, colors, texCoords, tangents
+    autoMoved<GLuint> VAO{}, VBOv{}, VBOn{}, VBOf{}, VBOc{}, VBOt{}, VBOtan{};
+    autoMoved<GLuint> depthVAO{};
+
+    unsigned int indexCount = 0;
+    unsigned int vertexCount = 0;
+    size_t gpuBytes = 0;
+
+    // moved together with the ids, the destructor deletes them with it
+    autoMoved<GLFunctions*> f{};
+};
+
+#endif // MESHBUFFERS_H
@@ -0,0 +1,412 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: CPU side mesh data, loading and processing without OpenGL        //
+// ========================================================================= //
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+#include "log.h"
+#include "meshdata.h"
+#include "meshkernels.h"
+#include "profiler.h"
+
+namespace {
+constexpr float Pi = 3.14159265358979f;
+}
+
+void MeshData::clear()
+{
+    vertices.clear();
+    triangles.clear();
+    normals.clear();
+    colors.clear();
+    texCoords.clear();
+    tangents.clear();
+    texCoordsPending = false;
+    boundingBoxMin = Vec3f(FLT_MAX, FLT_MAX, FLT_MAX);
+    boundingBoxMax = Vec3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    boundingBoxMid.zero();
+    boundingBoxSize.zero();
+}
+
+void MeshData::releaseArrays()
+{
+    // swapping with empty vectors frees the memory, clear() would keep the capacity
+    std::vector<Vec3f>().swap(vertices);
+    std::vector<Vec3f>().swap(normals);
+    std::vector<Vec3ui>().swap(triangles);
+    std::vector<Vec3f>().swap(colors);
+    std::vector<TexCoord>().swap(texCoords);
+    std::vector<Vec3f>().swap(tangents);
+}
+
+size_t MeshData::memoryBytes() const
+{
+    return (vertices.capacity() + normals.capacity() + colors.capacity() + tangents.capacity()) * sizeof(Vec3f)
+           + triangles.capacity() * sizeof(Vec3ui) + texCoords.capacity() * sizeof(TexCoord);
+}
+
+// =================
+// === LOAD MESH ===
+// =================
+
+bool MeshData::loadOFF(const char *filename)
+{
+    PROFILE_FUNCTION();
+    // clear any existing mesh
+    clear();
+    // load from off
+    std::ifstream in(filename);
+    if (!in.is_open())
+    {
+        LOG_ERROR(Mesh, "loadOFF: can not find {}", filename);
+        return false;
+    }
+    const int MAX = 256;
+    char s[MAX];
+    in >> std::setw(MAX) >> s;
+    // differentiate between OFF (vertices only) and NOFF (vertices and normals)
+    bool noff = false;
+    if (s[0] == 'O' && s[1] == 'F' && s[2] == 'F')
+        ;
+    else if (s[0] == 'N' && s[1] == 'O' && s[2] == 'F' && s[3] == 'F')
+        noff = true;
+    else
+        return false;
+    // get number of vertices nv, faces nf and edges ne
+    int nv, nf, ne;
+    in >> std::setw(MAX) >> nv;
+    in >> std::setw(MAX) >> nf;
+    in >> std::setw(MAX) >> ne;
+    if (nv <= 0 || nf <= 0)
+        return false;
+    // read vertices
+    vertices.resize(nv);
+    if (noff)
+        normals.resize(nv);
+    for (int i = 0; i < nv; ++i)
+    {
+        in >> std::setw(MAX) >> vertices[i][0];
+        in >> std::setw(MAX) >> vertices[i][1];
+        in >> std::setw(MAX) >> vertices[i][2];
+        boundingBoxMin[0] = std::min(vertices[i][0], boundingBoxMin[0]);
+        boundingBoxMin[1] = std::min(vertices[i][1], boundingBoxMin[1]);
+        boundingBoxMin[2] = std::min(vertices[i][2], boundingBoxMin[2]);
+        boundingBoxMax[0] = std::max(vertices[i][0], boundingBoxMax[0]);
+        boundingBoxMax[1] = std::max(vertices[i][1], boundingBoxMax[1]);
+        boundingBoxMax[2] = std::max(vertices[i][2], boundingBoxMax[2]);
+        if (noff)
+        {
+            in >> std::setw(MAX) >> normals[i][0];
+            in >> std::setw(MAX) >> normals[i][1];
+            in >> std::setw(MAX) >> normals[i][2];
+        }
+    }
+    boundingBoxMid = 0.5f * boundingBoxMin + 0.5f * boundingBoxMax;
+    boundingBoxSize = boundingBoxMax - boundingBoxMin;
+    // read triangles
+    triangles.resize(nf);
+    for (int i = 0; i < nf; ++i)
+    {
+        int three;
+        in >> std::setw(MAX) >> three;
+        in >> std::setw(MAX) >> triangles[i][0];
+        in >> std::setw(MAX) >> triangles[i][1];
+        in >> std::setw(MAX) >> triangles[i][2];
+    }
+    // close ifstream
+    in.close();
+    // calculate normals if not given
+    if (!noff)
+        calculateNormalsByArea();
+    // texture coordinates are calculated when a coloring mode samples them, see TriangleMesh::setColoringMode()
+    texCoordsPending = true;
+    return true;
+}
+
+void MeshData::generateSphere(int longdiv, int latdiv)
+{
+    PROFILE_FUNCTION();
+    clear();
+    // The sphere consists of latdiv rings of longdiv faces.
+    longdiv = std::max(longdiv, 4);
+    latdiv = std::max(latdiv, 2);
+
+    // Generate vertices.
+    for (int latitude = 0; latitude <= latdiv; latitude++)
+    {
+        float v = static_cast<float>(latitude) / static_cast<float>(latdiv);
+        float latangle = v * Pi;
+
+        float extent = std::sin(latangle);
+        float y = -std::cos(latangle);
+
+        for (int longitude = 0; longitude <= longdiv; longitude++)
+        {
+            float u = static_cast<float>(longitude) / static_cast<float>(longdiv);
+            float longangle = u * 2.0f * Pi;
+
+            float z = std::sin(longangle) * extent;
+            float x = std::cos(longangle) * extent;
+
+            Vec3f pos(x, y, z);
+
+            vertices.push_back(pos);
+            normals.push_back(pos);
+            texCoords.push_back({2.0f - 2.0f * u, v});
+            tangents.push_back(cross(Vec3f(0, 1, 0), pos));
+        }
+    }
+
+    for (int latitude = 0; latitude < latdiv; latitude++)
+    {
+        unsigned int bottomBase = latitude * (longdiv + 1);
+        unsigned int topBase = (latitude + 1) * (longdiv + 1);
+        for (int longitude = 0; longitude < longdiv; longitude++)
+        {
+            unsigned int bottomCurrent = bottomBase + longitude;
+            unsigned int bottomNext = bottomBase + (longitude + 1);
+            unsigned int topCurrent = topBase + longitude;
+            unsigned int topNext = topBase + (longitude + 1);
+            triangles.emplace_back(bottomCurrent, bottomNext, topNext);
+            triangles.emplace_back(topNext, topCurrent, bottomCurrent);
+        }
+    }
+
+    boundingBoxMid = Vec3f(0, 0, 0);
+    boundingBoxSize = Vec3f(2, 2, 2);
+    boundingBoxMin = Vec3f(-1, -1, -1);
+    boundingBoxMax = Vec3f(1, 1, 1);
+}
+
+void MeshData::generateTerrain(unsigned int h, unsigned int w, unsigned int seed)
+{
+    PROFILE_FUNCTION();
+    // TODO(3.1): Implement terrain generation.
+
+    // Diamond-Square Algorithm:
+    // https://janert.me/blog/2022/the-diamond-square-algorithm-for-terrain-generation/
+    // https://medium.com/@nickobrien/diamond-square-algorithm-explanation-and-c-implementation-5efa891e486f
+    // https://en.wikipedia.org/wiki/Diamond-square_algorithm
+
+    // 1) Clear any old data.
+    clear();
+
+    // 2) Allocate a 2D heightmap of size (w+1) x (h+1).
+    std::vector<std::vector<float>> heightmap(w + 1, std::vector<float>(h + 1, 0.0f));
+
+    // 3) Initialize corners with random seeds.
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(0.0f, 5.0f); //range, corner heights of map
+    heightmap[0][0] = dist(gen);
+    heightmap[w][0] = dist(gen);
+    heightmap[0][h] = dist(gen);
+    heightmap[w][h] = dist(gen);
+
+    // 4) Diamond-Square algorithm:
+    //    The 'stepSize' is current subdivision size; it is halved each iteration.
+    //    The 'roughness' controls how wild the random additions are each iteration.
+    float roughness = 3.0f;
+    int stepSize    = std::max(w, h);
+
+    while (stepSize > 1) {
+        int halfStep = stepSize / 2;
+
+        // Diamond step
+        for (int x = halfStep; x < (int)w; x += stepSize) {
+            for (int z = halfStep; z < (int)h; z += stepSize) {
+                float a = heightmap[x - halfStep][z - halfStep];
+                float b = heightmap[x + halfStep][z - halfStep];
+                float c = heightmap[x - halfStep][z + halfStep];
+                float d = heightmap[x + halfStep][z + halfStep];
+                float avg = (a + b + c + d) * 0.25f;
+
+                float offset = dist(gen) * roughness - roughness * 0.5f;
+                heightmap[x][z] = avg + offset;
+            }
+        }
+
+        // Square step
+        for (int x = 0; x <= (int)w; x += halfStep) {
+            for (int z = ((x / halfStep) % 2 == 0) ? halfStep : 0; z <= (int)h; z += stepSize) {
+                float sum     = 0.0f;
+                int   count   = 0;
+                if ((x - halfStep) >= 0 && (z - halfStep) >= 0) {
+                    sum += heightmap[x - halfStep][z - halfStep];
+                    ++count;
+                }
+                if ((x + halfStep) <= (int)w && (z - halfStep) >= 0) {
+                    sum += heightmap[x + halfStep][z - halfStep];
+                    ++count;
+                }
+                if ((x - halfStep) >= 0 && (z + halfStep) <= (int)h) {
+                    sum += heightmap[x - halfStep][z + halfStep];
+                    ++count;
+                }
+                if ((x + halfStep) <= (int)w && (z + halfStep) <= (int)h) {
+                    sum += heightmap[x + halfStep][z + halfStep];
+                    ++count;
+                }
+                float avg = (count > 0) ? sum / count : 0.0f;
+
+                float offset = dist(gen) * roughness - roughness * 0.5f;
+                heightmap[x][z] = avg + offset;
+            }
+        }
+
+        // Halve the step size and reduce roughness
+        stepSize  /= 2;
+        roughness *= 0.5f;
+    }
+
+    // 5) Build the mesh from the heightmap
+    //    for each grid cell create 2 triangles
+    //    (w+1)*(h+1) vertices in total
+    vertices.reserve((w+1)*(h+1));
+    normals.reserve((w+1)*(h+1));
+    colors.reserve((w+1)*(h+1));
+
+    // prepare index buffer for triangles
+    triangles.reserve(w * h * 2);
+
+    // for color calculation:
+    auto computeColor = [&](float heightValue) -> Vec3f {
+        // clamp height for safety
+        heightValue = std::clamp(heightValue, 0.0f, 10.0f);
+
+        // example coloring (very rough):
+        // 0 - 1.5: water (blue)
+        // 1.5 - 2.5: sand (brownish)
+        // 2.5 - 4.0: grass (green)
+        // 4.0 - 6.0: rock (grey)
+        // 6.0+ : snow (white)
+        if (heightValue < 1.5f) return Vec3f(0.0f, 0.0f, 1.0f);
+        if (heightValue < 2.5f) return Vec3f(0.5f, 0.35f, 0.05f);
+        if (heightValue < 4.0f) return Vec3f(0.0f, 0.7f, 0.0f);
+        if (heightValue < 6.0f) return Vec3f(0.5f, 0.5f, 0.5f);
+        return Vec3f(1.0f, 1.0f, 1.0f);
+    };
+
+    // Loop through points in heightmap
+    for (int z = 0; z <= (int)h; ++z) {
+        for (int x = 0; x <= (int)w; ++x) {
+            float y = heightmap[x][z];
+            vertices.push_back(Vec3f(static_cast<float>(x), y, static_cast<float>(z)));
+            // fill placeholder normal , refine later (calculateNormalsByArea).
+            normals.push_back(Vec3f(0.0f, 1.0f, 0.0f));
+            // Per-vertex color based on height:
+            Vec3f c = computeColor(y);
+            colors.push_back(c);
+        }
+    }
+
+    // Create triangles: for each cell (x,z)two triangles
+    for (int z = 0; z < (int)h; ++z) {
+        for (int x = 0; x < (int)w; ++x) {
+            // Indices in the vertex array:
+            unsigned int i0 = z * (w + 1) + x;
+            unsigned int i1 = i0 + 1;
+            unsigned int i2 = (z + 1) * (w + 1) + x;
+            unsigned int i3 = i2 + 1;
+
+            triangles.emplace_back(i0, i2, i1);
+
+            triangles.emplace_back(i1, i2, i3);
+        }
+    }
+
+    // 6) recalculate the normals from new triangles
+    calculateNormalsByArea();
+    calculateBB(); // bounding box
+}
+
+// =======================
+// === MESH PROCESSING ===
+// =======================
+
+void MeshData::calculateNormalsByArea()
+{
+    // sum up triangle normals in each vertex
+    normals.resize(vertices.size());
+    for (auto &triangle : triangles)
+    {
+        unsigned int
+            id0 = triangle[0],
+            id1 = triangle[1],
+            id2 = triangle[2];
+        Vec3f
+            vec1 = vertices[id1] - vertices[id0],
+            vec2 = vertices[id2] - vertices[id0],
+            normal = cross(vec1, vec2);
+        normals[id0] += normal;
+        normals[id1] += normal;
+        normals[id2] += normal;
+    }
+    // normalize normals
+    meshKernels().normalize(reinterpret_cast<float *>(normals.data()), normals.size());
+}
+
+void MeshData::calculateTexCoordsSphereMapping()
+{
+    PROFILE_FUNCTION();
+    static_assert(sizeof(TexCoord) == 2 * sizeof(float), "texCoords are written as a float array");
+    texCoordsPending = false;
+    // texCoords by central projection on unit sphere, ranges of vertices on several threads
+    texCoords.resize(vertices.size());
+    const float center[3] = {boundingBoxMid.x(), boundingBoxMid.y(), boundingBoxMid.z()};
+    const MeshKernels &kernels = meshKernels();
+    const float *xyz = reinterpret_cast<const float *>(vertices.data());
+    float *uv = reinterpret_cast<float *>(texCoords.data());
+    parallelFor(vertices.size(), 1 << 16, [&](size_t begin, size_t end) {
+        kernels.sphereTexCoords(xyz + 3 * begin, end - begin, center, uv + 2 * begin);
+    });
+}
+
+void MeshData::calculateBB()
+{
+    // clear bounding box data
+    boundingBoxMin = Vec3f(FLT_MAX, FLT_MAX, FLT_MAX);
+    boundingBoxMax = Vec3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    boundingBoxMid.zero();
+    boundingBoxSize.zero();
+    // iterate over vertices
+    meshKernels().boundingBox(reinterpret_cast<const float *>(vertices.data()), vertices.size(), &boundingBoxMin[0], &boundingBoxMax[0]);
+    boundingBoxMid = 0.5f * boundingBoxMin + 0.5f * boundingBoxMax;
+    boundingBoxSize = boundingBoxMax - boundingBoxMin;
+}
+
+void MeshData::flipNormals()
+{
+    for (auto &n : normals)
+        n *= -1.0f;
+}
+
+void MeshData::translateToCenter(const Vec3f &newBBmid)
+{
+    Vec3f trans = newBBmid - boundingBoxMid;
+    for (auto &vertex : vertices)
+        vertex += trans;
+    boundingBoxMin += trans;
+    boundingBoxMax += trans;
+    boundingBoxMid += trans;
+}
+
+void MeshData::scaleToLength(const float newLength)
+{
+    float length = std::max(std::max(boundingBoxSize.x(), boundingBoxSize.y()), boundingBoxSize.z());
+    float scale = newLength / length;
+    for (auto &vertex : vertices)
+        vertex *= scale;
+    boundingBoxMin *= scale;
+    boundingBoxMax *= scale;
+    boundingBoxMid *= scale;
+    boundingBoxSize *= scale;
+}
@@ -0,0 +1,73 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: CPU side mesh data, loading and processing without OpenGL        //
+// ========================================================================= //
+
+#ifndef MESHDATA_H
+#define MESHDATA_H
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+#include "vec3.h"
+
+/*
+ * Vertex attributes, triangles and bounding box of a mesh. Everything here only touches memory, so a
+ * MeshData can be loaded, generated and processed on any thread and then handed to a TriangleMesh, which
+ * uploads it into MeshBuffers on the OpenGL thread.
+ */
+struct MeshData {
+    struct TexCoord { float u, v; };
+
+    std::vector<Vec3f> vertices;   // vertex positions
+    std::vector<Vec3f> normals;    // normals per vertex
+    std::vector<Vec3ui> triangles; // indices of vertices that form a triangle
+    std::vector<Vec3f> colors;     // r,g,b in [0,1]
+    std::vector<TexCoord> texCoords; // u,v in [0,1]
+    std::vector<Vec3f> tangents;   // tangent per vertex
+
+    // bounding box data
+    Vec3f boundingBoxMin{FLT_MAX, FLT_MAX, FLT_MAX};
+    Vec3f boundingBoxMax{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    Vec3f boundingBoxMid;
+    Vec3f boundingBoxSize;
+
+    // loadOFF() skipped calculateTexCoordsSphereMapping(), see TriangleMesh::setColoringMode()
+    bool texCoordsPending = false;
+
+    // clears all data
+    void clear();
+    // frees the attribute arrays and triangles, e.g. after they were uploaded. The bounding box stays.
+    void releaseArrays();
+    // bytes of the attribute arrays and triangles
+    size_t memoryBytes() const;
+
+    // Reads an OFF or NOFF file, calculates normals if not given in the file. Texture coordinates are
+    // only marked as pending. Returns false if the file can not be read.
+    bool loadOFF(const char* filename);
+    // unit sphere of latdiv rings with longdiv faces each (longdiv >= 4, latdiv >= 2)
+    void generateSphere(int longdiv, int latdiv);
+    // diamond-square terrain of (w+1) x (h+1) vertices, the same for the same seed
+    void generateTerrain(unsigned int h, unsigned int w, unsigned int seed);
+
+    // calculate normals, weighted by area
+    void calculateNormalsByArea();
+    // calculate texture coordinates by central projection, see MeshKernels::sphereTexCoords.
+    // Large meshes are processed on several threads.
+    void calculateTexCoordsSphereMapping();
+    // calculates axis aligned bounding box data
+    void calculateBB();
+
+    void flipNormals();
+    // translates vertices so that the bounding box center is at newBBmid
+    void translateToCenter(const Vec3f& newBBmid);
+    // scales vertices so that the largest bounding box size has length newLength
+    void scaleToLength(float newLength);
+};
+
+#endif // MESHDATA_H
@@ -0,0 +1,165 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Scalar mesh kernels and selection of the instruction set level   //
+// ========================================================================= //
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "log.h"
+#include "meshkernels.h"
+#include "vec3.h"
+
+static_assert(sizeof(Vec3f) == 3 * sizeof(float), "Vec3f arrays are passed to the kernels as float arrays");
+
+#if defined(GDV_SIMD_DISPATCH_X86)
+MeshKernels meshKernelsSSE42();
+MeshKernels meshKernelsAVX2();
+MeshKernels meshKernelsAVX512();
+#endif
+
+namespace {
+
+// reference implementations, also used on CPUs without SSE 4.2 and on other architectures
+
+void boundingBoxScalar(const float* xyz, size_t count, float min[3], float max[3])
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            min[c] = std::min(xyz[3 * i + c], min[c]);
+            max[c] = std::max(xyz[3 * i + c], max[c]);
+        }
+    }
+}
+
+void normalizeScalar(float* xyz, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        float* v = xyz + 3 * i;
+        const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (length < EPS)
+            continue;
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+void cullBoxesScalar(const float planes[24], const float* centers, size_t count, const float halfExtent[3], uint8_t* visible)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* center = centers + 3 * i;
+        bool inside = true;
+        for (int k = 0; k < 6 && inside; ++k)
+        {
+            const float* plane = planes + 4 * k;
+            const float distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+            const float radius = std::fabs(plane[0]) * halfExtent[0] + std::fabs(plane[1]) * halfExtent[1] + std::fabs(plane[2]) * halfExtent[2];
+            inside = distance + radius >= 0.0f;
+        }
+        visible[i] = inside ? 1 : 0;
+    }
+}
+
+void sphereTexCoordsScalar(const float* xyz, size_t count, const float center[3], float* uv)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float x = xyz[3 * i] - center[0], y = xyz[3 * i + 1] - center[1], z = xyz[3 * i + 2] - center[2];
+        const float length = std::sqrt(x * x + y * y + z * z);
+        uv[2 * i] = 0.159154943f * std::atan2(x, z) + 0.5f;
+        uv[2 * i + 1] = length > 0.0f ? 0.318309886f * std::asin(std::clamp(y / length, -1.0f, 1.0f)) : 0.0f;
+    }
+}
+
+size_t spheresTouchingBoxScalar(const float* x, const float* y, const float* z, const float* radius, size_t count,
+                                const float boxMin[3], const float boxMax[3], uint32_t* hits)
+{
+    size_t hitCount = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        // distance to the closest point of the box, zero on each axis within its range
+        const float dx = x[i] - std::clamp(x[i], boxMin[0], boxMax[0]);
+        const float dy = y[i] - std::clamp(y[i], boxMin[1], boxMax[1]);
+        const float dz = z[i] - std::clamp(z[i], boxMin[2], boxMax[2]);
+        if (dx * dx + dy * dy + dz * dz <= radius[i] * radius[i])
+            hits[hitCount++] = static_cast<uint32_t>(i);
+    }
+    return hitCount;
+}
+
+std::array<MeshKernels, static_cast<size_t>(SimdLevel::Count)> createTables()
+{
+    const MeshKernels scalar{SimdLevel::Scalar, boundingBoxScalar, normalizeScalar, cullBoxesScalar, sphereTexCoordsScalar,
+                             spheresTouchingBoxScalar};
+    std::array<MeshKernels, static_cast<size_t>(SimdLevel::Count)> tables;
+    tables.fill(scalar);
+#if defined(GDV_SIMD_DISPATCH_X86)
+    tables[static_cast<size_t>(SimdLevel::SSE42)] = meshKernelsSSE42();
+    tables[static_cast<size_t>(SimdLevel::AVX2)] = meshKernelsAVX2();
+    tables[static_cast<size_t>(SimdLevel::AVX512)] = meshKernelsAVX512();
+#endif
+    return tables;
+}
+
+} // namespace
+
+const MeshKernels& meshKernels(SimdLevel level)
+{
+    static const auto tables = createTables();
+    level = std::min(level, detectedSimdLevel());
+    return tables[static_cast<size_t>(level)];
+}
+
+const MeshKernels& meshKernels()
+{
+    static const MeshKernels& kernels = [] () -> const MeshKernels& {
+        const MeshKernels& selected = meshKernels(activeSimdLevel());
+        LOG_INFO(General, "mesh kernels: {} (CPU supports {})", simdLevelName(selected.level), simdLevelName(detectedSimdLevel()));
+        return selected;
+    }();
+    return kernels;
+}
+
+void parallelFor(size_t count, size_t minRange, const std::function<void(size_t, size_t)>& body)
+{
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t ranges = std::min(threads, count / std::max<size_t>(minRange, 1));
+    if (ranges <= 1)
+    {
+        if (count > 0)
+            body(0, count);
+        return;
+    }
+    const size_t rangeSize = (count + ranges - 1) / ranges;
+    std::vector<std::thread> workers;
+    workers.reserve(ranges - 1);
+    for (size_t begin = rangeSize; begin < count; begin += rangeSize)
+        workers.emplace_back(body, begin, std::min(count, begin + rangeSize));
+    body(0, rangeSize);
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void frustumPlanes(const float* m, float planes[24])
+{
+    // rows of the clip matrix: left, right, bottom, top, near, far = row 3 -+ row 0, 1, 2
+    for (int k = 0; k < 6; ++k)
+    {
+        const int row = k / 2;
+        const float sign = k % 2 == 0 ? 1.0f : -1.0f;
+        for (int column = 0; column < 4; ++column)
+            planes[4 * k + column] = m[4 * column + 3] + sign * m[4 * column + row];
+    }
+}
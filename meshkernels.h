@@ -0,0 +1,58 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Hot mesh kernels compiled for several instruction set levels,    //
+//          selected at startup                                              //
+// ========================================================================= //
+
+#ifndef MESHKERNELS_H
+#define MESHKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "cpufeatures.h"
+
+/*
+ * Function table of the kernels of one SimdLevel. Every level above Scalar is compiled in its own
+ * translation unit (meshkernels_<level>.cpp) with the matching compiler flags, from the same source in
+ * meshkernels_impl.h. The application only calls through meshKernels(), which uses activeSimdLevel().
+ *
+ * Arrays of Vec3f are passed as interleaved x, y, z floats.
+ */
+struct MeshKernels {
+    SimdLevel level;
+    // extends min and max by count points
+    void (*boundingBox)(const float* xyz, size_t count, float min[3], float max[3]);
+    // normalizes count vectors. Vectors shorter than EPS stay unchanged, like Vec3::normalize().
+    void (*normalize)(float* xyz, size_t count);
+    // Sets visible[i] to 0 if the box centers[i] +- halfExtent is completely outside one of the six planes
+    // (a, b, c, d each, outside where a * x + b * y + c * z + d < 0), otherwise to 1.
+    void (*cullBoxes)(const float planes[24], const float* centers, size_t count, const float halfExtent[3], uint8_t* visible);
+    // Texture coordinates (u, v interleaved) of the central projection of count points around center onto
+    // the unit sphere: u = atan2(x, z) / 2pi + 0.5, v = asin(y / length) / pi. The SIMD levels are within
+    // 2e-6 of the exact values, except close to the poles, where asin amplifies the rounding of y / length.
+    void (*sphereTexCoords)(const float* xyz, size_t count, const float center[3], float* uv);
+    // Writes the indices of the spheres (x[i], y[i], z[i]) with radius[i] that touch the box from boxMin to
+    // boxMax into hits, in ascending order, and returns their number. hits needs room for count indices.
+    size_t (*spheresTouchingBox)(const float* x, const float* y, const float* z, const float* radius, size_t count,
+                                 const float boxMin[3], const float boxMax[3], uint32_t* hits);
+};
+
+// kernels of activeSimdLevel()
+const MeshKernels& meshKernels();
+// kernels of this level, or of the highest level below it that the CPU supports, e.g. for benchmarks
+const MeshKernels& meshKernels(SimdLevel level);
+
+// Calls body(begin, end) for consecutive ranges of [0, count) on several threads and returns when all are
+// done. Ranges have at least minRange elements, so small counts run on the calling thread only.
+void parallelFor(size_t count, size_t minRange, const std::function<void(size_t, size_t)>& body);
+
+// the six frustum planes of the column-major matrix clip = projection * modelView, for cullBoxes()
+void frustumPlanes(const float* clip, float planes[24]);
+
+#endif // MESHKERNELS_H
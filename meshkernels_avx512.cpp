@@ -0,0 +1,20 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Mesh kernels compiled for AVX-512F and DQ                        //
+// ========================================================================= //
+
+#if defined(GDV_SIMD_DISPATCH_X86)
+
+#if !defined(_MSC_VER) && !defined(__AVX512DQ__)
+#error "compile meshkernels_avx512.cpp with the flags of its instruction set level, see CMakeLists.txt"
+#endif
+
+#define GDV_MESH_KERNELS_LEVEL SimdLevel::AVX512
+#define GDV_MESH_KERNELS_FUNCTION meshKernelsAVX512
+#include "meshkernels_impl.h"
+
+#endif // GDV_SIMD_DISPATCH_X86
@@ -0,0 +1,194 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Source of the SIMD mesh kernels, included once per instruction   //
+//          set level                                                        //
+// ========================================================================= //
+
+// Included by meshkernels_<level>.cpp after defining
+//   GDV_MESH_KERNELS_LEVEL     the SimdLevel of the file
+//   GDV_MESH_KERNELS_FUNCTION  the name of the function returning the table
+// The kernels use simd::FloatxN, the widest batch of the flags the file is compiled with.
+//
+// Only call functions defined here or in vec3simd.h. Other inline functions, e.g. of <algorithm>, <cmath>
+// or vec3.h, are also instantiated by files compiled without the flags. The linker keeps one of the
+// copies, and if it is the one of this file, code for older CPUs would run AVX instructions.
+
+#include <cfloat>
+
+#include "meshkernels.h"
+#include "vec3simd.h"
+
+namespace {
+
+using F = simd::FloatxN;
+constexpr size_t W = F::width;
+
+// x, y and z of up to W points of xyz into separate arrays, missing lanes are zero
+inline void deinterleave(const float* xyz, size_t n, float* x, float* y, float* z)
+{
+    for (size_t j = 0; j < W; ++j)
+    {
+        x[j] = j < n ? xyz[3 * j] : 0.0f;
+        y[j] = j < n ? xyz[3 * j + 1] : 0.0f;
+        z[j] = j < n ? xyz[3 * j + 2] : 0.0f;
+    }
+}
+
+void boundingBox(const float* xyz, size_t count, float boxMin[3], float boxMax[3])
+{
+    // W points are 3 batches, lane j of batch r holds component (r * W + j) % 3
+    F lo[3] = {F(FLT_MAX), F(FLT_MAX), F(FLT_MAX)};
+    F hi[3] = {F(-FLT_MAX), F(-FLT_MAX), F(-FLT_MAX)};
+    size_t i = 0;
+    for (; i + W <= count; i += W)
+    {
+        const float* p = xyz + 3 * i;
+        for (size_t r = 0; r < 3; ++r)
+        {
+            const F v = F::load(p + r * W);
+            lo[r] = min(lo[r], v);
+            hi[r] = max(hi[r], v);
+        }
+    }
+    alignas(64) float lanes[W];
+    for (size_t r = 0; r < 3; ++r)
+    {
+        lo[r].store(lanes);
+        for (size_t j = 0; j < W; ++j)
+        {
+            float& m = boxMin[(r * W + j) % 3];
+            m = lanes[j] < m ? lanes[j] : m;
+        }
+        hi[r].store(lanes);
+        for (size_t j = 0; j < W; ++j)
+        {
+            float& m = boxMax[(r * W + j) % 3];
+            m = lanes[j] > m ? lanes[j] : m;
+        }
+    }
+    for (; i < count; ++i)
+    {
+        for (size_t c = 0; c < 3; ++c)
+        {
+            const float v = xyz[3 * i + c];
+            boxMin[c] = v < boxMin[c] ? v : boxMin[c];
+            boxMax[c] = v > boxMax[c] ? v : boxMax[c];
+        }
+    }
+}
+
+void normalize(float* xyz, size_t count)
+{
+    alignas(64) float x[W], y[W], z[W];
+    for (size_t i = 0; i < count; i += W)
+    {
+        float* p = xyz + 3 * i;
+        const size_t n = count - i < W ? count - i : W;
+        deinterleave(p, n, x, y, z);
+        simd::Vec3xNf::loadSoA(x, y, z).normalized().storeSoA(x, y, z);
+        for (size_t j = 0; j < n; ++j)
+        {
+            p[3 * j] = x[j];
+            p[3 * j + 1] = y[j];
+            p[3 * j + 2] = z[j];
+        }
+    }
+}
+
+void cullBoxes(const float planes[24], const float* centers, size_t count, const float halfExtent[3], uint8_t* visible)
+{
+    // distance of the corner farthest inside: center distance + |a| * hx + |b| * hy + |c| * hz
+    F a[6], b[6], c[6], d[6];
+    for (int k = 0; k < 6; ++k)
+    {
+        const float* plane = planes + 4 * k;
+        const float radius = (plane[0] < 0.0f ? -plane[0] : plane[0]) * halfExtent[0]
+                           + (plane[1] < 0.0f ? -plane[1] : plane[1]) * halfExtent[1]
+                           + (plane[2] < 0.0f ? -plane[2] : plane[2]) * halfExtent[2];
+        a[k] = F(plane[0]);
+        b[k] = F(plane[1]);
+        c[k] = F(plane[2]);
+        d[k] = F(plane[3] + radius);
+    }
+    alignas(64) float x[W], y[W], z[W];
+    for (size_t i = 0; i < count; i += W)
+    {
+        const size_t n = count - i < W ? count - i : W;
+        deinterleave(centers + 3 * i, n, x, y, z);
+        const F cx = F::load(x), cy = F::load(y), cz = F::load(z);
+        F inside = F(0.0f) == F(0.0f);
+        for (int k = 0; k < 6; ++k)
+            inside = inside & (fma(a[k], cx, fma(b[k], cy, fma(c[k], cz, d[k]))) >= F(0.0f));
+        const int mask = movemask(inside);
+        for (size_t j = 0; j < n; ++j)
+            visible[i + j] = static_cast<uint8_t>((mask >> j) & 1);
+    }
+}
+
+void sphereTexCoords(const float* xyz, size_t count, const float center[3], float* uv)
+{
+    const F mx(center[0]), my(center[1]), mz(center[2]);
+    alignas(64) float x[W], y[W], z[W];
+    alignas(64) float u[W], v[W];
+    for (size_t i = 0; i < count; i += W)
+    {
+        const size_t n = count - i < W ? count - i : W;
+        deinterleave(xyz + 3 * i, n, x, y, z);
+        const F dx = F::load(x) - mx, dy = F::load(y) - my, dz = F::load(z) - mz;
+        const F squaredLength = fma(dx, dx, fma(dy, dy, dz * dz));
+        const F inverseLength = select(squaredLength > F(0.0f), simd::rsqrt(squaredLength), F(0.0f));
+        fma(F(0.159154943f), simd::atan2(dx, dz), F(0.5f)).store(u);
+        (F(0.318309886f) * simd::asin(min(max(dy * inverseLength, F(-1.0f)), F(1.0f)))).store(v);
+        for (size_t j = 0; j < n; ++j)
+        {
+            uv[2 * (i + j)] = u[j];
+            uv[2 * (i + j) + 1] = v[j];
+        }
+    }
+}
+
+size_t spheresTouchingBox(const float* x, const float* y, const float* z, const float* radius, size_t count,
+                          const float boxMin[3], const float boxMax[3], uint32_t* hits)
+{
+    const F minX(boxMin[0]), minY(boxMin[1]), minZ(boxMin[2]);
+    const F maxX(boxMax[0]), maxY(boxMax[1]), maxZ(boxMax[2]);
+    alignas(64) float tail[4][W];
+    size_t hitCount = 0;
+    for (size_t i = 0; i < count; i += W)
+    {
+        const size_t n = count - i < W ? count - i : W;
+        const float* lanes[4] = {x + i, y + i, z + i, radius + i};
+        if (n < W)
+        {
+            // missing lanes are zero and masked out below
+            for (size_t k = 0; k < 4; ++k)
+            {
+                for (size_t j = 0; j < W; ++j)
+                    tail[k][j] = j < n ? lanes[k][j] : 0.0f;
+                lanes[k] = tail[k];
+            }
+        }
+        const F cx = F::load(lanes[0]), cy = F::load(lanes[1]), cz = F::load(lanes[2]), r = F::load(lanes[3]);
+        const F dx = cx - min(max(cx, minX), maxX);
+        const F dy = cy - min(max(cy, minY), maxY);
+        const F dz = cz - min(max(cz, minZ), maxZ);
+        int mask = movemask(fma(dx, dx, fma(dy, dy, dz * dz)) <= r * r);
+        for (size_t j = 0; j < n && mask != 0; ++j, mask >>= 1)
+        {
+            if (mask & 1)
+                hits[hitCount++] = static_cast<uint32_t>(i + j);
+        }
+    }
+    return hitCount;
+}
+
+} // namespace
+
+MeshKernels GDV_MESH_KERNELS_FUNCTION()
+{
+    return MeshKernels{GDV_MESH_KERNELS_LEVEL, boundingBox, normalize, cullBoxes, sphereTexCoords, spheresTouchingBox};
+}
@@ -0,0 +1,20 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Mesh kernels compiled for SSE 4.2                                //
+// ========================================================================= //
+
+#if defined(GDV_SIMD_DISPATCH_X86)
+
+#if !defined(_MSC_VER) && !defined(__SSE4_2__)
+#error "compile meshkernels_sse42.cpp with the flags of its instruction set level, see CMakeLists.txt"
+#endif
+
+#define GDV_MESH_KERNELS_LEVEL SimdLevel::SSE42
+#define GDV_MESH_KERNELS_FUNCTION meshKernelsSSE42
+#include "meshkernels_impl.h"
+
+#endif // GDV_SIMD_DISPATCH_X86
@@ -0,0 +1,224 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Micro benchmarks of the CPU side mesh kernels. Links only the    //
+//          OpenGL free uebung_03_core and QtCore                            //
+// ========================================================================= //
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+#include "benchrunner.h"
+#include "cpufeatures.h"
+#include "meshdata.h"
+#include "meshkernels.h"
+#include "vec3.h"
+
+namespace {
+
+// Writes a regular grid of (n+1)^2 vertices and 2n^2 triangles as OFF file.
+std::string writeSyntheticOFF(unsigned int n)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / ("microbench_grid_" + std::to_string(n) + ".off");
+    std::ofstream out(path);
+    out << "OFF\n" << (n + 1) * (n + 1) << " " << 2 * n * n << " 0\n";
+    for (unsigned int z = 0; z <= n; ++z)
+        for (unsigned int x = 0; x <= n; ++x)
+            out << x << " " << std::sin(0.1f * x) * std::cos(0.1f * z) << " " << z << "\n";
+    for (unsigned int z = 0; z < n; ++z)
+    {
+        for (unsigned int x = 0; x < n; ++x)
+        {
+            const unsigned int i0 = z * (n + 1) + x;
+            const unsigned int i2 = i0 + n + 1;
+            out << "3 " << i0 << " " << i2 << " " << i0 + 1 << "\n";
+            out << "3 " << i0 + 1 << " " << i2 << " " << i2 + 1 << "\n";
+        }
+    }
+    return path.string();
+}
+
+void benchmarkMesh(BenchmarkRunner &runner, const QString &meshName, const std::string &fileName)
+{
+    MeshData mesh;
+    runner.run(QStringLiteral("loadOFF/%1").arg(meshName), [&] { mesh.loadOFF(fileName.c_str()); });
+    const double vertexCount = mesh.vertices.size();
+    const double triangleCount = mesh.triangles.size();
+    if (vertexCount == 0)
+    {
+        std::cerr << "microbench: could not load " << fileName << std::endl;
+        return;
+    }
+    runner.run(QStringLiteral("calculateNormalsByArea/%1").arg(meshName), [&] { mesh.calculateNormalsByArea(); }, triangleCount,
+               [&] { mesh.normals.clear(); });
+    runner.run(QStringLiteral("calculateTexCoordsSphereMapping/%1").arg(meshName), [&] { mesh.calculateTexCoordsSphereMapping(); }, vertexCount);
+    runner.run(QStringLiteral("calculateBB/%1").arg(meshName), [&] { mesh.calculateBB(); }, vertexCount);
+}
+
+void benchmarkTerrain(BenchmarkRunner &runner)
+{
+    for (unsigned int size : {64u, 128u, 256u, 512u})
+    {
+        MeshData terrain;
+        runner.run(QStringLiteral("generateTerrain/%1").arg(size), [&] { terrain.generateTerrain(size, size, 42); },
+                   static_cast<double>(size + 1) * (size + 1));
+    }
+}
+
+// Column major projection * view matrix of the interactive application with its default camera:
+// perspective(65, 16 / 9, 0.5, 10000) * lookAt((0, 0, -3), (0, 0, -4), (0, 1, 0)) of QMatrix4x4. The camera
+// looks along -z, so the view matrix is only a translation by 3 along z.
+void defaultCameraClipMatrix(float clip[16])
+{
+    const float nearPlane = 0.5f, farPlane = 10000.0f;
+    const float cotangent = 1.0f / std::tan(65.0f / 2.0f * 3.14159265f / 180.0f);
+    const float depthScale = -(nearPlane + farPlane) / (farPlane - nearPlane);
+    const float depthOffset = -2.0f * nearPlane * farPlane / (farPlane - nearPlane);
+    for (int i = 0; i < 16; ++i)
+        clip[i] = 0.0f;
+    clip[0] = cotangent / (16.0f / 9.0f);
+    clip[5] = cotangent;
+    clip[10] = depthScale;
+    clip[11] = -1.0f;
+    clip[14] = 3.0f * depthScale + depthOffset;
+    clip[15] = -3.0f;
+}
+
+// The dispatched mesh kernels at every instruction set level the CPU supports
+void benchmarkKernels(BenchmarkRunner &runner)
+{
+    const size_t count = 1000000;
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> dist(-50.0f, 50.0f);
+    std::vector<float> points(3 * count);
+    for (auto &value : points)
+        value = dist(gen);
+    std::vector<float> vectors(points.size());
+    std::vector<uint8_t> visible(count);
+    std::vector<float> texCoords(2 * count);
+    const float center[3] = {0.0f, 0.0f, 0.0f};
+
+    // same frustum as boundingBoxIsVisible in microbench_render
+    float clip[16];
+    defaultCameraClipMatrix(clip);
+    float planes[24];
+    frustumPlanes(clip, planes);
+    const float halfExtent[3] = {1.0f, 1.0f, 1.0f};
+
+    // spheres of radius 2 in structure of arrays layout against a box of a fifth of the volume, about a
+    // quarter of them touch it
+    std::vector<float> sphereX(count), sphereY(count), sphereZ(count), sphereRadius(count, 2.0f);
+    for (size_t i = 0; i < count; ++i)
+    {
+        sphereX[i] = points[3 * i];
+        sphereY[i] = points[3 * i + 1];
+        sphereZ[i] = points[3 * i + 2];
+    }
+    std::vector<uint32_t> hits(count);
+    const float boxMin[3] = {-30.0f, -30.0f, -30.0f}, boxMax[3] = {30.0f, 30.0f, 30.0f};
+
+    for (int level = 0; level <= static_cast<int>(detectedSimdLevel()); ++level)
+    {
+        const MeshKernels &kernels = meshKernels(static_cast<SimdLevel>(level));
+        const QString name = QString::fromLatin1(simdLevelName(kernels.level));
+        runner.run(QStringLiteral("kernels/boundingBox/%1").arg(name), [&] {
+            float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+            kernels.boundingBox(points.data(), count, min, max);
+            doNotOptimize(min[0]);
+            doNotOptimize(max[0]);
+        }, count);
+        runner.run(QStringLiteral("kernels/normalize/%1").arg(name), [&] { kernels.normalize(vectors.data(), count); }, count,
+                   [&] { vectors = points; });
+        runner.run(QStringLiteral("kernels/cullBoxes/%1").arg(name), [&] {
+            kernels.cullBoxes(planes, points.data(), count, halfExtent, visible.data());
+            doNotOptimize(visible.data());
+        }, count);
+        runner.run(QStringLiteral("kernels/sphereTexCoords/%1").arg(name), [&] {
+            kernels.sphereTexCoords(points.data(), count, center, texCoords.data());
+            doNotOptimize(texCoords.data());
+        }, count);
+        runner.run(QStringLiteral("kernels/spheresTouchingBox/%1").arg(name), [&] {
+            const size_t hitCount = kernels.spheresTouchingBox(sphereX.data(), sphereY.data(), sphereZ.data(), sphereRadius.data(),
+                                                               count, boxMin, boxMax, hits.data());
+            doNotOptimize(hitCount);
+        }, count);
+    }
+}
+
+void benchmarkVec3(BenchmarkRunner &runner)
+{
+    const size_t count = 1 << 20;
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<Vec3f> a(count), b(count), result(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        a[i] = Vec3f(dist(gen), dist(gen), dist(gen));
+        b[i] = Vec3f(dist(gen), dist(gen), dist(gen));
+    }
+
+    runner.run(QStringLiteral("Vec3f/add_scale"), [&] {
+        for (size_t i = 0; i < count; ++i)
+            result[i] = a[i] + 0.5f * b[i];
+        doNotOptimize(result.data());
+    }, count);
+    runner.run(QStringLiteral("Vec3f/dot"), [&] {
+        float sum = 0.0f;
+        for (size_t i = 0; i < count; ++i)
+            sum += a[i] * b[i];
+        doNotOptimize(sum);
+    }, count);
+    runner.run(QStringLiteral("Vec3f/cross"), [&] {
+        for (size_t i = 0; i < count; ++i)
+            result[i] = cross(a[i], b[i]);
+        doNotOptimize(result.data());
+    }, count);
+    runner.run(QStringLiteral("Vec3f/normalize"), [&] {
+        for (size_t i = 0; i < count; ++i)
+            result[i].normalize();
+        doNotOptimize(result.data());
+    }, count, [&] { result = a; });
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("microbench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Micro benchmarks of the CPU side mesh kernels."));
+    parser.addHelpOption();
+    const BenchmarkOptions options;
+    options.addTo(parser);
+    const QCommandLineOption gridOption(QStringLiteral("synthetic-size"), QStringLiteral("Cells per side of the synthetic OFF grid."), QStringLiteral("n"), QStringLiteral("700"));
+    parser.addOption(gridOption);
+    parser.process(app);
+
+    BenchmarkRunner runner = options.runner(parser);
+
+    benchmarkMesh(runner, QStringLiteral("doppeldecker"), "../Models/doppeldecker.off");
+    const unsigned int syntheticSize = std::max(1, parser.value(gridOption).toInt());
+    const std::string syntheticFile = writeSyntheticOFF(syntheticSize);
+    benchmarkMesh(runner, QStringLiteral("grid%1").arg(syntheticSize), syntheticFile);
+    std::remove(syntheticFile.c_str());
+    benchmarkTerrain(runner);
+    benchmarkKernels(runner);
+    benchmarkVec3(runner);
+
+    return options.writeReport(parser, runner, "microbench");
+}
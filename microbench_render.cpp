@@ -0,0 +1,162 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Micro benchmarks of the CPU side of drawing: frustum culling,    //
+//          static batches and the matrix stack. Needs no OpenGL context     //
+// ========================================================================= //
+
+#include <random>
+#include <stack>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QMatrix4x4>
+
+#include "benchrunner.h"
+#include "meshdata.h"
+#include "renderstate.h"
+#include "staticbatch.h"
+#include "trianglemesh.h"
+#include "vec3.h"
+
+namespace {
+
+void benchmarkStaticBatch(BenchmarkRunner &runner)
+{
+    MeshData mesh;
+    mesh.loadOFF("../Models/doppeldecker.off");
+    mesh.calculateTexCoordsSphereMapping();
+    // accumulated random positions like the scene
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> dist(-5.0f, 5.0f);
+    std::vector<Vec3f> translations;
+    Vec3f offset(0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < 250; ++i)
+    {
+        const float x = dist(generator);
+        const float y = dist(generator);
+        const float z = dist(generator);
+        offset += Vec3f(x, y, z);
+        translations.push_back(offset);
+    }
+
+    for (size_t count : {15u, 100u, 250u})
+    {
+        const std::vector<Vec3f> instances(translations.begin(), translations.begin() + count);
+        const std::vector<Vec3f> fewer(translations.begin(), translations.begin() + count - 5);
+        StaticBatch batch;
+        batch.setSource(mesh);
+        const double vertices = static_cast<double>(count) * mesh.vertices.size();
+        // setSource() drops all clusters, so every instance is transformed again
+        runner.run(QStringLiteral("staticBatch/build/%1").arg(count), [&] { batch.setSource(mesh); batch.setInstances(instances); }, vertices);
+        // one grid size step down and up again, only the clusters of the last five instances change
+        runner.run(QStringLiteral("staticBatch/grow/%1").arg(count), [&] { batch.setInstances(fewer); batch.setInstances(instances); }, vertices);
+    }
+}
+
+void benchmarkCulling(BenchmarkRunner &runner)
+{
+    TriangleMesh mesh;
+    mesh.loadOFF("../Models/doppeldecker.off", false);
+
+    // same projection and default camera as the interactive application
+    RenderState state;
+    state.getCurrentProjectionMatrix().perspective(65.f, 16.f / 9.f, 0.5f, 10000.f);
+    state.lookAt(QVector3D(0.0f, 0.0f, -3.0f), QVector3D(0.0f, 0.0f, -4.0f), QVector3D(0.0f, 1.0f, 0.0f));
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dist(-50.0f, 50.0f);
+    for (unsigned int instances : {1000u, 10000u, 100000u})
+    {
+        std::vector<Vec3f> positions(instances);
+        for (auto &p : positions)
+            p = Vec3f(dist(gen), dist(gen), dist(gen));
+        runner.run(QStringLiteral("boundingBoxIsVisible/%1").arg(instances), [&] {
+            unsigned int visible = 0;
+            for (const auto &p : positions)
+            {
+                state.pushModelViewMatrix();
+                state.translateModelViewMatrix(p.x(), p.y(), p.z());
+                visible += mesh.boundingBoxIsVisible(state) ? 1 : 0;
+                state.popModelViewMatrix();
+            }
+            doNotOptimize(visible);
+        }, instances);
+    }
+}
+
+// The matrix work of the per instance loop of Scene::render: push, translate, model view and normal
+// matrix for the draw, culling matrix, pop. Compared with the std::stack and QMatrix4x4 functions it replaces.
+void benchmarkMatrices(BenchmarkRunner &runner)
+{
+    const unsigned int instances = 10000;
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> dist(-50.0f, 50.0f);
+    std::vector<Vec3f> positions(instances);
+    for (auto &p : positions)
+        p = Vec3f(dist(gen), dist(gen), dist(gen));
+    const QVector3D eye(0.0f, 0.0f, -3.0f), center(0.0f, 0.0f, -4.0f), up(0.0f, 1.0f, 0.0f);
+
+    RenderState state;
+    state.getCurrentProjectionMatrix().perspective(65.f, 16.f / 9.f, 0.5f, 10000.f);
+    runner.run(QStringLiteral("matrices/MatrixStack/%1").arg(instances), [&] {
+        state.loadIdentityModelViewMatrix();
+        state.lookAt(eye, center, up);
+        float sum = 0.0f;
+        for (const auto &p : positions)
+        {
+            state.pushModelViewMatrix();
+            state.translateModelViewMatrix(p.x(), p.y(), p.z());
+            const QMatrix4x4 clip = multiplyMatrices(state.getCurrentProjectionMatrix(), state.getCurrentModelViewMatrix());
+            sum += clip.constData()[15] + state.calculateNormalMatrix().constData()[0] + state.getCurrentModelViewMatrix().constData()[12];
+            state.popModelViewMatrix();
+        }
+        doNotOptimize(sum);
+    }, instances);
+
+    std::stack<QMatrix4x4> modelView;
+    QMatrix4x4 projection;
+    projection.perspective(65.f, 16.f / 9.f, 0.5f, 10000.f);
+    runner.run(QStringLiteral("matrices/std::stack/%1").arg(instances), [&] {
+        modelView = std::stack<QMatrix4x4>();
+        modelView.emplace();
+        modelView.top().lookAt(eye, center, up);
+        float sum = 0.0f;
+        for (const auto &p : positions)
+        {
+            modelView.push(modelView.top());
+            modelView.top().translate(p.x(), p.y(), p.z());
+            const QMatrix4x4 clip = projection * modelView.top();
+            sum += clip.constData()[15] + modelView.top().normalMatrix().constData()[0] + modelView.top().constData()[12];
+            modelView.pop();
+        }
+        doNotOptimize(sum);
+    }, instances);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("microbench_render"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Micro benchmarks of the CPU side of drawing."));
+    parser.addHelpOption();
+    const BenchmarkOptions options;
+    options.addTo(parser);
+    parser.process(app);
+
+    BenchmarkRunner runner = options.runner(parser);
+
+    benchmarkCulling(runner);
+    benchmarkStaticBatch(runner);
+    benchmarkMatrices(runner);
+
+    return options.writeReport(parser, runner, "microbench_render");
+}
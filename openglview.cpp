@@ -10,29 +10,17 @@
 // ========================================================================= //
 
 #include <cmath>
+#include <thread>
 
-#include <QtDebug>
+#include <QFile>
+#include <QJsonDocument>
 #include <QMatrix4x4>
-#include <QOpenGLVersionFunctionsFactory>
 
+#include "log.h"
+#include "profiler.h"
 #include "shader.h"
 #include "openglview.h"
-
-GLuint OpenGLView::csVAO = 0;
-GLuint OpenGLView::csVBOs[2] = {0, 0};
-
-void OpenGLView::generateRandomPosition(int newObjectCount)
-{
-
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_real_distribution<float> dist(-5.0f, 5.0f);
-
-    for (int i = 0; i < 500; i++)
-    {
-        objectPositions.push_back(Vec3f(dist(gen), dist(gen), dist(gen)));
-    }
-}
+#include "utilities.h"
 
 OpenGLView::OpenGLView(QWidget *parent) : QOpenGLWidget(parent)
 {
@@ -42,280 +30,286 @@ OpenGLView::OpenGLView(QWidget *parent) : QOpenGLWidget(parent)
     fpsCounterTimer.setInterval(1000);
     fpsCounterTimer.setSingleShot(false);
     fpsCounterTimer.start();
+    cpuUsageClock.start();
+    cpuSecondsAtLastRefresh = processCpuSeconds();
+
+    connect(&pacingTimer, &QTimer::timeout, this, &OpenGLView::paceFrame);
+    pacingTimer.setTimerType(Qt::PreciseTimer);
+    pacingTimer.setSingleShot(true);
+    pacingClock.start();
 }
 
 void OpenGLView::setGridSize(int gridSize)
 {
-    this->gridSize = gridSize;
+    scene.setGridSize(gridSize);
     emit triangleCountChanged(getTriangleCount());
+    requestFrame();
 }
 
 void OpenGLView::initializeGL()
 {
-    generateRandomPosition(500);
-    f = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_3_Core>(QOpenGLContext::currentContext());
+    PROFILE_BEGIN("initializeGL");
+    glFunctions.initializeOpenGLFunctions();
+    f = &glFunctions;
     const GLubyte *versionString = f->glGetString(GL_VERSION);
-    std::cout << "The current OpenGL version is: " << versionString << std::endl;
-    state.setOpenGLFunctions(f);
-
-    // black screen
-    f->glClearColor(0.f, 0.f, 0.f, 1.f);
-    // enable depth buffer
-    f->glEnable(GL_DEPTH_TEST);
-
-    GLuint testTexture = loadImageIntoTexture(f, "../Textures/TEST_GRID.bmp");
-
-    GLuint diffuseTexture = loadImageIntoTexture(f, "../Textures/rough_block_wall_diff_1k.jpg", true);
-    GLuint normalTexture = loadImageIntoTexture(f, "../Textures/rough_block_wall_nor_1k.jpg", true);
-    GLuint displacementTexture = loadImageIntoTexture(f, "../Textures/rough_block_wall_disp_1k.jpg", true);
-
-    // Load the sphere of the light
-    sphereMesh.setGLFunctionPtr(f);
-    sphereMesh.loadOFF("../Models/sphere.off");
-    sphereMesh.setStaticColor(Vec3f(1.0f, 1.0f, 0.0f));
-
-    // load meshes
-    meshes.emplace_back(f);
-    meshes[0].loadOFF("../Models/doppeldecker.off");
-    meshes[0].setStaticColor(Vec3f(0.0f, 1.0f, 0.0f));
-    meshes[0].setTexture(testTexture);
-    meshes[0].setColoringMode(TriangleMesh::ColoringType::TEXTURE);
-
-    meshes.emplace_back(f);
-    meshes[1].generateTerrain(50, 50, 4000);
-    meshes[1].setStaticColor(Vec3f(1.f, 1.f, 0.f));
-    meshes[1].setColoringMode(TriangleMesh::ColoringType::COLOR_ARRAY);
-
-    bumpSphereMesh.generateSphere(f);
-    bumpSphereMesh.setStaticColor(Vec3f(0.8f, 0.8f, 0.8f));
-    bumpSphereMesh.setColoringMode(TriangleMesh::ColoringType::BUMP_MAPPING);
-    bumpSphereMesh.setTexture(diffuseTexture);
-    bumpSphereMesh.setNormalTexture(normalTexture);
-    bumpSphereMesh.setDisplacementTexture(displacementTexture);
-
-    // load coordinate system
-    csVAO = genCSVAO();
-
-    // load shaders
-    GLuint lightShaderID = readShaders(f, "../Shader/only_mvp.vert", "../Shader/constant_color.frag");
-    if (lightShaderID)
-    {
-        programIDs.push_back(lightShaderID);
-        state.setStandardProgram(lightShaderID);
-    }
-    GLuint shaderID = readShaders(f, "../Shader/only_mvp.vert", "../Shader/lambert.frag");
-    if (shaderID != 0)
-        programIDs.push_back(shaderID);
-    currentProgramID = lightShaderID;
+    LOG_INFO(Render, "The current OpenGL version is: {}", versionString);
 
-    bumpProgramID = readShaders(f, "../Shader/bump.vert", "../Shader/bump.frag");
+    scene.initialize(f);
+    glInitialized = true;
 
     emit shaderCompiled(0);
     emit shaderCompiled(1);
+    PROFILE_END("initializeGL");
+    Profiler::markStartupComplete();
+    // everything between two frames is spent in the event loop of Qt (input, timers, buffer swap)
+    PROFILE_BEGIN("Qt event loop");
 }
 
 void OpenGLView::resizeGL(int width, int height)
 {
-    // Calculate new projection matrix
-    const float aspectRatio = static_cast<float>(width) / static_cast<float>(height);
-    state.loadIdentityProjectionMatrix();
-    state.getCurrentProjectionMatrix().perspective(65.f, aspectRatio, 0.5f, 10000.f);
-
-    // set projection matrix in OpenGL shader
-    state.switchToStandardProgram();
-    f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
-    state.setCurrentProgram(bumpProgramID);
-    f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
-    for (GLuint progID : programIDs)
-    {
-        state.setCurrentProgram(progID);
-        f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
-    }
-
-    // Resize viewport
-    f->glViewport(0, 0, width, height);
+    scene.resize(width, height);
 }
 
-void OpenGLView::drawSkybox()
+void OpenGLView::paintGL()
 {
-    // TODO(3.2): Draw a skybox
+    PROFILE_END("Qt event loop");
+    const uint64_t now = Profiler::now();
+    const double frameMs = frameBegin != 0 ? (now - frameBegin) / 1e6 : 0.0;
+    if (frameBegin != 0 && hitchDetector.frameFinished(frameBegin, now))
+        LOG_WARNING(Render, "Hitch: frame took {} ms", frameMs);
+    frameBegin = now;
+    PROFILE_BEGIN("paintGL");
+    if (captureFramesLeft > 0 && !f->isCapturing())
+        f->beginCapture(&capture);
+    if (replaying)
+    {
+        // the recording also contains the light position, so nothing depends on the time between frames
+        const CameraPathFrame &frame = replayPath.frames[replayFrame];
+        cameraPos = frame.cameraPos;
+        cameraDir = frame.cameraDir;
+        scene.applyState(frame);
+    }
+    else if (lightMoves)
+    {
+        moveLight();
+    }
+
+    LOG_TRACE(Render, "Object count {}", scene.getObjectPositions().size());
+    const Scene::FrameStats stats = scene.render(cameraPos, cameraDir);
+    const double cpuMs = (Profiler::now() - now) / 1e6;
+    if (qualityGovernor.update(cpuMs, scene.getGpuTimer().getLastFrameMs()))
+    {
+        scene.setQualitySettings(qualityGovernor.getSettings());
+        emit qualityLevelChanged(qualityGovernor.getLevel(), qualityGovernor.getSettings().renderScale);
+    }
+    recordFrame(stats, frameMs, cpuMs);
+    if (f->isCapturing())
+    {
+        f->endCaptureFrame();
+        if (--captureFramesLeft == 0)
+        {
+            f->endCapture();
+            const bool success = capture.save(captureFileName);
+            LOG_INFO(Capture, "Captured {} frames with {} OpenGL calls", capture.frameCount(), capture.commands.size());
+            capture.clear();
+            emit captureFinished(captureFileName, success);
+        }
+    }
+    mesh_culled = stats.objectsCulled;
 
-    // shader configuration and activation
-    GLuint skybox_shaderID = readShaders(f, "../Shader/skybox1.vert", "../Shader/skybox1.frag");
-    if (skybox_shaderID != 0)
+    // cout number of objects and triangles if different from last run
+    if (stats.trianglesDrawn != trianglesLastRun)
     {
-        state.setCurrentProgram(skybox_shaderID);
+        trianglesLastRun = stats.trianglesDrawn;
+        emit triangleCountChanged(stats.trianglesDrawn);
     }
+    mesh_drawn = stats.objectsDrawn;
+    LOG_TRACE(Render, "Number of Objects Culled: {}, Drawn: {}", mesh_culled, mesh_drawn);
 
-    f->glUniform1i(f->glGetUniformLocation(skybox_shaderID, "skybox"), 0);
-
-    // load cubemap imgs
-    const char *filename[6] = {
-        "../Textures/skybox1/pos_x.bmp",
-        "../Textures/skybox1/neg_x.bmp",
-        "../Textures/skybox1/pos_y.bmp",
-        "../Textures/skybox1/neg_y.bmp",
-        "../Textures/skybox1/pos_z.bmp",
-        "../Textures/skybox1/neg_z.bmp"};
-
-    GLuint cubemap_texture = loadCubeMap(f, filename);
-
-    // set buffers
-#define SKY_SIZE 20.0f
-    float skyboxVertices[] = {
-        // positions
-        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
-        -SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
-        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
-        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
-        SKY_SIZE, SKY_SIZE, -SKY_SIZE,
-        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
-
-        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
-        -SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
-        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
-        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
-        -SKY_SIZE, SKY_SIZE, SKY_SIZE,
-        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
-
-        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
-        SKY_SIZE, -SKY_SIZE, SKY_SIZE,
-        SKY_SIZE, SKY_SIZE, SKY_SIZE,
-        SKY_SIZE, SKY_SIZE, SKY_SIZE,
-        SKY_SIZE, SKY_SIZE, -SKY_SIZE,
-        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
-
-        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
-        -SKY_SIZE, SKY_SIZE, SKY_SIZE,
-        SKY_SIZE, SKY_SIZE, SKY_SIZE,
-        SKY_SIZE, SKY_SIZE, SKY_SIZE,
-        SKY_SIZE, -SKY_SIZE, SKY_SIZE,
-        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
-
-        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
-        SKY_SIZE, SKY_SIZE, -SKY_SIZE,
-        SKY_SIZE, SKY_SIZE, SKY_SIZE,
-        SKY_SIZE, SKY_SIZE, SKY_SIZE,
-        -SKY_SIZE, SKY_SIZE, SKY_SIZE,
-        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
-
-        -SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
-        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
-        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
-        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
-        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
-        SKY_SIZE, -SKY_SIZE, SKY_SIZE};
-    unsigned int skyboxVAO, skyboxVBO;
-    f->glGenVertexArrays(1, &skyboxVAO);
-    f->glGenBuffers(1, &skyboxVBO);
-    f->glBindVertexArray(skyboxVAO);
-    f->glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-    f->glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-    f->glEnableVertexAttribArray(0);
-    f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-
-    // draw
-    f->glDepthFunc(GL_LEQUAL);
-    f->glUniformMatrix4fv(state.getModelViewUniform(), 1, GL_FALSE, state.getCurrentModelViewMatrix().constData());
-    f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
-    f->glUniform3f(state.getCameraPositionUniform(), cameraPos.x(), cameraPos.y(), cameraPos.z());
-
-    f->glBindVertexArray(skyboxVAO);
-    f->glActiveTexture(GL_TEXTURE0);
-    f->glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap_texture);
-    f->glDrawArrays(GL_TRIANGLES, 0, 36);
-
-    // restore matrix and attributes
-    f->glBindVertexArray(0);
-    f->glDepthFunc(GL_LESS); // set depth function back to default
+    frameCounter++;
+    scheduleNextFrame();
+    PROFILE_END("paintGL");
+    PROFILE_BEGIN("Qt event loop");
 }
 
-void OpenGLView::paintGL()
+void OpenGLView::recordFrame(const Scene::FrameStats &stats, double frameMs, double cpuMs)
 {
-    mesh_culled = 0;
+    if (!recording && !replaying)
+        return;
+    CameraPathFrame frame;
+    if (replaying)
+    {
+        frame = replayPath.frames[replayFrame];
+    }
+    else
+    {
+        frame.timeMs = recordingClock.nsecsElapsed() / 1e6;
+        frame.cameraPos = cameraPos;
+        frame.cameraDir = cameraDir;
+        scene.storeState(frame);
+        frame.setFlag(CameraPathFrame::LightMoves, lightMoves);
+    }
+    frame.frameMs = frameMs;
+    frame.cpuMs = cpuMs;
+    frame.gpuMs = scene.getGpuTimer().getLastFrameMs();
+    frame.triangles = stats.trianglesDrawn;
+    frame.drawCalls = stats.drawCalls;
+    frame.objectsCulled = stats.objectsCulled;
+
+    if (recording)
+        recordedPath.frames.push_back(frame);
+    if (replaying)
+    {
+        replayResult.frames.push_back(frame);
+        if (++replayFrame == replayPath.frames.size())
+        {
+            replaying = false;
+            bool success = true;
+            if (!replayOutput.isEmpty())
+                success = replayResult.save(replayOutput);
+            LOG_INFO(General, "Replay finished after {} frames", replayFrame);
+            emit replayFinished(success);
+        }
+    }
+}
 
-    f->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    state.loadIdentityModelViewMatrix();
+void OpenGLView::setSeed(unsigned int seed)
+{
+    if (glInitialized)
+        makeCurrent();
+    scene.setSeed(seed);
+    if (glInitialized)
+        doneCurrent();
+    requestFrame();
+}
 
-    // translate to center, rotate and render coordinate system and light sphere
-    QVector3D cameraLookAt = cameraPos + cameraDir;
-    static QVector3D upVector(0.0f, 1.0f, 0.0f);
-    state.getCurrentModelViewMatrix().lookAt(cameraPos, cameraLookAt, upVector);
-    drawSkybox();
-    state.switchToStandardProgram();
-    drawCS();
+void OpenGLView::startRecording()
+{
+    recordedPath = CameraPath();
+    recordedPath.seed = scene.getSeed();
+    recordingClock.start();
+    recording = true;
+}
 
-    if (lightMoves)
-        moveLight();
+bool OpenGLView::stopRecording(const QString &fileName)
+{
+    recording = false;
+    return recordedPath.save(fileName);
+}
 
-    drawLight();
-
-    unsigned int trianglesDrawn = 0;
-    // draw bump mapping sphere
-    state.setCurrentProgram(bumpProgramID);
-    state.pushModelViewMatrix();
-    state.setLightUniform();
-    state.getCurrentModelViewMatrix().translate(0, 5, 0);
-    trianglesDrawn += bumpSphereMesh.draw(state);
-    state.popModelViewMatrix();
-
-    state.setCurrentProgram(currentProgramID);
-    state.setLightUniform();
-    std::cout << "Chck object size" << objectPositions.size() << std::endl;
-    // draw objects. count triangles and objects drawn.
-    state.pushModelViewMatrix();
-    for (int i = 0; i < gridSize * 5; ++i)
-    {
+bool OpenGLView::startReplay(const QString &fileName, const QString &outputFileName)
+{
+    CameraPath path;
+    if (!path.load(fileName) || path.frames.empty())
+        return false;
+    replayPath = std::move(path);
+    replayResult = CameraPath();
+    replayResult.seed = replayPath.seed;
+    replayOutput = outputFileName;
+    replayFrame = 0;
+    lightMoves = false;
+    setSeed(replayPath.seed);
+    replaying = true;
+    // replays always render every frame as fast as possible
+    renderPolicy = RenderPolicy::Continuous;
+    pacingTimer.stop();
+    update();
+    return true;
+}
 
-        state.getCurrentModelViewMatrix().translate(objectPositions[i][0], objectPositions[i][1], objectPositions[i][2]);
-        // state.getCurrentModelViewMatrix().translate(static_cast<float>(1.f), 0.f);
-        int triangles_check = meshes[0].draw(state);
-        if (triangles_check == 0)
-            mesh_culled++;
-        trianglesDrawn += triangles_check;
+void OpenGLView::captureFrames(int frameCount, const QString &fileName)
+{
+    if (f && f->isCapturing())
+        return;
+    captureFramesLeft = std::max(1, frameCount);
+    captureFileName = fileName;
+    requestFrame();
+}
 
-        // trianglesDrawn += meshes[0].draw(state);
-    }
-    state.popModelViewMatrix();
-    for (size_t i = 1; i < meshes.size(); ++i)
+void OpenGLView::scheduleNextFrame()
+{
+    switch (renderPolicy) {
+    case RenderPolicy::Continuous:
+        update();
+        break;
+    case RenderPolicy::OnDemand:
+        // animations request frames only while they run
+        if (lightMoves || captureFramesLeft > 0)
+            update();
+        else
+            frameBegin = 0; // the idle time until the next request is no frame time for the hitch detector
+        break;
+    case RenderPolicy::Capped:
     {
-        trianglesDrawn += meshes[i].draw(state);
+        const qint64 interval = 1000000000LL / targetFrameRate;
+        const qint64 now = pacingClock.nsecsElapsed();
+        // a late frame moves the schedule instead of rendering the missed frames in a burst
+        nextFrameDeadline = std::max(nextFrameDeadline + interval, now);
+        const qint64 sleepMs = (nextFrameDeadline - now) / 1000000 - spinMarginMs;
+        pacingTimer.start(static_cast<int>(std::max<qint64>(0, sleepMs)));
+        break;
     }
-    // cout number of objects and triangles if different from last run
-    if (trianglesDrawn != trianglesLastRun)
-    {
-        trianglesLastRun = trianglesDrawn;
-        emit triangleCountChanged(trianglesDrawn);
     }
-    mesh_drawn = gridSize * 5 - mesh_culled;
-    std::cout << "Number of Objects Culled: " << mesh_culled << std::endl;
-    std::cout << "Number of Objects Drawn: " << mesh_drawn << std::endl;
+}
 
-    frameCounter++;
+void OpenGLView::paceFrame()
+{
+    // timers are only accurate to about a millisecond, so the last part is spun
+    while (pacingClock.nsecsElapsed() < nextFrameDeadline)
+        std::this_thread::yield();
+    update();
+}
+
+void OpenGLView::requestFrame()
+{
+    // Continuous and Capped draw the next frame anyway
+    if (renderPolicy == RenderPolicy::OnDemand)
+        update();
+}
+
+void OpenGLView::setRenderPolicy(int policy)
+{
+    switch (policy) {
+    default:
+        LOG_WARNING(General, "Falscher Rendermodus {}. Setze Standardwert...", policy);
+        // [[fallthrough]];
+    case 0:
+        renderPolicy = RenderPolicy::Continuous;
+        break;
+    case 1:
+        renderPolicy = RenderPolicy::OnDemand;
+        break;
+    case 2:
+        renderPolicy = RenderPolicy::Capped;
+        break;
+    }
+    pacingTimer.stop();
+    nextFrameDeadline = pacingClock.nsecsElapsed();
+    // restart the frame loop, it may have stopped in OnDemand mode
     update();
 }
 
-void OpenGLView::drawCS()
+void OpenGLView::setTargetFrameRate(int fps)
+{
+    targetFrameRate = std::max(1, fps);
+}
+
+void OpenGLView::toggleAdaptiveQuality(bool enable)
 {
-    f->glUniformMatrix4fv(state.getModelViewUniform(), 1, GL_FALSE, state.getCurrentModelViewMatrix().constData());
-    f->glBindVertexArray(csVAO);
-    f->glDrawArrays(GL_LINES, 0, 6);
-    f->glBindVertexArray(GL_NONE);
+    qualityGovernor.setEnabled(enable);
+    scene.setQualitySettings(qualityGovernor.getSettings());
+    emit qualityLevelChanged(qualityGovernor.getLevel(), qualityGovernor.getSettings().renderScale);
+    requestFrame();
 }
 
-void OpenGLView::drawLight()
+void OpenGLView::setQualityTargetFrameRate(int fps)
 {
-    // draw yellow sphere for light source
-    state.pushModelViewMatrix();
-    Vec3f &lp = state.getLightPos();
-    state.getCurrentModelViewMatrix().translate(lp.x(), lp.y(), lp.z());
-    sphereMesh.draw(state);
-    state.popModelViewMatrix();
+    qualityGovernor.setFrameBudgetMs(1000.0 / std::max(1, fps));
 }
 
 void OpenGLView::moveLight()
 {
-    state.getLightPos().rotY(lightMotionSpeed * (deltaTimer.restart() / 1000.f));
+    scene.getLightPos().rotY(lightMotionSpeed * (deltaTimer.restart() / 1000.f));
 }
 
 unsigned int OpenGLView::getTriangleCount() const
@@ -334,21 +328,34 @@ void OpenGLView::setDefaults()
     angleX = 0.0f;
     angleY = 0.0f;
     // light information
-    state.getLightPos() = Vec3f(0.0f, 5.0f, 20.0f);
+    scene.getLightPos() = Vec3f(0.0f, 5.0f, 20.0f);
     lightMotionSpeed = 10.f;
     // mouse information
     mouseSensitivy = 1.0f;
 
-    gridSize = 3;
+    scene.setGridSize(3);
     // last run: 0 objects and 0 triangles
     objectsLastRun = 0;
     trianglesLastRun = 0;
+    requestFrame();
 }
 
 void OpenGLView::refreshFpsCounter()
 {
     emit fpsCountChanged(frameCounter);
+    QString gpuSummary = scene.getGpuTimer().summary();
+    if (scene.isOverdrawMeasured() && scene.getOverdrawMeter().getMeasuredFrames() > 0)
+        gpuSummary += (gpuSummary.isEmpty() ? QString() : QStringLiteral(", ")) + scene.getOverdrawMeter().summary();
+    if (scene.isClusteredLightingEnabled() && scene.getLightClusters().getBinnedFrames() > 0)
+        gpuSummary += (gpuSummary.isEmpty() ? QString() : QStringLiteral(", ")) + scene.getLightClusters().summary();
+    emit gpuTimesChanged(gpuSummary);
     frameCounter = 0;
+
+    const double cpuSeconds = processCpuSeconds();
+    const qint64 wallMs = cpuUsageClock.restart();
+    if (wallMs > 0)
+        emit cpuUsageChanged(100.0 * (cpuSeconds - cpuSecondsAtLastRefresh) / (wallMs / 1000.0));
+    cpuSecondsAtLastRefresh = cpuSeconds;
 }
 
 void OpenGLView::triggerLightMovement(bool shouldMove)
@@ -364,6 +371,7 @@ void OpenGLView::triggerLightMovement(bool shouldMove)
         {
             deltaTimer.start();
         }
+        requestFrame();
     }
 }
 
@@ -376,7 +384,7 @@ void OpenGLView::cameraMoves(float deltaX, float deltaY, float deltaZ)
     cameraPos += deltaY * up;
     cameraPos += deltaZ * cameraDir;
 
-    update();
+    requestFrame();
 }
 
 void OpenGLView::cameraRotates(float deltaX, float deltaY)
@@ -392,7 +400,7 @@ void OpenGLView::cameraRotates(float deltaX, float deltaY)
     if (angleY < 0.f)
         cameraDir.setY(-cameraDir.y());
 
-    update();
+    requestFrame();
 }
 
 void OpenGLView::changeShader(unsigned int index)
@@ -400,14 +408,14 @@ void OpenGLView::changeShader(unsigned int index)
     makeCurrent();
     try
     {
-        GLuint progID = programIDs.at(index);
-        currentProgramID = progID;
+        scene.setCurrentProgram(index);
     }
     catch (std::out_of_range &ex)
     {
         qFatal("Tried to access shader index that has not been loaded! %s", ex.what());
     }
     doneCurrent();
+    requestFrame();
 }
 
 void OpenGLView::compileShader(const QString &vertexShaderPath, const QString &fragmentShaderPath)
@@ -415,111 +423,145 @@ void OpenGLView::compileShader(const QString &vertexShaderPath, const QString &f
     GLuint programHandle = readShaders(f, vertexShaderPath, fragmentShaderPath);
     if (programHandle)
     {
-        programIDs.push_back(programHandle);
-        emit shaderCompiled(programIDs.size() - 1);
+        emit shaderCompiled(scene.addProgram(programHandle));
     }
+    requestFrame();
 }
 
 void OpenGLView::changeColoringMode(TriangleMesh::ColoringType type)
 {
-    for (auto &mesh : meshes)
-        mesh.setColoringMode(type);
+    scene.changeColoringMode(type);
+    requestFrame();
 }
 
 void OpenGLView::toggleBoundingBox(bool enable)
 {
-    for (auto &mesh : meshes)
-        mesh.toggleBB(enable);
-    bumpSphereMesh.toggleBB(enable);
+    scene.toggleBoundingBox(enable);
+    requestFrame();
 }
 
 void OpenGLView::toggleNormals(bool enable)
 {
-    for (auto &mesh : meshes)
-        mesh.toggleNormals(enable);
-    bumpSphereMesh.toggleNormals(enable);
+    scene.toggleNormals(enable);
+    requestFrame();
 }
 
 void OpenGLView::toggleDiffuse(bool enable)
 {
-    bumpSphereMesh.toggleDiffuse(enable);
+    scene.toggleDiffuse(enable);
+    requestFrame();
 }
 
 void OpenGLView::toggleNormalMapping(bool enable)
 {
-    bumpSphereMesh.toggleNormalMapping(enable);
+    scene.toggleNormalMapping(enable);
+    requestFrame();
 }
 
 void OpenGLView::toggleDisplacementMapping(bool enable)
 {
-    bumpSphereMesh.toggleDisplacementMapping(enable);
+    scene.toggleDisplacementMapping(enable);
+    requestFrame();
+}
+
+void OpenGLView::toggleParallaxMapping(bool enable)
+{
+    scene.toggleParallaxMapping(enable);
+    requestFrame();
+}
+
+void OpenGLView::toggleStaticBatching(bool enable)
+{
+    scene.toggleStaticBatching(enable);
+    requestFrame();
+}
+
+void OpenGLView::toggleVertexPulling(bool enable)
+{
+    scene.toggleVertexPulling(enable);
+    requestFrame();
+}
+
+void OpenGLView::setDepthPrepass(int mode)
+{
+    switch (mode) {
+    default:
+        LOG_WARNING(General, "Falscher Tiefen-Vorpass-Modus {}. Setze Standardwert...", mode);
+        // [[fallthrough]];
+    case 0:
+        scene.setDepthPrepass(DepthPrepassMode::Off);
+        break;
+    case 1:
+        scene.setDepthPrepass(DepthPrepassMode::On);
+        break;
+    case 2:
+        scene.setDepthPrepass(DepthPrepassMode::Auto);
+        break;
+    }
+    requestFrame();
+}
+
+void OpenGLView::setOverdrawMode(int mode)
+{
+    switch (mode) {
+    default:
+        LOG_WARNING(General, "Falscher Overdraw-Modus {}. Setze Standardwert...", mode);
+        // [[fallthrough]];
+    case 0:
+        scene.setOverdrawMeasurement(false);
+        break;
+    case 1:
+        scene.setOverdrawMeasurement(true);
+        break;
+    case 2:
+        scene.setOverdrawMeasurement(true, true);
+        break;
+    }
+    requestFrame();
+}
+
+void OpenGLView::toggleDeferredShading(bool enable)
+{
+    scene.toggleDeferredShading(enable);
+    requestFrame();
+}
+
+void OpenGLView::toggleVisibilityBuffer(bool enable)
+{
+    scene.toggleVisibilityBuffer(enable);
+    requestFrame();
+}
+
+void OpenGLView::setPointLightCount(int count)
+{
+    scene.setPointLightCount(static_cast<unsigned int>(count));
+    requestFrame();
+}
+
+void OpenGLView::toggleClusteredLighting(bool enable)
+{
+    scene.toggleClusteredLighting(enable);
+    requestFrame();
+}
+
+void OpenGLView::setHitchThreshold(double factor)
+{
+    hitchDetector.setThresholdFactor(factor);
+}
+
+bool OpenGLView::writeHitchReport(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate))
+        return false;
+    file.write(QJsonDocument(hitchDetector.report()).toJson(QJsonDocument::Indented));
+    return true;
 }
 
 void OpenGLView::recreateTerrain()
 {
     makeCurrent();
-    meshes[1].clear();
-    meshes[1].generateTerrain(50, 50, 4000);
+    scene.recreateTerrain();
     doneCurrent();
-}
-
-// This creates a VAO that represents the coordinate system
-GLuint OpenGLView::genCSVAO()
-{
-    GLuint VAOresult;
-    f->glGenVertexArrays(1, &VAOresult);
-    f->glGenBuffers(2, csVBOs);
-
-    f->glBindVertexArray(VAOresult);
-    f->glBindBuffer(GL_ARRAY_BUFFER, csVBOs[0]);
-    const static float vertices[] = {
-        0.f,
-        0.f,
-        0.f,
-        5.f,
-        0.f,
-        0.f,
-        0.f,
-        0.f,
-        0.f,
-        0.f,
-        5.f,
-        0.f,
-        0.f,
-        0.f,
-        0.f,
-        0.f,
-        0.f,
-        5.f,
-    };
-    f->glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    f->glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    f->glEnableVertexAttribArray(POSITION_LOCATION);
-    f->glBindBuffer(GL_ARRAY_BUFFER, csVBOs[1]);
-    const static float colors[] = {
-        1.f,
-        0.f,
-        0.f,
-        1.f,
-        0.f,
-        0.f,
-        0.f,
-        1.f,
-        0.f,
-        0.f,
-        1.f,
-        0.f,
-        0.f,
-        0.f,
-        1.f,
-        0.f,
-        0.f,
-        1.f,
-    };
-    f->glBufferData(GL_ARRAY_BUFFER, sizeof(colors), colors, GL_STATIC_DRAW);
-    f->glVertexAttribPointer(COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    f->glEnableVertexAttribArray(COLOR_LOCATION);
-    f->glBindBuffer(GL_ARRAY_BUFFER, GL_NONE);
-    f->glBindVertexArray(GL_NONE);
-    return VAOresult;
+    requestFrame();
 }
@@ -16,24 +16,28 @@
 #include <QTimer>
 #include <QString>
 #include <QElapsedTimer>
-#include <QOpenGLFunctions_3_3_Core>
 #include <QObject>
 #include <QOpenGLWidget>
 #include <QVector3D>
 
+#include "camerapath.h"
+#include "glfunctions.h"
+#include "hitchdetector.h"
+#include "qualitygovernor.h"
 #include "trianglemesh.h"
 #include "vec3.h"
-#include "renderstate.h"
-#include <random>
+#include "scene.h"
 
 
 class OpenGLView : public QOpenGLWidget
 {
     Q_OBJECT
 public:
+    // When new frames are drawn. Continuous: as fast as possible. OnDemand: only after something changed
+    // or while the light moves. Capped: continuously, but at most targetFrameRate frames per second.
+    enum class RenderPolicy { Continuous, OnDemand, Capped };
+
     OpenGLView(QWidget *parent = nullptr);
-    std::vector<Vec3f> objectPositions;
-    void generateRandomPosition(int newObjectCount = 500);
     int mesh_drawn;
     int mesh_culled;
 
@@ -52,7 +56,44 @@ public slots:
     void toggleDiffuse(bool enable);
     void toggleNormalMapping(bool enable);
     void toggleDisplacementMapping(bool enable);
+    void toggleParallaxMapping(bool enable);
+    void toggleStaticBatching(bool enable);
+    void toggleVertexPulling(bool enable);
+    // 0 off, 1 on, 2 automatic, for all passes
+    void setDepthPrepass(int mode);
+    // 0 off, 1 measured, 2 measured with heatmap
+    void setOverdrawMode(int mode);
+    void toggleDeferredShading(bool enable);
+    void toggleVisibilityBuffer(bool enable);
+    void setPointLightCount(int count);
+    void toggleClusteredLighting(bool enable);
     void recreateTerrain();
+    void setHitchThreshold(double factor);
+    void setRenderPolicy(int policy);
+    void setTargetFrameRate(int fps);
+    void toggleAdaptiveQuality(bool enable);
+    void setQualityTargetFrameRate(int fps);
+    // marks the view as dirty, needed in OnDemand mode
+    void requestFrame();
+
+public:
+    // writes the frame time histogram and the worst frames as JSON. Returns false if the file could not be written.
+    bool writeHitchReport(const QString& fileName) const;
+
+    // seed of the random object positions and terrains
+    void setSeed(unsigned int seed);
+
+    // Records camera, light and UI state of every frame until stopRecording() writes them to fileName.
+    void startRecording();
+    bool stopRecording(const QString& fileName);
+    bool isRecording() const { return recording; }
+
+    // Replays a recording one frame per paintGL() call, independent of the time between the frames.
+    // If outputFileName is not empty, the frames are written there with the new measurements.
+    bool startReplay(const QString& fileName, const QString& outputFileName = QString());
+
+    // Records all OpenGL calls of the next frameCount frames into a trace for glreplay.
+    void captureFrames(int frameCount, const QString& fileName);
 
 protected:
     void initializeGL() override;
@@ -61,11 +102,23 @@ protected:
 
 signals:
     void fpsCountChanged(int newFps);
+    // CPU time of all threads of the process in percent of one core
+    void cpuUsageChanged(double percent);
+    void qualityLevelChanged(int level, float renderScale);
+    void replayFinished(bool success);
+    void captureFinished(const QString& fileName, bool success);
+    void gpuTimesChanged(const QString& summary);
     void triangleCountChanged(unsigned int newTriangles);
     void shaderCompiled(unsigned int index);
 
 private:
-    QOpenGLFunctions_3_3_Core *f;
+    GLFunctions glFunctions;
+    GLFunctions *f = nullptr;
+
+    // OpenGL capture
+    GLTrace capture;
+    int captureFramesLeft = 0;
+    QString captureFileName;
 
     // camera Information
     QVector3D cameraPos;
@@ -78,12 +131,7 @@ private:
 
     // rendered objects
     unsigned int objectsLastRun, trianglesLastRun;
-    std::vector<TriangleMesh> meshes;
-    TriangleMesh sphereMesh; // sun
-    TriangleMesh bumpSphereMesh;
-
-    static GLuint csVAO, csVBOs[2];
-    int gridSize;
+    Scene scene;
 
     // light information
     float lightMotionSpeed;
@@ -94,24 +142,43 @@ private:
     // timer for counting FPS
     QTimer fpsCounterTimer;
 
+    // CPU utilization since the last FPS refresh
+    QElapsedTimer cpuUsageClock;
+    double cpuSecondsAtLastRefresh = 0.0;
+
+    // frame pacing of the Capped policy. The timer wakes up shortly before the deadline, the rest is spun.
+    RenderPolicy renderPolicy = RenderPolicy::Continuous;
+    int targetFrameRate = 60;
+    QTimer pacingTimer;
+    QElapsedTimer pacingClock;
+    qint64 nextFrameDeadline = 0; // ns of pacingClock
+    static constexpr qint64 spinMarginMs = 2;
+
+    // frame times between two paintGL() calls, including the event loop
+    HitchDetector hitchDetector;
+    uint64_t frameBegin = 0;
+
+    // adapts the scene quality to CPU and GPU frame times
+    QualityGovernor qualityGovernor;
+
+    // camera path recording and replay
+    bool glInitialized = false;
+    bool recording = false;
+    QElapsedTimer recordingClock;
+    CameraPath recordedPath;
+    bool replaying = false;
+    size_t replayFrame = 0;
+    CameraPath replayPath, replayResult;
+    QString replayOutput;
+    void recordFrame(const Scene::FrameStats& stats, double frameMs, double cpuMs);
+
     // timer for counting delta time of a frame, needed for light movement
     QElapsedTimer deltaTimer;
     bool lightMoves = false;
 
-    // shaders
-    GLuint currentProgramID;
-    std::vector<GLuint> programIDs;
-    GLuint bumpProgramID;
-
-    // RenderState with matrix stack
-    RenderState state;
-
-    GLuint genCSVAO();
-
-    void drawSkybox();
-    void drawCS();
-    void drawLight();
     void moveLight();
+    void scheduleNextFrame();
+    void paceFrame();
     unsigned int getTriangleCount() const;
 };
 
@@ -0,0 +1,303 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Shaded fragments per pixel of the render passes, counted in      //
+//          the stencil buffer and read back asynchronously                  //
+// ========================================================================= //
+
+#include <algorithm>
+
+#include "overdrawmeter.h"
+#include "profiler.h"
+#include "renderstate.h"
+
+namespace {
+
+// counts[pass] holds the stencil values after the pass, nullptr if it was not drawn
+void reduce(const std::array<const uint8_t *, OverdrawMeter::passCount> &counts, size_t pixels,
+            std::array<OverdrawMeter::Stats, OverdrawMeter::passCount + 1> &stats)
+{
+    constexpr int total = OverdrawMeter::passCount;
+    std::array<uint64_t, total + 1> fragments{}, covered{};
+    std::array<unsigned int, total + 1> maxima{};
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        unsigned int before = 0;
+        for (int pass = 0; pass < total; ++pass)
+        {
+            if (!counts[pass])
+                continue;
+            const unsigned int after = counts[pass][i];
+            const unsigned int count = after - before;
+            before = after;
+            if (count == 0)
+                continue;
+            fragments[pass] += count;
+            covered[pass]++;
+            maxima[pass] = std::max(maxima[pass], count);
+        }
+        if (before == 0)
+            continue;
+        fragments[total] += before;
+        covered[total]++;
+        maxima[total] = std::max(maxima[total], before);
+    }
+    for (int pass = 0; pass <= total; ++pass)
+    {
+        OverdrawMeter::Stats &result = stats[pass];
+        result.average = pixels ? static_cast<double>(fragments[pass]) / pixels : 0.0;
+        result.averageCovered = covered[pass] ? static_cast<double>(fragments[pass]) / covered[pass] : 0.0;
+        result.coverage = pixels ? static_cast<double>(covered[pass]) / pixels : 0.0;
+        result.max = maxima[pass];
+    }
+}
+
+} // namespace
+
+void OverdrawMeter::initialize(GLFunctions *f, GLuint heatmapProgram)
+{
+    this->f = f;
+    this->heatmapProgram = heatmapProgram;
+    heatmapColorUniform = heatmapProgram ? f->glGetUniformLocation(heatmapProgram, "bandColor") : -1;
+    f->glGenVertexArrays(1, &emptyVAO);
+    for (auto &frame : frames)
+    {
+        f->glGenBuffers(passCount, frame.buffers.data());
+        frame.capacity = 0;
+        frame.pending = false;
+    }
+}
+
+void OverdrawMeter::cleanup()
+{
+    if (!f)
+        return;
+    for (auto &frame : frames)
+    {
+        if (frame.fence)
+            f->glDeleteSync(frame.fence);
+        f->glDeleteBuffers(passCount, frame.buffers.data());
+        frame = FrameCopies();
+    }
+    if (emptyVAO != 0)
+        f->glDeleteVertexArrays(1, &emptyVAO);
+    emptyVAO = 0;
+    heatmapProgram = 0;
+    counting = recording = false;
+    openPass = -1;
+    f = nullptr;
+}
+
+void OverdrawMeter::beginFrame(int width, int height)
+{
+    counting = recording = false;
+    openPass = -1;
+    if (!f)
+        return;
+
+    // map all finished frames, oldest first
+    for (int i = 1; i <= framesInFlight; ++i)
+    {
+        FrameCopies &frame = frames[(currentFrame + i) % framesInFlight];
+        if (frame.pending && !collect(frame))
+            break;
+    }
+
+    this->width = width;
+    this->height = height;
+    f->glClear(GL_STENCIL_BUFFER_BIT);
+    counting = true;
+
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    FrameCopies &frame = frames[currentFrame];
+    if (frame.pending)
+        return; // the GPU is more than framesInFlight frames behind, count but do not copy this frame
+    const size_t bytes = static_cast<size_t>(width) * static_cast<size_t>(height);
+    if (frame.capacity < bytes)
+    {
+        for (GLuint buffer : frame.buffers)
+        {
+            f->glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            f->glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_READ);
+        }
+        f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        frame.capacity = bytes;
+    }
+    frame.width = width;
+    frame.height = height;
+    frame.copied.fill(false);
+    recording = true;
+}
+
+void OverdrawMeter::endFrame(RenderState &state, bool heatmap)
+{
+    if (!counting)
+        return;
+    endPass();
+    if (heatmap)
+        drawHeatmap(state);
+    FrameCopies &frame = frames[currentFrame];
+    if (recording && std::find(frame.copied.begin(), frame.copied.end(), true) != frame.copied.end())
+    {
+        frame.fence = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame.pending = true;
+    }
+    counting = recording = false;
+}
+
+void OverdrawMeter::beginPass(Pass pass)
+{
+    if (!counting || openPass >= 0)
+        return;
+    f->glEnable(GL_STENCIL_TEST);
+    f->glStencilFunc(GL_ALWAYS, 0, 0xff);
+    // only fragments that pass the depth test are shaded; the count saturates instead of wrapping
+    f->glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+    openPass = pass;
+}
+
+void OverdrawMeter::endPass()
+{
+    if (openPass < 0)
+        return;
+    f->glDisable(GL_STENCIL_TEST);
+    FrameCopies &frame = frames[currentFrame];
+    if (recording && !frame.copied[openPass])
+    {
+        // the copy runs on the GPU, the buffer is mapped when the fence of the frame has signaled
+        f->glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.buffers[openPass]);
+        f->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        f->glReadPixels(0, 0, width, height, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, nullptr);
+        f->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        frame.copied[openPass] = true;
+    }
+    openPass = -1;
+}
+
+void OverdrawMeter::setCounting(bool count)
+{
+    if (openPass >= 0)
+        f->glStencilOp(GL_KEEP, GL_KEEP, count ? GL_INCR : GL_KEEP);
+}
+
+bool OverdrawMeter::collect(FrameCopies &frame)
+{
+    const GLenum status = f->glClientWaitSync(frame.fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return false;
+    f->glDeleteSync(frame.fence);
+    frame.fence = nullptr;
+    frame.pending = false;
+    if (status == GL_WAIT_FAILED)
+        return true;
+
+    PROFILE_FUNCTION();
+    const size_t pixels = static_cast<size_t>(frame.width) * static_cast<size_t>(frame.height);
+    std::array<const uint8_t *, passCount> counts{};
+    bool mapped = true;
+    for (int pass = 0; pass < passCount; ++pass)
+    {
+        if (!frame.copied[pass])
+            continue;
+        f->glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.buffers[pass]);
+        counts[pass] = static_cast<const uint8_t *>(f->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(pixels), GL_MAP_READ_BIT));
+        mapped = mapped && counts[pass];
+    }
+    if (mapped)
+    {
+        reduce(counts, pixels, latest);
+        for (int pass = 0; pass <= passCount; ++pass)
+        {
+            sums[pass].average += latest[pass].average;
+            sums[pass].averageCovered += latest[pass].averageCovered;
+            sums[pass].coverage += latest[pass].coverage;
+            sums[pass].max = std::max(sums[pass].max, latest[pass].max);
+        }
+        measuredFrames++;
+    }
+    for (int pass = 0; pass < passCount; ++pass)
+    {
+        if (!counts[pass])
+            continue;
+        f->glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.buffers[pass]);
+        f->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void OverdrawMeter::drawHeatmap(RenderState &state)
+{
+    if (heatmapProgram == 0)
+        return;
+    // lowest count of each band and its color, from black over blue, green and red to white
+    static const struct {
+        GLint count;
+        float color[3];
+    } bands[] = {
+        {0, {0.0f, 0.0f, 0.0f}}, {1, {0.0f, 0.0f, 0.5f}}, {2, {0.0f, 0.4f, 1.0f}},
+        {3, {0.0f, 0.9f, 0.9f}}, {4, {0.2f, 0.9f, 0.2f}}, {6, {1.0f, 0.9f, 0.0f}},
+        {8, {1.0f, 0.5f, 0.0f}}, {12, {1.0f, 0.0f, 0.0f}}, {16, {1.0f, 1.0f, 1.0f}},
+    };
+    state.setCurrentProgram(heatmapProgram);
+    f->glDisable(GL_DEPTH_TEST);
+    f->glEnable(GL_STENCIL_TEST);
+    f->glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    f->glBindVertexArray(emptyVAO);
+    // every band covers the pixels with at least its count, the highest one drawn last stays visible
+    for (const auto &band : bands)
+    {
+        f->glStencilFunc(GL_LEQUAL, band.count, 0xff);
+        f->glUniform3f(heatmapColorUniform, band.color[0], band.color[1], band.color[2]);
+        f->glDrawArrays(GL_TRIANGLES, 0, 3);
+        state.countDrawCall();
+    }
+    f->glBindVertexArray(0);
+    f->glDisable(GL_STENCIL_TEST);
+    f->glEnable(GL_DEPTH_TEST);
+}
+
+const char *OverdrawMeter::passName(int pass)
+{
+    static const char *const names[passCount + 1] = {"skybox", "bump sphere", "objects", "terrain", "total"};
+    return pass >= 0 && pass <= passCount ? names[pass] : "";
+}
+
+std::array<OverdrawMeter::Stats, OverdrawMeter::passCount + 1> OverdrawMeter::getMean() const
+{
+    std::array<Stats, passCount + 1> mean{};
+    if (measuredFrames == 0)
+        return mean;
+    for (int pass = 0; pass <= passCount; ++pass)
+    {
+        mean[pass].average = sums[pass].average / measuredFrames;
+        mean[pass].averageCovered = sums[pass].averageCovered / measuredFrames;
+        mean[pass].coverage = sums[pass].coverage / measuredFrames;
+        mean[pass].max = sums[pass].max;
+    }
+    return mean;
+}
+
+void OverdrawMeter::resetStatistics()
+{
+    sums.fill(Stats());
+    measuredFrames = 0;
+}
+
+QString OverdrawMeter::summary() const
+{
+    if (measuredFrames == 0)
+        return QString();
+    QString details;
+    for (int pass = 0; pass < passCount; ++pass)
+    {
+        if (!details.isEmpty())
+            details += QStringLiteral(", ");
+        details += QStringLiteral("%1 %2").arg(QString(passName(pass))).arg(latest[pass].average, 0, 'f', 2);
+    }
+    return QStringLiteral("Overdraw %1 (max %2): %3").arg(latest[passCount].average, 0, 'f', 2).arg(latest[passCount].max).arg(details);
+}
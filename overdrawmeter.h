@@ -0,0 +1,111 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Shaded fragments per pixel of the render passes, counted in      //
+//          the stencil buffer and read back asynchronously                  //
+// ========================================================================= //
+
+#ifndef OVERDRAWMETER_H
+#define OVERDRAWMETER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <QString>
+
+#include "glfunctions.h"
+
+class RenderState;
+
+/*
+ * Counts the fragments that pass the depth test, i.e. the ones that are shaded, with glStencilOp(GL_INCR)
+ * while a pass is drawn. The stencil buffer is not cleared between the passes; after each pass it is copied
+ * into a pixel pack buffer, and the difference of two copies is the count of one pass. The copies of a
+ * frame are mapped when its fence has signaled, usually two or three frames later, so the CPU never waits
+ * for the GPU. If all buffers are still in flight, the frame is simply not measured.
+ *
+ * The counts saturate at 255 fragments per pixel. The current framebuffer needs a stencil buffer; Scene
+ * renders into its offscreen target while the meter is enabled.
+ */
+class OverdrawMeter
+{
+public:
+    enum Pass { Skybox, BumpSphere, Objects, Terrain };
+    static constexpr int passCount = 4;
+    static constexpr int framesInFlight = 3;
+
+    struct Stats {
+        double average = 0.0;        // shaded fragments per pixel of the target
+        double averageCovered = 0.0; // shaded fragments per pixel the pass reached
+        double coverage = 0.0;       // part of the pixels the pass reached
+        unsigned int max = 0;        // fragments of the most overdrawn pixel
+    };
+
+    OverdrawMeter() = default;
+    ~OverdrawMeter() = default;
+    OverdrawMeter(const OverdrawMeter& other) = delete;
+    OverdrawMeter& operator= (const OverdrawMeter& other) = delete;
+
+    // heatmapProgram draws the false color bands (fullscreen.vert, overdraw.frag) and stays owned by the
+    // caller. Needs a current OpenGL context.
+    void initialize(GLFunctions* f, GLuint heatmapProgram);
+    // deletes the buffers, needs the context of initialize()
+    void cleanup();
+
+    // Collects the finished frames and starts counting into the stencil buffer of the current framebuffer,
+    // which is cleared. width and height are the size of its viewport.
+    void beginFrame(int width, int height);
+    // Draws the heatmap over the color buffer if heatmap is set, then fences the copies of the frame.
+    // Leaves the heatmap program current.
+    void endFrame(RenderState& state, bool heatmap);
+    // Counts the fragments drawn until endPass(). Only one pass at a time, each at most once per frame.
+    void beginPass(Pass pass);
+    void endPass();
+    // pauses the counting within a pass, e.g. during its depth pre-pass
+    void setCounting(bool count);
+
+    // passCount is the sum of all passes
+    static const char* passName(int pass);
+    // the latest frame read back, [passCount] is the sum of all passes
+    const std::array<Stats, passCount + 1>& getLatest() const { return latest; }
+    // Averages over all frames read back since resetStatistics(); max is the largest of them.
+    std::array<Stats, passCount + 1> getMean() const;
+    uint64_t getMeasuredFrames() const { return measuredFrames; }
+    void resetStatistics();
+    // short text for the status bar, e.g. "Overdraw 2.31 (max 14): skybox 1.00, objects 0.84, ..."
+    QString summary() const;
+
+private:
+    struct FrameCopies {
+        std::array<GLuint, passCount> buffers{};
+        std::array<bool, passCount> copied{};
+        size_t capacity = 0; // bytes of each buffer
+        int width = 0, height = 0;
+        GLsync fence = nullptr;
+        bool pending = false;
+    };
+
+    GLFunctions* f = nullptr;
+    GLuint heatmapProgram = 0;
+    GLint heatmapColorUniform = -1;
+    GLuint emptyVAO = 0;
+    std::array<FrameCopies, framesInFlight> frames;
+    int currentFrame = 0;
+    bool counting = false;  // between beginFrame() and endFrame()
+    bool recording = false; // whether the counts of the current frame are copied
+    int openPass = -1;
+    int width = 0, height = 0;
+
+    std::array<Stats, passCount + 1> latest{};
+    std::array<Stats, passCount + 1> sums{}; // max holds the largest instead of the sum
+    uint64_t measuredFrames = 0;
+
+    bool collect(FrameCopies& frame);
+    void drawHeatmap(RenderState& state);
+};
+
+#endif // OVERDRAWMETER_H
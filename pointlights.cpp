@@ -0,0 +1,125 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Animated point lights, streamed into one buffer that is read     //
+//          as instance attributes and as a buffer texture                   //
+// ========================================================================= //
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "pointlights.h"
+#include "profiler.h"
+
+PointLights::~PointLights()
+{
+    release();
+}
+
+void PointLights::generate(unsigned int count, const Vec3f &boundsMin, const Vec3f &boundsMax, unsigned int seed)
+{
+    lights.clear();
+    lights.reserve(count);
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        Light light;
+        // evaluation order of function arguments is unspecified, so draw the values one after another
+        for (unsigned int axis = 0; axis < 3; ++axis)
+            light.base[axis] = boundsMin[axis] + unit(generator) * (boundsMax[axis] - boundsMin[axis]);
+        // saturated colors of random hue, dimmed since many lights overlap
+        const float hue = 6.0f * unit(generator);
+        for (unsigned int channel = 0; channel < 3; ++channel)
+        {
+            const float distance = std::fabs(std::fmod(hue + 4.0f * channel, 6.0f) - 3.0f);
+            light.color[channel] = intensity * std::clamp(distance - 1.0f, 0.0f, 1.0f);
+        }
+        light.orbit = 0.5f + 1.5f * unit(generator);
+        light.speed = (unit(generator) < 0.5f ? -1.0f : 1.0f) * (0.3f + unit(generator));
+        light.phase = 6.2831853f * unit(generator);
+        light.position = light.base;
+        lights.push_back(light);
+    }
+    // the spheres of about a dozen lights overlap above every point of the ground (count * pi * radius^2
+    // is 4 pi times the ground area), between 0.5 and a quarter of the scene
+    const float width = std::max(boundsMax.x() - boundsMin.x(), 1.0f);
+    const float depth = std::max(boundsMax.z() - boundsMin.z(), 1.0f);
+    radius = std::clamp(2.0f * std::sqrt(width * depth / std::max(count, 1u)), 0.5f, 0.25f * std::max(width, depth));
+}
+
+void PointLights::animate(float seconds)
+{
+    for (Light &light : lights)
+    {
+        const float angle = light.phase + light.speed * seconds;
+        light.position = light.base + Vec3f(light.orbit * std::cos(angle), 0.25f * light.orbit * std::sin(2.0f * angle),
+                                            light.orbit * std::sin(angle));
+    }
+}
+
+void PointLights::upload(GLFunctions *f, const QMatrix4x4 &view)
+{
+    PROFILE_FUNCTION();
+    if (lights.empty())
+        return;
+    this->f = f;
+    data.resize(lights.size() * floatsPerLight);
+    const float *m = view.constData();
+    float *out = data.data();
+    for (const Light &light : lights)
+    {
+        const Vec3f &p = light.position;
+        for (int row = 0; row < 3; ++row)
+            out[row] = m[row] * p.x() + m[4 + row] * p.y() + m[8 + row] * p.z() + m[12 + row];
+        out[3] = radius;
+        out[4] = light.color.x();
+        out[5] = light.color.y();
+        out[6] = light.color.z();
+        out[7] = 0.0f;
+        out += floatsPerLight;
+    }
+
+    if (buffer == 0)
+    {
+        // the buffer texture keeps referring to the buffer when its store is replaced
+        f->glGenBuffers(1, &buffer);
+        f->glGenTextures(1, &texture);
+        f->glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        f->glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(data.size() * sizeof(float)), nullptr, GL_STREAM_DRAW);
+        f->glActiveTexture(GL_TEXTURE0 + textureUnit);
+        f->glBindTexture(GL_TEXTURE_BUFFER, texture);
+        f->glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+        f->glActiveTexture(GL_TEXTURE0);
+    }
+    // a new buffer store every frame, the driver does not have to wait for the draws of the last frame
+    f->glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    f->glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(data.size() * sizeof(float)), data.data(), GL_STREAM_DRAW);
+    f->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void PointLights::bindTexture() const
+{
+    if (!f)
+        return;
+    f->glActiveTexture(GL_TEXTURE0 + textureUnit);
+    f->glBindTexture(GL_TEXTURE_BUFFER, texture);
+    f->glActiveTexture(GL_TEXTURE0);
+}
+
+void PointLights::release()
+{
+    if (f)
+    {
+        if (buffer != 0)
+            f->glDeleteBuffers(1, &buffer);
+        if (texture != 0)
+            f->glDeleteTextures(1, &texture);
+    }
+    buffer = texture = 0;
+    f = nullptr;
+}
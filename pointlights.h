@@ -0,0 +1,79 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Animated point lights, streamed into one buffer that is read     //
+//          as instance attributes and as a buffer texture                   //
+// ========================================================================= //
+
+#ifndef POINTLIGHTS_H
+#define POINTLIGHTS_H
+
+#include <cstddef>
+#include <vector>
+
+#include <QMatrix4x4>
+
+#include "glfunctions.h"
+#include "vec3.h"
+
+/*
+ * Point lights with a finite radius: their light fades out smoothly and is zero at the radius, so a light
+ * only has to be evaluated within its sphere. Each light circles around its own base position.
+ *
+ * upload() writes two vec4 per light in camera coordinates, (position, radius) and (color, 0), into one
+ * buffer. DeferredRenderer draws the light volumes with it as instance attributes; the forward shaders
+ * (lambert.frag, bump.frag) loop over all lights through its buffer texture on textureUnit.
+ */
+class PointLights
+{
+public:
+    // texture unit of the buffer texture, above the ones of VertexPullBuffers
+    static constexpr GLuint textureUnit = 7;
+    static constexpr size_t floatsPerLight = 8;
+    // brightest color channel of a light
+    static constexpr float intensity = 0.25f;
+
+    PointLights() = default;
+    ~PointLights();
+    PointLights(const PointLights& other) = delete;
+    PointLights& operator= (const PointLights& other) = delete;
+
+    // Places count lights at random in the box from boundsMin to boundsMax. The radius shrinks with the
+    // number of lights so that about the same number of them overlaps at any point.
+    void generate(unsigned int count, const Vec3f& boundsMin, const Vec3f& boundsMax, unsigned int seed);
+    // moves every light to its position at time seconds
+    void animate(float seconds);
+    // Writes the lights in the camera coordinates of view into the buffer. The first upload creates the
+    // buffer and the texture and needs a current OpenGL context, later ones the same context.
+    void upload(GLFunctions* f, const QMatrix4x4& view);
+    // binds the buffer texture to textureUnit
+    void bindTexture() const;
+    // deletes the GPU objects, the lights stay
+    void release();
+
+    unsigned int getCount() const { return static_cast<unsigned int>(lights.size()); }
+    float getRadius() const { return radius; }
+    GLuint getBuffer() const { return buffer; }
+    // the data of the last upload, floatsPerLight per light
+    const std::vector<float>& getUploadedData() const { return data; }
+
+private:
+    struct Light {
+        Vec3f base;
+        Vec3f color;
+        float orbit, speed, phase;
+        Vec3f position; // at the time of the last animate()
+    };
+
+    std::vector<Light> lights;
+    float radius = 1.0f;
+    std::vector<float> data;
+
+    GLFunctions* f = nullptr;
+    GLuint buffer = 0, texture = 0;
+};
+
+#endif // POINTLIGHTS_H
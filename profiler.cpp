@@ -0,0 +1,225 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Scoped CPU profiler with per-thread event buffers and export as  //
+//          Chrome trace_event JSON (chrome://tracing, ui.perfetto.dev)      //
+// ========================================================================= //
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "profiler.h"
+
+namespace {
+
+struct Event {
+    const char* name;
+    uint64_t timestamp;
+    char phase; // 'B' begin, 'E' end
+};
+
+// Single producer ring buffer. Only the owning thread writes, readers validate what they copied
+// against the write counter afterwards.
+struct ThreadBuffer {
+    static constexpr uint64_t capacity = 1 << 17;
+    static constexpr uint64_t mask = capacity - 1;
+
+    std::unique_ptr<Event[]> events{new Event[capacity]};
+    std::atomic<uint64_t> written{0};
+    uint64_t startupEnd = 0; // events before this index are in startupEvents
+    std::vector<Event> startupEvents;
+    unsigned int threadId = 0;
+    std::string threadName;
+
+    void push(const char* name, char phase, uint64_t timestamp = Profiler::now()) {
+        const uint64_t index = written.load(std::memory_order_relaxed);
+        events[index & mask] = Event{name, timestamp, phase};
+        written.store(index + 1, std::memory_order_release);
+    }
+
+    // copies the events with index in [first, written) that are still in the ring
+    void copyEvents(uint64_t first, std::vector<Event>& out) const {
+        const uint64_t end = written.load(std::memory_order_acquire);
+        uint64_t begin = end > capacity ? end - capacity : 0;
+        begin = std::max(begin, first);
+        const size_t offset = out.size();
+        for (uint64_t i = begin; i < end; ++i)
+            out.push_back(events[i & mask]);
+        // events overwritten by the writer while copying are dropped
+        const uint64_t endAfterCopy = written.load(std::memory_order_acquire);
+        const uint64_t validBegin = endAfterCopy > capacity ? endAfterCopy - capacity : 0;
+        if (validBegin > begin)
+        {
+            const size_t dropped = static_cast<size_t>(std::min(validBegin, end) - begin);
+            out.erase(out.begin() + offset, out.begin() + offset + dropped);
+        }
+    }
+};
+
+const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry; // buffers live until program end, threads may exit earlier
+bool startupComplete = false;
+
+thread_local ThreadBuffer* currentBuffer = nullptr;
+ThreadBuffer* gpuBuffer = nullptr;
+
+ThreadBuffer* registerBuffer(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.emplace_back(new ThreadBuffer);
+    ThreadBuffer* buffer = registry.back().get();
+    buffer->threadId = static_cast<unsigned int>(registry.size());
+    buffer->threadName = name.empty() ? "thread " + std::to_string(buffer->threadId) : name;
+    return buffer;
+}
+
+ThreadBuffer& threadBuffer()
+{
+    if (!currentBuffer)
+        currentBuffer = registerBuffer(std::string());
+    return *currentBuffer;
+}
+
+bool enabledByEnvironment()
+{
+    const char* value = std::getenv("GDV_PROFILER");
+    return !value || std::strcmp(value, "0") != 0;
+}
+
+void writeEscaped(std::FILE* file, const char* text)
+{
+    for (const char* c = text; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            std::fputc('\\', file);
+        std::fputc(*c, file);
+    }
+}
+
+} // namespace
+
+std::atomic<bool> Profiler::enabled{enabledByEnvironment()};
+
+uint64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Profiler::beginEvent(const char* name)
+{
+    threadBuffer().push(name, 'B');
+}
+
+void Profiler::endEvent(const char* name)
+{
+    threadBuffer().push(name, 'E');
+}
+
+void Profiler::recordGpuEvent(const char* name, uint64_t begin, uint64_t end)
+{
+    if (!gpuBuffer)
+        gpuBuffer = registerBuffer("GPU");
+    gpuBuffer->push(name, 'B', begin);
+    gpuBuffer->push(name, 'E', end);
+}
+
+std::vector<Profiler::Zone> Profiler::zonesOfCurrentThread(uint64_t begin, uint64_t end)
+{
+    std::vector<Zone> zones;
+    if (!currentBuffer)
+        return zones;
+    std::vector<Event> events;
+    currentBuffer->copyEvents(0, events);
+    std::vector<const Event*> open;
+    for (const Event& event : events)
+    {
+        if (event.phase == 'B')
+        {
+            open.push_back(&event);
+        }
+        else if (!open.empty())
+        {
+            const Event* first = open.back();
+            open.pop_back();
+            if (event.timestamp > begin && first->timestamp < end)
+                zones.push_back(Zone{first->name, first->timestamp, event.timestamp});
+        }
+    }
+    return zones;
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer.threadName = name;
+}
+
+void Profiler::markStartupComplete()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (startupComplete)
+        return;
+    startupComplete = true;
+    for (auto& buffer : registry)
+    {
+        buffer->copyEvents(0, buffer->startupEvents);
+        buffer->startupEnd = buffer->written.load(std::memory_order_acquire);
+    }
+}
+
+bool Profiler::writeChromeTrace(const std::string& fileName)
+{
+    std::FILE* file = std::fopen(fileName.c_str(), "w");
+    if (!file)
+        return false;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    bool first = true;
+    std::vector<Event> events;
+    for (const auto& buffer : registry)
+    {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                     first ? "" : ",\n", buffer->threadId);
+        writeEscaped(file, buffer->threadName.c_str());
+        std::fputs("\"}}", file);
+        first = false;
+
+        events = buffer->startupEvents;
+        buffer->copyEvents(buffer->startupEnd, events);
+
+        // The ring may start in the middle of a scope. Skip end events without a begin event.
+        int depth = 0;
+        for (const Event& event : events)
+        {
+            if (event.phase == 'E')
+            {
+                if (depth == 0)
+                    continue;
+                --depth;
+            }
+            else
+            {
+                ++depth;
+            }
+            std::fputs(",\n{\"name\":\"", file);
+            writeEscaped(file, event.name);
+            std::fprintf(file, "\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                         event.phase, event.timestamp / 1000.0, buffer->threadId);
+        }
+    }
+    std::fputs("\n]}\n", file);
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,103 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Scoped CPU profiler with per-thread event buffers and export as  //
+//          Chrome trace_event JSON (chrome://tracing, ui.perfetto.dev)      //
+// ========================================================================= //
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Every thread writes begin/end events into its own ring buffer, so recording needs neither locks nor
+ * allocations. Only the first event of a thread registers its buffer under a mutex. Event names must be
+ * string literals (or otherwise live until the end of the program) because only the pointer is stored.
+ *
+ * The PROFILE_* macros compile to nothing unless GDV_ENABLE_PROFILER is defined (CMake option
+ * ENABLE_PROFILER). At runtime recording can be switched off with Profiler::setEnabled(false) or by
+ * starting the application with GDV_PROFILER=0.
+ *
+ * Events recorded before markStartupComplete() are kept aside, so a capture always contains the startup
+ * (shader compilation, asset loading) followed by the most recent frames still in the ring buffers.
+ */
+class Profiler {
+public:
+    struct Zone {
+        const char* name;
+        uint64_t begin, end;
+    };
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+
+    // nanoseconds since the profiler was started
+    static uint64_t now();
+
+    static void beginEvent(const char* name);
+    static void endEvent(const char* name);
+
+    // names the calling thread in the trace
+    static void setThreadName(const char* name);
+
+    // Records a finished GPU pass on the separate "GPU" track of the trace. Times are in the clock of now().
+    // Must always be called from the same thread, the one owning the OpenGL context.
+    static void recordGpuEvent(const char* name, uint64_t begin, uint64_t end);
+
+    // Completed zones of the calling thread that overlap [begin, end), ordered by their end. Zones that were
+    // already overwritten in the ring buffer are missing.
+    static std::vector<Zone> zonesOfCurrentThread(uint64_t begin, uint64_t end);
+
+    // keeps all events recorded so far, they are not overwritten by later frames
+    static void markStartupComplete();
+
+    // writes the startup events and the content of all ring buffers. Returns false if the file could not be written.
+    static bool writeChromeTrace(const std::string& fileName);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+// Records a begin event on construction and the matching end event on destruction.
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : name(name) {
+        if (Profiler::isEnabled())
+            Profiler::beginEvent(name);
+        else
+            this->name = nullptr;
+    }
+    ~ProfileScope() {
+        if (name)
+            Profiler::endEvent(name);
+    }
+    ProfileScope(const ProfileScope& other) = delete;
+    ProfileScope& operator= (const ProfileScope& other) = delete;
+
+private:
+    const char* name;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef GDV_ENABLE_PROFILER
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_BEGIN(name) do { if (Profiler::isEnabled()) Profiler::beginEvent(name); } while (0)
+#define PROFILE_END(name) do { if (Profiler::isEnabled()) Profiler::endEvent(name); } while (0)
+#else
+#define PROFILE_SCOPE(name) do {} while (0)
+#define PROFILE_FUNCTION() do {} while (0)
+#define PROFILE_BEGIN(name) do {} while (0)
+#define PROFILE_END(name) do {} while (0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,66 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Lowers and raises the render quality to keep the frame time     //
+//          within a budget                                                  //
+// ========================================================================= //
+
+#include <algorithm>
+
+#include "qualitygovernor.h"
+
+QualitySettings QualityGovernor::settingsForLevel(int level)
+{
+    // renderScale, lodBias, contributionCullPixels, bumpFeatureLevel
+    static const QualitySettings levels[levelCount] = {
+        {1.0f, 0, 0.0f, 2},
+        {1.0f, 0, 1.0f, 2},
+        {0.85f, 1, 2.0f, 1},
+        {0.7f, 1, 3.0f, 1},
+        {0.6f, 2, 4.0f, 0},
+        {0.5f, 2, 6.0f, 0},
+    };
+    return levels[std::clamp(level, 0, levelCount - 1)];
+}
+
+void QualityGovernor::setEnabled(bool enable)
+{
+    enabled = enable;
+    level = 0;
+    overCount = underCount = cooldown = 0;
+    hasSample = false;
+}
+
+bool QualityGovernor::update(double cpuMs, double gpuMs)
+{
+    const double frameMs = std::max(cpuMs, gpuMs);
+    smoothedMs = hasSample ? smoothedMs + smoothing * (frameMs - smoothedMs) : frameMs;
+    hasSample = true;
+    if (!enabled)
+        return false;
+
+    if (cooldown > 0)
+    {
+        cooldown--;
+        return false;
+    }
+
+    overCount = smoothedMs > budgetMs ? overCount + 1 : 0;
+    underCount = smoothedMs < raiseThreshold * budgetMs ? underCount + 1 : 0;
+
+    int newLevel = level;
+    if (overCount >= framesAboveBudget)
+        newLevel = std::min(level + 1, levelCount - 1);
+    else if (underCount >= framesBelowBudget)
+        newLevel = std::max(level - 1, 0);
+    if (newLevel == level)
+        return false;
+
+    level = newLevel;
+    overCount = underCount = 0;
+    cooldown = cooldownFrames;
+    return true;
+}
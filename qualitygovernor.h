@@ -0,0 +1,64 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Lowers and raises the render quality to keep the frame time     //
+//          within a budget                                                  //
+// ========================================================================= //
+
+#ifndef QUALITYGOVERNOR_H
+#define QUALITYGOVERNOR_H
+
+// Settings of the scene that trade image quality for frame time.
+struct QualitySettings {
+    float renderScale = 1.0f;           // resolution of the offscreen target relative to the viewport
+    int lodBias = 0;                    // added to the LOD level chosen by distance (bump sphere)
+    float contributionCullPixels = 0.0f; // objects with a smaller projected radius are not drawn, 0 disables
+    int bumpFeatureLevel = 2;           // 2: all bump features, 1: no displacement, 0: no normal mapping either
+};
+
+/*
+ * The governor compares the slower of CPU and GPU frame time, smoothed with an exponential moving average,
+ * to the frame budget. It lowers the quality one level after the budget was exceeded for several frames
+ * and raises it again only after a longer time well below the budget. After every change it waits, so that
+ * the new level can show its effect and the level does not oscillate.
+ */
+class QualityGovernor
+{
+public:
+    static constexpr int levelCount = 6;
+    static constexpr int framesAboveBudget = 10;  // frames over budget before the quality is lowered
+    static constexpr int framesBelowBudget = 90;  // frames under the lower threshold before it is raised
+    static constexpr int cooldownFrames = 30;     // no change for this many frames after a change
+    static constexpr double raiseThreshold = 0.7; // fraction of the budget below which the quality is raised
+    static constexpr double smoothing = 0.1;      // weight of the newest frame in the moving average
+
+    static QualitySettings settingsForLevel(int level);
+
+    void setEnabled(bool enable);
+    bool isEnabled() const { return enabled; }
+    void setFrameBudgetMs(double ms) { budgetMs = ms; }
+    double getFrameBudgetMs() const { return budgetMs; }
+
+    // Feeds the times of one frame. Returns true if the quality level changed.
+    bool update(double cpuMs, double gpuMs);
+
+    // 0 is the highest quality
+    int getLevel() const { return level; }
+    double getSmoothedMs() const { return smoothedMs; }
+    QualitySettings getSettings() const { return settingsForLevel(level); }
+
+private:
+    bool enabled = false;
+    double budgetMs = 1000.0 / 60.0;
+    double smoothedMs = 0.0;
+    bool hasSample = false;
+    int level = 0;
+    int overCount = 0;
+    int underCount = 0;
+    int cooldown = 0;
+};
+
+#endif // QUALITYGOVERNOR_H
@@ -5,79 +5,76 @@
 #ifndef UEBUNG_03_RENDERSTATE_H
 #define UEBUNG_03_RENDERSTATE_H
 
-#include <stack>
 #include <QMatrix3x3>
 #include <QMatrix4x4>
-#include <QOpenGLFunctions_3_3_Core>
 
+#include "glfunctions.h"
+#include "matrixstack.h"
 #include "vec3.h"
 
+class DebugDraw;
+
 class RenderState {
     Vec3f lightPos;
     GLuint activeProgram{}, standardProgram{};
-    std::stack<QMatrix4x4> modelViewMatrixStack;
-    std::stack<QMatrix4x4> projectionMatrixStack;
-    QOpenGLFunctions_3_3_Core* f;
+    DebugDraw* debugDraw{}; // batched debug lines of the frame, may be nullptr
+    MatrixStack modelViewMatrixStack;
+    MatrixStack projectionMatrixStack;
+    GLFunctions* f;
     GLint modelViewMatrixUniformStandard{-1}, projectionMatrixUniformStandard{-1}, normalMatrixUniformStandard{-1}, lightPositionUniformStandard{-1},
             cameraPositionUniformStandard{-1}, textureUniformStandard{-1}, normalMapUniformStandard{-1}, useTextureUniformStandard{-1};
     GLint modelViewMatrixUniform{-1}, projectionMatrixUniform{-1}, normalMatrixUniform{-1}, lightPositionUniform{-1},
         cameraPositionUniform{-1}, textureUniform{-1}, normalMapUniform{-1}, useTextureUniform{-1};
-
-    static void loadIdentity(std::stack<QMatrix4x4>& stack) {
-        if (!stack.empty()) {
-            stack.top().setToIdentity();
-        }
-    }
+    unsigned int drawCalls{0};
 
 public:
-    explicit RenderState(QOpenGLFunctions_3_3_Core* f = nullptr) : f(f) {
-        //Put the identity matrix on all stacks
-        modelViewMatrixStack.emplace();
-        projectionMatrixStack.emplace();
-    }
+    explicit RenderState(GLFunctions* f = nullptr) : f(f) {}
 
-    void setOpenGLFunctions(QOpenGLFunctions_3_3_Core* f) {
+    void setOpenGLFunctions(GLFunctions* f) {
         this->f = f;
     }
 
-    QOpenGLFunctions_3_3_Core* getOpenGLFunctions() {
+    GLFunctions* getOpenGLFunctions() {
         return f;
     }
 
     void loadIdentityModelViewMatrix() {
-        loadIdentity(modelViewMatrixStack);
+        modelViewMatrixStack.loadIdentity();
     }
 
     void loadIdentityProjectionMatrix() {
-        loadIdentity(projectionMatrixStack);
+        projectionMatrixStack.loadIdentity();
     }
 
     void pushModelViewMatrix() {
-        modelViewMatrixStack.push(modelViewMatrixStack.top());
+        modelViewMatrixStack.push();
     }
     void popModelViewMatrix() {
-        if (modelViewMatrixStack.size() > 1)
-            modelViewMatrixStack.pop();
-        else loadIdentityModelViewMatrix();
+        modelViewMatrixStack.pop();
     }
 
     void pushProjectionMatrix() {
-        projectionMatrixStack.push(projectionMatrixStack.top());
+        projectionMatrixStack.push();
     }
 
     void popProjectionMatrix() {
-        if (projectionMatrixStack.size() > 1)
-            projectionMatrixStack.pop();
-        else loadIdentityProjectionMatrix();
+        projectionMatrixStack.pop();
     }
 
-    QMatrix4x4& getCurrentModelViewMatrix() { return modelViewMatrixStack.top(); }
-    QMatrix4x4& getCurrentProjectionMatrix() { return projectionMatrixStack.top(); }
+    // Changes of the model view matrix go through these functions, so the normal matrix can be derived cheaply
+    void translateModelViewMatrix(float x, float y, float z) { modelViewMatrixStack.translate(x, y, z); }
+    void scaleModelViewMatrix(float x, float y, float z) { modelViewMatrixStack.scale(x, y, z); }
+    void lookAt(const QVector3D& eye, const QVector3D& center, const QVector3D& up) { modelViewMatrixStack.lookAt(eye, center, up); }
+
+    QMatrix4x4& getCurrentProjectionMatrix() { return projectionMatrixStack.modify(); }
     const QMatrix4x4& getCurrentModelViewMatrix() const { return modelViewMatrixStack.top(); }
     const QMatrix4x4& getCurrentProjectionMatrix() const { return projectionMatrixStack.top(); }
-    QMatrix3x3 calculateNormalMatrix() const { return modelViewMatrixStack.top().normalMatrix(); }
+    // cached per model view matrix, see MatrixStack
+    const QMatrix3x3& calculateNormalMatrix() const { return modelViewMatrixStack.normalMatrix(); }
     GLuint getCurrentProgram() const { return activeProgram; }
     GLuint getStandardProgram() const { return standardProgram; }
+    DebugDraw* getDebugDraw() const { return debugDraw; }
+    void setDebugDraw(DebugDraw* debugDraw) { this->debugDraw = debugDraw; }
 
     void setCurrentProgram(GLuint nextProgram) {
         f->glUseProgram(nextProgram);
@@ -130,10 +127,19 @@ public:
     GLint getNormalMapUniform() const { return normalMapUniform; }
     GLint getUseTextureUniform() const { return useTextureUniform; }
 
+    // draw call statistics, reset once per frame
+    void countDrawCall() { ++drawCalls; }
+    void resetDrawCalls() { drawCalls = 0; }
+    unsigned int getDrawCalls() const { return drawCalls; }
+
     Vec3f& getLightPos() {
         return lightPos;
     }
 
+    const Vec3f& getLightPos() const {
+        return lightPos;
+    }
+
     void setLightUniform() {
         QVector4D Qlp4d(lightPos.x(), lightPos.y(), lightPos.z(), 1.0f);
         Qlp4d = getCurrentModelViewMatrix().map(Qlp4d);
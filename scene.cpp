@@ -0,0 +1,1200 @@
+// ========================================================================= //
+// Authors: Daniel Rutz, Daniel Ströter, Roman Getto, Matthias Bein          //
+//                                                                           //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Scene content and render loop shared by the interactive view    //
+//          and the headless benchmark                                       //
+// ========================================================================= //
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <random>
+
+#include <QMatrix4x4>
+
+#include "log.h"
+#include "meshkernels.h"
+#include "profiler.h"
+#include "shader.h"
+#include "scene.h"
+
+Scene::Scene()
+    : prepasses{{{{}, "bump sphere", "bump sphere depth", "bump sphere shading"},
+                 {{}, "objects", "objects depth", "objects shading"},
+                 {{}, "terrain", "terrain depth", "terrain shading"}}}
+{
+}
+
+Scene::~Scene()
+{
+}
+
+void Scene::generateRandomPosition(unsigned int objectCount)
+{
+    std::uniform_real_distribution<float> dist(-5.0f, 5.0f);
+
+    while (objectPositions.size() < objectCount)
+    {
+        // evaluation order of function arguments is unspecified, so draw the coordinates one after another
+        const float x = dist(positionGenerator);
+        const float y = dist(positionGenerator);
+        const float z = dist(positionGenerator);
+        objectPositions.push_back(Vec3f(x, y, z));
+    }
+}
+
+void Scene::setSeed(unsigned int seed)
+{
+    this->seed = seed;
+    positionGenerator.seed(seed);
+    terrainGenerator.seed(seed + 1);
+    const size_t positionCount = std::max<size_t>(500, objectPositions.size());
+    objectPositions.clear();
+    generateRandomPosition(static_cast<unsigned int>(positionCount));
+    staticBatchDirty = true;
+    pointLightsDirty = true;
+    if (meshes.size() > 1)
+    {
+        meshes[1].clear();
+        meshes[1].generateTerrain(50, 50, 4000, terrainGenerator());
+        pullBuffers.update(pulledMeshes[1], meshes[1].getData());
+    }
+    terrainGeneration = 0;
+}
+
+void Scene::setGridSize(int gridSize)
+{
+    this->gridSize = gridSize;
+    generateRandomPosition(getObjectCount());
+    staticBatchDirty = true;
+}
+
+void Scene::toggleStaticBatching(bool enable)
+{
+    staticBatchingEnabled = enable;
+}
+
+void Scene::toggleVertexPulling(bool enable)
+{
+    vertexPullingEnabled = enable;
+}
+
+bool Scene::beginVertexPulling(GLuint pullProgram, GLuint fallbackProgram)
+{
+    if (pullProgram == 0)
+        return false;
+    state.setCurrentProgram(pullProgram);
+    state.setLightUniform();
+    if (pullBuffers.bind(state))
+        return true;
+    state.setCurrentProgram(fallbackProgram);
+    state.setLightUniform();
+    return false;
+}
+
+void Scene::setDepthPrepass(ShadedPass pass, DepthPrepassMode mode)
+{
+    prepasses[static_cast<int>(pass)].selector.setMode(mode);
+}
+
+void Scene::setDepthPrepass(DepthPrepassMode mode)
+{
+    for (auto &prepass : prepasses)
+        prepass.selector.setMode(mode);
+}
+
+void Scene::updateDepthPrepasses()
+{
+    for (auto &prepass : prepasses)
+    {
+        const GpuTimer::PassTime without = gpuTimer.getPassTime(prepass.name);
+        const GpuTimer::PassTime depth = gpuTimer.getPassTime(prepass.depthName);
+        const GpuTimer::PassTime shading = gpuTimer.getPassTime(prepass.shadingName);
+        const DepthPrepassSelector::Cost with{depth.averageMs + shading.averageMs, std::min(depth.samples, shading.samples)};
+        if (prepass.selector.update({without.averageMs, without.samples}, with))
+        {
+            // the next measurement only contains frames drawn the new way
+            for (const char *name : {prepass.name, prepass.depthName, prepass.shadingName})
+                gpuTimer.resetPass(name);
+        }
+    }
+}
+
+bool Scene::beginDepthPrepass(ShadedPass pass, GLuint program)
+{
+    const Prepass &prepass = prepasses[static_cast<int>(pass)];
+    if (program == 0 || !prepass.selector.usePrepass())
+    {
+        gpuTimer.beginPass(prepass.name);
+        return false;
+    }
+    gpuTimer.beginPass(prepass.depthName);
+    overdrawMeter.setCounting(false);
+    f->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    state.setCurrentProgram(program);
+    return true;
+}
+
+void Scene::beginShadingAfterPrepass(ShadedPass pass, GLuint shadingProgram)
+{
+    gpuTimer.endPass();
+    f->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    // gl_Position is invariant in all shaders, so the visible fragments have exactly the stored depth
+    f->glDepthFunc(GL_LEQUAL);
+    f->glDepthMask(GL_FALSE);
+    state.setCurrentProgram(shadingProgram);
+    overdrawMeter.setCounting(true);
+    gpuTimer.beginPass(prepasses[static_cast<int>(pass)].shadingName);
+}
+
+void Scene::endShading(bool prepass)
+{
+    gpuTimer.endPass();
+    if (prepass)
+    {
+        f->glDepthMask(GL_TRUE);
+        f->glDepthFunc(GL_LESS);
+    }
+}
+
+void Scene::setOverdrawMeasurement(bool enable, bool heatmap)
+{
+    if (enable && !overdrawEnabled)
+        overdrawMeter.resetStatistics();
+    overdrawEnabled = enable;
+    overdrawHeatmap = heatmap;
+}
+
+void Scene::toggleDeferredShading(bool enable)
+{
+    if (enable == deferredEnabled)
+        return;
+    deferredEnabled = enable;
+    // the shaded passes cost differently now, the pre-pass selectors start measuring again
+    for (const auto &prepass : prepasses)
+    {
+        for (const char *name : {prepass.name, prepass.depthName, prepass.shadingName})
+            gpuTimer.resetPass(name);
+    }
+}
+
+void Scene::toggleVisibilityBuffer(bool enable)
+{
+    if (enable == visibilityEnabled)
+        return;
+    visibilityEnabled = enable;
+    // like toggleDeferredShading(): the selectors measure the passes drawn the new way
+    for (const auto &prepass : prepasses)
+    {
+        for (const char *name : {prepass.name, prepass.depthName, prepass.shadingName})
+            gpuTimer.resetPass(name);
+    }
+}
+
+void Scene::setPointLightCount(unsigned int count)
+{
+    pointLightCount = count;
+    pointLightsDirty = true;
+    pointLightUniformsDirty = true;
+}
+
+void Scene::toggleClusteredLighting(bool enable)
+{
+    if (enable && !clusteredEnabled)
+        lightClusters.resetStatistics();
+    clusteredEnabled = enable;
+}
+
+void Scene::measureClusterLightsPerPixel()
+{
+    if (!lastFrameClustered)
+        return;
+    GLint drawFramebuffer = 0;
+    f->glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+    // the depth is in the offscreen target if the frame was rendered into it
+    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, lastFrameScaled ? scaledFBO : static_cast<GLuint>(drawFramebuffer));
+    lightClusters.measureLightsPerPixel();
+    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(drawFramebuffer));
+}
+
+void Scene::collectPointLightPrograms()
+{
+    std::vector<GLuint> programs = programIDs;
+    programs.insert(programs.end(), pullProgramIDs.begin(), pullProgramIDs.end());
+    programs.push_back(bumpProgramID);
+    programs.push_back(visibilityResolveProgramID);
+    pointLightPrograms.clear();
+    for (GLuint program : programs)
+    {
+        if (program != 0)
+            pointLightPrograms.push_back({program, f->glGetUniformLocation(program, "useClusters"),
+                                          LightClusters::uniformLocations(f, program)});
+    }
+}
+
+bool Scene::updatePointLights(int width, int height, bool clustered)
+{
+    PROFILE_FUNCTION();
+    if (pointLightsDirty && meshes.size() > 1)
+    {
+        // over the terrain and up to two units above its highest point
+        const Vec3f boundsMin = meshes[1].getBoundingBoxMin();
+        const Vec3f boundsMax = meshes[1].getBoundingBoxMax() + Vec3f(0.0f, 2.0f, 0.0f);
+        pointLights.generate(pointLightCount, boundsMin, boundsMax, seed + 2);
+        pointLightsDirty = false;
+    }
+    // glUseProgram() instead of state.setCurrentProgram(), which would look up all its uniforms for every
+    // program; the program of state is made current again at the end
+    bool programsSwitched = false;
+    if (pointLightUniformsDirty)
+    {
+        collectPointLightPrograms();
+        // also with no lights: the samplers must not stay on unit 0, where the materials bind 2D textures
+        for (const PointLightProgram& entry : pointLightPrograms)
+        {
+            f->glUseProgram(entry.program);
+            f->glUniform1i(f->glGetUniformLocation(entry.program, "pointLights"), PointLights::textureUnit);
+            f->glUniform1i(f->glGetUniformLocation(entry.program, "pointLightCount"), static_cast<GLint>(pointLights.getCount()));
+            f->glUniform1i(f->glGetUniformLocation(entry.program, "clusterRanges"), LightClusters::rangesUnit);
+            f->glUniform1i(f->glGetUniformLocation(entry.program, "clusterLightIndices"), LightClusters::indicesUnit);
+            f->glUniform1i(entry.useClustersUniform, 0);
+        }
+        clusterUniformsEnabled = false;
+        pointLightUniformsDirty = false;
+        programsSwitched = true;
+    }
+    bool useClusters = false;
+    if (pointLights.getCount() > 0)
+    {
+        pointLights.animate(pointLightTime);
+        pointLightTime += 1.0f / 60.0f;
+        pointLights.upload(f, state.getCurrentModelViewMatrix());
+        pointLights.bindTexture();
+        // the lists of all lights may not fit into a buffer texture, the shaders loop over all lights then
+        useClusters = clustered && lightClusters.bin(f, pointLights.getUploadedData(), state.getCurrentProjectionMatrix(), width, height);
+        if (useClusters)
+            lightClusters.bindTextures();
+    }
+    // the cluster geometry changes every frame, with the depth of the farthest light; useClusters only
+    // when the clusters are switched
+    if (useClusters || clusterUniformsEnabled)
+    {
+        for (const PointLightProgram& entry : pointLightPrograms)
+        {
+            f->glUseProgram(entry.program);
+            if (useClusters != clusterUniformsEnabled)
+                f->glUniform1i(entry.useClustersUniform, useClusters ? 1 : 0);
+            if (useClusters)
+                lightClusters.setUniforms(entry.clusterUniforms);
+        }
+        clusterUniformsEnabled = useClusters;
+        programsSwitched = true;
+    }
+    if (programsSwitched)
+        f->glUseProgram(state.getCurrentProgram());
+    return useClusters;
+}
+
+bool Scene::updateStaticBatch()
+{
+    if (staticBatchDirty)
+    {
+        // the translations accumulate like the modelView matrix of the per object draws
+        std::vector<Vec3f> translations(getObjectCount());
+        Vec3f offset(0.0f, 0.0f, 0.0f);
+        for (size_t i = 0; i < translations.size(); ++i)
+        {
+            offset += objectPositions[i];
+            translations[i] = offset;
+        }
+        staticBatchValid = staticBatch.setInstances(translations);
+        staticBatchDirty = false;
+    }
+    return staticBatchValid;
+}
+
+void Scene::initialize(GLFunctions *f)
+{
+    PROFILE_FUNCTION();
+    this->f = f;
+    generateRandomPosition(std::max(500u, getObjectCount()));
+    state.setOpenGLFunctions(f);
+
+    // black screen
+    f->glClearColor(0.f, 0.f, 0.f, 1.f);
+    // enable depth buffer
+    f->glEnable(GL_DEPTH_TEST);
+
+    // the models are read and processed on worker threads while the textures are loaded
+    auto loadMesh = [](const char *fileName) {
+        MeshData data;
+        data.loadOFF(fileName);
+        return data;
+    };
+    std::future<MeshData> sphereData = std::async(std::launch::async, loadMesh, "../Models/sphere.off");
+    std::future<MeshData> planeData = std::async(std::launch::async, loadMesh, "../Models/doppeldecker.off");
+
+    GLuint testTexture = loadImageIntoTexture(f, "../Textures/TEST_GRID.bmp");
+
+    GLuint diffuseTexture = loadImageIntoTexture(f, "../Textures/rough_block_wall_diff_1k.jpg", true);
+    GLuint normalTexture = loadImageIntoTexture(f, "../Textures/rough_block_wall_nor_1k.jpg", true);
+    GLuint displacementTexture = loadImageIntoTexture(f, "../Textures/rough_block_wall_disp_1k.jpg", true);
+
+    // Load the sphere of the light
+    sphereMesh.setGLFunctionPtr(f);
+    sphereMesh.setData(sphereData.get());
+    sphereMesh.setStaticColor(Vec3f(1.0f, 1.0f, 0.0f));
+
+    // load meshes
+    meshes.emplace_back(f);
+    meshes[0].setData(planeData.get());
+    meshes[0].setStaticColor(Vec3f(0.0f, 1.0f, 0.0f));
+    meshes[0].setTexture(testTexture);
+    meshes[0].setColoringMode(TriangleMesh::ColoringType::TEXTURE);
+
+    meshes.emplace_back(f);
+    meshes[1].generateTerrain(50, 50, 4000, terrainGenerator());
+    meshes[1].setStaticColor(Vec3f(1.f, 1.f, 0.f));
+    meshes[1].setColoringMode(TriangleMesh::ColoringType::COLOR_ARRAY);
+
+    // longitude and latitude divisions of the LOD levels
+    const int sphereDivisions[bumpSphereLodCount][2] = {{200, 100}, {100, 50}, {48, 24}};
+    for (int lod = 0; lod < bumpSphereLodCount; ++lod)
+    {
+        TriangleMesh &sphere = bumpSphereLods[lod];
+        sphere.generateSphere(f, sphereDivisions[lod][0], sphereDivisions[lod][1]);
+        sphere.setStaticColor(Vec3f(0.8f, 0.8f, 0.8f));
+        sphere.setColoringMode(TriangleMesh::ColoringType::BUMP_MAPPING);
+        sphere.setTexture(diffuseTexture);
+        sphere.setNormalTexture(normalTexture);
+        sphere.setDisplacementTexture(displacementTexture);
+    }
+
+    // the static batch keeps its own copy of the doppeldecker
+    staticBatch.setSource(meshes[0].getData());
+    staticBatchDirty = true;
+    // and so do the buffers of vertex pulling
+    for (const auto &mesh : meshes)
+        pulledMeshes.push_back(pullBuffers.add(mesh.getData()));
+
+    // only the terrain is generated again later, the other meshes keep just their VBOs and bounding boxes
+    meshes[0].releaseCPUData();
+    for (auto &sphere : bumpSphereLods)
+        sphere.releaseCPUData();
+
+    // load skybox
+    createSkybox();
+
+    // load shaders
+    GLuint lightShaderID = readShaders(f, "../Shader/only_mvp.vert", "../Shader/constant_color.frag");
+    if (lightShaderID)
+    {
+        programIDs.push_back(lightShaderID);
+        pullProgramIDs.push_back(readShaders(f, "../Shader/pull.vert", "../Shader/constant_color.frag"));
+        state.setStandardProgram(lightShaderID);
+    }
+    GLuint shaderID = readShaders(f, "../Shader/only_mvp.vert", "../Shader/lambert.frag");
+    if (shaderID != 0)
+    {
+        programIDs.push_back(shaderID);
+        pullProgramIDs.push_back(readShaders(f, "../Shader/pull.vert", "../Shader/lambert.frag"));
+    }
+    currentProgramID = lightShaderID;
+
+    bumpProgramID = readShaders(f, "../Shader/bump.vert", "../Shader/bump.frag");
+    normalProgramID = readShaders(f, "../Shader/normals.vert", "../Shader/normals.geom", "../Shader/constant_color.frag");
+    debugLineProgramID = readShaders(f, "../Shader/debug_lines.vert", "../Shader/constant_color.frag");
+    depthProgramID = readShaders(f, "../Shader/depth_only.vert", "../Shader/depth_only.frag");
+    bumpDepthProgramID = readShaders(f, "../Shader/bump.vert", "../Shader/depth_only.frag");
+    overdrawProgramID = readShaders(f, "../Shader/fullscreen.vert", "../Shader/overdraw.frag");
+    gbufferProgramID = readShaders(f, "../Shader/only_mvp.vert", "../Shader/gbuffer.frag");
+    gbufferPullProgramID = readShaders(f, "../Shader/pull.vert", "../Shader/gbuffer.frag");
+    gbufferBumpProgramID = readShaders(f, "../Shader/bump.vert", "../Shader/gbuffer_bump.frag");
+    deferredSunProgramID = readShaders(f, "../Shader/fullscreen.vert", "../Shader/deferred_sun.frag");
+    lightVolumeProgramID = readShaders(f, "../Shader/light_volume.vert", "../Shader/depth_only.frag");
+    deferredLightProgramID = readShaders(f, "../Shader/light_volume.vert", "../Shader/deferred_light.frag");
+    visibilityProgramID = readShaders(f, "../Shader/pull.vert", "../Shader/visibility.frag");
+    visibilityResolveProgramID = readShaders(f, "../Shader/fullscreen.vert", "../Shader/visibility_resolve.frag");
+    debugDraw.initialize(f, debugLineProgramID, normalProgramID);
+    state.setDebugDraw(&debugDraw);
+
+    // normal arrows and bounding boxes are no longer uploaded with every mesh
+    size_t debugBytesSaved = sphereMesh.getBuffers().getDebugBytesSaved();
+    for (const auto &mesh : meshes)
+        debugBytesSaved += mesh.getBuffers().getDebugBytesSaved();
+    for (const auto &sphere : bumpSphereLods)
+        debugBytesSaved += sphere.getBuffers().getDebugBytesSaved();
+    LOG_INFO(Mesh, "debug geometry not created: {} KiB", debugBytesSaved / 1024);
+
+    gpuTimer.initialize(f);
+    overdrawMeter.initialize(f, overdrawProgramID);
+    deferred.initialize(f, deferredSunProgramID, lightVolumeProgramID, deferredLightProgramID);
+    visibility.initialize(f, visibilityProgramID, visibilityResolveProgramID);
+    pointLightsDirty = pointLightUniformsDirty = true;
+}
+
+void Scene::cleanup()
+{
+    if (!f)
+        return;
+    meshes.clear();
+    sphereMesh.clear();
+    for (auto &sphere : bumpSphereLods)
+        sphere.clear();
+    deleteScaledTarget();
+    staticBatch.release();
+    pullBuffers.release();
+    pullBuffers.clear();
+    pulledMeshes.clear();
+    state.setDebugDraw(nullptr);
+    debugDraw.cleanup();
+    if (skyboxVAO != 0)
+        f->glDeleteVertexArrays(1, &skyboxVAO);
+    if (skyboxVBO != 0)
+        f->glDeleteBuffers(1, &skyboxVBO);
+    if (skyboxTexture != 0)
+        f->glDeleteTextures(1, &skyboxTexture);
+    if (skyboxProgramID != 0)
+        f->glDeleteProgram(skyboxProgramID);
+    for (GLuint progID : programIDs)
+        f->glDeleteProgram(progID);
+    for (GLuint progID : pullProgramIDs)
+    {
+        if (progID != 0)
+            f->glDeleteProgram(progID);
+    }
+    if (bumpProgramID != 0)
+        f->glDeleteProgram(bumpProgramID);
+    if (normalProgramID != 0)
+        f->glDeleteProgram(normalProgramID);
+    if (debugLineProgramID != 0)
+        f->glDeleteProgram(debugLineProgramID);
+    for (GLuint progID : {depthProgramID, bumpDepthProgramID, overdrawProgramID, gbufferProgramID, gbufferPullProgramID,
+                          gbufferBumpProgramID, deferredSunProgramID, lightVolumeProgramID, deferredLightProgramID,
+                          visibilityProgramID, visibilityResolveProgramID})
+    {
+        if (progID != 0)
+            f->glDeleteProgram(progID);
+    }
+    programIDs.clear();
+    pullProgramIDs.clear();
+    gpuTimer.cleanup();
+    overdrawMeter.cleanup();
+    deferred.cleanup();
+    visibility.cleanup();
+    pointLights.release();
+    lightClusters.release();
+    pointLightPrograms.clear();
+    clusterUniformsEnabled = lastFrameClustered = false;
+    skyboxVAO = skyboxVBO = skyboxTexture = skyboxProgramID = bumpProgramID = normalProgramID = debugLineProgramID = 0;
+    depthProgramID = bumpDepthProgramID = overdrawProgramID = 0;
+    gbufferProgramID = gbufferPullProgramID = gbufferBumpProgramID = 0;
+    deferredSunProgramID = lightVolumeProgramID = deferredLightProgramID = 0;
+    visibilityProgramID = visibilityResolveProgramID = 0;
+}
+
+void Scene::resize(int width, int height)
+{
+    viewportWidth = std::max(width, 1);
+    viewportHeight = std::max(height, 1);
+    // Calculate new projection matrix
+    // from the clamped size, a window of height 0 would give an infinite projection
+    const float aspectRatio = static_cast<float>(viewportWidth) / static_cast<float>(viewportHeight);
+    state.loadIdentityProjectionMatrix();
+    state.getCurrentProjectionMatrix().perspective(65.f, aspectRatio, 0.5f, 10000.f);
+
+    // set projection matrix in OpenGL shader
+    state.switchToStandardProgram();
+    f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
+    state.setCurrentProgram(bumpProgramID);
+    f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
+    for (GLuint progID : programIDs)
+    {
+        state.setCurrentProgram(progID);
+        f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
+    }
+    for (GLuint progID : pullProgramIDs)
+    {
+        if (progID == 0)
+            continue;
+        state.setCurrentProgram(progID);
+        f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
+    }
+    // the light passes of the deferred path and the visibility resolve take the projection from state every frame
+    for (GLuint progID : {depthProgramID, bumpDepthProgramID, gbufferProgramID, gbufferPullProgramID, gbufferBumpProgramID,
+                          visibilityProgramID})
+    {
+        if (progID == 0)
+            continue;
+        state.setCurrentProgram(progID);
+        f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
+    }
+
+    // Resize viewport
+    f->glViewport(0, 0, width, height);
+}
+
+void Scene::createSkybox()
+{
+    // TODO(3.2): Draw a skybox
+
+    // shader configuration
+    skyboxProgramID = readShaders(f, "../Shader/skybox1.vert", "../Shader/skybox1.frag");
+
+    // load cubemap imgs
+    const char *filename[6] = {
+        "../Textures/skybox1/pos_x.bmp",
+        "../Textures/skybox1/neg_x.bmp",
+        "../Textures/skybox1/pos_y.bmp",
+        "../Textures/skybox1/neg_y.bmp",
+        "../Textures/skybox1/pos_z.bmp",
+        "../Textures/skybox1/neg_z.bmp"};
+
+    skyboxTexture = loadCubeMap(f, filename);
+
+    // set buffers
+#define SKY_SIZE 20.0f
+    const float skyboxVertices[] = {
+        // positions
+        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
+        -SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
+        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
+        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
+        SKY_SIZE, SKY_SIZE, -SKY_SIZE,
+        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
+
+        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
+        -SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
+        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
+        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
+        -SKY_SIZE, SKY_SIZE, SKY_SIZE,
+        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
+
+        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
+        SKY_SIZE, -SKY_SIZE, SKY_SIZE,
+        SKY_SIZE, SKY_SIZE, SKY_SIZE,
+        SKY_SIZE, SKY_SIZE, SKY_SIZE,
+        SKY_SIZE, SKY_SIZE, -SKY_SIZE,
+        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
+
+        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
+        -SKY_SIZE, SKY_SIZE, SKY_SIZE,
+        SKY_SIZE, SKY_SIZE, SKY_SIZE,
+        SKY_SIZE, SKY_SIZE, SKY_SIZE,
+        SKY_SIZE, -SKY_SIZE, SKY_SIZE,
+        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
+
+        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
+        SKY_SIZE, SKY_SIZE, -SKY_SIZE,
+        SKY_SIZE, SKY_SIZE, SKY_SIZE,
+        SKY_SIZE, SKY_SIZE, SKY_SIZE,
+        -SKY_SIZE, SKY_SIZE, SKY_SIZE,
+        -SKY_SIZE, SKY_SIZE, -SKY_SIZE,
+
+        -SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
+        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
+        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
+        SKY_SIZE, -SKY_SIZE, -SKY_SIZE,
+        -SKY_SIZE, -SKY_SIZE, SKY_SIZE,
+        SKY_SIZE, -SKY_SIZE, SKY_SIZE};
+#undef SKY_SIZE
+    f->glGenVertexArrays(1, &skyboxVAO);
+    f->glGenBuffers(1, &skyboxVBO);
+    f->glBindVertexArray(skyboxVAO);
+    f->glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+    f->glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), skyboxVertices, GL_STATIC_DRAW);
+    f->glEnableVertexAttribArray(0);
+    f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+    f->glBindVertexArray(0);
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Scene::drawSkybox(const QVector3D &cameraPos)
+{
+    PROFILE_FUNCTION();
+    if (skyboxProgramID == 0)
+        return;
+    state.setCurrentProgram(skyboxProgramID);
+    f->glUniform1i(f->glGetUniformLocation(skyboxProgramID, "skybox"), 0);
+
+    // draw
+    f->glDepthFunc(GL_LEQUAL);
+    f->glUniformMatrix4fv(state.getModelViewUniform(), 1, GL_FALSE, state.getCurrentModelViewMatrix().constData());
+    f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
+    f->glUniform3f(state.getCameraPositionUniform(), cameraPos.x(), cameraPos.y(), cameraPos.z());
+
+    f->glBindVertexArray(skyboxVAO);
+    f->glActiveTexture(GL_TEXTURE0);
+    f->glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
+    f->glDrawArrays(GL_TRIANGLES, 0, 36);
+    state.countDrawCall();
+
+    // restore matrix and attributes
+    f->glBindVertexArray(0);
+    f->glDepthFunc(GL_LESS); // set depth function back to default
+}
+
+Scene::FrameStats Scene::render(const QVector3D &cameraPos, const QVector3D &cameraDir)
+{
+    PROFILE_FUNCTION();
+    FrameStats stats;
+    state.resetDrawCalls();
+    gpuTimer.beginFrame();
+    updateDepthPrepasses();
+
+    // render at a lower resolution into the scaled target, it is upscaled at the end of the frame. The
+    // overdraw meter counts in its stencil buffer, and the deferred light passes and the visibility resolve
+    // need a depth and stencil buffer of the format of their buffers, so they use the target at full
+    // resolution as well.
+    GLint targetFramebuffer = 0;
+    const int renderWidth = std::max(1, static_cast<int>(viewportWidth * quality.renderScale));
+    const int renderHeight = std::max(1, static_cast<int>(viewportHeight * quality.renderScale));
+    const bool visibilityShading = visibilityEnabled && visibilityProgramID != 0 && visibilityResolveProgramID != 0;
+    const bool deferredShading = !visibilityShading && deferredEnabled && gbufferProgramID != 0 && gbufferBumpProgramID != 0;
+    bool scaled = quality.renderScale < 1.0f || overdrawEnabled || deferredShading || visibilityShading;
+    if (scaled)
+    {
+        f->glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+        scaled = prepareScaledTarget(renderWidth, renderHeight);
+    }
+    if (scaled)
+    {
+        f->glBindFramebuffer(GL_FRAMEBUFFER, scaledFBO);
+        f->glViewport(0, 0, renderWidth, renderHeight);
+        stats.renderScale = quality.renderScale;
+    }
+    const bool measureOverdraw = scaled && overdrawEnabled && !deferredShading && !visibilityShading;
+    if (measureOverdraw)
+        overdrawMeter.beginFrame(renderWidth, renderHeight);
+
+    // the deferred path draws the geometry into the G-buffer, its light passes add to the cleared color.
+    // The visibility buffer splits the bits of its IDs between the instances and the triangles of the
+    // largest mesh; all meshes are pulled, so it needs one.
+    gpuTimer.beginPass("clear");
+    f->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    const bool deferredFrame = scaled && deferredShading && deferred.beginGeometry(renderWidth, renderHeight);
+    unsigned int maxTriangles = 0;
+    for (const auto &mesh : pulledMeshes)
+        maxTriangles = std::max(maxTriangles, mesh.indexCount / 3);
+    const bool visibilityFrame = scaled && visibilityShading && visibility.beginGeometry(renderWidth, renderHeight, maxTriangles);
+    gpuTimer.endPass();
+    lastShadingPath = deferredFrame ? ShadingPath::Deferred : visibilityFrame ? ShadingPath::Visibility : ShadingPath::Forward;
+    state.loadIdentityModelViewMatrix();
+
+    // translate to center, rotate and render coordinate system and light sphere
+    QVector3D cameraLookAt = cameraPos + cameraDir;
+    static QVector3D upVector(0.0f, 1.0f, 0.0f);
+    state.lookAt(cameraPos, cameraLookAt, upVector);
+    lastFrameClustered = updatePointLights(scaled ? renderWidth : viewportWidth, scaled ? renderHeight : viewportHeight,
+                                           clusteredEnabled && !deferredFrame);
+    lastFrameScaled = scaled;
+    if (!deferredFrame && !visibilityFrame)
+    {
+        gpuTimer.beginPass("skybox");
+        overdrawMeter.beginPass(OverdrawMeter::Skybox);
+        drawSkybox(cameraPos);
+        gpuTimer.endPass();
+        overdrawMeter.endPass();
+
+        gpuTimer.beginPass("coordinate system and light");
+        state.switchToStandardProgram();
+        drawCS();
+        drawLight();
+        gpuTimer.endPass();
+    }
+
+    // programs of the shaded passes
+    const GLuint sphereProgramID = deferredFrame ? gbufferBumpProgramID : bumpProgramID;
+    const GLuint meshProgramID = deferredFrame ? gbufferProgramID : currentProgramID;
+    GLuint pullProgramID = currentProgramIndex < pullProgramIDs.size() ? pullProgramIDs[currentProgramIndex] : 0;
+    if (deferredFrame)
+        pullProgramID = gbufferPullProgramID;
+    else if (visibilityFrame)
+        pullProgramID = visibilityProgramID;
+
+    // draw bump mapping sphere
+    auto drawBumpSphere = [&]() {
+        PROFILE_SCOPE("bump sphere");
+        TriangleMesh &sphere = bumpSphereLods[bumpSphereLod(cameraPos)];
+        state.setCurrentProgram(sphereProgramID);
+        state.pushModelViewMatrix();
+        state.setLightUniform();
+        state.translateModelViewMatrix(0, 5, 0);
+        // parallax occlusion mapping draws the sphere at the largest displacement, the relief lies below it
+        if (parallaxMappingActive())
+            state.scaleModelViewMatrix(2.0f, 2.0f, 2.0f);
+        // the depth of the displaced sphere needs bump.vert, its texture coordinates and its material
+        overdrawMeter.beginPass(OverdrawMeter::BumpSphere);
+        const bool prepass = beginDepthPrepass(ShadedPass::BumpSphere, bumpDepthProgramID);
+        if (prepass)
+        {
+            if (sphere.boundingBoxIsVisible(state))
+                sphere.drawDepth(state, true);
+            beginShadingAfterPrepass(ShadedPass::BumpSphere, sphereProgramID);
+        }
+        stats.bumpSphereTriangles = sphere.draw(state);
+        stats.trianglesDrawn += stats.bumpSphereTriangles;
+        endShading(prepass);
+        overdrawMeter.endPass();
+        state.popModelViewMatrix();
+    };
+    // the vertices of the sphere are displaced by bump.vert, the visibility resolve can not fetch them. It
+    // is shaded forward after the resolve instead.
+    if (!visibilityFrame)
+        drawBumpSphere();
+
+    state.setCurrentProgram(meshProgramID);
+    state.setLightUniform();
+    // draw objects. count triangles and objects drawn.
+    const unsigned int objectCount = getObjectCount();
+    bool pulling = false;
+    overdrawMeter.beginPass(OverdrawMeter::Objects);
+    if (staticBatchingEnabled && !visibilityFrame && updateStaticBatch())
+    {
+        // merged copies of all instances, culled per cluster. No contribution culling.
+        PROFILE_SCOPE("static batch");
+        float planes[24];
+        frustumPlanes(multiplyMatrices(state.getCurrentProjectionMatrix(), state.getCurrentModelViewMatrix()).constData(), planes);
+        const bool prepass = beginDepthPrepass(ShadedPass::Objects, depthProgramID);
+        if (prepass)
+        {
+            staticBatch.draw(state, meshes[0], planes, false);
+            beginShadingAfterPrepass(ShadedPass::Objects, meshProgramID);
+        }
+        stats.trianglesDrawn += staticBatch.draw(state, meshes[0], planes, boundingBoxEnabled);
+        stats.objectsCulled = objectCount - static_cast<unsigned int>(staticBatch.getInstancesDrawn());
+        endShading(prepass);
+    }
+    else
+    {
+        PROFILE_SCOPE("culling and objects");
+        // contribution culling: projected radius in pixels = radius * pixelsPerUnit / depth
+        const bool contributionCull = quality.contributionCullPixels > 0.0f;
+        const Vec3f mid = meshes[0].getBoundingBoxMid();
+        const QVector3D center(mid.x(), mid.y(), mid.z());
+        const float radius = 0.5f * meshes[0].getBoundingBoxSize().length();
+        const float pixelsPerUnit = 0.5f * viewportHeight / std::tan(0.5f * 65.f * static_cast<float>(M_PI) / 180.f);
+        state.pushModelViewMatrix();
+        // frustum culling of all instances at once. The translations accumulate, the bounding box of
+        // instance i is the one of the mesh moved by the first i + 1 positions.
+        float planes[24];
+        frustumPlanes(multiplyMatrices(state.getCurrentProjectionMatrix(), state.getCurrentModelViewMatrix()).constData(), planes);
+        objectCenters.resize(3 * objectCount);
+        objectVisible.resize(objectCount);
+        Vec3f offset = mid;
+        for (unsigned int i = 0; i < objectCount; ++i)
+        {
+            offset += objectPositions[i];
+            objectCenters[3 * i] = offset.x();
+            objectCenters[3 * i + 1] = offset.y();
+            objectCenters[3 * i + 2] = offset.z();
+        }
+        const Vec3f halfSize = 0.5f * meshes[0].getBoundingBoxSize();
+        const float halfExtent[3] = {halfSize.x(), halfSize.y(), halfSize.z()};
+        meshKernels().cullBoxes(planes, objectCenters.data(), objectCount, halfExtent, objectVisible.data());
+        // afterwards objectVisible marks the instances that are drawn
+        for (unsigned int i = 0; i < objectCount; ++i)
+        {
+            state.translateModelViewMatrix(objectPositions[i][0], objectPositions[i][1], objectPositions[i][2]);
+            if (!objectVisible[i])
+            {
+                stats.objectsCulled++;
+                continue;
+            }
+            if (contributionCull)
+            {
+                const float depth = -state.getCurrentModelViewMatrix().map(center).z();
+                if (depth > radius && radius * pixelsPerUnit < quality.contributionCullPixels * depth)
+                {
+                    objectVisible[i] = 0;
+                    stats.objectsCulled++;
+                    stats.objectsTooSmall++;
+                }
+            }
+        }
+        state.popModelViewMatrix();
+
+        // both passes accumulate the translations the same way, so the depth pass gets the same matrices
+        auto drawObjects = [&](bool depthOnly) {
+            state.pushModelViewMatrix();
+            for (unsigned int i = 0; i < objectCount; ++i)
+            {
+                state.translateModelViewMatrix(objectPositions[i][0], objectPositions[i][1], objectPositions[i][2]);
+                if (!objectVisible[i])
+                    continue;
+                if (depthOnly)
+                {
+                    meshes[0].drawDepth(state);
+                    continue;
+                }
+                unsigned int triangles;
+                if (pulling)
+                {
+                    meshes[0].drawDebug(state);
+                    triangles = visibilityFrame ? visibility.draw(state, pullBuffers, meshes[0], pulledMeshes[0])
+                                                : pullBuffers.draw(state, meshes[0], pulledMeshes[0]);
+                }
+                else
+                {
+                    triangles = meshes[0].drawVisible(state);
+                }
+                if (triangles == 0)
+                    stats.objectsCulled++;
+                stats.trianglesDrawn += triangles;
+            }
+            state.popModelViewMatrix();
+        };
+        // the visibility buffer writes 4 bytes per fragment, a depth pre-pass would not save anything
+        const bool prepass = beginDepthPrepass(ShadedPass::Objects, visibilityFrame ? 0 : depthProgramID);
+        if (prepass)
+        {
+            drawObjects(true);
+            beginShadingAfterPrepass(ShadedPass::Objects, meshProgramID);
+        }
+        pulling = (vertexPullingEnabled || visibilityFrame) && beginVertexPulling(pullProgramID, meshProgramID);
+        drawObjects(false);
+        endShading(prepass);
+    }
+    overdrawMeter.endPass();
+    {
+        PROFILE_SCOPE("terrain");
+        overdrawMeter.beginPass(OverdrawMeter::Terrain);
+        const bool prepass = beginDepthPrepass(ShadedPass::Terrain, visibilityFrame ? 0 : depthProgramID);
+        if (prepass)
+        {
+            for (size_t i = 1; i < meshes.size(); ++i)
+            {
+                if (meshes[i].boundingBoxIsVisible(state))
+                    meshes[i].drawDepth(state);
+            }
+            beginShadingAfterPrepass(ShadedPass::Terrain, meshProgramID);
+            pulling = false; // the pull program is no longer current
+        }
+        if ((vertexPullingEnabled || visibilityFrame) && !pulling)
+            pulling = beginVertexPulling(pullProgramID, meshProgramID);
+        for (size_t i = 1; i < meshes.size(); ++i)
+        {
+            if (!pulling)
+            {
+                stats.trianglesDrawn += meshes[i].draw(state);
+            }
+            else if (meshes[i].boundingBoxIsVisible(state))
+            {
+                meshes[i].drawDebug(state);
+                stats.trianglesDrawn += visibilityFrame ? visibility.draw(state, pullBuffers, meshes[i], pulledMeshes[i])
+                                                        : pullBuffers.draw(state, meshes[i], pulledMeshes[i]);
+            }
+        }
+        endShading(prepass);
+        overdrawMeter.endPass();
+    }
+    if (deferredFrame)
+    {
+        PROFILE_SCOPE("deferred lighting");
+        gpuTimer.beginPass("depth copy");
+        deferred.endGeometry(scaledFBO);
+        gpuTimer.endPass();
+        gpuTimer.beginPass("main light");
+        deferred.drawMainLight(state);
+        gpuTimer.endPass();
+        gpuTimer.beginPass("point lights");
+        deferred.drawPointLights(state, pointLights);
+        gpuTimer.endPass();
+    }
+    if (visibilityFrame)
+    {
+        {
+            PROFILE_SCOPE("visibility resolve");
+            gpuTimer.beginPass("depth copy");
+            visibility.endGeometry(scaledFBO);
+            gpuTimer.endPass();
+            gpuTimer.beginPass("visibility resolve");
+            visibility.resolve(state, pullBuffers);
+            gpuTimer.endPass();
+        }
+        drawBumpSphere();
+    }
+    if (deferredFrame || visibilityFrame)
+    {
+        // the sky and the light sphere against the depth of the geometry passes
+        gpuTimer.beginPass("skybox");
+        drawSkybox(cameraPos);
+        gpuTimer.endPass();
+        gpuTimer.beginPass("coordinate system and light");
+        state.switchToStandardProgram();
+        drawCS();
+        drawLight();
+        gpuTimer.endPass();
+    }
+    {
+        // coordinate system, bounding boxes and normals appended during the frame
+        PROFILE_SCOPE("debug lines");
+        GpuPassScope gpuPass(gpuTimer, "debug lines");
+        debugDraw.flush(state);
+    }
+    if (measureOverdraw)
+    {
+        GpuPassScope gpuPass(gpuTimer, "overdraw");
+        overdrawMeter.endFrame(state, overdrawHeatmap);
+    }
+    if (scaled)
+    {
+        GpuPassScope gpuPass(gpuTimer, "upscale");
+        f->glBindFramebuffer(GL_READ_FRAMEBUFFER, scaledFBO);
+        f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+        f->glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, viewportWidth, viewportHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        f->glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+        f->glViewport(0, 0, viewportWidth, viewportHeight);
+    }
+    stats.objectsDrawn = objectCount - stats.objectsCulled;
+    stats.drawCalls = state.getDrawCalls();
+    gpuTimer.endFrame();
+    return stats;
+}
+
+void Scene::drawCS()
+{
+    PROFILE_FUNCTION();
+    const QMatrix4x4 &modelView = state.getCurrentModelViewMatrix();
+    const Vec3f origin(0.f, 0.f, 0.f);
+    debugDraw.line(modelView, origin, Vec3f(5.f, 0.f, 0.f), Vec3f(1.f, 0.f, 0.f));
+    debugDraw.line(modelView, origin, Vec3f(0.f, 5.f, 0.f), Vec3f(0.f, 1.f, 0.f));
+    debugDraw.line(modelView, origin, Vec3f(0.f, 0.f, 5.f), Vec3f(0.f, 0.f, 1.f));
+}
+
+void Scene::drawLight()
+{
+    PROFILE_FUNCTION();
+    // draw yellow sphere for light source
+    state.pushModelViewMatrix();
+    Vec3f &lp = state.getLightPos();
+    state.translateModelViewMatrix(lp.x(), lp.y(), lp.z());
+    sphereMesh.draw(state);
+    state.popModelViewMatrix();
+}
+
+unsigned int Scene::addProgram(GLuint programID)
+{
+    programIDs.push_back(programID);
+    pointLightUniformsDirty = true;
+    return programIDs.size() - 1;
+}
+
+void Scene::setCurrentProgram(unsigned int index)
+{
+    currentProgramID = programIDs.at(index);
+    currentProgramIndex = index;
+}
+
+void Scene::changeColoringMode(TriangleMesh::ColoringType type)
+{
+    coloringMode = static_cast<int>(type);
+    for (auto &mesh : meshes)
+        mesh.setColoringMode(type);
+    // the terrain may have got texture coordinates
+    if (pulledMeshes.size() > 1)
+        pullBuffers.update(pulledMeshes[1], meshes[1].getData());
+}
+
+void Scene::toggleBoundingBox(bool enable)
+{
+    boundingBoxEnabled = enable;
+    for (auto &mesh : meshes)
+        mesh.toggleBB(enable);
+    for (auto &sphere : bumpSphereLods)
+        sphere.toggleBB(enable);
+}
+
+void Scene::toggleNormals(bool enable)
+{
+    normalsEnabled = enable;
+    for (auto &mesh : meshes)
+        mesh.toggleNormals(enable);
+    for (auto &sphere : bumpSphereLods)
+        sphere.toggleNormals(enable);
+}
+
+void Scene::toggleDiffuse(bool enable)
+{
+    diffuseEnabled = enable;
+    applyBumpFeatures();
+}
+
+void Scene::toggleNormalMapping(bool enable)
+{
+    normalMappingEnabled = enable;
+    applyBumpFeatures();
+}
+
+void Scene::toggleDisplacementMapping(bool enable)
+{
+    displacementEnabled = enable;
+    applyBumpFeatures();
+}
+
+void Scene::toggleParallaxMapping(bool enable)
+{
+    parallaxEnabled = enable;
+    applyBumpFeatures();
+}
+
+void Scene::applyBumpFeatures()
+{
+    const bool displacement = displacementEnabled && quality.bumpFeatureLevel >= 2;
+    for (auto &sphere : bumpSphereLods)
+    {
+        sphere.toggleDiffuse(diffuseEnabled);
+        sphere.toggleNormalMapping(normalMappingEnabled && quality.bumpFeatureLevel >= 1);
+        sphere.toggleDisplacementMapping(displacement && !parallaxEnabled);
+        sphere.toggleParallaxMapping(displacement && parallaxEnabled);
+    }
+}
+
+void Scene::setQualitySettings(const QualitySettings &settings)
+{
+    quality = settings;
+    quality.renderScale = std::clamp(quality.renderScale, 0.1f, 1.0f);
+    applyBumpFeatures();
+}
+
+unsigned int Scene::bumpSphereLod(const QVector3D &cameraPos) const
+{
+    // The vertex displacement needs the fine spheres for its detail. Parallax occlusion mapping finds it per
+    // pixel, the geometry only has to give the outline: the coarsest sphere at every distance.
+    if (parallaxMappingActive())
+        return bumpSphereLodCount - 1;
+    // one level coarser for every doubling of the distance beyond 15 units
+    const float distance = (cameraPos - QVector3D(0.0f, 5.0f, 0.0f)).length();
+    const int lod = distance > 15.0f ? 1 + static_cast<int>(std::log2(distance / 15.0f)) : 0;
+    return static_cast<unsigned int>(std::clamp(lod + quality.lodBias, 0, bumpSphereLodCount - 1));
+}
+
+bool Scene::prepareScaledTarget(int width, int height)
+{
+    if (scaledFBO != 0 && width == scaledWidth && height == scaledHeight)
+        return true;
+    deleteScaledTarget();
+
+    f->glGenRenderbuffers(1, &scaledColorRenderbuffer);
+    f->glBindRenderbuffer(GL_RENDERBUFFER, scaledColorRenderbuffer);
+    f->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    f->glGenRenderbuffers(1, &scaledDepthRenderbuffer);
+    f->glBindRenderbuffer(GL_RENDERBUFFER, scaledDepthRenderbuffer);
+    f->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    f->glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLint formerFramebuffer = 0;
+    f->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &formerFramebuffer);
+    f->glGenFramebuffers(1, &scaledFBO);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, scaledFBO);
+    f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, scaledColorRenderbuffer);
+    f->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, scaledDepthRenderbuffer);
+    const bool complete = f->glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    f->glBindFramebuffer(GL_FRAMEBUFFER, formerFramebuffer);
+    if (!complete)
+    {
+        LOG_WARNING(Render, "Scene: framebuffer for render scale {} is incomplete", quality.renderScale);
+        deleteScaledTarget();
+        quality.renderScale = 1.0f; // do not try again every frame
+        return false;
+    }
+    scaledWidth = width;
+    scaledHeight = height;
+    return true;
+}
+
+void Scene::deleteScaledTarget()
+{
+    if (scaledFBO != 0)
+        f->glDeleteFramebuffers(1, &scaledFBO);
+    if (scaledColorRenderbuffer != 0)
+        f->glDeleteRenderbuffers(1, &scaledColorRenderbuffer);
+    if (scaledDepthRenderbuffer != 0)
+        f->glDeleteRenderbuffers(1, &scaledDepthRenderbuffer);
+    scaledFBO = scaledColorRenderbuffer = scaledDepthRenderbuffer = 0;
+    scaledWidth = scaledHeight = 0;
+}
+
+void Scene::recreateTerrain()
+{
+    PROFILE_FUNCTION();
+    meshes[1].clear();
+    meshes[1].generateTerrain(50, 50, 4000, terrainGenerator());
+    pullBuffers.update(pulledMeshes[1], meshes[1].getData());
+    pointLightsDirty = true;
+    terrainGeneration++;
+}
+
+void Scene::storeState(CameraPathFrame &frame) const
+{
+    frame.lightPos = state.getLightPos();
+    frame.gridSize = gridSize;
+    frame.coloringMode = coloringMode;
+    frame.shaderIndex = currentProgramIndex;
+    frame.terrainGeneration = terrainGeneration;
+    frame.setFlag(CameraPathFrame::BoundingBox, boundingBoxEnabled);
+    frame.setFlag(CameraPathFrame::Normals, normalsEnabled);
+    frame.setFlag(CameraPathFrame::Diffuse, diffuseEnabled);
+    frame.setFlag(CameraPathFrame::NormalMapping, normalMappingEnabled);
+    frame.setFlag(CameraPathFrame::Displacement, displacementEnabled);
+    frame.setFlag(CameraPathFrame::Parallax, parallaxEnabled);
+    frame.setFlag(CameraPathFrame::StaticBatching, staticBatchingEnabled);
+    frame.setFlag(CameraPathFrame::VertexPulling, vertexPullingEnabled);
+    frame.setFlag(CameraPathFrame::DeferredShading, deferredEnabled);
+    frame.setFlag(CameraPathFrame::ClusteredLighting, clusteredEnabled);
+    frame.setFlag(CameraPathFrame::VisibilityBuffer, visibilityEnabled);
+    frame.pointLightCount = pointLightCount;
+    for (int pass = 0; pass < shadedPassCount; ++pass)
+        frame.setDepthPrepass(pass, static_cast<int>(prepasses[pass].selector.getMode()));
+}
+
+void Scene::applyState(const CameraPathFrame &frame)
+{
+    state.getLightPos() = frame.lightPos;
+    if (frame.gridSize != gridSize)
+        setGridSize(frame.gridSize);
+    if (frame.coloringMode >= 0 && frame.coloringMode != coloringMode)
+        changeColoringMode(static_cast<TriangleMesh::ColoringType>(frame.coloringMode));
+    if (frame.shaderIndex != currentProgramIndex && frame.shaderIndex < programIDs.size())
+        setCurrentProgram(frame.shaderIndex);
+    // the terrain generator is seeded, so generating as often as in the recording gives the same terrain
+    while (terrainGeneration < frame.terrainGeneration)
+        recreateTerrain();
+    if (frame.hasFlag(CameraPathFrame::BoundingBox) != boundingBoxEnabled)
+        toggleBoundingBox(!boundingBoxEnabled);
+    if (frame.hasFlag(CameraPathFrame::Normals) != normalsEnabled)
+        toggleNormals(!normalsEnabled);
+    if (frame.hasFlag(CameraPathFrame::Diffuse) != diffuseEnabled)
+        toggleDiffuse(!diffuseEnabled);
+    if (frame.hasFlag(CameraPathFrame::NormalMapping) != normalMappingEnabled)
+        toggleNormalMapping(!normalMappingEnabled);
+    if (frame.hasFlag(CameraPathFrame::Displacement) != displacementEnabled)
+        toggleDisplacementMapping(!displacementEnabled);
+    if (frame.hasFlag(CameraPathFrame::Parallax) != parallaxEnabled)
+        toggleParallaxMapping(!parallaxEnabled);
+    if (frame.hasFlag(CameraPathFrame::StaticBatching) != staticBatchingEnabled)
+        toggleStaticBatching(!staticBatchingEnabled);
+    if (frame.hasFlag(CameraPathFrame::VertexPulling) != vertexPullingEnabled)
+        toggleVertexPulling(!vertexPullingEnabled);
+    if (frame.hasFlag(CameraPathFrame::DeferredShading) != deferredEnabled)
+        toggleDeferredShading(!deferredEnabled);
+    if (frame.hasFlag(CameraPathFrame::ClusteredLighting) != clusteredEnabled)
+        toggleClusteredLighting(!clusteredEnabled);
+    if (frame.hasFlag(CameraPathFrame::VisibilityBuffer) != visibilityEnabled)
+        toggleVisibilityBuffer(!visibilityEnabled);
+    if (frame.pointLightCount != pointLightCount)
+        setPointLightCount(frame.pointLightCount);
+    // setMode() restarts the measurements of Auto, so only changed modes are applied. Which variant Auto
+    // then chooses depends on the GPU timings of the replay.
+    for (int pass = 0; pass < shadedPassCount; ++pass)
+    {
+        const auto mode = static_cast<DepthPrepassMode>(frame.getDepthPrepass(pass));
+        if (mode != prepasses[pass].selector.getMode())
+            setDepthPrepass(static_cast<ShadedPass>(pass), mode);
+    }
+}
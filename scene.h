@@ -0,0 +1,312 @@
+// ========================================================================= //
+// Authors: Daniel Rutz, Daniel Ströter, Roman Getto, Matthias Bein          //
+//                                                                           //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Scene content and render loop shared by the interactive view    //
+//          and the headless benchmark                                       //
+// ========================================================================= //
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <QVector3D>
+
+#include "camerapath.h"
+#include "debugdraw.h"
+#include "deferredrenderer.h"
+#include "depthprepass.h"
+#include "glfunctions.h"
+#include "gputimer.h"
+#include "lightclusters.h"
+#include "overdrawmeter.h"
+#include "pointlights.h"
+#include "qualitygovernor.h"
+#include "staticbatch.h"
+#include "trianglemesh.h"
+#include "vec3.h"
+#include "vertexpulling.h"
+#include "visibilitybuffer.h"
+#include "renderstate.h"
+
+class Scene
+{
+public:
+    // statistics of one rendered frame
+    struct FrameStats {
+        unsigned int trianglesDrawn = 0;
+        unsigned int drawCalls = 0;
+        unsigned int objectsDrawn = 0;
+        unsigned int objectsCulled = 0;
+        unsigned int objectsTooSmall = 0; // part of objectsCulled, below the contribution cull threshold
+        unsigned int bumpSphereTriangles = 0; // part of trianglesDrawn
+        float renderScale = 1.0f;
+    };
+
+    // passes that can draw a depth pre-pass before shading
+    enum class ShadedPass { BumpSphere, Objects, Terrain };
+    static constexpr int shadedPassCount = 3;
+    // where the built-in materials of a frame were shaded
+    enum class ShadingPath { Forward, Deferred, Visibility };
+
+    Scene();
+    ~Scene();
+    Scene(const Scene& other) = delete;
+    Scene& operator= (const Scene& other) = delete;
+
+    // loads meshes, textures and shaders. Needs a current OpenGL context.
+    void initialize(GLFunctions* f);
+    // releases the GPU resources not owned by a TriangleMesh. Needs the context of initialize().
+    void cleanup();
+    // recalculates the projection matrix and sets the viewport
+    void resize(int width, int height);
+    // renders one frame into the currently bound framebuffer
+    FrameStats render(const QVector3D& cameraPos, const QVector3D& cameraDir);
+
+    // appends random positions until at least objectCount instances can be drawn
+    void generateRandomPosition(unsigned int objectCount = 500);
+    // Restarts the random object positions and terrains with this seed. If the scene is initialized,
+    // the terrain is generated again and the context of initialize() must be current.
+    void setSeed(unsigned int seed);
+    unsigned int getSeed() const { return seed; }
+    const std::vector<Vec3f>& getObjectPositions() const { return objectPositions; }
+
+    void setGridSize(int gridSize);
+    int getGridSize() const { return gridSize; }
+    // number of doppeldecker instances drawn for the current grid size
+    unsigned int getObjectCount() const { return static_cast<unsigned int>(gridSize) * 5; }
+
+    Vec3f& getLightPos() { return state.getLightPos(); }
+
+    // GPU time of the render passes
+    GpuTimer& getGpuTimer() { return gpuTimer; }
+
+    // render resolution, LOD bias, contribution culling and bump features, see QualityGovernor
+    void setQualitySettings(const QualitySettings& settings);
+    const QualitySettings& getQualitySettings() const { return quality; }
+
+    // adds a linked program to the list of selectable shaders. Returns its index.
+    unsigned int addProgram(GLuint programID);
+    // selects the shader used for the meshes. Throws std::out_of_range for unknown indices.
+    void setCurrentProgram(unsigned int index);
+
+    void changeColoringMode(TriangleMesh::ColoringType type);
+    void toggleBoundingBox(bool enable);
+    void toggleNormals(bool enable);
+    void toggleDiffuse(bool enable);
+    void toggleNormalMapping(bool enable);
+    void toggleDisplacementMapping(bool enable);
+    // Displaces the bump sphere per pixel with parallax occlusion mapping in bump.frag instead of moving the
+    // vertices of a fine sphere in bump.vert. The coarsest sphere LOD is drawn then, at the largest displacement.
+    void toggleParallaxMapping(bool enable);
+    bool isParallaxMappingEnabled() const { return parallaxEnabled; }
+    bool isDisplacementMappingEnabled() const { return displacementEnabled; }
+    void recreateTerrain();
+    unsigned int getTerrainGeneration() const { return terrainGeneration; }
+    // Draws the doppeldeckers from a StaticBatch instead of one draw per instance. The batch is updated
+    // when the grid size or the seed changed.
+    void toggleStaticBatching(bool enable);
+    bool isStaticBatchingEnabled() const { return staticBatchingEnabled; }
+    // Draws the meshes with the built-in shaders from VertexPullBuffers instead of their VAOs. Loaded shaders
+    // keep using the VAOs, the static batch takes precedence for the doppeldeckers.
+    void toggleVertexPulling(bool enable);
+    bool isVertexPullingEnabled() const { return vertexPullingEnabled; }
+    // Depth pre-pass of one pass or of all of them, see DepthPrepassSelector. The doppeldeckers and the
+    // terrain use a position-only VAO and depth_only.vert, the bump sphere bump.vert for its displacement.
+    // Auto needs the GPU timer; without its measurements no pre-pass is drawn.
+    void setDepthPrepass(ShadedPass pass, DepthPrepassMode mode);
+    void setDepthPrepass(DepthPrepassMode mode);
+    const DepthPrepassSelector& getDepthPrepass(ShadedPass pass) const { return prepasses[static_cast<int>(pass)].selector; }
+    // GPU timer name of the pass without pre-pass, e.g. "objects"
+    const char* getShadedPassName(ShadedPass pass) const { return prepasses[static_cast<int>(pass)].name; }
+
+    // Counts the fragments shaded per pixel by the skybox, the bump sphere, the doppeldeckers and the terrain,
+    // see OverdrawMeter. The frame is rendered into the offscreen target, also at full resolution. heatmap
+    // replaces the image by the false color counts of all passes.
+    void setOverdrawMeasurement(bool enable, bool heatmap = false);
+    bool isOverdrawMeasured() const { return overdrawEnabled; }
+    OverdrawMeter& getOverdrawMeter() { return overdrawMeter; }
+
+    // Shades the built-in materials in light passes over a G-buffer instead of in the geometry passes, see
+    // DeferredRenderer. The shader selected with setCurrentProgram() is not used then, and no overdraw is
+    // measured. Renders into the offscreen target, also at full resolution.
+    void toggleDeferredShading(bool enable);
+    bool isDeferredShadingEnabled() const { return deferredEnabled; }
+    const DeferredRenderer& getDeferredRenderer() const { return deferred; }
+    // Draws the doppeldeckers and the terrain into a visibility buffer of instance and triangle IDs and
+    // shades every pixel once in a full-screen resolve, see VisibilityBuffer. Takes precedence over deferred
+    // shading and static batching; the bump sphere, whose vertices bump.vert displaces, is shaded forward
+    // after the resolve. No depth pre-pass and no overdraw are measured. Renders into the offscreen target.
+    void toggleVisibilityBuffer(bool enable);
+    bool isVisibilityBufferEnabled() const { return visibilityEnabled; }
+    const VisibilityBuffer& getVisibilityBuffer() const { return visibility; }
+    ShadingPath getLastShadingPath() const { return lastShadingPath; }
+    // Animated point lights over the terrain, in all paths: the forward shaders and the visibility resolve loop
+    // over all of them, the deferred path draws their light volumes. Their positions depend on the seed.
+    void setPointLightCount(unsigned int count);
+    unsigned int getPointLightCount() const { return pointLightCount; }
+    // The forward shaders and the visibility resolve only evaluate the point lights of the cluster of each
+    // fragment, binned on the CPU every frame, see LightClusters. The deferred path is not affected.
+    void toggleClusteredLighting(bool enable);
+    bool isClusteredLightingEnabled() const { return clusteredEnabled; }
+    LightClusters& getLightClusters() { return lightClusters; }
+    // LightClusters::measureLightsPerPixel() on the depth of the last frame, if it was clustered. Waits for
+    // the GPU; call it after render(), while the framebuffer of render() is still bound.
+    void measureClusterLightsPerPixel();
+
+    // the scene part of a recorded frame (light, grid size, toggles, shader, terrain, render paths, point
+    // lights, depth pre-pass modes)
+    void storeState(CameraPathFrame& frame) const;
+    // applies the scene part of a recorded frame. Needs the context of initialize().
+    void applyState(const CameraPathFrame& frame);
+
+private:
+    GLFunctions *f = nullptr;
+
+    // rendered objects
+    std::vector<Vec3f> objectPositions;
+    // per frame bounding box centers (x, y, z) and frustum test results of the instances
+    std::vector<float> objectCenters;
+    std::vector<uint8_t> objectVisible;
+    std::vector<TriangleMesh> meshes;
+    // merged copies of the doppeldecker instances, see toggleStaticBatching()
+    StaticBatch staticBatch;
+    bool staticBatchingEnabled = false;
+    bool staticBatchDirty = true;
+    bool staticBatchValid = false; // false if the batch would exceed its memory limit
+    // copies of the meshes in buffer textures, pulledMeshes[i] is meshes[i], see toggleVertexPulling()
+    VertexPullBuffers pullBuffers;
+    std::vector<VertexPullBuffers::Mesh> pulledMeshes;
+    bool vertexPullingEnabled = false;
+    TriangleMesh sphereMesh; // sun
+    // bump mapping sphere, from fine to coarse
+    static constexpr int bumpSphereLodCount = 3;
+    std::array<TriangleMesh, bumpSphereLodCount> bumpSphereLods;
+    int gridSize = 3;
+
+    // random object positions and terrain
+    unsigned int seed = std::random_device()();
+    std::mt19937 positionGenerator{seed};
+    std::mt19937 terrainGenerator{seed + 1};
+    unsigned int terrainGeneration = 0;
+
+    // settings selected in the UI
+    int coloringMode = -1; // -1: initial modes of the meshes
+    unsigned int currentProgramIndex = 0;
+    bool boundingBoxEnabled = false;
+    bool normalsEnabled = false;
+    // bump features selected in the UI, the quality settings may switch some of them off
+    bool diffuseEnabled = false;
+    bool normalMappingEnabled = false;
+    bool displacementEnabled = false;
+    bool parallaxEnabled = false; // the displacement is done by parallax occlusion mapping
+
+    QualitySettings quality;
+    int viewportWidth = 1, viewportHeight = 1;
+    // per ShadedPass: the pre-pass choice and the GPU timer names of the pass without pre-pass, of the
+    // depth pass and of the shading pass after it
+    struct Prepass {
+        DepthPrepassSelector selector;
+        const char* name;
+        const char* depthName;
+        const char* shadingName;
+    };
+    std::array<Prepass, shadedPassCount> prepasses;
+    // offscreen target for render scales below 1 and the overdraw measurement, blitted to the actual framebuffer
+    GLuint scaledFBO = 0, scaledColorRenderbuffer = 0, scaledDepthRenderbuffer = 0;
+    int scaledWidth = 0, scaledHeight = 0;
+
+    // skybox, created once in initialize()
+    GLuint skyboxProgramID = 0;
+    GLuint skyboxTexture = 0;
+    GLuint skyboxVAO = 0, skyboxVBO = 0;
+
+    // shaders
+    GLuint currentProgramID = 0;
+    std::vector<GLuint> programIDs;
+    // pull.vert versions of the built-in programs, same index as in programIDs; 0 if there is none
+    std::vector<GLuint> pullProgramIDs;
+    GLuint bumpProgramID = 0;
+    GLuint normalProgramID = 0; // normal arrows of toggleNormals()
+    GLuint debugLineProgramID = 0; // lines and instanced boxes of debugDraw
+    GLuint depthProgramID = 0; // position-only depth pre-pass
+    GLuint bumpDepthProgramID = 0; // depth pre-pass of the displaced bump sphere
+    GLuint overdrawProgramID = 0; // heatmap bands of overdrawMeter
+    // G-buffer versions of the built-in programs and the light passes of the deferred path
+    GLuint gbufferProgramID = 0, gbufferPullProgramID = 0, gbufferBumpProgramID = 0;
+    GLuint deferredSunProgramID = 0, lightVolumeProgramID = 0, deferredLightProgramID = 0;
+    // geometry pass and resolve of the visibility buffer
+    GLuint visibilityProgramID = 0, visibilityResolveProgramID = 0;
+
+    // RenderState with matrix stack
+    RenderState state;
+
+    GpuTimer gpuTimer;
+    OverdrawMeter overdrawMeter;
+    bool overdrawEnabled = false;
+    bool overdrawHeatmap = false;
+    DeferredRenderer deferred;
+    bool deferredEnabled = false;
+    VisibilityBuffer visibility;
+    bool visibilityEnabled = false;
+    ShadingPath lastShadingPath = ShadingPath::Forward;
+    PointLights pointLights;
+    unsigned int pointLightCount = 0;
+    bool pointLightsDirty = false;        // the lights are placed again before the next frame
+    bool pointLightUniformsDirty = true;  // a program has not got the texture unit and count of the lights
+    float pointLightTime = 0.0f;          // advances by 1/60 s per frame, so benchmarks see the same lights
+    LightClusters lightClusters;
+    bool clusteredEnabled = false;
+    bool clusterUniformsEnabled = false;  // useClusters is set on the forward programs
+    // a built-in program that shades the point lights itself: in the geometry passes or the resolve of
+    // the visibility buffer
+    struct PointLightProgram {
+        GLuint program;
+        GLint useClustersUniform;
+        LightClusters::Uniforms clusterUniforms;
+    };
+    std::vector<PointLightProgram> pointLightPrograms; // collected again with the point light uniforms
+    bool lastFrameClustered = false, lastFrameScaled = false;
+    // coordinate system, bounding boxes and normals, drawn at the end of render()
+    DebugDraw debugDraw;
+
+    void createSkybox();
+    void applyBumpFeatures();
+    bool prepareScaledTarget(int width, int height);
+    void deleteScaledTarget();
+    unsigned int bumpSphereLod(const QVector3D& cameraPos) const;
+    bool parallaxMappingActive() const { return displacementEnabled && parallaxEnabled && quality.bumpFeatureLevel >= 2; }
+    // updates the instances of staticBatch if necessary, false if it can not be used
+    bool updateStaticBatch();
+    // makes pullProgram current with the buffers of pullBuffers, false and fallbackProgram current if it
+    // can not be used
+    bool beginVertexPulling(GLuint pullProgram, GLuint fallbackProgram);
+    // collects pointLightPrograms and looks up their uniforms
+    void collectPointLightPrograms();
+    // Places, animates and uploads the point lights for the current model view matrix. With clustered, they
+    // are binned for a target of width x height; true if the programs use the clusters this frame.
+    bool updatePointLights(int width, int height, bool clustered);
+    // feeds the GPU times of the shaded passes to their selectors
+    void updateDepthPrepasses();
+    // Starts the GPU timing of pass. If it draws a pre-pass this frame, also masks the color writes, makes
+    // program current and returns true; the caller then draws the depth and calls beginShadingAfterPrepass().
+    bool beginDepthPrepass(ShadedPass pass, GLuint program);
+    // makes shadingProgram current and draws only the fragments on the depth of the pre-pass
+    void beginShadingAfterPrepass(ShadedPass pass, GLuint shadingProgram);
+    // ends the GPU timing and restores the depth state of beginShadingAfterPrepass()
+    void endShading(bool prepass);
+
+    void drawSkybox(const QVector3D& cameraPos);
+    void drawCS();
+    void drawLight();
+};
+
+#endif // SCENE_H
@@ -1,18 +1,24 @@
+#include <QApplication>
+#include <QMessageBox>
+
+#include "hitchdetector.h"
+#include "log.h"
+#include "profiler.h"
 #include "shader.h"
 
-GLint getProgramLogLength(QOpenGLFunctions_3_3_Core* f, GLuint obj) {
+GLint getProgramLogLength(GLFunctions* f, GLuint obj) {
     GLint infologLength = 0;
     f->glGetProgramiv(obj, GL_INFO_LOG_LENGTH, &infologLength);
     return infologLength;
 }
 
-GLint getShaderLogLength(QOpenGLFunctions_3_3_Core* f, GLuint obj) {
+GLint getShaderLogLength(GLFunctions* f, GLuint obj) {
     GLint infologLength = 0;
     f->glGetShaderiv(obj, GL_INFO_LOG_LENGTH, &infologLength);
     return infologLength;
 }
 
-std::vector<GLchar> getShaderInfoLogAsVector(QOpenGLFunctions_3_3_Core* f, GLuint obj) {
+std::vector<GLchar> getShaderInfoLogAsVector(GLFunctions* f, GLuint obj) {
     GLint infologLength = getShaderLogLength(f, obj);
     std::vector<GLchar> result;
     
@@ -25,21 +31,21 @@ std::vector<GLchar> getShaderInfoLogAsVector(QOpenGLFunctions_3_3_Core* f, GLuin
 	return result;
 }
 
-QString getShaderInfoLogAsQString(QOpenGLFunctions_3_3_Core* f, GLuint obj) {
+QString getShaderInfoLogAsQString(GLFunctions* f, GLuint obj) {
     auto infoLog = getShaderInfoLogAsVector(f, obj);
     if (infoLog.empty()) return QString();
     else return QString(infoLog.data());
 }
 
-void printShaderInfoLog(QOpenGLFunctions_3_3_Core* f, GLuint obj)
+void printShaderInfoLog(GLFunctions* f, GLuint obj)
 {
     auto infoLog = getShaderInfoLogAsVector(f, obj);
     if (!infoLog.empty()) {
-		std::cout << infoLog.data() << std::endl;
+		LOG_ERROR(Shader, "{}", infoLog.data());
     }
 }
 
-std::vector<GLchar> getProgramInfoLogAsVector(QOpenGLFunctions_3_3_Core* f, GLuint obj) {
+std::vector<GLchar> getProgramInfoLogAsVector(GLFunctions* f, GLuint obj) {
     GLint infologLength = getProgramLogLength(f, obj);
     std::vector<GLchar> result;
     
@@ -52,42 +58,78 @@ std::vector<GLchar> getProgramInfoLogAsVector(QOpenGLFunctions_3_3_Core* f, GLui
 	return result;
 }
 
-QString getProgramInfoLogAsQString(QOpenGLFunctions_3_3_Core* f, GLuint obj) {
+QString getProgramInfoLogAsQString(GLFunctions* f, GLuint obj) {
     auto infoLog = getProgramInfoLogAsVector(f, obj);
     if (infoLog.empty()) return QString();
     else return QString(infoLog.data());
 }
 
-void printProgramInfoLog(QOpenGLFunctions_3_3_Core* f, GLuint obj)
+void printProgramInfoLog(GLFunctions* f, GLuint obj)
 {
     auto infoLog = getProgramInfoLogAsVector(f, obj);
     if (!infoLog.empty()) {
-		std::cout << infoLog.data() << std::endl;
+		LOG_ERROR(Shader, "{}", infoLog.data());
     }
 }
 
 
-GLuint compileShaders(QOpenGLFunctions_3_3_Core* f, const char* vertexShaderSrc, GLint vertexShaderSize, const char* fragmentShaderSrc, GLint fragmentShaderSize) {
+GLuint compileShaders(GLFunctions* f, const char* vertexShaderSrc, GLint vertexShaderSize, const char* fragmentShaderSrc, GLint fragmentShaderSize) {
+    return compileShaders(f, vertexShaderSrc, vertexShaderSize, nullptr, 0, fragmentShaderSrc, fragmentShaderSize);
+}
+
+GLuint compileShaders(GLFunctions* f, const char* vertexShaderSrc, GLint vertexShaderSize, const char* geometryShaderSrc, GLint geometryShaderSize,
+                      const char* fragmentShaderSrc, GLint fragmentShaderSize) {
+    PROFILE_FUNCTION();
+    HitchDetector::countShaderCompile();
     // create shaders, set source and compile
     GLuint vertexShader = f->glCreateShader(GL_VERTEX_SHADER);
     GLuint fragmentShader = f->glCreateShader(GL_FRAGMENT_SHADER);
+    GLuint geometryShader = geometryShaderSrc ? f->glCreateShader(GL_GEOMETRY_SHADER) : 0;
     f->glShaderSource(vertexShader, 1, &vertexShaderSrc, &vertexShaderSize);
     f->glShaderSource(fragmentShader, 1, &fragmentShaderSrc, &fragmentShaderSize);
     f->glCompileShader(vertexShader);
     f->glCompileShader(fragmentShader);
+    if (geometryShader) {
+        f->glShaderSource(geometryShader, 1, &geometryShaderSrc, &geometryShaderSize);
+        f->glCompileShader(geometryShader);
+    }
 
-    // create a program, attach both shaders and link the program (shaders can be deleted now)
+    // create a program, attach the shaders and link the program (shaders can be deleted now)
     GLuint program = f->glCreateProgram();
     f->glAttachShader(program, vertexShader);
+    if (geometryShader)
+        f->glAttachShader(program, geometryShader);
     f->glAttachShader(program, fragmentShader);
     f->glLinkProgram(program);
     f->glDeleteShader(vertexShader);
     f->glDeleteShader(fragmentShader);
+    if (geometryShader)
+        f->glDeleteShader(geometryShader);
 
     // check if compilation was successful and return the programID
     GLint success = 0;
     f->glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
+    if (!success && !qobject_cast<QApplication*>(QCoreApplication::instance())) {
+        // no widgets available (e.g. headless benchmark), report on the console instead
+        LOG_ERROR(Shader, "compileShaders(): compiler or linker error");
+        printShaderInfoLog(f, vertexShader);
+        if (geometryShader)
+            printShaderInfoLog(f, geometryShader);
+        printShaderInfoLog(f, fragmentShader);
+        printProgramInfoLog(f, program);
+        f->glDeleteProgram(program);
+        program = 0;
+    }
+    else if (!success) {
+        QString geometryDetails;
+        if (geometryShader) {
+            geometryDetails = QStringLiteral(
+                "===== Geometry Shader =====\n"
+                "%1\n"
+                "===== Geometry Shader Info Log =====\n"
+                "%2\n")
+                .arg(QString::fromUtf8(geometryShaderSrc, geometryShaderSize), getShaderInfoLogAsQString(f, geometryShader));
+        }
         QMessageBox failureBox;
         failureBox.setIcon(QMessageBox::Critical);
         failureBox.setStandardButtons(QMessageBox::StandardButton::Ok);
@@ -98,14 +140,16 @@ GLuint compileShaders(QOpenGLFunctions_3_3_Core* f, const char* vertexShaderSrc,
             "%1\n"
             "===== Vertex Shader Info Log =====\n"
             "%2\n"
+            "%3"
             "===== Fragment Shader =====\n"
-            "%3\n"
-            "===== Fragment Shader Info Log =====\n"
             "%4\n"
+            "===== Fragment Shader Info Log =====\n"
+            "%5\n"
             "===== Program Info Log =====\n"
-            "%5\n")
+            "%6\n")
             .arg(vertexShaderSrc,
                  getShaderInfoLogAsQString(f, vertexShader),
+                 geometryDetails,
                  fragmentShaderSrc,
                  getShaderInfoLogAsQString(f, fragmentShader),
                  getProgramInfoLogAsQString(f, program))
@@ -119,13 +163,14 @@ GLuint compileShaders(QOpenGLFunctions_3_3_Core* f, const char* vertexShaderSrc,
     return program;
 }
 
-GLuint readShaders(QOpenGLFunctions_3_3_Core* f, const QString& vertexShaderPath, const QString& fragmentShaderPath) {
+GLuint readShaders(GLFunctions* f, const QString& vertexShaderPath, const QString& fragmentShaderPath) {
+    PROFILE_FUNCTION();
     QFile vertexShaderFile(vertexShaderPath);
     QFile fragmentShaderFile(fragmentShaderPath);
 
     //Open and read vertex shader file
     if (!vertexShaderFile.open(QFile::OpenModeFlag::ReadOnly)) {
-        qDebug() << "readShaders(): could not open file " << vertexShaderPath;
+        LOG_ERROR(Shader, "readShaders(): could not open file {}", qPrintable(vertexShaderPath));
         return 0;
     }
 
@@ -133,7 +178,7 @@ GLuint readShaders(QOpenGLFunctions_3_3_Core* f, const QString& vertexShaderPath
 
     //Open and read fragment shader file
     if (!fragmentShaderFile.open(QFile::OpenModeFlag::ReadOnly)) {
-        qDebug() << "readShaders(): could not open file " << fragmentShaderPath;
+        LOG_ERROR(Shader, "readShaders(): could not open file {}", qPrintable(fragmentShaderPath));
         return 0;
     }
 
@@ -141,3 +186,24 @@ GLuint readShaders(QOpenGLFunctions_3_3_Core* f, const QString& vertexShaderPath
 
   return compileShaders(f, vertexShaderText.constData(), vertexShaderText.size(), fragmentShaderText.constData(), fragmentShaderText.size());
 }
+
+GLuint readShaders(GLFunctions* f, const QString& vertexShaderPath, const QString& geometryShaderPath, const QString& fragmentShaderPath) {
+    PROFILE_FUNCTION();
+    QFile vertexShaderFile(vertexShaderPath);
+    QFile geometryShaderFile(geometryShaderPath);
+    QFile fragmentShaderFile(fragmentShaderPath);
+
+    for (QFile* file : {&vertexShaderFile, &geometryShaderFile, &fragmentShaderFile}) {
+        if (!file->open(QFile::OpenModeFlag::ReadOnly)) {
+            LOG_ERROR(Shader, "readShaders(): could not open file {}", qPrintable(file->fileName()));
+            return 0;
+        }
+    }
+
+    const auto vertexShaderText = vertexShaderFile.readAll();
+    const auto geometryShaderText = geometryShaderFile.readAll();
+    const auto fragmentShaderText = fragmentShaderFile.readAll();
+
+    return compileShaders(f, vertexShaderText.constData(), vertexShaderText.size(), geometryShaderText.constData(), geometryShaderText.size(),
+                          fragmentShaderText.constData(), fragmentShaderText.size());
+}
@@ -0,0 +1,344 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Pre-transformed, clustered copies of immobile mesh instances     //
+// ========================================================================= //
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "debugdraw.h"
+#include "hitchdetector.h"
+#include "log.h"
+#include "meshkernels.h"
+#include "profiler.h"
+#include "renderstate.h"
+#include "shader.h"
+#include "staticbatch.h"
+#include "trianglemesh.h"
+
+StaticBatch::StaticBatch(float cellSize)
+    : cellSize(cellSize)
+{
+}
+
+StaticBatch::~StaticBatch()
+{
+    release();
+}
+
+void StaticBatch::setSource(const MeshData &mesh)
+{
+    // the attribute layout of the VAO depends on the source, the next draw() creates it again
+    release();
+    source = mesh;
+    const size_t numVertices = source.vertices.size();
+    if (source.texCoordsPending)
+        source.calculateTexCoordsSphereMapping();
+    if (source.normals.size() != numVertices)
+        source.calculateNormalsByArea();
+    if (source.colors.size() != numVertices)
+        source.colors.clear();
+    if (source.texCoords.size() != numVertices)
+        source.texCoords.clear();
+    source.tangents.clear();
+    floatsPerVertex = 6 + (source.colors.empty() ? 0 : 3) + (source.texCoords.empty() ? 0 : 2);
+    clusters.clear();
+    layout.clear();
+    instanceCount = 0;
+    layoutChanged = true;
+}
+
+bool StaticBatch::setInstances(const std::vector<Vec3f> &translations)
+{
+    PROFILE_FUNCTION();
+    if (!hasSource())
+        return false;
+    const size_t instanceBytes = source.vertices.size() * floatsPerVertex * sizeof(float) + source.triangles.size() * sizeof(Vec3ui);
+    if (translations.size() * instanceBytes > maxBytes)
+    {
+        LOG_WARNING(Mesh, "static batch of {} instances would need {} MiB, the limit is {} MiB", translations.size(), (translations.size() * instanceBytes) >> 20, maxBytes >> 20);
+        clusters.clear();
+        layout.clear();
+        instanceCount = 0;
+        layoutChanged = true;
+        return false;
+    }
+
+    // sort the instances into the cells of their bounding box centers
+    std::map<CellKey, Cluster> assigned;
+    for (size_t i = 0; i < translations.size(); ++i)
+    {
+        const Vec3f center = source.boundingBoxMid + translations[i];
+        const CellKey key = {static_cast<int>(std::floor(center.x() / cellSize)), static_cast<int>(std::floor(center.y() / cellSize)),
+                             static_cast<int>(std::floor(center.z() / cellSize))};
+        Cluster &cluster = assigned[key];
+        cluster.instances.push_back(static_cast<unsigned int>(i));
+        cluster.translations.push_back(translations[i]);
+    }
+
+    // clusters with the same translations as before keep their vertices
+    auto sameTranslations = [](const std::vector<Vec3f> &a, const std::vector<Vec3f> &b) {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (a[i].x() != b[i].x() || a[i].y() != b[i].y() || a[i].z() != b[i].z())
+                return false;
+        }
+        return true;
+    };
+    std::vector<Cluster *> changed;
+    for (auto &[key, cluster] : assigned)
+    {
+        auto previous = clusters.find(key);
+        if (previous != clusters.end() && sameTranslations(previous->second.translations, cluster.translations))
+        {
+            previous->second.instances = std::move(cluster.instances);
+            cluster = std::move(previous->second);
+        }
+        else
+        {
+            changed.push_back(&cluster);
+        }
+    }
+    parallelFor(changed.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            buildCluster(*changed[i]);
+    });
+    clusters = std::move(assigned);
+    instanceCount = translations.size();
+    // the layout points into the replaced map; the next upload() only sends clusters that changed or moved
+    layout.clear();
+    layoutChanged = true;
+    LOG_DEBUG(Mesh, "static batch: {} instances in {} clusters, {} clusters rebuilt", instanceCount, clusters.size(), changed.size());
+    return true;
+}
+
+void StaticBatch::buildCluster(Cluster &cluster) const
+{
+    const size_t numVertices = source.vertices.size();
+    const size_t numTriangles = source.triangles.size();
+    const bool hasColors = !source.colors.empty();
+    const bool hasTexCoords = !source.texCoords.empty();
+    cluster.vertices.resize(cluster.translations.size() * numVertices * floatsPerVertex);
+    cluster.indices.resize(cluster.translations.size() * numTriangles * 3);
+    cluster.boundsMin = Vec3f(FLT_MAX, FLT_MAX, FLT_MAX);
+    cluster.boundsMax = Vec3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    float *vertex = cluster.vertices.data();
+    GLuint *index = cluster.indices.data();
+    for (size_t instance = 0; instance < cluster.translations.size(); ++instance)
+    {
+        const Vec3f &t = cluster.translations[instance];
+        for (size_t v = 0; v < numVertices; ++v)
+        {
+            const Vec3f &p = source.vertices[v];
+            const Vec3f &n = source.normals[v];
+            *vertex++ = p.x() + t.x();
+            *vertex++ = p.y() + t.y();
+            *vertex++ = p.z() + t.z();
+            *vertex++ = n.x();
+            *vertex++ = n.y();
+            *vertex++ = n.z();
+            if (hasColors)
+            {
+                const Vec3f &c = source.colors[v];
+                *vertex++ = c.x();
+                *vertex++ = c.y();
+                *vertex++ = c.z();
+            }
+            if (hasTexCoords)
+            {
+                *vertex++ = source.texCoords[v].u;
+                *vertex++ = source.texCoords[v].v;
+            }
+        }
+        const GLuint base = static_cast<GLuint>(instance * numVertices);
+        for (const Vec3ui &triangle : source.triangles)
+        {
+            *index++ = base + triangle[0];
+            *index++ = base + triangle[1];
+            *index++ = base + triangle[2];
+        }
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            cluster.boundsMin[axis] = std::min(cluster.boundsMin[axis], source.boundingBoxMin[axis] + t[axis]);
+            cluster.boundsMax[axis] = std::max(cluster.boundsMax[axis], source.boundingBoxMax[axis] + t[axis]);
+        }
+    }
+    cluster.uploaded = false;
+}
+
+bool StaticBatch::upload(GLFunctions *f)
+{
+    if (!layoutChanged && VAO != 0)
+        return true;
+    PROFILE_FUNCTION();
+    this->f = f;
+    const GLsizei stride = static_cast<GLsizei>(floatsPerVertex * sizeof(float));
+    if (VAO == 0)
+    {
+        f->glGenVertexArrays(1, &VAO);
+        f->glGenBuffers(1, &VBO);
+        f->glGenBuffers(1, &IBO);
+        f->glBindVertexArray(VAO);
+        f->glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        f->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+        size_t offset = 0;
+        f->glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offset));
+        f->glEnableVertexAttribArray(POSITION_LOCATION);
+        offset += 3 * sizeof(float);
+        f->glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offset));
+        f->glEnableVertexAttribArray(NORMAL_LOCATION);
+        offset += 3 * sizeof(float);
+        if (!source.colors.empty())
+        {
+            f->glVertexAttribPointer(COLOR_LOCATION, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offset));
+            f->glEnableVertexAttribArray(COLOR_LOCATION);
+            offset += 3 * sizeof(float);
+        }
+        if (!source.texCoords.empty())
+        {
+            f->glVertexAttribPointer(TEXCOORD_LOCATION, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offset));
+            f->glEnableVertexAttribArray(TEXCOORD_LOCATION);
+        }
+        vertexCapacity = indexCapacity = 0;
+    }
+    else
+    {
+        // the VAO keeps the element buffer binding
+        f->glBindVertexArray(VAO);
+        f->glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    }
+
+    // Clusters are placed in the order of their first instance. Instances that are added later go to the
+    // end, so the clusters before them keep their place; a cluster whose place moved is uploaded again.
+    layout.clear();
+    for (auto &[key, cluster] : clusters)
+        layout.push_back(&cluster);
+    std::sort(layout.begin(), layout.end(), [](const Cluster *a, const Cluster *b) { return a->instances.front() < b->instances.front(); });
+    size_t vertexBytes = 0, indexBytes = 0;
+    for (Cluster *cluster : layout)
+    {
+        if (cluster->vertexOffset != vertexBytes || cluster->indexOffset != indexBytes)
+            cluster->uploaded = false;
+        cluster->vertexOffset = vertexBytes;
+        cluster->indexOffset = indexBytes;
+        vertexBytes += cluster->vertices.size() * sizeof(float);
+        indexBytes += cluster->indices.size() * sizeof(GLuint);
+    }
+    if (vertexBytes > vertexCapacity || indexBytes > indexCapacity)
+    {
+        // room for more instances, so adding some does not reallocate every time
+        vertexCapacity = vertexBytes + vertexBytes / 2;
+        indexCapacity = indexBytes + indexBytes / 2;
+        f->glBufferData(GL_ARRAY_BUFFER, vertexCapacity, nullptr, GL_STATIC_DRAW);
+        f->glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity, nullptr, GL_STATIC_DRAW);
+        for (auto &[key, cluster] : clusters)
+            cluster.uploaded = false;
+    }
+
+    size_t uploadedBytes = 0, clustersUploaded = 0;
+    std::vector<GLuint> indices;
+    for (Cluster *cluster : layout)
+    {
+        if (cluster->uploaded)
+            continue;
+        // the indices of a cluster start at its first vertex in the shared buffer
+        const GLuint firstVertex = static_cast<GLuint>(cluster->vertexOffset / stride);
+        indices.resize(cluster->indices.size());
+        std::transform(cluster->indices.begin(), cluster->indices.end(), indices.begin(), [firstVertex](GLuint i) { return i + firstVertex; });
+        f->glBufferSubData(GL_ARRAY_BUFFER, cluster->vertexOffset, cluster->vertices.size() * sizeof(float), cluster->vertices.data());
+        f->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, cluster->indexOffset, indices.size() * sizeof(GLuint), indices.data());
+        uploadedBytes += cluster->vertices.size() * sizeof(float) + indices.size() * sizeof(GLuint);
+        clustersUploaded++;
+        cluster->uploaded = true;
+    }
+    f->glBindVertexArray(0);
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    HitchDetector::countUpload(uploadedBytes);
+    LOG_DEBUG(Mesh, "static batch: uploaded {} of {} clusters, {} bytes", clustersUploaded, clusters.size(), uploadedBytes);
+    layoutChanged = false;
+    return true;
+}
+
+unsigned int StaticBatch::draw(RenderState &state, const TriangleMesh &material, const float planes[24], bool withBounds)
+{
+    PROFILE_FUNCTION();
+    instancesDrawn = 0;
+    if (clusters.empty())
+        return 0;
+    GLFunctions *f = state.getOpenGLFunctions();
+    if (!upload(f))
+        return 0;
+
+    const QMatrix4x4 &modelView = state.getCurrentModelViewMatrix();
+    f->glBindVertexArray(VAO);
+    f->glUniformMatrix4fv(state.getModelViewUniform(), 1, GL_FALSE, modelView.constData());
+    f->glUniformMatrix3fv(state.getNormalMatrixUniform(), 1, GL_FALSE, state.calculateNormalMatrix().constData());
+    material.bindMaterial(state, !source.colors.empty());
+
+    // consecutive visible clusters are one range of the index buffer
+    size_t rangeBegin = 0, rangeEnd = 0;
+    auto drawRange = [&]() {
+        if (rangeEnd == rangeBegin)
+            return;
+        f->glDrawElements(GL_TRIANGLES, static_cast<GLsizei>((rangeEnd - rangeBegin) / sizeof(GLuint)), GL_UNSIGNED_INT, reinterpret_cast<void *>(rangeBegin));
+        state.countDrawCall();
+        rangeBegin = rangeEnd = 0;
+    };
+    DebugDraw *debugDraw = withBounds ? state.getDebugDraw() : nullptr;
+    unsigned int trianglesDrawn = 0;
+    for (const Cluster *cluster : layout)
+    {
+        const Vec3f center = 0.5f * (cluster->boundsMin + cluster->boundsMax);
+        const Vec3f size = cluster->boundsMax - cluster->boundsMin;
+        const float centerXYZ[3] = {center.x(), center.y(), center.z()};
+        const float halfExtent[3] = {0.5f * size.x(), 0.5f * size.y(), 0.5f * size.z()};
+        uint8_t visible = 0;
+        meshKernels().cullBoxes(planes, centerXYZ, 1, halfExtent, &visible);
+        if (!visible)
+        {
+            drawRange();
+            continue;
+        }
+        if (rangeEnd != cluster->indexOffset)
+        {
+            drawRange();
+            rangeBegin = rangeEnd = cluster->indexOffset;
+        }
+        rangeEnd += cluster->indices.size() * sizeof(GLuint);
+        trianglesDrawn += static_cast<unsigned int>(cluster->indices.size() / 3);
+        instancesDrawn += cluster->instances.size();
+        if (debugDraw)
+            debugDraw->box(modelView, center, size, Vec3f(1.0f, 0.5f, 0.0f));
+    }
+    drawRange();
+    f->glBindVertexArray(0);
+    return trianglesDrawn;
+}
+
+void StaticBatch::release()
+{
+    if (f)
+    {
+        if (VAO != 0)
+            f->glDeleteVertexArrays(1, &VAO);
+        for (GLuint *buffer : {&VBO, &IBO})
+        {
+            if (*buffer != 0)
+                f->glDeleteBuffers(1, buffer);
+        }
+    }
+    VAO = VBO = IBO = 0;
+    vertexCapacity = indexCapacity = 0;
+    for (auto &[key, cluster] : clusters)
+        cluster.uploaded = false;
+    layoutChanged = true;
+    f = nullptr;
+}
@@ -0,0 +1,103 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Pre-transformed, clustered copies of immobile mesh instances     //
+// ========================================================================= //
+
+#ifndef STATICBATCH_H
+#define STATICBATCH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "glfunctions.h"
+#include "meshdata.h"
+#include "vec3.h"
+
+class RenderState;
+class TriangleMesh;
+
+/*
+ * Static batching of immobile instances of one mesh. Every instance is a copy of the source mesh moved by
+ * its translation. The instances are sorted into clusters of a regular grid by their bounding box center;
+ * the vertices of a cluster are translated once on the CPU (clusters in parallel) and all clusters share
+ * one vertex and one index buffer. draw() culls whole clusters and draws consecutive visible clusters with
+ * one glDrawElements, with the modelView matrix of the scene for all of them.
+ *
+ * setInstances() is incremental: clusters whose instances did not change keep their vertices, and only
+ * clusters that changed or moved in the buffers are uploaded again. Everything except setSource()
+ * and setInstances() needs the OpenGL context of the first draw().
+ */
+class StaticBatch {
+public:
+    // edge length of the cluster grid cells
+    explicit StaticBatch(float cellSize = 5.0f);
+    ~StaticBatch();
+    StaticBatch(const StaticBatch& other) = delete;
+    StaticBatch& operator= (const StaticBatch& other) = delete;
+
+    // Copies the source mesh (positions, normals and, if there is one per vertex, colors and texture
+    // coordinates). Pending texture coordinates are calculated. Removes all instances and deletes the
+    // GPU buffers like release(), so with a context of an earlier draw() that context has to be current.
+    void setSource(const MeshData& mesh);
+    bool hasSource() const { return !source.vertices.empty(); }
+
+    // Instance i is the source mesh moved by translations[i]. Returns false, and keeps no instances, if the
+    // merged buffers would be larger than maxBytes.
+    bool setInstances(const std::vector<Vec3f>& translations);
+    void setMaxBytes(size_t bytes) { maxBytes = bytes; }
+
+    // Draws the clusters that intersect the frustum planes (see frustumPlanes()) with the current program
+    // and modelView matrix of state and the material of 'material'. Appends the cluster bounds to the
+    // DebugDraw of state if withBounds is set. Returns the number of triangles drawn.
+    unsigned int draw(RenderState& state, const TriangleMesh& material, const float planes[24], bool withBounds);
+    // deletes the GPU buffers, the clusters stay and are uploaded again by the next draw()
+    void release();
+
+    size_t getInstanceCount() const { return instanceCount; }
+    size_t getClusterCount() const { return clusters.size(); }
+    // instances in the clusters drawn by the last draw()
+    size_t getInstancesDrawn() const { return instancesDrawn; }
+    size_t getGpuBytes() const { return vertexCapacity + indexCapacity; }
+
+private:
+    using CellKey = std::array<int, 3>;
+    struct Cluster {
+        std::vector<unsigned int> instances; // indices into the translations of setInstances()
+        std::vector<Vec3f> translations;
+        std::vector<float> vertices; // interleaved, floatsPerVertex each
+        std::vector<GLuint> indices; // relative to the first vertex of the cluster
+        Vec3f boundsMin, boundsMax;
+        // position in the shared buffers, in bytes, and whether the data there is current
+        size_t vertexOffset = 0, indexOffset = 0;
+        bool uploaded = false;
+    };
+
+    // translates the source into cluster.vertices and cluster.indices
+    void buildCluster(Cluster& cluster) const;
+    // (re)creates the buffers or uploads the clusters that changed since the last call
+    bool upload(GLFunctions* f);
+
+    MeshData source;
+    size_t floatsPerVertex = 0;
+    float cellSize;
+    size_t maxBytes = size_t(256) << 20;
+
+    std::map<CellKey, Cluster> clusters;
+    std::vector<Cluster*> layout; // clusters in the order of the buffers, see upload()
+    size_t instanceCount = 0;
+    size_t instancesDrawn = 0;
+    bool layoutChanged = false;
+
+    GLFunctions* f = nullptr;
+    GLuint VAO = 0, VBO = 0, IBO = 0;
+    size_t vertexCapacity = 0, indexCapacity = 0;
+};
+
+#endif // STATICBATCH_H
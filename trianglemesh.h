@@ -9,11 +9,13 @@
 
 #include <vector>
 
+#include "meshbuffers.h"
+#include "meshdata.h"
 #include "vec3.h"
 #include "utilities.h"
 
 //Forward declaration, avoids being forced to include header
-class QOpenGLFunctions_3_3_Core;
+class GLFunctions;
 class RenderState;
 
 class TriangleMesh {
@@ -25,38 +27,14 @@ public:
         BUMP_MAPPING,
     };
 private:
-    // typedefs for data
-    typedef Vec3ui Triangle;
-    typedef Vec3f Vertex;
-    typedef Vec3f Normal;
-    typedef Vec3f Color;
-    struct TexCoord { float u, v; };
-    typedef Vec3f Tangent;
-
-    typedef std::vector<Triangle> Triangles;
-    typedef std::vector<Vertex> Vertices;
-    typedef std::vector<Normal> Normals;
-    typedef std::vector<Color> Colors;
-    typedef std::vector<TexCoord> TexCoords;
-    typedef std::vector<Tangent> Tangents;
-
-
-    // data of TriangleMesh
-    Vertices vertices;    // vertex positions
-    Normals normals;      // normals per vertex
-    Triangles triangles;  // indices of vertices that form a triangle
-    Colors colors;        // r,g,b in [0,1]
-    TexCoords texCoords;  // u,v in [0,1]
-    Tangents tangents;    // tangent per vertex
+    // vertex attributes, triangles and bounding box, see releaseCPUData()
+    MeshData data;
+    // VAO and VBOs created from data
+    MeshBuffers buffers;
+
     Vec3f staticColor;
     ColoringType coloringType{ColoringType::STATIC_COLOR};
 
-    // VAO and VBO ids for vertices, normals, faces, colors, texCoords, tangents
-    autoMoved<GLuint> VAO{}, VBOv{}, VBOn{}, VBOf{}, VBOc{}, VBOt{}, VBOtan{};
-    // VBO for bounding box
-    autoMoved<GLuint> VAObb{}, VBOvbb{}, VBOfbb{};
-    //VBO for normal lines
-    autoMoved<GLuint> VAOn{}, VBOvn{};
     // texture
     autoMoved<GLuint> textureID{};
     autoMoved<GLuint> normalMapID{};
@@ -70,17 +48,12 @@ private:
     bool enableDiffuseTexture = false;
     bool enableNormalMapping = false;
     bool enableDisplacementMapping = false;
+    bool enableParallaxMapping = false;
 
-    // bounding box data
-    Vec3f boundingBoxMin;
-    Vec3f boundingBoxMax;
-    Vec3f boundingBoxMid;
-    Vec3f boundingBoxSize;
-
-    mutable QOpenGLFunctions_3_3_Core* f;
+    mutable GLFunctions* f;
 
 public:
-    TriangleMesh(QOpenGLFunctions_3_3_Core* f = nullptr);
+    TriangleMesh(GLFunctions* f = nullptr);
     ~TriangleMesh();
     //Make TriangleMesh non-copyable in order to avoid problems with VBO copying
     TriangleMesh(const TriangleMesh& other) = delete;
@@ -88,7 +61,7 @@ public:
     TriangleMesh(TriangleMesh&& other) noexcept = default;
     TriangleMesh& operator= (TriangleMesh&& other) noexcept = default;
 
-    void setGLFunctionPtr(QOpenGLFunctions_3_3_Core* f) { this->f = f; }
+    void setGLFunctionPtr(GLFunctions* f) { this->f = f; }
 
     // clears all data, sets defaults
     void clear();
@@ -97,24 +70,34 @@ public:
     void coutData();
 
     // get raw data references
-    std::vector<Vec3f>& getVertices() { return vertices; }
-    std::vector<Vec3ui>& getTriangles() { return triangles; }
-    std::vector<Vec3f>& getNormals() { return normals; }
-    std::vector<Vec3f>& getColors() { return colors; }
-    std::vector<TexCoord>& getTexCoords() { return texCoords; }
+    std::vector<Vec3f>& getVertices() { return data.vertices; }
+    std::vector<Vec3ui>& getTriangles() { return data.triangles; }
+    std::vector<Vec3f>& getNormals() { return data.normals; }
+    std::vector<Vec3f>& getColors() { return data.colors; }
+    std::vector<MeshData::TexCoord>& getTexCoords() { return data.texCoords; }
+    const MeshData& getData() const { return data; }
+    const MeshBuffers& getBuffers() const { return buffers; }
 
     // get size of all elements
-    unsigned int getNumVertices() { return vertices.size(); }
-    unsigned int getNumNormals() { return normals.size(); }
-    unsigned int getNumTriangles() { return triangles.size(); }
-    unsigned int getNumColors() { return colors.size(); }
-    unsigned int getNumTexCoords() { return texCoords.size(); }
+    unsigned int getNumVertices() { return data.vertices.size(); }
+    unsigned int getNumNormals() { return data.normals.size(); }
+    unsigned int getNumTriangles() { return data.triangles.size(); }
+    unsigned int getNumColors() { return data.colors.size(); }
+    unsigned int getNumTexCoords() { return data.texCoords.size(); }
 
     // get boundingBox data
-    Vec3f getBoundingBoxMin() { return boundingBoxMin; }
-    Vec3f getBoundingBoxMax() { return boundingBoxMax; }
-    Vec3f getBoundingBoxMid() { return boundingBoxMid; }
-    Vec3f getBoundingBoxSize() { return boundingBoxSize; }
+    Vec3f getBoundingBoxMin() { return data.boundingBoxMin; }
+    Vec3f getBoundingBoxMax() { return data.boundingBoxMax; }
+    Vec3f getBoundingBoxMid() { return data.boundingBoxMid; }
+    Vec3f getBoundingBoxSize() { return data.boundingBoxSize; }
+
+    // replaces the mesh data, e.g. data loaded on another thread. Keeps the render settings.
+    void setData(MeshData&& data, bool createVBOs = true);
+    // Frees the CPU copies of the attribute arrays after the VBOs were created, the bounding box stays
+    // for culling. Pending texture coordinates are calculated and uploaded first, so all coloring modes
+    // keep working. Needs the OpenGL context. Afterwards the getters above return empty arrays and the
+    // processing functions have no effect on the drawn mesh.
+    void releaseCPUData();
 
     // flip all normals
     void flipNormals(bool createVBOs = true);
@@ -133,6 +116,8 @@ public:
     void toggleDiffuse(bool enable) { enableDiffuseTexture = enable; }
     void toggleNormalMapping(bool enable) { enableNormalMapping = enable; }
     void toggleDisplacementMapping(bool enable) { enableDisplacementMapping = enable; }
+    // parallax occlusion mapping of the displacement texture in bump.frag, independent of toggleDisplacementMapping()
+    void toggleParallaxMapping(bool enable) { enableParallaxMapping = enable; }
 
     // scales vertices so that the largest bounding box size has length newLength
     void scaleToLength(float newLength, bool createVBOs = true);
@@ -148,32 +133,30 @@ public:
     // translates and scales vertices with bounding box center at BBmid and largest side BBlength
     void loadOFF(const char* filename, const Vec3f& BBmid, float BBlength);
 
-    void generateSphere(QOpenGLFunctions_3_3_Core* f);
+    // unit sphere of latdiv rings with longdiv faces each (longdiv >= 4, latdiv >= 2)
+    void generateSphere(GLFunctions* f, int longdiv = 200, int latdiv = 100);
 
     void generateTerrain(unsigned int h, unsigned int w, unsigned int iterations);
+    // same terrain for the same seed
+    void generateTerrain(unsigned int h, unsigned int w, unsigned int iterations, unsigned int seed);
+
+    // =======================
+    // === MESH PROCESSING ===
+    // =======================
 
-private:
     // calculate normals, weighted by area
     void calculateNormalsByArea();
 
-    // calculate texture coordinates by central projection
+    // calculate texture coordinates by central projection, see MeshKernels::sphereTexCoords.
+    // Large meshes are processed on several threads.
     void calculateTexCoordsSphereMapping();
 
     // calculates axis aligned bounding box data
     void calculateBB();
 
+private:
     // create VBOs for vertices, faces, normals, colors, textureCoords
     void createAllVBOs();
-    // create VBOs for normals
-    void createNormalVAO(QOpenGLFunctions_3_3_Core* f);
-    void createBBVAO(QOpenGLFunctions_3_3_Core* f);
-
-    // create VBO
-    GLuint createVBO(QOpenGLFunctions_3_3_Core* f, const void* data, int dataSize, GLenum target, GLenum usage);
-
-    // clean up VBO data (delete from gpu memory)
-    void cleanupVBO();
-    void cleanupVBO(QOpenGLFunctions_3_3_Core* f);
 
     // ==============
     // === RENDER ===
@@ -182,22 +165,42 @@ private:
 public:
 
     // set coloring type
-    void setColoringMode(ColoringType type) { coloringType = type; };
+    // Texture coordinates of loadOFF are calculated the first time a mode samples them (TEXTURE,
+    // BUMP_MAPPING). Their VBO is created by the next draw.
+    void setColoringMode(ColoringType type);
 
     // draw mesh with current drawing mode settings. returns the number of triangles drawn.
     unsigned int draw(RenderState& state);
+    // like draw(), for meshes the caller already tested against the view frustum
+    unsigned int drawVisible(RenderState& state);
+    // Sets the coloring uniforms, textures and the color attribute of the bound VAO for the current
+    // program, like draw() does. Used by StaticBatch to draw merged copies of this mesh.
+    void bindMaterial(RenderState& state, bool hasColorArray) const;
+    // whether bindMaterial() colors with a color array of the mesh, if it has one
+    bool usesColorArray(bool hasColorArray) const;
+    // the texture bindMaterial() colors with, 0 if it uses none
+    GLuint getMaterialTexture() const { return coloringType == ColoringType::TEXTURE ? textureID.val : 0; }
+    const Vec3f& getStaticColor() const { return staticColor; }
+    // append the bounding box and normals to the DebugDraw of state if they are enabled, like draw() does
+    void drawDebug(RenderState& state);
+    // Draws the mesh for a depth-only pass with the current program, without frustum test and debug
+    // geometry: from the position-only VAO, or with withMaterial from the full VAO with bindMaterial(),
+    // for programs that need more than positions (bump.vert with displacement). Returns the triangles drawn.
+    unsigned int drawDepth(RenderState& state, bool withMaterial = false);
 
 private:
 
     // draw VBO
     void drawVBO(RenderState& state);
 
-    // draw the bounding box (wired, immediate mode) (withBB)
+    // append the bounding box (withBB) to the DebugDraw of state, drawn at the end of the frame
     void drawBB(RenderState& state);
 
-    // draw object normals (lines, immediate mode) (withNormals)
+    // append the object normals (withNormals) to the DebugDraw of state
     void drawNormals(RenderState& state);
 
+public:
+
     // ===========
     // === VFC ===
     // ===========
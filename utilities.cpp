@@ -11,8 +11,14 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
-#include <QOpenGLFunctions_3_3_Core>
-
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "hitchdetector.h"
+#include "profiler.h"
 #include "utilities.h"
 
 const GLfloat BoxVertices[] = {
@@ -62,7 +68,24 @@ const GLuint BoxTriangleIndices[] = {
 
 const size_t BoxTriangleIndicesSize = sizeof(BoxTriangleIndices);
 
-GLuint loadImageIntoTexture(QOpenGLFunctions_3_3_Core* f, const char* fileName, bool wrap) {
+double processCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) return 0.0;
+    //FILETIME counts in 100 ns steps
+    auto toSeconds = [](const FILETIME& time) {
+        return ((static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7;
+    };
+    return toSeconds(kernelTime) + toSeconds(userTime);
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+GLuint loadImageIntoTexture(GLFunctions* f, const char* fileName, bool wrap) {
+    PROFILE_FUNCTION();
     //flip all images on load because origin of OpenGL textures is at lower left, not upper left
     stbi_set_flip_vertically_on_load(true);
 
@@ -87,13 +110,15 @@ GLuint loadImageIntoTexture(QOpenGLFunctions_3_3_Core* f, const char* fileName,
                     GL_UNSIGNED_BYTE,   //type of the pixels
                     pixelData           //pointer to pixels
     );
+    HitchDetector::countUpload(static_cast<size_t>(width) * height * 3);
     f->glGenerateMipmap(GL_TEXTURE_2D);
     f->glBindTexture(GL_TEXTURE_2D, 0);
     stbi_image_free(pixelData);
     return result;
 }
 
-GLuint loadCubeMap(QOpenGLFunctions_3_3_Core* f, const char* fileName[6]) {
+GLuint loadCubeMap(GLFunctions* f, const char* fileName[6]) {
+    PROFILE_FUNCTION();
     //For whatever reason, cubemaps are not flipped per standard.
     stbi_set_flip_vertically_on_load(false);
 
@@ -120,6 +145,7 @@ GLuint loadCubeMap(QOpenGLFunctions_3_3_Core* f, const char* fileName[6]) {
                         GL_UNSIGNED_BYTE,   //type of the pixels
                         pixelData           //pointer to pixels
         );
+        HitchDetector::countUpload(static_cast<size_t>(width) * height * 3);
         stbi_image_free(pixelData);
     }
 
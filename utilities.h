@@ -14,7 +14,7 @@
 
 #include <utility>
 
-#include <QOpenGLFunctions_3_3_Core>
+#include "glfunctions.h"
 
 /*
  * This struct makes sure that moving works correctly. For example, if you have:
@@ -58,8 +58,11 @@ extern const GLuint BoxTriangleIndices[];
 extern const size_t BoxTriangleIndicesSize;
 
 //Automatically load a texture into a OpenGL Texture Object of type GL_TEXTURE_2D. Returns 0 on failure.
-GLuint loadImageIntoTexture(QOpenGLFunctions_3_3_Core* f, const char* fileName, bool wrap = false);
+GLuint loadImageIntoTexture(GLFunctions* f, const char* fileName, bool wrap = false);
+//CPU time used by all threads of this process so far, in seconds
+double processCpuSeconds();
+
 //Automatically load six textures into a OpenGL Texture Object of type GL_TEXTURE_CUBE_MAP. Returns 0 on failure. The order of the textures is POS_X, NEG_X, POS_Y, NEG_Y, POS_Z, NEG_Z.
-GLuint loadCubeMap(QOpenGLFunctions_3_3_Core* f, const char* fileName[6]);
+GLuint loadCubeMap(GLFunctions* f, const char* fileName[6]);
 
 #endif //UTILITES_H
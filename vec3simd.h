@@ -0,0 +1,470 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: SIMD batches of floats and Vec3 (structure of arrays) with fast  //
+//          approximations of rsqrt, atan2, asin, sin and cos                //
+// ========================================================================= //
+
+#ifndef VEC3SIMD_H
+#define VEC3SIMD_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "vec3.h"
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+#define GDV_SIMD_AVX512
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GDV_SIMD_AVX2
+#endif
+#if defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#define GDV_SIMD_SSE41
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GDV_SIMD_SSE2
+#endif
+
+// The implementation depends on the instruction set the translation unit is compiled for. The inline
+// namespace gives every variant its own symbols, so files compiled with different flags can be linked.
+#if defined(GDV_SIMD_AVX512)
+#define GDV_SIMD_ISA avx512
+#elif defined(GDV_SIMD_AVX2)
+#define GDV_SIMD_ISA avx2
+#elif defined(GDV_SIMD_SSE41)
+#define GDV_SIMD_ISA sse41
+#elif defined(GDV_SIMD_SSE2)
+#define GDV_SIMD_ISA sse2
+#else
+#define GDV_SIMD_ISA scalar
+#endif
+
+/*
+ * Floatx4 and Floatx8 hold 4 or 8 floats and map to SSE2 and AVX2 registers if the compiler targets them.
+ * Otherwise, Floatx4 is a plain array and Floatx8 a pair of Floatx4. Floatx16 exists only with AVX-512. Comparisons return masks (all bits of
+ * a lane set or cleared) of the same type, for select(), any() and all().
+ *
+ * Vec3x4f and Vec3x8f are 4 or 8 Vec3f with one batch per coordinate. Kernels are written once as
+ * templates over the batch type and handle width elements per iteration.
+ */
+namespace simd {
+inline namespace GDV_SIMD_ISA {
+
+#ifdef GDV_SIMD_SSE2
+
+struct Floatx4 {
+    static constexpr int width = 4;
+    __m128 v;
+
+    Floatx4() = default;
+    Floatx4(float s) : v(_mm_set1_ps(s)) {}
+    explicit Floatx4(__m128 v) : v(v) {}
+
+    static Floatx4 load(const float* p) { return Floatx4(_mm_loadu_ps(p)); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend Floatx4 operator+ (Floatx4 a, Floatx4 b) { return Floatx4(_mm_add_ps(a.v, b.v)); }
+    friend Floatx4 operator- (Floatx4 a, Floatx4 b) { return Floatx4(_mm_sub_ps(a.v, b.v)); }
+    friend Floatx4 operator* (Floatx4 a, Floatx4 b) { return Floatx4(_mm_mul_ps(a.v, b.v)); }
+    friend Floatx4 operator/ (Floatx4 a, Floatx4 b) { return Floatx4(_mm_div_ps(a.v, b.v)); }
+    friend Floatx4 operator- (Floatx4 a) { return Floatx4(_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))); }
+    friend Floatx4 operator& (Floatx4 a, Floatx4 b) { return Floatx4(_mm_and_ps(a.v, b.v)); }
+    friend Floatx4 operator| (Floatx4 a, Floatx4 b) { return Floatx4(_mm_or_ps(a.v, b.v)); }
+    friend Floatx4 operator^ (Floatx4 a, Floatx4 b) { return Floatx4(_mm_xor_ps(a.v, b.v)); }
+    friend Floatx4 operator< (Floatx4 a, Floatx4 b) { return Floatx4(_mm_cmplt_ps(a.v, b.v)); }
+    friend Floatx4 operator<= (Floatx4 a, Floatx4 b) { return Floatx4(_mm_cmple_ps(a.v, b.v)); }
+    friend Floatx4 operator> (Floatx4 a, Floatx4 b) { return Floatx4(_mm_cmpgt_ps(a.v, b.v)); }
+    friend Floatx4 operator>= (Floatx4 a, Floatx4 b) { return Floatx4(_mm_cmpge_ps(a.v, b.v)); }
+    friend Floatx4 operator== (Floatx4 a, Floatx4 b) { return Floatx4(_mm_cmpeq_ps(a.v, b.v)); }
+
+    friend Floatx4 min(Floatx4 a, Floatx4 b) { return Floatx4(_mm_min_ps(a.v, b.v)); }
+    friend Floatx4 max(Floatx4 a, Floatx4 b) { return Floatx4(_mm_max_ps(a.v, b.v)); }
+    friend Floatx4 sqrt(Floatx4 a) { return Floatx4(_mm_sqrt_ps(a.v)); }
+    friend Floatx4 abs(Floatx4 a) { return Floatx4(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+    // a * b + c
+    friend Floatx4 fma(Floatx4 a, Floatx4 b, Floatx4 c) { return a * b + c; }
+    // mask ? a : b
+#ifdef GDV_SIMD_SSE41
+    friend Floatx4 select(Floatx4 mask, Floatx4 a, Floatx4 b) { return Floatx4(_mm_blendv_ps(b.v, a.v, mask.v)); }
+    friend Floatx4 round(Floatx4 a) { return Floatx4(_mm_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); }
+#else
+    friend Floatx4 select(Floatx4 mask, Floatx4 a, Floatx4 b) { return Floatx4(_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))); }
+    // to the nearest integer, for |a| < 2^31
+    friend Floatx4 round(Floatx4 a) { return Floatx4(_mm_cvtepi32_ps(_mm_cvtps_epi32(a.v))); }
+#endif
+    // bit i is set if lane i of the mask is set
+    friend int movemask(Floatx4 mask) { return _mm_movemask_ps(mask.v); }
+    // initial estimate of rsqrt, refined by simd::rsqrt()
+    friend Floatx4 rsqrtEstimate(Floatx4 a) { return Floatx4(_mm_rsqrt_ps(a.v)); }
+};
+
+#else
+
+struct Floatx4 {
+    static constexpr int width = 4;
+    float v[4];
+
+    Floatx4() = default;
+    Floatx4(float s) : v{s, s, s, s} {}
+
+    static Floatx4 load(const float* p) { Floatx4 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+    void store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+
+    template <typename Op>
+    static Floatx4 apply(Floatx4 a, Floatx4 b, Op op) { Floatx4 r; for (int i = 0; i < 4; ++i) r.v[i] = op(a.v[i], b.v[i]); return r; }
+    template <typename Op>
+    static Floatx4 applyBits(Floatx4 a, Floatx4 b, Op op) {
+        Floatx4 r;
+        for (int i = 0; i < 4; ++i) {
+            uint32_t x, y;
+            std::memcpy(&x, &a.v[i], 4);
+            std::memcpy(&y, &b.v[i], 4);
+            const uint32_t z = op(x, y);
+            std::memcpy(&r.v[i], &z, 4);
+        }
+        return r;
+    }
+    static float mask(bool set) { const uint32_t bits = set ? 0xffffffffu : 0u; float f; std::memcpy(&f, &bits, 4); return f; }
+
+    friend Floatx4 operator+ (Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+    friend Floatx4 operator- (Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+    friend Floatx4 operator* (Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+    friend Floatx4 operator/ (Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return x / y; }); }
+    friend Floatx4 operator- (Floatx4 a) { return apply(a, a, [](float x, float) { return -x; }); }
+    friend Floatx4 operator& (Floatx4 a, Floatx4 b) { return applyBits(a, b, [](uint32_t x, uint32_t y) { return x & y; }); }
+    friend Floatx4 operator| (Floatx4 a, Floatx4 b) { return applyBits(a, b, [](uint32_t x, uint32_t y) { return x | y; }); }
+    friend Floatx4 operator^ (Floatx4 a, Floatx4 b) { return applyBits(a, b, [](uint32_t x, uint32_t y) { return x ^ y; }); }
+    friend Floatx4 operator< (Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return mask(x < y); }); }
+    friend Floatx4 operator<= (Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return mask(x <= y); }); }
+    friend Floatx4 operator> (Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return mask(x > y); }); }
+    friend Floatx4 operator>= (Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return mask(x >= y); }); }
+    friend Floatx4 operator== (Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return mask(x == y); }); }
+
+    friend Floatx4 min(Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return x < y ? x : y; }); }
+    friend Floatx4 max(Floatx4 a, Floatx4 b) { return apply(a, b, [](float x, float y) { return x > y ? x : y; }); }
+    friend Floatx4 sqrt(Floatx4 a) { return apply(a, a, [](float x, float) { return std::sqrt(x); }); }
+    friend Floatx4 abs(Floatx4 a) { return apply(a, a, [](float x, float) { return std::fabs(x); }); }
+    friend Floatx4 fma(Floatx4 a, Floatx4 b, Floatx4 c) { return a * b + c; }
+    friend Floatx4 select(Floatx4 mask, Floatx4 a, Floatx4 b) { return (mask & a) | applyBits(mask, b, [](uint32_t m, uint32_t y) { return ~m & y; }); }
+    friend Floatx4 round(Floatx4 a) { return apply(a, a, [](float x, float) { return std::nearbyint(x); }); }
+    friend int movemask(Floatx4 mask) {
+        int bits = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint32_t x;
+            std::memcpy(&x, &mask.v[i], 4);
+            bits |= static_cast<int>(x >> 31) << i;
+        }
+        return bits;
+    }
+    friend Floatx4 rsqrtEstimate(Floatx4 a) { return apply(a, a, [](float x, float) { return 1.0f / std::sqrt(x); }); }
+};
+
+#endif // GDV_SIMD_SSE2
+
+#ifdef GDV_SIMD_AVX2
+
+struct Floatx8 {
+    static constexpr int width = 8;
+    __m256 v;
+
+    Floatx8() = default;
+    Floatx8(float s) : v(_mm256_set1_ps(s)) {}
+    explicit Floatx8(__m256 v) : v(v) {}
+
+    static Floatx8 load(const float* p) { return Floatx8(_mm256_loadu_ps(p)); }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend Floatx8 operator+ (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_add_ps(a.v, b.v)); }
+    friend Floatx8 operator- (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_sub_ps(a.v, b.v)); }
+    friend Floatx8 operator* (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_mul_ps(a.v, b.v)); }
+    friend Floatx8 operator/ (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_div_ps(a.v, b.v)); }
+    friend Floatx8 operator- (Floatx8 a) { return Floatx8(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))); }
+    friend Floatx8 operator& (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_and_ps(a.v, b.v)); }
+    friend Floatx8 operator| (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_or_ps(a.v, b.v)); }
+    friend Floatx8 operator^ (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_xor_ps(a.v, b.v)); }
+    friend Floatx8 operator< (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+    friend Floatx8 operator<= (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)); }
+    friend Floatx8 operator> (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+    friend Floatx8 operator>= (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)); }
+    friend Floatx8 operator== (Floatx8 a, Floatx8 b) { return Floatx8(_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)); }
+
+    friend Floatx8 min(Floatx8 a, Floatx8 b) { return Floatx8(_mm256_min_ps(a.v, b.v)); }
+    friend Floatx8 max(Floatx8 a, Floatx8 b) { return Floatx8(_mm256_max_ps(a.v, b.v)); }
+    friend Floatx8 sqrt(Floatx8 a) { return Floatx8(_mm256_sqrt_ps(a.v)); }
+    friend Floatx8 abs(Floatx8 a) { return Floatx8(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)); }
+#ifdef __FMA__
+    friend Floatx8 fma(Floatx8 a, Floatx8 b, Floatx8 c) { return Floatx8(_mm256_fmadd_ps(a.v, b.v, c.v)); }
+#else
+    friend Floatx8 fma(Floatx8 a, Floatx8 b, Floatx8 c) { return a * b + c; }
+#endif
+    friend Floatx8 select(Floatx8 mask, Floatx8 a, Floatx8 b) { return Floatx8(_mm256_blendv_ps(b.v, a.v, mask.v)); }
+    friend Floatx8 round(Floatx8 a) { return Floatx8(_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); }
+    friend int movemask(Floatx8 mask) { return _mm256_movemask_ps(mask.v); }
+    friend Floatx8 rsqrtEstimate(Floatx8 a) { return Floatx8(_mm256_rsqrt_ps(a.v)); }
+};
+
+#else
+
+// two Floatx4, so the same kernels run 8 wide without AVX2
+struct Floatx8 {
+    static constexpr int width = 8;
+    Floatx4 lo, hi;
+
+    Floatx8() = default;
+    Floatx8(float s) : lo(s), hi(s) {}
+    Floatx8(Floatx4 lo, Floatx4 hi) : lo(lo), hi(hi) {}
+
+    static Floatx8 load(const float* p) { return Floatx8(Floatx4::load(p), Floatx4::load(p + 4)); }
+    void store(float* p) const { lo.store(p); hi.store(p + 4); }
+
+    friend Floatx8 operator+ (Floatx8 a, Floatx8 b) { return Floatx8(a.lo + b.lo, a.hi + b.hi); }
+    friend Floatx8 operator- (Floatx8 a, Floatx8 b) { return Floatx8(a.lo - b.lo, a.hi - b.hi); }
+    friend Floatx8 operator* (Floatx8 a, Floatx8 b) { return Floatx8(a.lo * b.lo, a.hi * b.hi); }
+    friend Floatx8 operator/ (Floatx8 a, Floatx8 b) { return Floatx8(a.lo / b.lo, a.hi / b.hi); }
+    friend Floatx8 operator- (Floatx8 a) { return Floatx8(-a.lo, -a.hi); }
+    friend Floatx8 operator& (Floatx8 a, Floatx8 b) { return Floatx8(a.lo & b.lo, a.hi & b.hi); }
+    friend Floatx8 operator| (Floatx8 a, Floatx8 b) { return Floatx8(a.lo | b.lo, a.hi | b.hi); }
+    friend Floatx8 operator^ (Floatx8 a, Floatx8 b) { return Floatx8(a.lo ^ b.lo, a.hi ^ b.hi); }
+    friend Floatx8 operator< (Floatx8 a, Floatx8 b) { return Floatx8(a.lo < b.lo, a.hi < b.hi); }
+    friend Floatx8 operator<= (Floatx8 a, Floatx8 b) { return Floatx8(a.lo <= b.lo, a.hi <= b.hi); }
+    friend Floatx8 operator> (Floatx8 a, Floatx8 b) { return Floatx8(a.lo > b.lo, a.hi > b.hi); }
+    friend Floatx8 operator>= (Floatx8 a, Floatx8 b) { return Floatx8(a.lo >= b.lo, a.hi >= b.hi); }
+    friend Floatx8 operator== (Floatx8 a, Floatx8 b) { return Floatx8(a.lo == b.lo, a.hi == b.hi); }
+
+    friend Floatx8 min(Floatx8 a, Floatx8 b) { return Floatx8(min(a.lo, b.lo), min(a.hi, b.hi)); }
+    friend Floatx8 max(Floatx8 a, Floatx8 b) { return Floatx8(max(a.lo, b.lo), max(a.hi, b.hi)); }
+    friend Floatx8 sqrt(Floatx8 a) { return Floatx8(sqrt(a.lo), sqrt(a.hi)); }
+    friend Floatx8 abs(Floatx8 a) { return Floatx8(abs(a.lo), abs(a.hi)); }
+    friend Floatx8 fma(Floatx8 a, Floatx8 b, Floatx8 c) { return Floatx8(fma(a.lo, b.lo, c.lo), fma(a.hi, b.hi, c.hi)); }
+    friend Floatx8 select(Floatx8 mask, Floatx8 a, Floatx8 b) { return Floatx8(select(mask.lo, a.lo, b.lo), select(mask.hi, a.hi, b.hi)); }
+    friend Floatx8 round(Floatx8 a) { return Floatx8(round(a.lo), round(a.hi)); }
+    friend int movemask(Floatx8 mask) { return movemask(mask.lo) | (movemask(mask.hi) << 4); }
+    friend Floatx8 rsqrtEstimate(Floatx8 a) { return Floatx8(rsqrtEstimate(a.lo), rsqrtEstimate(a.hi)); }
+};
+
+#endif // GDV_SIMD_AVX2
+
+#ifdef GDV_SIMD_AVX512
+
+// Only with AVX-512F and DQ. Comparisons expand the mask registers to lanes of all bits set, like SSE and AVX.
+struct Floatx16 {
+    static constexpr int width = 16;
+    __m512 v;
+
+    Floatx16() = default;
+    Floatx16(float s) : v(_mm512_set1_ps(s)) {}
+    explicit Floatx16(__m512 v) : v(v) {}
+    static Floatx16 fromMask(__mmask16 k) { return Floatx16(_mm512_castsi512_ps(_mm512_movm_epi32(k))); }
+    __mmask16 toMask() const { return _mm512_movepi32_mask(_mm512_castps_si512(v)); }
+
+    static Floatx16 load(const float* p) { return Floatx16(_mm512_loadu_ps(p)); }
+    void store(float* p) const { _mm512_storeu_ps(p, v); }
+
+    friend Floatx16 operator+ (Floatx16 a, Floatx16 b) { return Floatx16(_mm512_add_ps(a.v, b.v)); }
+    friend Floatx16 operator- (Floatx16 a, Floatx16 b) { return Floatx16(_mm512_sub_ps(a.v, b.v)); }
+    friend Floatx16 operator* (Floatx16 a, Floatx16 b) { return Floatx16(_mm512_mul_ps(a.v, b.v)); }
+    friend Floatx16 operator/ (Floatx16 a, Floatx16 b) { return Floatx16(_mm512_div_ps(a.v, b.v)); }
+    friend Floatx16 operator- (Floatx16 a) { return Floatx16(_mm512_xor_ps(a.v, _mm512_set1_ps(-0.0f))); }
+    friend Floatx16 operator& (Floatx16 a, Floatx16 b) { return Floatx16(_mm512_and_ps(a.v, b.v)); }
+    friend Floatx16 operator| (Floatx16 a, Floatx16 b) { return Floatx16(_mm512_or_ps(a.v, b.v)); }
+    friend Floatx16 operator^ (Floatx16 a, Floatx16 b) { return Floatx16(_mm512_xor_ps(a.v, b.v)); }
+    friend Floatx16 operator< (Floatx16 a, Floatx16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ)); }
+    friend Floatx16 operator<= (Floatx16 a, Floatx16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ)); }
+    friend Floatx16 operator> (Floatx16 a, Floatx16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ)); }
+    friend Floatx16 operator>= (Floatx16 a, Floatx16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ)); }
+    friend Floatx16 operator== (Floatx16 a, Floatx16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ)); }
+
+    friend Floatx16 min(Floatx16 a, Floatx16 b) { return Floatx16(_mm512_min_ps(a.v, b.v)); }
+    friend Floatx16 max(Floatx16 a, Floatx16 b) { return Floatx16(_mm512_max_ps(a.v, b.v)); }
+    friend Floatx16 sqrt(Floatx16 a) { return Floatx16(_mm512_sqrt_ps(a.v)); }
+    friend Floatx16 abs(Floatx16 a) { return Floatx16(_mm512_abs_ps(a.v)); }
+    friend Floatx16 fma(Floatx16 a, Floatx16 b, Floatx16 c) { return Floatx16(_mm512_fmadd_ps(a.v, b.v, c.v)); }
+    friend Floatx16 select(Floatx16 mask, Floatx16 a, Floatx16 b) { return Floatx16(_mm512_mask_blend_ps(mask.toMask(), b.v, a.v)); }
+    friend Floatx16 round(Floatx16 a) { return Floatx16(_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); }
+    friend int movemask(Floatx16 mask) { return mask.toMask(); }
+    friend Floatx16 rsqrtEstimate(Floatx16 a) { return Floatx16(_mm512_rsqrt14_ps(a.v)); }
+};
+
+#endif // GDV_SIMD_AVX512
+
+// the widest batch of the instruction set this file is compiled for
+#if defined(GDV_SIMD_AVX512)
+using FloatxN = Floatx16;
+#elif defined(GDV_SIMD_AVX2)
+using FloatxN = Floatx8;
+#else
+using FloatxN = Floatx4;
+#endif
+
+template <typename F> bool any(F mask) { return movemask(mask) != 0; }
+template <typename F> bool all(F mask) { return movemask(mask) == (1 << F::width) - 1; }
+
+// ---------------------------------------------------------------------------
+// Approximations. The error bounds are the largest deviations from the float
+// functions of <cmath> measured over the stated ranges.
+// ---------------------------------------------------------------------------
+
+// 1 / sqrt(a), estimate refined by one Newton step. Relative error below 3e-7 for normal positive a.
+template <typename F>
+F rsqrt(F a)
+{
+    const F y = rsqrtEstimate(a);
+    return y * fma(F(-0.5f) * a, y * y, F(1.5f));
+}
+
+// atan2(y, x) in [-pi, pi] with a minimax polynomial of degree 11. Absolute error below 2e-6,
+// atan2(0, 0) is 0.
+template <typename F>
+F atan2(F y, F x)
+{
+    const F ax = abs(x), ay = abs(y);
+    const F maxAbs = max(ax, ay);
+    const F a = min(ax, ay) / max(maxAbs, F(1e-30f));
+    const F s = a * a;
+    F r = fma(F(-0.01172120f), s, F(0.05265332f));
+    r = fma(r, s, F(-0.11643287f));
+    r = fma(r, s, F(0.19354346f));
+    r = fma(r, s, F(-0.33262347f));
+    r = fma(r, s, F(0.99997726f));
+    r = r * a;
+    r = select(ay > ax, F(1.57079637f) - r, r);
+    r = select(x < F(0.0f), F(3.14159274f) - r, r);
+    return select(y < F(0.0f), -r, r);
+}
+
+// asin(a) for a in [-1, 1] (Abramowitz and Stegun 4.4.46). Absolute error below 5e-7.
+template <typename F>
+F asin(F a)
+{
+    const F x = abs(a);
+    F p = fma(F(-0.0012624911f), x, F(0.0066700901f));
+    p = fma(p, x, F(-0.0170881256f));
+    p = fma(p, x, F(0.0308918810f));
+    p = fma(p, x, F(-0.0501743046f));
+    p = fma(p, x, F(0.0889789874f));
+    p = fma(p, x, F(-0.2145988016f));
+    p = fma(p, x, F(1.5707963050f));
+    const F r = F(1.57079637f) - sqrt(max(F(1.0f) - x, F(0.0f))) * p;
+    return select(a < F(0.0f), -r, r);
+}
+
+// sin(a) and cos(a). The argument is reduced to [-pi/4, pi/4], then polynomials of Cephes' sinf and cosf
+// are evaluated. Absolute error below 2e-7 for |a| <= 8192, the error grows with |a| beyond that.
+template <typename F>
+void sincos(F a, F& sine, F& cosine)
+{
+    const F k = round(a * F(0.636619772f)); // a / (pi/2)
+    // pi/2 split into three parts, so k * part is exact
+    F r = fma(k, F(-1.5703125f), a);
+    r = fma(k, F(-4.837512969970703125e-4f), r);
+    r = fma(k, F(-7.54978995489188216e-8f), r);
+    const F r2 = r * r;
+    F s = fma(F(-1.9515295891e-4f), r2, F(8.3321608736e-3f));
+    s = fma(s, r2, F(-1.6666654611e-1f));
+    s = fma(s * r2, r, r);
+    F c = fma(F(2.443315711809948e-5f), r2, F(-1.388731625493765e-3f));
+    c = fma(c, r2, F(4.166664568298827e-2f));
+    c = fma(c * r2, r2, fma(F(-0.5f), r2, F(1.0f)));
+    // quadrant q = k mod 4
+    const F q = k - F(4.0f) * round(k * F(0.25f) - F(0.375f));
+    const F odd = (q == F(1.0f)) | (q == F(3.0f));
+    const F sinNegative = q >= F(2.0f);
+    const F cosNegative = (q == F(1.0f)) | (q == F(2.0f));
+    const F sinValue = select(odd, c, s), cosValue = select(odd, s, c);
+    sine = select(sinNegative, -sinValue, sinValue);
+    cosine = select(cosNegative, -cosValue, cosValue);
+}
+
+template <typename F> F sin(F a) { F s, c; sincos(a, s, c); return s; }
+template <typename F> F cos(F a) { F s, c; sincos(a, s, c); return c; }
+
+// ---------------------------------------------------------------------------
+// Vec3 batches
+// ---------------------------------------------------------------------------
+
+template <typename F>
+struct Vec3xN {
+    static constexpr int width = F::width;
+    F x, y, z;
+
+    Vec3xN() = default;
+    Vec3xN(F x, F y, F z) : x(x), y(y), z(z) {}
+    Vec3xN(const Vec3f& v) : x(v.x()), y(v.y()), z(v.z()) {}
+
+    static Vec3xN loadSoA(const float* x, const float* y, const float* z) { return Vec3xN(F::load(x), F::load(y), F::load(z)); }
+    void storeSoA(float* x, float* y, float* z) const { this->x.store(x); this->y.store(y); this->z.store(z); }
+
+    // width consecutive Vec3f. With count < width only count are read and the other lanes are zero.
+    static Vec3xN loadAoS(const Vec3f* v, int count = width) {
+        alignas(64) float xs[width] = {}, ys[width] = {}, zs[width] = {};
+        for (int i = 0; i < count; ++i) {
+            xs[i] = v[i].x();
+            ys[i] = v[i].y();
+            zs[i] = v[i].z();
+        }
+        return loadSoA(xs, ys, zs);
+    }
+    void storeAoS(Vec3f* v, int count = width) const {
+        alignas(64) float xs[width], ys[width], zs[width];
+        storeSoA(xs, ys, zs);
+        for (int i = 0; i < count; ++i)
+            v[i] = Vec3f(xs[i], ys[i], zs[i]);
+    }
+
+    friend Vec3xN operator+ (const Vec3xN& a, const Vec3xN& b) { return Vec3xN(a.x + b.x, a.y + b.y, a.z + b.z); }
+    friend Vec3xN operator- (const Vec3xN& a, const Vec3xN& b) { return Vec3xN(a.x - b.x, a.y - b.y, a.z - b.z); }
+    friend Vec3xN operator* (const Vec3xN& a, F f) { return Vec3xN(a.x * f, a.y * f, a.z * f); }
+    friend Vec3xN operator* (F f, const Vec3xN& a) { return a * f; }
+    // dot product, like Vec3
+    friend F operator* (const Vec3xN& a, const Vec3xN& b) { return fma(a.x, b.x, fma(a.y, b.y, a.z * b.z)); }
+    Vec3xN& operator+= (const Vec3xN& b) { return *this = *this + b; }
+    Vec3xN& operator-= (const Vec3xN& b) { return *this = *this - b; }
+
+    F sqlength() const { return *this * *this; }
+    F length() const { return sqrt(sqlength()); }
+    // like Vec3::normalized(), vectors shorter than EPS stay unchanged. Uses rsqrt().
+    Vec3xN normalized() const {
+        const F l2 = sqlength();
+        const F scale = select(l2 < F(EPS * EPS), F(1.0f), rsqrt(l2));
+        return *this * scale;
+    }
+
+    friend Vec3xN cross(const Vec3xN& a, const Vec3xN& b) {
+        return Vec3xN(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+    }
+    friend Vec3xN min(const Vec3xN& a, const Vec3xN& b) { return Vec3xN(min(a.x, b.x), min(a.y, b.y), min(a.z, b.z)); }
+    friend Vec3xN max(const Vec3xN& a, const Vec3xN& b) { return Vec3xN(max(a.x, b.x), max(a.y, b.y), max(a.z, b.z)); }
+    friend Vec3xN select(F mask, const Vec3xN& a, const Vec3xN& b) {
+        return Vec3xN(select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z));
+    }
+};
+
+using Vec3x4f = Vec3xN<Floatx4>;
+using Vec3x8f = Vec3xN<Floatx8>;
+using Vec3xNf = Vec3xN<FloatxN>;
+
+// smallest and largest lane, e.g. to finish a bounding box
+template <typename F>
+void horizontalMinMax(F a, float& smallest, float& largest)
+{
+    alignas(64) float lanes[F::width];
+    a.store(lanes);
+    for (int i = 0; i < F::width; ++i) {
+        smallest = std::fmin(smallest, lanes[i]);
+        largest = std::fmax(largest, lanes[i]);
+    }
+}
+
+} // namespace GDV_SIMD_ISA
+
+} // namespace simd
+
+#endif // VEC3SIMD_H
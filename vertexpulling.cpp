@@ -0,0 +1,259 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Meshes in buffer textures, drawn by fetching their attributes    //
+//          in the vertex shader (Shader/pull.vert)                          //
+// ========================================================================= //
+
+#include <algorithm>
+
+#include "hitchdetector.h"
+#include "log.h"
+#include "meshdata.h"
+#include "profiler.h"
+#include "renderstate.h"
+#include "trianglemesh.h"
+#include "vertexpulling.h"
+
+VertexPullBuffers::~VertexPullBuffers()
+{
+    release();
+}
+
+VertexPullBuffers::Mesh VertexPullBuffers::add(const MeshData &data)
+{
+    Mesh mesh;
+    if (data.vertices.empty() || data.triangles.empty())
+        return mesh;
+    DrawRecord record{};
+    record.firstFloat = static_cast<GLint>(vertices.size());
+    record.firstIndex = static_cast<GLint>(indices.size());
+    write(record, data);
+    mesh.drawIndex = static_cast<int>(draws.size());
+    mesh.indexCount = static_cast<unsigned int>(3 * data.triangles.size());
+    mesh.hasColors = record.colorOffset >= 0;
+    drawDirty = std::min(drawDirty, draws.size());
+    draws.push_back(record);
+    allocations.push_back({vertices.size() - record.firstFloat, indices.size() - record.firstIndex});
+    return mesh;
+}
+
+void VertexPullBuffers::update(Mesh &mesh, const MeshData &data)
+{
+    if (!mesh.valid())
+    {
+        mesh = add(data);
+        return;
+    }
+    if (data.vertices.empty() || data.triangles.empty())
+    {
+        mesh.indexCount = 0;
+        return;
+    }
+    DrawRecord &record = draws[mesh.drawIndex];
+    Allocation &allocation = allocations[mesh.drawIndex];
+    const size_t floatsPerVertex = 6 + (data.colors.size() == data.vertices.size() ? 3 : 0)
+                                   + (data.texCoords.size() == data.vertices.size() || data.texCoordsPending ? 2 : 0);
+    if (data.vertices.size() * floatsPerVertex > allocation.floats || 3 * data.triangles.size() > allocation.indices)
+    {
+        // the old range stays unused until clear()
+        record.firstFloat = static_cast<GLint>(vertices.size());
+        record.firstIndex = static_cast<GLint>(indices.size());
+        allocation = {data.vertices.size() * floatsPerVertex, 3 * data.triangles.size()};
+    }
+    write(record, data);
+    drawDirty = std::min(drawDirty, static_cast<size_t>(mesh.drawIndex));
+    mesh.indexCount = static_cast<unsigned int>(3 * data.triangles.size());
+    mesh.hasColors = record.colorOffset >= 0;
+}
+
+void VertexPullBuffers::write(DrawRecord &record, const MeshData &data)
+{
+    // texture coordinates of loadOFF are only calculated on demand, see TriangleMesh::releaseCPUData()
+    const MeshData *source = &data;
+    MeshData prepared;
+    if (data.texCoordsPending || data.normals.size() != data.vertices.size())
+    {
+        prepared = data;
+        if (prepared.texCoordsPending)
+            prepared.calculateTexCoordsSphereMapping();
+        if (prepared.normals.size() != prepared.vertices.size())
+            prepared.calculateNormalsByArea();
+        source = &prepared;
+    }
+    const size_t numVertices = source->vertices.size();
+    const bool hasColors = source->colors.size() == numVertices;
+    const bool hasTexCoords = source->texCoords.size() == numVertices;
+    record.normalOffset = 3;
+    record.colorOffset = hasColors ? 6 : -1;
+    record.texCoordOffset = hasTexCoords ? (hasColors ? 9 : 6) : -1;
+    record.floatsPerVertex = 6 + (hasColors ? 3 : 0) + (hasTexCoords ? 2 : 0);
+    record.unused0 = record.unused1 = 0;
+
+    const size_t firstFloat = static_cast<size_t>(record.firstFloat);
+    const size_t firstIndex = static_cast<size_t>(record.firstIndex);
+    vertices.resize(std::max(vertices.size(), firstFloat + numVertices * record.floatsPerVertex));
+    indices.resize(std::max(indices.size(), firstIndex + 3 * source->triangles.size()));
+    float *vertex = vertices.data() + firstFloat;
+    for (size_t v = 0; v < numVertices; ++v)
+    {
+        const Vec3f &p = source->vertices[v];
+        const Vec3f &n = source->normals[v];
+        *vertex++ = p.x();
+        *vertex++ = p.y();
+        *vertex++ = p.z();
+        *vertex++ = n.x();
+        *vertex++ = n.y();
+        *vertex++ = n.z();
+        if (hasColors)
+        {
+            const Vec3f &c = source->colors[v];
+            *vertex++ = c.x();
+            *vertex++ = c.y();
+            *vertex++ = c.z();
+        }
+        if (hasTexCoords)
+        {
+            *vertex++ = source->texCoords[v].u;
+            *vertex++ = source->texCoords[v].v;
+        }
+    }
+    // the indices stay relative to the first vertex of the mesh, pull.vert adds firstFloat
+    GLuint *index = indices.data() + firstIndex;
+    for (const Vec3ui &triangle : source->triangles)
+    {
+        *index++ = triangle[0];
+        *index++ = triangle[1];
+        *index++ = triangle[2];
+    }
+    vertexDirty = std::min(vertexDirty, firstFloat);
+    indexDirty = std::min(indexDirty, firstIndex);
+}
+
+void VertexPullBuffers::clear()
+{
+    vertices.clear();
+    indices.clear();
+    draws.clear();
+    allocations.clear();
+    vertexDirty = indexDirty = drawDirty = 0;
+}
+
+size_t VertexPullBuffers::upload(GLuint buffer, const void *data, size_t count, size_t &capacity, size_t &dirty)
+{
+    f->glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    if (count > capacity)
+    {
+        // room for more meshes, so adding some does not reallocate every time
+        capacity = count + count / 2;
+        f->glBufferData(GL_TEXTURE_BUFFER, capacity * 4, nullptr, GL_STATIC_DRAW);
+        dirty = 0;
+    }
+    size_t bytes = 0;
+    if (dirty < count)
+    {
+        bytes = (count - dirty) * 4;
+        f->glBufferSubData(GL_TEXTURE_BUFFER, dirty * 4, bytes, static_cast<const char *>(data) + dirty * 4);
+    }
+    dirty = count;
+    return bytes;
+}
+
+bool VertexPullBuffers::bind(RenderState &state)
+{
+    if (draws.empty())
+        return false;
+    f = state.getOpenGLFunctions();
+    if (VAO == 0)
+    {
+        // the buffer textures keep referring to their buffer when it is reallocated
+        f->glGenVertexArrays(1, &VAO);
+        f->glGenBuffers(1, &vertexBuffer);
+        f->glGenBuffers(1, &indexBuffer);
+        f->glGenBuffers(1, &drawBuffer);
+        f->glGenTextures(1, &vertexTexture);
+        f->glGenTextures(1, &indexTexture);
+        f->glGenTextures(1, &drawTexture);
+        f->glActiveTexture(GL_TEXTURE0 + vertexUnit);
+        f->glBindTexture(GL_TEXTURE_BUFFER, vertexTexture);
+        f->glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, vertexBuffer);
+        f->glActiveTexture(GL_TEXTURE0 + indexUnit);
+        f->glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+        f->glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indexBuffer);
+        // two texels of 4 ints per draw
+        f->glActiveTexture(GL_TEXTURE0 + drawUnit);
+        f->glBindTexture(GL_TEXTURE_BUFFER, drawTexture);
+        f->glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, drawBuffer);
+        vertexCapacity = indexCapacity = drawCapacity = 0;
+    }
+
+    if (vertexDirty < vertices.size() || indexDirty < indices.size() || drawDirty < draws.size())
+    {
+        PROFILE_SCOPE("vertex pulling upload");
+        size_t bytes = upload(vertexBuffer, vertices.data(), vertices.size(), vertexCapacity, vertexDirty);
+        bytes += upload(indexBuffer, indices.data(), indices.size(), indexCapacity, indexDirty);
+        bytes += upload(drawBuffer, draws.data(), draws.size() * sizeof(DrawRecord) / 4, drawCapacity, drawDirty);
+        f->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        HitchDetector::countUpload(bytes);
+        LOG_DEBUG(Mesh, "vertex pulling: uploaded {} bytes, {} meshes", bytes, draws.size());
+    }
+
+    f->glBindVertexArray(VAO);
+    f->glActiveTexture(GL_TEXTURE0 + vertexUnit);
+    f->glBindTexture(GL_TEXTURE_BUFFER, vertexTexture);
+    f->glActiveTexture(GL_TEXTURE0 + indexUnit);
+    f->glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+    f->glActiveTexture(GL_TEXTURE0 + drawUnit);
+    f->glBindTexture(GL_TEXTURE_BUFFER, drawTexture);
+    f->glActiveTexture(GL_TEXTURE0);
+
+    const GLuint program = state.getCurrentProgram();
+    f->glUniform1i(f->glGetUniformLocation(program, "pullVertices"), vertexUnit);
+    f->glUniform1i(f->glGetUniformLocation(program, "pullIndices"), indexUnit);
+    f->glUniform1i(f->glGetUniformLocation(program, "pullDraws"), drawUnit);
+    drawIndexUniform = f->glGetUniformLocation(program, "drawIndex");
+    useColorArrayUniform = f->glGetUniformLocation(program, "useColorArray");
+    return true;
+}
+
+unsigned int VertexPullBuffers::draw(RenderState &state, const TriangleMesh &material, const Mesh &mesh)
+{
+    if (!mesh.valid() || mesh.indexCount == 0)
+        return 0;
+    f->glUniformMatrix4fv(state.getModelViewUniform(), 1, GL_FALSE, state.getCurrentModelViewMatrix().constData());
+    f->glUniformMatrix3fv(state.getNormalMatrixUniform(), 1, GL_FALSE, state.calculateNormalMatrix().constData());
+    // the empty VAO has no color array, the shader reads the colors itself if useColorArray is set
+    material.bindMaterial(state, false);
+    f->glUniform1i(drawIndexUniform, mesh.drawIndex);
+    f->glUniform1ui(useColorArrayUniform, material.usesColorArray(mesh.hasColors));
+    f->glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(mesh.indexCount));
+    state.countDrawCall();
+    return mesh.indexCount / 3;
+}
+
+void VertexPullBuffers::release()
+{
+    if (f)
+    {
+        if (VAO != 0)
+            f->glDeleteVertexArrays(1, &VAO);
+        for (GLuint *buffer : {&vertexBuffer, &indexBuffer, &drawBuffer})
+        {
+            if (*buffer != 0)
+                f->glDeleteBuffers(1, buffer);
+        }
+        for (GLuint *texture : {&vertexTexture, &indexTexture, &drawTexture})
+        {
+            if (*texture != 0)
+                f->glDeleteTextures(1, texture);
+        }
+    }
+    VAO = vertexBuffer = indexBuffer = drawBuffer = 0;
+    vertexTexture = indexTexture = drawTexture = 0;
+    vertexCapacity = indexCapacity = drawCapacity = 0;
+    vertexDirty = indexDirty = drawDirty = 0;
+    f = nullptr;
+}
@@ -0,0 +1,101 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Meshes in buffer textures, drawn by fetching their attributes    //
+//          in the vertex shader (Shader/pull.vert)                          //
+// ========================================================================= //
+
+#ifndef VERTEXPULLING_H
+#define VERTEXPULLING_H
+
+#include <cstddef>
+#include <vector>
+
+#include "glfunctions.h"
+
+struct MeshData;
+class RenderState;
+class TriangleMesh;
+
+/*
+ * Programmable vertex pulling. The attributes of all meshes are stored in one float buffer, each mesh
+ * interleaved in its own layout (position, normal, and color and texture coordinates if it has them), and
+ * the triangles in one index buffer. Both are read through buffer textures by Shader/pull.vert, which finds
+ * the layout of a mesh in a third buffer texture. A draw is glDrawArrays(GL_TRIANGLES, 0, indexCount) with
+ * one empty VAO for every mesh; only the drawIndex uniform changes between meshes.
+ *
+ * add() and update() only change the CPU copy; bind() uploads what changed. Everything else needs the
+ * OpenGL context of the first bind().
+ */
+class VertexPullBuffers {
+public:
+    // texture units of the buffer textures, above the ones of TriangleMesh::bindMaterial()
+    static constexpr GLuint vertexUnit = 4, indexUnit = 5, drawUnit = 6;
+
+    // handle of a mesh in the buffers
+    struct Mesh {
+        int drawIndex = -1;
+        unsigned int indexCount = 0;
+        bool hasColors = false;
+        bool valid() const { return drawIndex >= 0; }
+    };
+
+    VertexPullBuffers() = default;
+    ~VertexPullBuffers();
+    VertexPullBuffers(const VertexPullBuffers& other) = delete;
+    VertexPullBuffers& operator= (const VertexPullBuffers& other) = delete;
+
+    // appends the vertices and triangles of data. Returns an invalid handle for an empty mesh.
+    Mesh add(const MeshData& data);
+    // Replaces a mesh added before, e.g. a generated terrain or one that got texture coordinates. It is
+    // written in place if it fits, otherwise appended; the handle keeps its drawIndex.
+    void update(Mesh& mesh, const MeshData& data);
+    // removes all meshes, the handles become invalid
+    void clear();
+
+    // Uploads the changes, binds the empty VAO and the buffer textures and sets the samplers of the current
+    // program of state, which has to use pull.vert. Returns false if there is nothing to draw.
+    bool bind(RenderState& state);
+    // draws mesh with the modelView matrix of state and the coloring of material. Needs bind() first.
+    unsigned int draw(RenderState& state, const TriangleMesh& material, const Mesh& mesh);
+    // deletes the GPU objects, the meshes are uploaded again by the next bind()
+    void release();
+
+    size_t getGpuBytes() const { return (vertices.size() + indices.size() + draws.size()) * 4; }
+
+private:
+    // layout of one mesh, two ivec4 texels of the draw buffer
+    struct DrawRecord {
+        GLint firstIndex, firstFloat, floatsPerVertex, normalOffset;
+        GLint colorOffset, texCoordOffset, unused0, unused1;
+    };
+    // Writes the attributes and triangles of data at record.firstFloat and record.firstIndex, which have to
+    // be set, and its layout into the rest of record.
+    void write(DrawRecord& record, const MeshData& data);
+    // Uploads count elements of 4 bytes from data to buffer, from the first dirty one on. The buffer grows by
+    // half if they do not fit. Returns the bytes uploaded.
+    size_t upload(GLuint buffer, const void* data, size_t count, size_t& capacity, size_t& dirty);
+
+    std::vector<float> vertices;
+    std::vector<GLuint> indices;
+    std::vector<DrawRecord> draws;
+    // floats and indices reserved for each draw, update() writes in place if the new mesh fits
+    struct Allocation { size_t floats, indices; };
+    std::vector<Allocation> allocations;
+    // first changed float, index and draw since the last upload
+    size_t vertexDirty = 0, indexDirty = 0, drawDirty = 0;
+
+    GLFunctions* f = nullptr;
+    GLuint VAO = 0;
+    GLuint vertexBuffer = 0, indexBuffer = 0, drawBuffer = 0;
+    GLuint vertexTexture = 0, indexTexture = 0, drawTexture = 0;
+    size_t vertexCapacity = 0, indexCapacity = 0, drawCapacity = 0; // elements in the buffer objects
+
+    // uniforms of the program of the last bind()
+    GLint drawIndexUniform = -1, useColorArrayUniform = -1;
+};
+
+#endif // VERTEXPULLING_H
@@ -0,0 +1,218 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Visibility buffer of instance and triangle IDs, shaded once per  //
+//          pixel by a full-screen resolve                                   //
+// ========================================================================= //
+
+#include <algorithm>
+#include <string>
+
+#include <QMatrix4x4>
+
+#include "log.h"
+#include "profiler.h"
+#include "renderstate.h"
+#include "trianglemesh.h"
+#include "visibilitybuffer.h"
+
+void VisibilityBuffer::initialize(GLFunctions *f, GLuint geometryProgram, GLuint resolveProgram)
+{
+    this->f = f;
+    this->geometryProgram = geometryProgram;
+    this->resolveProgram = resolveProgram;
+    instanceBaseUniform = geometryProgram != 0 ? f->glGetUniformLocation(geometryProgram, "visibilityInstanceBase") : -1;
+    // the instances are one buffer texture, its size limits them as well as the bits of the IDs
+    GLint maxTexels = 0;
+    f->glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    maxBufferInstances = static_cast<uint32_t>(std::max(maxTexels, 0)) / (floatsPerInstance / 4);
+}
+
+void VisibilityBuffer::cleanup()
+{
+    if (!f)
+        return;
+    deleteBuffer();
+    if (instanceBuffer != 0)
+        f->glDeleteBuffers(1, &instanceBuffer);
+    if (instanceTexture != 0)
+        f->glDeleteTextures(1, &instanceTexture);
+    instanceBuffer = instanceTexture = 0;
+    instances.clear();
+    geometryProgram = resolveProgram = 0;
+    instanceBaseUniform = -1;
+    f = nullptr;
+}
+
+bool VisibilityBuffer::prepareBuffer(int width, int height)
+{
+    if (FBO != 0 && width == this->width && height == this->height)
+        return true;
+    deleteBuffer();
+
+    auto createTexture = [&](GLuint &texture, GLint internalFormat, GLenum format, GLenum type) {
+        f->glGenTextures(1, &texture);
+        f->glBindTexture(GL_TEXTURE_2D, texture);
+        f->glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        // integer textures can not be filtered, they are read with texelFetch only
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    };
+    createTexture(idTexture, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT);
+    createTexture(depthTexture, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLint formerFramebuffer = 0;
+    f->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &formerFramebuffer);
+    f->glGenFramebuffers(1, &FBO);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, idTexture, 0);
+    f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    const bool complete = f->glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    f->glBindFramebuffer(GL_FRAMEBUFFER, formerFramebuffer);
+    if (!complete)
+    {
+        LOG_WARNING(Render, "VisibilityBuffer: buffer of {}x{} is incomplete", width, height);
+        deleteBuffer();
+        return false;
+    }
+    this->width = width;
+    this->height = height;
+    return true;
+}
+
+void VisibilityBuffer::deleteBuffer()
+{
+    if (FBO != 0)
+        f->glDeleteFramebuffers(1, &FBO);
+    for (GLuint *texture : {&idTexture, &depthTexture})
+    {
+        if (*texture != 0)
+            f->glDeleteTextures(1, texture);
+        *texture = 0;
+    }
+    FBO = 0;
+    width = height = 0;
+}
+
+bool VisibilityBuffer::beginGeometry(int width, int height, unsigned int maxTriangles)
+{
+    if (!f || geometryProgram == 0 || resolveProgram == 0 || maxTriangles == 0 || !prepareBuffer(width, height))
+        return false;
+    triangleBits = 1;
+    while (triangleBits < 31 && (1u << triangleBits) < maxTriangles)
+        ++triangleBits;
+    // the ID of the last triangle of the last instance would be emptyId
+    maxInstances = std::min((1u << (32 - triangleBits)) - 1, maxBufferInstances);
+    instances.clear();
+    materialTextures.fill(0);
+    materialTextureUsed = 0;
+
+    f->glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    const GLuint clearId[4] = {emptyId, 0, 0, 0};
+    f->glClearBufferuiv(GL_COLOR, 0, clearId);
+    f->glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    return true;
+}
+
+int VisibilityBuffer::materialSlot(GLuint texture)
+{
+    if (texture == 0)
+        return -1;
+    for (int slot = 0; slot < materialTextureUsed; ++slot)
+    {
+        if (materialTextures[slot] == texture)
+            return slot;
+    }
+    if (materialTextureUsed == materialTextureCount)
+        return -1;
+    materialTextures[materialTextureUsed] = texture;
+    return materialTextureUsed++;
+}
+
+unsigned int VisibilityBuffer::draw(RenderState &state, VertexPullBuffers &buffers, const TriangleMesh &material, const VertexPullBuffers::Mesh &mesh)
+{
+    if (!mesh.valid() || mesh.indexCount == 0)
+        return 0;
+    const uint32_t instance = getInstanceCount();
+    if (instance >= maxInstances)
+        return 0;
+    const float *modelView = state.getCurrentModelViewMatrix().constData();
+    instances.insert(instances.end(), modelView, modelView + 16);
+    const Vec3f &color = material.getStaticColor();
+    const float slot = static_cast<float>(materialSlot(material.getMaterialTexture()));
+    const float useColorArray = material.usesColorArray(mesh.hasColors) ? 1.0f : 0.0f;
+    instances.insert(instances.end(), {static_cast<float>(mesh.drawIndex), slot, useColorArray, 0.0f,
+                                       color.x(), color.y(), color.z(), 0.0f});
+    f->glUniform1ui(instanceBaseUniform, instance << triangleBits);
+    return buffers.draw(state, material, mesh);
+}
+
+void VisibilityBuffer::endGeometry(GLuint targetFramebuffer)
+{
+    PROFILE_FUNCTION();
+    if (instanceBuffer == 0)
+    {
+        // the buffer texture keeps referring to the buffer when its store is replaced
+        f->glGenBuffers(1, &instanceBuffer);
+        f->glGenTextures(1, &instanceTexture);
+        f->glBindBuffer(GL_TEXTURE_BUFFER, instanceBuffer);
+        f->glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(floatsPerInstance * sizeof(float)), nullptr, GL_STREAM_DRAW);
+        f->glActiveTexture(GL_TEXTURE0 + instanceUnit);
+        f->glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+        f->glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceBuffer);
+        f->glActiveTexture(GL_TEXTURE0);
+    }
+    // new buffer store every frame, like PointLights::upload()
+    f->glBindBuffer(GL_TEXTURE_BUFFER, instanceBuffer);
+    f->glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(instances.size() * sizeof(float)), instances.data(), GL_STREAM_DRAW);
+    f->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+    f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+    f->glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+}
+
+void VisibilityBuffer::resolve(RenderState &state, VertexPullBuffers &buffers)
+{
+    PROFILE_FUNCTION();
+    if (resolveProgram == 0 || FBO == 0 || instances.empty())
+        return;
+    state.setCurrentProgram(resolveProgram);
+    state.setLightUniform();
+    // the empty VAO of the buffers also serves fullscreen.vert, which reads no attributes
+    if (!buffers.bind(state))
+        return;
+    f->glUniformMatrix4fv(state.getProjectionUniform(), 1, GL_FALSE, state.getCurrentProjectionMatrix().constData());
+    const QMatrix4x4 inverseProjection = state.getCurrentProjectionMatrix().inverted();
+    f->glUniformMatrix4fv(f->glGetUniformLocation(resolveProgram, "inverseProjection"), 1, GL_FALSE, inverseProjection.constData());
+    f->glUniform1ui(f->glGetUniformLocation(resolveProgram, "triangleBits"), triangleBits);
+    f->glUniform1i(f->glGetUniformLocation(resolveProgram, "visibilityIds"), idUnit);
+    f->glUniform1i(f->glGetUniformLocation(resolveProgram, "visibilityInstances"), instanceUnit);
+    for (int slot = 0; slot < materialTextureCount; ++slot)
+    {
+        const std::string name = "materialTexture" + std::to_string(slot);
+        f->glUniform1i(f->glGetUniformLocation(resolveProgram, name.c_str()), firstMaterialUnit + slot);
+        f->glActiveTexture(GL_TEXTURE0 + firstMaterialUnit + slot);
+        f->glBindTexture(GL_TEXTURE_2D, materialTextures[slot]);
+    }
+    f->glActiveTexture(GL_TEXTURE0 + instanceUnit);
+    f->glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+    f->glActiveTexture(GL_TEXTURE0 + idUnit);
+    f->glBindTexture(GL_TEXTURE_2D, idTexture);
+
+    // every pixel once; the pixels without a triangle are discarded
+    f->glDisable(GL_DEPTH_TEST);
+    f->glDrawArrays(GL_TRIANGLES, 0, 3);
+    state.countDrawCall();
+    f->glEnable(GL_DEPTH_TEST);
+    f->glBindVertexArray(0);
+    // the next geometry pass renders into the IDs, it must not be able to sample them
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,106 @@
+// ========================================================================= //
+// GRIS - Graphisch Interaktive Systeme                                      //
+// Technische Universität Darmstadt                                          //
+// Fraunhoferstrasse 5                                                       //
+// D-64283 Darmstadt, Germany                                                //
+//                                                                           //
+// Content: Visibility buffer of instance and triangle IDs, shaded once per  //
+//          pixel by a full-screen resolve                                   //
+// ========================================================================= //
+
+#ifndef VISIBILITYBUFFER_H
+#define VISIBILITYBUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glfunctions.h"
+#include "vertexpulling.h"
+
+class RenderState;
+class TriangleMesh;
+
+/*
+ * The geometry pass writes only 4 bytes of color per fragment: (instance << triangleBits) | gl_PrimitiveID
+ * into a GL_R32UI target next to a GL_DEPTH24_STENCIL8 depth buffer, 8 bytes per pixel. triangleBits is
+ * the smallest number of bits for the triangles of the largest mesh, the rest numbers the instances drawn
+ * this frame; draws beyond the last instance ID or the size of a buffer texture are skipped. The meshes are
+ * drawn from VertexPullBuffers with pull.vert and visibility.frag.
+ *
+ * Every draw records an instance of floatsPerInstance floats, streamed into a buffer texture on
+ * instanceUnit: the four columns of its model view matrix, (drawIndex of the pulled mesh, material
+ * texture slot or -1, whether it uses its color array, 0) and (static color, 0). The resolve
+ * (fullscreen.vert, visibility_resolve.frag) then shades every covered pixel exactly once: it fetches the
+ * three vertices of the triangle from the pull buffers, intersects the view ray of the pixel with it for
+ * perspective correct barycentrics, and those of the rays of the neighboring pixels give the derivatives
+ * of the texture coordinates for textureGrad(). The resolve writes no depth; endGeometry() copies it into
+ * the target first.
+ *
+ * At most materialTextureCount different textures per frame are bound to the resolve, on the units from
+ * firstMaterialUnit; instances with further textures fall back to their static color.
+ */
+class VisibilityBuffer
+{
+public:
+    static constexpr GLuint idUnit = 0, firstMaterialUnit = 1;
+    static constexpr int materialTextureCount = 3;
+    // texture unit of the instance buffer texture, above the ones of LightClusters
+    static constexpr GLuint instanceUnit = 10;
+    static constexpr size_t floatsPerInstance = 24;
+    // cleared value of the pixels no triangle covers
+    static constexpr uint32_t emptyId = 0xffffffffu;
+
+    VisibilityBuffer() = default;
+    ~VisibilityBuffer() = default;
+    VisibilityBuffer(const VisibilityBuffer& other) = delete;
+    VisibilityBuffer& operator= (const VisibilityBuffer& other) = delete;
+
+    // The programs stay owned by the caller: the geometry pass (pull.vert, visibility.frag) and the resolve.
+    // Needs a current OpenGL context.
+    void initialize(GLFunctions* f, GLuint geometryProgram, GLuint resolveProgram);
+    // deletes the buffers, needs the context of initialize()
+    void cleanup();
+
+    // Binds the visibility buffer of size width x height and clears it. maxTriangles is the triangle count of
+    // the largest mesh drawn. False if the buffer could not be created, the framebuffer binding is unchanged then.
+    bool beginGeometry(int width, int height, unsigned int maxTriangles);
+    // Draws mesh from buffers like VertexPullBuffers::draw() and records its instance. The geometry program
+    // and the buffers have to be bound. Returns the triangles drawn.
+    unsigned int draw(RenderState& state, VertexPullBuffers& buffers, const TriangleMesh& material, const VertexPullBuffers::Mesh& mesh);
+    // Uploads the instances and copies the depth into targetFramebuffer, which needs a depth and stencil
+    // buffer of the same size and format, and binds it.
+    void endGeometry(GLuint targetFramebuffer);
+    // shades the covered pixels of the current framebuffer, with the current model view matrix as the camera
+    void resolve(RenderState& state, VertexPullBuffers& buffers);
+
+    // bytes of the ID and depth attachments
+    size_t getBufferBytes() const { return static_cast<size_t>(width) * static_cast<size_t>(height) * 8; }
+    // bytes of the instance records of the last frame
+    size_t getInstanceBytes() const { return instances.size() * sizeof(float); }
+    unsigned int getInstanceCount() const { return static_cast<unsigned int>(instances.size() / floatsPerInstance); }
+
+private:
+    GLFunctions* f = nullptr;
+    GLuint geometryProgram = 0, resolveProgram = 0;
+    GLint instanceBaseUniform = -1;
+
+    GLuint FBO = 0, idTexture = 0, depthTexture = 0;
+    int width = 0, height = 0;
+
+    unsigned int triangleBits = 1;
+    uint32_t maxInstances = 0;       // of this frame, limited by the bits of the IDs and the buffer texture
+    uint32_t maxBufferInstances = 0; // instances that fit into a buffer texture
+    std::vector<float> instances;
+    std::array<GLuint, materialTextureCount> materialTextures{};
+    int materialTextureUsed = 0;
+    GLuint instanceBuffer = 0, instanceTexture = 0;
+
+    bool prepareBuffer(int width, int height);
+    void deleteBuffer();
+    // slot of texture among the material textures of this frame, -1 if there is none left
+    int materialSlot(GLuint texture);
+};
+
+#endif // VISIBILITYBUFFER_H